@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "alignment_file.h"
+
+
+#define ALIGNMENT_FILE_MAGIC "arbtkf91-alignment"
+#define ALIGNMENT_FILE_VERSION 1
+
+/* the header is written in native byte order */
+typedef struct
+{
+    char magic[24];
+    int64_t version;
+    int64_t len_A;
+    int64_t len_B;
+    int64_t ncolumns;
+    int64_t certified;
+    double log_probability;
+} alignment_file_header_struct;
+
+
+char *
+alignment_ops_cigar(const unsigned char *ops, slong len)
+{
+    /*
+     * A run of r columns takes at most r + 1 characters,
+     * so two characters per column are always enough.
+     */
+    const char letters[3] = {'M', 'I', 'D'};
+    char *s, *p;
+    slong k, run;
+
+    s = flint_malloc(2 * len + 1);
+    p = s;
+    for (k = 0; k < len; k += run)
+    {
+        run = 1;
+        while (k + run < len && ops[k + run] == ops[k])
+        {
+            run++;
+        }
+        p += sprintf(p, "%ld%c", (long) run, letters[ops[k]]);
+    }
+    *p = '\0';
+    return s;
+}
+
+int
+alignment_file_write(const char *filename,
+        const unsigned char *ops, slong len, slong len_A, slong len_B,
+        double log_probability, int certified)
+{
+    /*
+     * Write the alignment to a temporary file and then rename it,
+     * so that readers never see a partially written file.
+     * Return nonzero on failure.
+     */
+    alignment_file_header_struct header;
+    unsigned char *packed;
+    char *tmpname;
+    FILE *fout;
+    slong k, nbytes;
+    int code;
+
+    memset(&header, 0, sizeof(header));
+    strncpy(header.magic, ALIGNMENT_FILE_MAGIC, sizeof(header.magic) - 1);
+    header.version = ALIGNMENT_FILE_VERSION;
+    header.len_A = len_A;
+    header.len_B = len_B;
+    header.ncolumns = len;
+    header.certified = certified;
+    header.log_probability = log_probability;
+
+    nbytes = (len + 3) / 4;
+    packed = flint_calloc(nbytes + 1, 1);
+    for (k = 0; k < len; k++)
+    {
+        packed[k / 4] |= (unsigned char) (ops[k] << (2 * (k % 4)));
+    }
+
+    tmpname = flint_malloc(strlen(filename) + 5);
+    strcpy(tmpname, filename);
+    strcat(tmpname, ".tmp");
+
+    fout = fopen(tmpname, "wb");
+    if (fout == NULL)
+    {
+        fprintf(stderr, "failed to open %s for writing\n", tmpname);
+        flint_free(packed);
+        flint_free(tmpname);
+        return 1;
+    }
+
+    code = 0;
+    if (fwrite(&header, sizeof(header), 1, fout) != 1 ||
+        (nbytes && fwrite(packed, 1, nbytes, fout) != (size_t) nbytes))
+    {
+        code = 1;
+    }
+    if (fclose(fout))
+    {
+        code = 1;
+    }
+    if (code)
+    {
+        fprintf(stderr, "failed to write the alignment file %s\n", tmpname);
+    }
+    else if (rename(tmpname, filename))
+    {
+        fprintf(stderr, "failed to rename the alignment file %s\n", tmpname);
+        code = 1;
+    }
+
+    flint_free(packed);
+    flint_free(tmpname);
+    return code;
+}
+
+int
+alignment_file_read(const char *filename,
+        unsigned char **pops, slong *plen, slong *plen_A, slong *plen_B,
+        double *plog_probability, int *pcertified)
+{
+    /*
+     * Read the alignment from the file.
+     * Return nonzero if the file cannot be read, or if its columns
+     * do not account for the recorded sequence lengths.
+     */
+    alignment_file_header_struct header;
+    unsigned char *packed, *ops;
+    FILE *fin;
+    slong k, nbytes, i, j;
+    int code;
+
+    fin = fopen(filename, "rb");
+    if (fin == NULL)
+    {
+        fprintf(stderr, "failed to open %s for reading\n", filename);
+        return 1;
+    }
+
+    if (fread(&header, sizeof(header), 1, fin) != 1 ||
+        strncmp(header.magic, ALIGNMENT_FILE_MAGIC, sizeof(header.magic)) ||
+        header.version != ALIGNMENT_FILE_VERSION)
+    {
+        fprintf(stderr, "%s is not an alignment file\n", filename);
+        fclose(fin);
+        return 1;
+    }
+    if (header.len_A < 0 || header.len_B < 0 ||
+        header.ncolumns < FLINT_MAX(header.len_A, header.len_B) ||
+        header.ncolumns > header.len_A + header.len_B)
+    {
+        fprintf(stderr, "the alignment file %s is corrupt\n", filename);
+        fclose(fin);
+        return 1;
+    }
+
+    nbytes = (header.ncolumns + 3) / 4;
+    packed = flint_malloc(nbytes + 1);
+    ops = flint_malloc(header.ncolumns + 1);
+    code = (nbytes && fread(packed, 1, nbytes, fin) != (size_t) nbytes);
+    fclose(fin);
+
+    /* unpack the columns, and count the characters of each sequence */
+    i = 0;
+    j = 0;
+    for (k = 0; k < header.ncolumns && !code; k++)
+    {
+        ops[k] = (packed[k / 4] >> (2 * (k % 4))) & 3;
+        switch (ops[k])
+        {
+            case DP_OP_MATCH:
+                i++;
+                j++;
+                break;
+            case DP_OP_INSERT:
+                j++;
+                break;
+            case DP_OP_DELETE:
+                i++;
+                break;
+            default:
+                code = 1;
+        }
+    }
+    if (code || i != header.len_A || j != header.len_B)
+    {
+        fprintf(stderr, "the alignment file %s is corrupt\n", filename);
+        flint_free(packed);
+        flint_free(ops);
+        return 1;
+    }
+
+    flint_free(packed);
+    *pops = ops;
+    *plen = (slong) header.ncolumns;
+    *plen_A = (slong) header.len_A;
+    *plen_B = (slong) header.len_B;
+    *plog_probability = header.log_probability;
+    *pcertified = (int) header.certified;
+    return 0;
+}
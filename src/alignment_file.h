@@ -0,0 +1,49 @@
+#ifndef ALIGNMENT_FILE_H
+#define ALIGNMENT_FILE_H
+
+/*
+ * Compact representations of an alignment, given as one DP_OP_* code
+ * per column as written by the traceback, so that long alignments
+ * need not be expanded into two gapped strings.
+ *
+ * A CIGAR string gives the run lengths of the column operations,
+ * with sequence A as the reference, for example "12M1I40M2D7M".
+ *
+ * The binary file starts with a header that records the sequence
+ * lengths, the number of columns, the log probability of the alignment
+ * and whether it was certified to be optimal. The header is followed by
+ * the column operations packed four to a byte, two bits each,
+ * starting with the low bits, which is a quarter of the size of
+ * the operations in memory and an eighth of the gapped strings.
+ */
+
+#include "flint/flint.h"
+
+#include "dp.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the CIGAR string, which must be freed by the caller with flint_free */
+char * alignment_ops_cigar(const unsigned char *ops, slong len);
+
+int alignment_file_write(const char *filename,
+        const unsigned char *ops, slong len, slong len_A, slong len_B,
+        double log_probability, int certified);
+
+/*
+ * The ops array is allocated by the reader, and must be freed
+ * by the caller with flint_free.
+ */
+int alignment_file_read(const char *filename,
+        unsigned char **pops, slong *plen, slong *plen_A, slong *plen_B,
+        double *plog_probability, int *pcertified);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,194 @@
+#include <math.h>
+
+#include "flint/flint.h"
+
+#include "allpairs.h"
+#include "batch.h"
+#include "dp.h"
+#include "tkf91_generator_indices.h"
+#include "unused.h"
+
+
+static void _task(void *userdata, slong index, slong worker);
+static void _emit(void *userdata, slong index);
+
+
+void
+_task(void *userdata, slong index, slong worker)
+{
+    allpairs_struct *s = userdata;
+    const allpairs_pair_struct *pair = s->pairs + index;
+    const slong *A, *B;
+    slong len_A, len_B;
+    const tkf91_generator_indices_struct * generators;
+    solution_t sol;
+    dp_mat_t tableau;
+    request_t req;
+    int status;
+
+    UNUSED(worker);
+
+    A = s->rows->seqs[pair->row];
+    len_A = s->rows->lens[pair->row];
+    B = s->cols->seqs[pair->col];
+    len_B = s->cols->lens[pair->col];
+
+    solution_init(sol, len_A + len_B);
+    if (s->use_tableau)
+    {
+        dp_mat_init(tableau, len_A + 1, len_B + 1);
+        sol->mat = tableau;
+    }
+
+    req->trace = s->trace;
+    req->rtol = 0;
+    req->budget = NULL;
+    req->checkpoint = NULL;
+    req->timing = NULL;
+    req->diagnostics = NULL;
+    req->ctx = s->ctx;
+
+    generators = tkf91_model_context_generators(s->ctx, A, len_A, B, len_B);
+    status = s->f(sol, req, s->ctx->mat, s->ctx->expressions_table,
+            generators, A, len_A, B, len_B);
+
+    s->status[index] = status;
+    s->scores[index] = status ? NAN :
+        arf_get_d(arb_midref(sol->log_probability), ARF_RND_NEAR);
+    if (s->trace && !status)
+    {
+        /* keep the aligned rows until the pair is emitted */
+        s->aligned_a[index] = sol->A;
+        s->aligned_b[index] = sol->B;
+        sol->A = NULL;
+        sol->B = NULL;
+    }
+
+    if (s->use_tableau)
+    {
+        dp_mat_clear(tableau);
+    }
+    solution_clear(sol);
+}
+
+void
+_emit(void *userdata, slong index)
+{
+    allpairs_struct *s = userdata;
+    const allpairs_pair_struct *pair = s->pairs + index;
+
+    if (s->alignments && !s->status[index])
+    {
+        fprintf(s->alignments, "%s\t%s\t%.17g\t%s\t%s\n",
+                s->rows->names[pair->row],
+                s->cols->names[pair->col],
+                s->scores[index],
+                s->aligned_a[index],
+                s->aligned_b[index]);
+    }
+    flint_free(s->aligned_a[index]);
+    flint_free(s->aligned_b[index]);
+    s->aligned_a[index] = NULL;
+    s->aligned_b[index] = NULL;
+}
+
+
+void
+allpairs_init(allpairs_t s, tkf91_model_context_ptr ctx,
+        tkf91_dp_fn f, int use_tableau, int trace,
+        const fasta_struct *rows, const fasta_struct *cols)
+{
+    slong i, j, k, n;
+
+    s->ctx = ctx;
+    s->f = f;
+    s->use_tableau = use_tableau;
+    s->trace = trace;
+    s->rows = rows;
+    s->cols = cols;
+    s->alignments = NULL;
+
+    s->npairs = (rows == cols) ? rows->len * (rows->len - 1) / 2 :
+        rows->len * cols->len;
+    n = FLINT_MAX(1, s->npairs);
+    s->pairs = flint_malloc(n * sizeof(allpairs_pair_struct));
+    s->cost = flint_malloc(n * sizeof(double));
+    s->status = flint_calloc(n, sizeof(int));
+    s->scores = flint_malloc(n * sizeof(double));
+    s->aligned_a = flint_calloc(n, sizeof(char *));
+    s->aligned_b = flint_calloc(n, sizeof(char *));
+
+    k = 0;
+    for (i = 0; i < rows->len; i++)
+    {
+        for (j = (rows == cols) ? i + 1 : 0; j < cols->len; j++)
+        {
+            s->pairs[k].row = i;
+            s->pairs[k].col = j;
+            s->cost[k] = (rows->lens[i] + 1.0) * (cols->lens[j] + 1.0);
+            k++;
+        }
+    }
+}
+
+void
+allpairs_clear(allpairs_t s)
+{
+    flint_free(s->pairs);
+    flint_free(s->cost);
+    flint_free(s->status);
+    flint_free(s->scores);
+    flint_free(s->aligned_a);
+    flint_free(s->aligned_b);
+}
+
+slong
+allpairs_run(allpairs_t s, slong nthreads, FILE *alignments)
+{
+    slong used;
+    s->alignments = alignments;
+    used = batch_run(s->npairs, s->cost, nthreads, BATCH_ORDER_INPUT,
+            _task, _emit, s);
+    s->alignments = NULL;
+    return used;
+}
+
+void
+allpairs_get_matrix(double *m, const allpairs_t s)
+{
+    slong i, j, k, ncols;
+
+    ncols = s->cols->len;
+    for (k = 0; k < s->rows->len * ncols; k++)
+    {
+        m[k] = NAN;
+    }
+    for (k = 0; k < s->npairs; k++)
+    {
+        i = s->pairs[k].row;
+        j = s->pairs[k].col;
+        m[i * ncols + j] = s->scores[k];
+        if (s->rows == s->cols)
+        {
+            m[j * ncols + i] = s->scores[k];
+        }
+    }
+}
+
+int
+allpairs_status(slong *failed, const allpairs_t s)
+{
+    slong k;
+    int status = 0;
+
+    *failed = 0;
+    for (k = s->npairs - 1; k >= 0; k--)
+    {
+        if (s->status[k])
+        {
+            status = s->status[k];
+            (*failed)++;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,95 @@
+#ifndef ALLPAIRS_H
+#define ALLPAIRS_H
+
+/*
+ * Alignment of all pairs of sequences of two FASTA collections.
+ *
+ * If the row and column collections are the same, then only the pairs
+ * above the diagonal are aligned, because the tkf91 model is
+ * time-reversible; otherwise each row sequence is aligned to each
+ * column sequence. The pairs share one model context and are aligned
+ * on a pool of threads (see 'batch.h'), starting with the largest
+ * tableaux. The score of a pair is the log probability of its
+ * alignment, as reported by the solver.
+ */
+
+#include <stdio.h>
+
+#include "flint/flint.h"
+
+#include "tkf91_dp.h"
+#include "tkf91_model_context.h"
+#include "fasta.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    slong row;
+    slong col;
+} allpairs_pair_struct;
+
+typedef struct
+{
+    /* shared inputs, read-only while the workers are running */
+    tkf91_model_context_ptr ctx;
+    tkf91_dp_fn f;
+    int use_tableau;
+    int trace;
+    const fasta_struct *rows;
+    const fasta_struct *cols;
+    allpairs_pair_struct *pairs;
+    double *cost;
+    slong npairs;
+
+    /* results, each entry written by the worker that aligns the pair */
+    int *status;
+    double *scores;
+    char **aligned_a;
+    char **aligned_b;
+
+    /* the alignments file, written by the serialized emit calls */
+    FILE *alignments;
+} allpairs_struct;
+typedef allpairs_struct allpairs_t[1];
+
+/*
+ * Enumerate the pairs to be aligned by the solver f. The tableau is
+ * allocated only if use_tableau is nonzero, and the aligned rows are
+ * kept only if trace is nonzero.
+ */
+void allpairs_init(allpairs_t s, tkf91_model_context_ptr ctx,
+        tkf91_dp_fn f, int use_tableau, int trace,
+        const fasta_struct *rows, const fasta_struct *cols);
+void allpairs_clear(allpairs_t s);
+
+/*
+ * Align the pairs on at most nthreads workers and return the number of
+ * workers that were used. If the alignments file is not NULL, then each
+ * aligned pair is written to it in the order of the pairs, as a line of
+ * tab separated names, log probability and the two aligned sequences.
+ */
+slong allpairs_run(allpairs_t s, slong nthreads, FILE *alignments);
+
+/*
+ * Set the (#rows x #cols) row-major matrix m to the scores, mirrored
+ * for a symmetric collection, with NaN for the entries that are not
+ * computed and for the pairs that failed.
+ */
+void allpairs_get_matrix(double *m, const allpairs_t s);
+
+/*
+ * Return the status of the first pair that failed, or zero,
+ * and set failed to the number of such pairs.
+ */
+int allpairs_status(slong *failed, const allpairs_t s);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -2,9 +2,106 @@
  * Align sequences.
  * Input and output uses json.
  * The output has all of the terms expected by the 'arbtkf91-check' tool.
+ *
+ * If the optional "deadline_ms" input is provided, then the refinement
+ * performed by the 'mag' and 'high' precision solvers stops when the
+ * deadline passes (for the 'auto' portfolio precision too),
+ * and the output gets an additional "certification"
+ * object reporting whether the alignment was certified as optimal,
+ * the last precision level reached, and the number of tableau cells
+ * that remain unresolved.
+ *
+ * If "precision" is not provided but "memory_limit" (bytes) or
+ * "guarantee" ("score" | "alignment" | "certified") is provided,
+ * then the precision and memory strategy are chosen by a planner
+ * and reported in an additional "plan" object. Its "memory" is
+ * "full-tableau", "linear-space" or "checkpointed"; the last one is a
+ * double precision traceback that keeps only about sqrt(len_A) rows
+ * of the tableau at a time. When only the score
+ * is requested, the output has a "log_probability" member instead of
+ * the aligned sequences.
+ *
+ * The high precision solver can save its progress to the file named by
+ * "checkpoint", between refinement rounds and at most once every
+ * "checkpoint_interval" seconds (default 600) during a round.
+ * A run can be continued from such a file with "resume_from".
+ *
+ * With "diagnostics" set to true, the output gets a "diagnostics" array
+ * recording the certification effort of each round of refinement of the
+ * 'high' or 'auto' precision solver: the precision in bits, the numbers
+ * of interesting and unresolved cells and of candidate flags cleared,
+ * and the symbolic consensus failures and where they occurred
+ * (see 'diagnostics.h'). Such requests are not cached.
+ *
+ * The finished tableau can be saved with "tableau_out", and the
+ * alignment can be read from a certified tableau saved by any of the
+ * tools with "tableau_in" instead of being recomputed.
+ *
+ * The optional "output_format" selects how the alignment is written:
+ * "strings" (the default) gives the two gapped sequences, "cigar" gives
+ * a "cigar" string of the column operations with sequence A as the
+ * reference, and "binary" writes the packed column operations to the
+ * file named by "alignment_out" (see 'alignment_file.h'). The compact
+ * formats are written from the traceback without building the gapped
+ * sequences, and they have the "log_probability" of the alignment;
+ * the tableau-based solvers score the path they trace back.
+ *
+ * A single request is read from stdin in large blocks, or from the
+ * memory-mapped file given by --input=FILE, and the sequence strings
+ * are encoded while the json text is scanned (see 'json_stream.h'),
+ * so that very long sequences are not copied.
+ *
+ * With the --jsonl command line option, each line of the input is
+ * a separate request and gets one line of output, written as soon as
+ * the request is finished. The model contexts are cached across
+ * requests, so requests with the same parameters share one context.
+ * In this mode and in the modes below, the cache keeps at most
+ * --contexts=N contexts (8 by default) that are not in use, evicting
+ * the least recently used of them.
+ *
+ * With the --batch option, all of the input lines are read first and
+ * then aligned on a pool of threads (--threads=N, by default one per
+ * processor), starting with the largest tableaux. The output lines are
+ * written in the input order, or as soon as each request is finished
+ * with --order=completion, and each has an additional "batch" object
+ * with the input line index, the worker index and the seconds spent.
+ *
+ * With the --pipeline option, the batch is not read first; instead
+ * the input lines are parsed while earlier lines are being aligned
+ * (--threads=N) and the output lines are serialized and written by
+ * another thread, with bounded queues between the three stages.
+ * The output is as with --batch.
+ *
+ * With --serve=PATH the requests are served on a Unix domain socket
+ * at that path (see 'jsonserver.h') by a pool of threads (--threads=N),
+ * sharing one model context cache for the lifetime of the server.
+ * The latency classes of the server are the precisions, and the
+ * handler statistics report the size and hit counts of the cache.
+ *
+ * An invalid request, or a request that the solver fails to complete,
+ * gets an error response {"error" : string} (see 'runjson.h') instead
+ * of an alignment, so in the modes with many requests the others are
+ * unaffected. With a single request the message is written to stderr
+ * and the exit status is nonzero.
+ *
+ * In any mode, --cache=DIR keeps the results in an on-disk cache
+ * shared with other processes (see 'result_cache.h'), limited to
+ * --cache-bytes=N bytes, and the requests that have been answered
+ * before are not solved again. Requests with a deadline or with
+ * checkpoint, tableau or alignment files are not cached.
+ *
+ * In any mode, --memory installs the heap accounting of 'memstats.h',
+ * and each solved request then gets a "memory" object with the peak heap
+ * bytes, the number and total size of the allocations made by the thread
+ * that answered it, so that the "estimated_bytes" of a plan can be
+ * compared with the real use. The worker threads of the 'auto' precision
+ * are not included, and the answers taken from the result cache have no
+ * "memory" object.
  */
 
+#include <math.h>
 #include <time.h>
+#include <pthread.h>
 
 #include "flint/flint.h"
 #include "flint/fmpq.h"
@@ -12,26 +109,121 @@
 #include "jansson.h"
 
 #include "runjson.h"
+#include "jsonserver.h"
+#include "json_stream.h"
 #include "jsonutil.h"
 #include "tkf91_dp_f.h"
 #include "tkf91_dp_d.h"
 #include "tkf91_dp_r.h"
+#include "tkf91_dp_auto.h"
 #include "tkf91_dp_bound.h"
-#include "tkf91_rgenerators.h"
+#include "tkf91_model_context.h"
 #include "tkf91_generator_indices.h"
 #include "model_params.h"
 #include "json_model_params.h"
+#include "budget.h"
+#include "plan.h"
+#include "checkpoint.h"
+#include "tableau_file.h"
+#include "alignment_file.h"
+#include "json_result_cache.h"
+#include "json_diagnostics.h"
+#include "batch.h"
+#include "memstats.h"
+#include "unused.h"
 
 
+/* the default limit of the model context cache; see --contexts */
+#define ALIGN_CONTEXTS 8
 
-void
-solve(tkf91_dp_fn f, solution_t sol, double rtol, const model_params_t p,
+/* the output formats of the alignment */
+#define OUTPUT_STRINGS 0
+#define OUTPUT_CIGAR 1
+#define OUTPUT_BINARY 2
+
+
+/*
+ * The state shared by the requests of one process. There is no cache
+ * in the single request mode, and the cache lock is NULL unless
+ * the requests run concurrently. A request holds a reference to its
+ * context while it is solving, so no context is evicted while another
+ * request is using it. The results are NULL unless the on-disk result
+ * cache is used.
+ */
+typedef struct
+{
+    tkf91_model_context_cache_ptr cache;
+    pthread_mutex_t *lock;
+    result_cache_ptr results;
+} align_shared_struct;
+typedef align_shared_struct align_shared_t[1];
+
+
+static double _log_probability(const solution_t sol);
+static int _traceback(
+        solution_t sol, const request_t req,
+        fmpz_mat_t mat, expr_ptr * expressions_table,
+        const tkf91_generator_indices_t g,
+        const slong *A, size_t szA,
+        const slong *B, size_t szB);
+
+/*
+ * The log probability of the alignment, or NaN if the solver was
+ * stopped before it had an alignment.
+ */
+double
+_log_probability(const solution_t sol)
+{
+    return arf_get_d(arb_midref(sol->log_probability), ARF_RND_NEAR);
+}
+
+/*
+ * Trace back through a tableau that was read from a file and score
+ * the alignment, in place of a solver.
+ */
+int
+_traceback(
+        solution_t sol, const request_t req,
+        fmpz_mat_t mat, expr_ptr * expressions_table,
+        const tkf91_generator_indices_t g,
+        const slong *A, size_t szA,
+        const slong *B, size_t szB)
+{
+    UNUSED(szA);
+    UNUSED(szB);
+    solution_traceback(sol, A, B);
+    tkf91_dp_score(sol, req, mat, expressions_table, g, A, B);
+    return TKF91_SUCCESS;
+}
+
+
+int
+solve(tkf91_dp_fn f, solution_t sol, int trace, double rtol,
+        budget_ptr budget, checkpoint_ptr checkpoint,
+        diagnostics_ptr diagnostics, tkf91_model_context_t ctx,
         const slong *A, slong len_A, const slong *B, slong len_B);
 
 
 json_t *run(void * userdata, json_t *root);
+json_t *run_sequences(void * userdata, json_t *root,
+        slong *seq_a, slong len_a, slong *seq_b, slong len_b);
+int run_stream(void * userdata, const char *filename);
+double request_cost(json_t *root);
+const char * request_label(json_t *root);
+json_t * shared_stats(void *userdata);
 
 json_t *run(void * userdata, json_t *root)
+{
+    return run_sequences(userdata, root, NULL, 0, NULL, 0);
+}
+
+/*
+ * Run a request whose sequences may already be encoded, in which case
+ * the strings in the json request are ignored and the sequence vectors
+ * are freed with the other temporary data.
+ */
+json_t *run_sequences(void * userdata, json_t *root,
+        slong *seq_a, slong len_a, slong *seq_b, slong len_b)
 {
     json_t *j_out;
     model_params_t p;
@@ -39,110 +231,514 @@ json_t *run(void * userdata, json_t *root)
     slong *A;
     slong *B;
     solution_t sol;
-    int result;
+    int result, status;
     json_t *parameters;
     const char * sequence_a;
     const char * sequence_b;
     const char * precision;
     double rtol;
+    json_int_t deadline_ms;
+    json_int_t memory_limit;
+    const char * guarantee_string;
+    int guarantee, use_plan, trace;
+    memstats_mark_t memory_start;
+    memstats_t memory;
+    plan_t plan;
+    budget_t budget;
+    const char * checkpoint_filename;
+    const char * resume_filename;
+    double checkpoint_interval;
+    checkpoint_t checkpoint;
+    checkpoint_ptr pcheckpoint;
+    const char * tableau_in;
+    const char * tableau_out;
+    const char * output_format_string;
+    const char * alignment_out;
+    int output_format;
+    int use_diagnostics;
+    diagnostics_t diagnostics;
+    result_key_t key;
+    int keyed;
+    result_key_t result_key;
+    int cached;
     json_error_t err;
     size_t flags;
     slong nrows, ncols;
+    dp_mat_t tableau;
+    tkf91_dp_fn f;
+    align_shared_struct *shared;
 
-    if (userdata)
-    {
-        fprintf(stderr, "error: unexpected userdata\n");
-        abort();
-    }
+    /* the userdata is the shared state */
+    shared = userdata;
 
     /* default values of optional json arguments */
     rtol = 0;
     precision = NULL;
+    deadline_ms = -1;
+    memory_limit = -1;
+    guarantee_string = NULL;
+    checkpoint_filename = NULL;
+    resume_filename = NULL;
+    checkpoint_interval = 600;
+    tableau_in = NULL;
+    tableau_out = NULL;
+    output_format_string = NULL;
+    alignment_out = NULL;
+    use_diagnostics = 0;
 
+    /*
+     * The parameters are borrowed from the request. Every invalid
+     * request gets an error response, after which the temporary data
+     * is cleared as after a solve.
+     */
     flags = JSON_STRICT;
     result = json_unpack_ex(root, &err, flags,
-            "{s:O, s:s, s:s, s?F, s?s}",
+            "{s:o, s:s, s:s, s?F, s?s, s?I, s?I, s?s, s?s, s?F, s?s, s?s, s?s, "
+            "s?s, s?s, s?b}",
             "parameters", &parameters,
             "sequence_a", &sequence_a,
             "sequence_b", &sequence_b,
             "rtol", &rtol,
-            "precision", &precision);
+            "precision", &precision,
+            "deadline_ms", &deadline_ms,
+            "memory_limit", &memory_limit,
+            "guarantee", &guarantee_string,
+            "checkpoint", &checkpoint_filename,
+            "checkpoint_interval", &checkpoint_interval,
+            "resume_from", &resume_filename,
+            "tableau_in", &tableau_in,
+            "tableau_out", &tableau_out,
+            "output_format", &output_format_string,
+            "alignment_out", &alignment_out,
+            "diagnostics", &use_diagnostics);
     if (result)
     {
-        fprintf(stderr, "error: on line %d: %s\n", err.line, err.text);
-        abort();
+        flint_free(seq_a);
+        flint_free(seq_b);
+        return json_error_response("on line %d: %s", err.line, err.text);
     }
 
+    /* the heap use of the request starts here */
+    memstats_mark(memory_start);
+
     model_params_init(p);
+    plan_init(plan);
+    budget_init(budget);
+    diagnostics_init(diagnostics);
+    pcheckpoint = NULL;
+    cached = 0;
+    keyed = 0;
+    j_out = NULL;
+
+    /* read the two unaligned sequences */
+
+    if (seq_a)
+    {
+        A = seq_a;
+        len_A = len_a;
+    }
+    else
+    {
+        len_A = strlen(sequence_a);
+        A = flint_malloc(len_A * sizeof(slong));
+        if (_fill_sequence_vector(A, sequence_a, len_A))
+        {
+            j_out = json_error_response("unrecognized nucleotide "
+                    "in sequence_a");
+        }
+    }
+
+    if (seq_b)
+    {
+        B = seq_b;
+        len_B = len_b;
+    }
+    else
+    {
+        len_B = strlen(sequence_b);
+        B = flint_malloc(len_B * sizeof(slong));
+        if (_fill_sequence_vector(B, sequence_b, len_B) && !j_out)
+        {
+            j_out = json_error_response("unrecognized nucleotide "
+                    "in sequence_b");
+        }
+    }
+
+    nrows = len_A + 1;
+    ncols = len_B + 1;
+    solution_init(sol, len_A + len_B);
+    if (j_out)
+    {
+        goto end;
+    }
+    if (!len_A || !len_B)
+    {
+        j_out = json_error_response("expected both sequences "
+                "to have length at least 1");
+        goto end;
+    }
+
+    output_format = OUTPUT_STRINGS;
+    if (output_format_string == NULL ||
+        strcmp(output_format_string, "strings") == 0)
+    {
+        output_format = OUTPUT_STRINGS;
+    }
+    else if (strcmp(output_format_string, "cigar") == 0)
+    {
+        output_format = OUTPUT_CIGAR;
+    }
+    else if (strcmp(output_format_string, "binary") == 0)
+    {
+        output_format = OUTPUT_BINARY;
+    }
+    else
+    {
+        j_out = json_error_response("expected the output format string "
+                "to be one of {strings | cigar | binary}");
+        goto end;
+    }
+    if ((output_format == OUTPUT_BINARY) != (alignment_out != NULL))
+    {
+        j_out = json_error_response("the binary output format requires "
+                "an alignment_out file, and only it uses one");
+        goto end;
+    }
+
     result = _json_get_model_params_ex(p, parameters, &err, flags);
     if (result)
     {
-        fprintf(stderr, "error: on line %d: %s\n", err.line, err.text);
-        abort();
+        j_out = json_error_response("on line %d: %s", err.line, err.text);
+        goto end;
     }
     result = model_params_validate(p);
     if (result)
     {
-        fprintf(stderr, "invalid model parameters\n");
-        abort();
+        j_out = json_error_response("invalid model parameters");
+        goto end;
     }
 
-    /* read the two unaligned sequences */
-
-    len_A = strlen(sequence_a);
-    A = flint_malloc(len_A * sizeof(slong));
-    _fill_sequence_vector(A, sequence_a, len_A);
-
-    len_B = strlen(sequence_b);
-    B = flint_malloc(len_B * sizeof(slong));
-    _fill_sequence_vector(B, sequence_b, len_B);
+    /* look for the result of the same request in the result cache */
+    cached = (shared && shared->results && deadline_ms < 0 &&
+            checkpoint_filename == NULL && resume_filename == NULL &&
+            tableau_in == NULL && tableau_out == NULL &&
+            output_format != OUTPUT_BINARY && !use_diagnostics);
+    if (cached)
+    {
+        char options[256];
+        snprintf(options, sizeof(options), "%s %.17g %lld %s %d",
+                precision ? precision : "", rtol, (long long) memory_limit,
+                guarantee_string ? guarantee_string : "", output_format);
+        result_key_init(result_key, "arbtkf91-align");
+        result_key_params(result_key, p);
+        result_key_slong_vec(result_key, A, len_A);
+        result_key_slong_vec(result_key, B, len_B);
+        result_key_string(result_key, options);
+        j_out = json_result_cache_get(shared->results, result_key);
+        if (j_out)
+        {
+            json_object_set(j_out, "parameters", parameters);
+            goto end;
+        }
+    }
 
-    nrows = len_A + 1;
-    ncols = len_B + 1;
-    solution_init(sol, len_A + len_B);
+    /* let the planner choose the precision if requested */
+    trace = 1;
+    use_plan = (precision == NULL &&
+            (memory_limit >= 0 || guarantee_string != NULL));
+    if (use_plan)
+    {
+        guarantee = PLAN_GUARANTEE_CERTIFIED;
+        if (guarantee_string != NULL &&
+            plan_guarantee_from_string(&guarantee, guarantee_string))
+        {
+            j_out = json_error_response("expected the guarantee string "
+                    "to be one of {score | alignment | certified}");
+            goto end;
+        }
+        if (plan_choose(plan, len_A, len_B, (slong) memory_limit,
+                    guarantee, plan_available_threads()))
+        {
+            j_out = json_error_response("no dynamic programming strategy "
+                    "fits within the memory limit");
+            goto end;
+        }
+        precision = plan->precision;
+        trace = (plan->memory != PLAN_MEMORY_LINEAR_SPACE);
+    }
+    if (output_format != OUTPUT_STRINGS)
+    {
+        if (!trace)
+        {
+            j_out = json_error_response("the %s output format requires "
+                    "an alignment, not only a score", output_format_string);
+            goto end;
+        }
+        sol->ops = flint_malloc(len_A + len_B + 1);
+    }
 
-    /* dispatch, initializing a tableau if necessary */
-    dp_mat_t tableau;
-    tkf91_dp_fn f = NULL;
-    if (precision == NULL) {
-        /* by default use high precision */
+    /* dispatch; the high precision solver is the default */
+    if (precision == NULL || strcmp(precision, "high") == 0) {
         f = tkf91_dp_high;
-        dp_mat_init(tableau, nrows, ncols);
-        sol->mat = tableau;
     }
     else if (strcmp(precision, "float") == 0) {
         f = tkf91_dp_f;
     }
     else if (strcmp(precision, "double") == 0) {
         f = tkf91_dp_d;
+        if (use_plan && plan->memory == PLAN_MEMORY_CHECKPOINTED)
+        {
+            f = tkf91_dp_d_checkpointed;
+        }
     }
     else if (strcmp(precision, "mag") == 0) {
         f = tkf91_dp_mag;
-        dp_mat_init(tableau, nrows, ncols);
-        sol->mat = tableau;
     }
-    else if (strcmp(precision, "high") == 0) {
-        f = tkf91_dp_high;
+    else if (strcmp(precision, "auto") == 0) {
+        f = tkf91_dp_auto;
+    }
+    else {
+        j_out = json_error_response("expected the precision string "
+                "to be one of {float | double | mag | high | auto}");
+        goto end;
+    }
+
+    /* identify the parameters and sequences in checkpoint and tableau files */
+    tableau_file_key_init(key, p, A, len_A, B, len_B);
+    keyed = 1;
+    if ((tableau_in != NULL || tableau_out != NULL) &&
+        (f == tkf91_dp_f || f == tkf91_dp_d ||
+         f == tkf91_dp_d_checkpointed))
+    {
+        j_out = json_error_response("tableau files require "
+                "a tableau-based precision {mag | high | auto}");
+        goto end;
+    }
+
+    /* the rounds of refinement are run by the high and auto solvers */
+    if (use_diagnostics && f != tkf91_dp_high && f != tkf91_dp_auto)
+    {
+        j_out = json_error_response("diagnostics require "
+                "the high or auto precision");
+        goto end;
+    }
+
+    /* checkpoints are supported by the high precision solver */
+    if ((checkpoint_filename != NULL || resume_filename != NULL) &&
+        f != tkf91_dp_high)
+    {
+        j_out = json_error_response("checkpoints require high precision");
+        goto end;
+    }
+
+    /* initialize a tableau if necessary */
+    if (f != tkf91_dp_f && f != tkf91_dp_d &&
+        f != tkf91_dp_d_checkpointed)
+    {
         dp_mat_init(tableau, nrows, ncols);
         sol->mat = tableau;
     }
-    else {
-        printf("expected the precision string to be one of ");
-        printf("{float | double | mag | high}\n");
-        abort();
+
+    if (checkpoint_filename != NULL || resume_filename != NULL)
+    {
+        checkpoint_init(checkpoint, checkpoint_filename,
+                checkpoint_interval, key->h[0]);
+        pcheckpoint = checkpoint;
+        if (resume_filename != NULL &&
+            checkpoint_read(checkpoint, resume_filename, sol->mat))
+        {
+            j_out = json_error_response("failed to resume from %s",
+                    resume_filename);
+            goto end;
+        }
+    }
+
+    /* the deadline includes the time spent building the model */
+    if (deadline_ms >= 0)
+    {
+        budget_set_deadline_ms(budget, (slong) deadline_ms);
+    }
+
+    if (tableau_in != NULL)
+    {
+        /* trace back through a previously certified tableau */
+        int certified;
+        slong level;
+        if (tableau_file_read(tableau_in, key, sol->mat, &certified, &level))
+        {
+            j_out = json_error_response("failed to read the tableau in %s",
+                    tableau_in);
+            goto end;
+        }
+        if (!certified)
+        {
+            j_out = json_error_response("the tableau in %s "
+                    "is not certified", tableau_in);
+            goto end;
+        }
+        sol->optimality_flag = 1;
+        sol->level = level;
+        f = _traceback;
     }
 
-    solve(f, sol, rtol, p, A, len_A, B, len_B);
+    /* the tableau from a file is traced back like a solver run */
+    if (shared && shared->cache)
+    {
+        tkf91_model_context_ptr ctx;
+        if (shared->lock)
+        {
+            pthread_mutex_lock(shared->lock);
+        }
+        ctx = tkf91_model_context_cache_get(shared->cache, p);
+        if (shared->lock)
+        {
+            pthread_mutex_unlock(shared->lock);
+        }
+        status = solve(f, sol, trace, rtol, budget, pcheckpoint,
+                use_diagnostics ? diagnostics : NULL, ctx,
+                A, len_A, B, len_B);
+        if (shared->lock)
+        {
+            pthread_mutex_lock(shared->lock);
+        }
+        tkf91_model_context_cache_release(shared->cache, ctx);
+        if (shared->lock)
+        {
+            pthread_mutex_unlock(shared->lock);
+        }
+    }
+    else
+    {
+        tkf91_model_context_t ctx;
+        tkf91_model_context_init(ctx, p);
+        status = solve(f, sol, trace, rtol, budget, pcheckpoint,
+                use_diagnostics ? diagnostics : NULL, ctx,
+                A, len_A, B, len_B);
+        tkf91_model_context_clear(ctx);
+    }
+
+    /* a solver without a tableau may be stopped before it has a result */
+    if (status || (sol->interrupted && sol->len < 0))
+    {
+        j_out = status ? _json_solver_error(status) :
+            json_error_response("the deadline passed before "
+                    "the double precision pass was finished");
+        goto end;
+    }
+
+    if (tableau_out != NULL && tableau_file_write(tableau_out, key,
+                sol->mat, sol->optimality_flag, sol->level))
+    {
+        j_out = json_error_response("failed to write the tableau to %s",
+                tableau_out);
+        goto end;
+    }
+
+    if (output_format == OUTPUT_CIGAR)
+    {
+        char *cigar = alignment_ops_cigar(sol->ops, sol->len);
+        j_out = json_pack("{s:O, s:s}",
+                "parameters", parameters,
+                "cigar", cigar);
+        flint_free(cigar);
+    }
+    else if (output_format == OUTPUT_BINARY)
+    {
+        if (alignment_file_write(alignment_out, sol->ops, sol->len,
+                    len_A, len_B, _log_probability(sol),
+                    sol->optimality_flag))
+        {
+            j_out = json_error_response("failed to write "
+                    "the alignment to %s", alignment_out);
+            goto end;
+        }
+        j_out = json_pack("{s:O, s:s, s:I}",
+                "parameters", parameters,
+                "alignment_out", alignment_out,
+                "columns", (json_int_t) sol->len);
+    }
+    else if (trace)
+    {
+        j_out = json_pack("{s:O, s:s, s:s}",
+                "parameters", parameters,
+                "sequence_a", sol->A,
+                "sequence_b", sol->B);
+    }
+    else
+    {
+        j_out = json_pack("{s:O, s:f}",
+                "parameters", parameters,
+                "log_probability",
+                arf_get_d(arb_midref(sol->log_probability), ARF_RND_NEAR));
+    }
 
-    j_out = json_pack("{s:o, s:s, s:s}",
-            "parameters", parameters,
-            "sequence_a", sol->A,
-            "sequence_b", sol->B);
+    if (output_format != OUTPUT_STRINGS && !isnan(_log_probability(sol)))
+    {
+        json_object_set_new(j_out, "log_probability",
+                json_real(_log_probability(sol)));
+    }
+
+    if (use_plan)
+    {
+        json_object_set_new(j_out, "plan", json_pack(
+                    "{s:s, s:s, s:I, s:I}",
+                    "precision", plan->precision,
+                    "memory", plan_memory_string(plan->memory),
+                    "threads", (json_int_t) plan->threads,
+                    "estimated_bytes", (json_int_t) plan->estimated_bytes));
+    }
 
+    if (deadline_ms >= 0 && sol->mat)
+    {
+        json_object_set_new(j_out, "certification", json_pack(
+                    "{s:b, s:I, s:I}",
+                    "certified", sol->optimality_flag,
+                    "precision_level", (json_int_t) sol->level,
+                    "unresolved_cells", (json_int_t) sol->unresolved));
+    }
+
+    if (use_diagnostics)
+    {
+        json_object_set_new(j_out, "diagnostics",
+                json_diagnostics(diagnostics));
+    }
+
+    if (cached)
+    {
+        json_result_cache_put(shared->results, result_key, j_out);
+    }
+
+    /* the memory use is measured for this run, so it is not cached */
+    if (memstats_installed())
+    {
+        memstats_interval(memory, memory_start);
+        json_object_set_new(j_out, "memory", json_pack("{s:I, s:I, s:I}",
+                    "heap_peak_bytes", (json_int_t) memory->peak,
+                    "allocations", (json_int_t) memory->allocations,
+                    "allocated_bytes", (json_int_t) memory->allocated_bytes));
+    }
+
+end:
+    if (cached)
+    {
+        result_key_clear(result_key);
+    }
+    if (keyed)
+    {
+        result_key_clear(key);
+    }
     flint_free(A);
     flint_free(B);
+    flint_free(sol->ops);
     solution_clear(sol);
     model_params_clear(p);
+    budget_clear(budget);
+    plan_clear(plan);
+    diagnostics_clear(diagnostics);
+    if (pcheckpoint)
+    {
+        checkpoint_clear(checkpoint);
+    }
     if (sol->mat)
     {
         dp_mat_clear(sol->mat);
@@ -153,58 +749,304 @@ json_t *run(void * userdata, json_t *root)
 
 
 
-void
-solve(tkf91_dp_fn f, solution_t sol, double rtol, const model_params_t p,
+/* returns the status of the solver */
+int
+solve(tkf91_dp_fn f, solution_t sol, int trace, double rtol,
+        budget_ptr budget, checkpoint_ptr checkpoint,
+        diagnostics_ptr diagnostics, tkf91_model_context_t ctx,
         const slong *A, slong szA, const slong *B, slong szB)
 {
-    tkf91_rationals_t r;
-    tkf91_expressions_t expressions;
-    tkf91_generator_indices_t generators;
-    fmpz_mat_t mat;
-    expr_ptr * expressions_table;
+    const tkf91_generator_indices_struct * generators;
     request_t req;
 
-    /* expressions registry and (refining) generator registry */
-    reg_t er;
-    rgen_reg_ptr gr;
+    /* the requests are checked for empty sequences before the solve */
+    generators = tkf91_model_context_generators(ctx, A, szA, B, szB);
+    if (!generators)
+    {
+        return TKF91_ERROR_DIMENSIONS;
+    }
 
-    reg_init(er);
-    tkf91_rationals_init(r, p->lambda, p->mu, p->tau, p->pi);
-    tkf91_expressions_init(expressions, er, r);
+    /* init request object */
+    req->trace = trace;
+    req->rtol = rtol;
+    req->budget = budget;
+    req->checkpoint = checkpoint;
+    req->timing = NULL;
+    req->diagnostics = diagnostics;
+    req->ctx = ctx;
 
-    gr = rgen_reg_new();
-    tkf91_rgenerators_init(generators, gr, r, expressions, A, szA, B, szB);
-    rgen_reg_finalize(gr, er);
-    fmpz_mat_init(mat, rgen_reg_nrows(gr), rgen_reg_ncols(gr));
-    rgen_reg_get_matrix(mat, gr);
+    return f(sol, req, ctx->mat, ctx->expressions_table, generators,
+            A, szA, B, szB);
+}
 
-    rgen_reg_clear(gr);
-    tkf91_rationals_clear(r);
 
-    expressions_table = reg_vec(er);
 
-    /* init request object */
-    req->trace = 1;
-    req->rtol = rtol;
+/*
+ * Read a single request from the file, or from stdin if the filename
+ * is NULL, encoding its sequences while the json text is scanned.
+ */
+int run_stream(void * userdata, const char *filename)
+{
+    json_stream_t stream;
+    json_error_t error;
+    json_t *j_in, *j_out;
+    slong *A, *B;
+    slong len_A, len_B;
+    char *s_out;
 
-    f(sol, req, mat, expressions_table, generators, A, szA, B, szB);
+    json_stream_init(stream);
+    if (filename ? json_stream_read_file(stream, filename) :
+                   json_stream_read(stream, stdin))
+    {
+        json_stream_clear(stream);
+        return -1;
+    }
+
+    j_in = json_loadb(stream->rest, stream->rest_len, 0, &error);
+    if (!j_in)
+    {
+        fprintf(stderr, "json error: on json line %d: %s\n",
+                error.line, error.text);
+        json_stream_clear(stream);
+        return -1;
+    }
 
-    fmpz_mat_clear(mat);
-    flint_free(expressions_table);
+    A = json_stream_take_sequence(stream, 0, &len_A);
+    B = json_stream_take_sequence(stream, 1, &len_B);
+    json_stream_clear(stream);
 
-    reg_clear(er);
-    tkf91_expressions_clear(expressions);
+    j_out = run_sequences(userdata, j_in, A, len_A, B, len_B);
+    json_decref(j_in);
+    if (json_error_message(j_out))
+    {
+        /* as in run_json_script */
+        fprintf(stderr, "error: %s\n", json_error_message(j_out));
+        json_decref(j_out);
+        return -1;
+    }
+    s_out = json_dumps(j_out, 0);
+    json_decref(j_out);
+    if (!s_out)
+    {
+        fprintf(stderr, "error: failed to dump ");
+        fprintf(stderr, "the json object to a string\n");
+        return -1;
+    }
+    puts(s_out);
+    free(s_out);
+    return 0;
 }
 
 
+/* the number of tableau cells, or zero if the sequences are missing */
+double request_cost(json_t *root)
+{
+    json_t *a = json_object_get(root, "sequence_a");
+    json_t *b = json_object_get(root, "sequence_b");
+    if (!json_is_string(a) || !json_is_string(b))
+    {
+        return 0;
+    }
+    return (strlen(json_string_value(a)) + 1.0) *
+           (strlen(json_string_value(b)) + 1.0);
+}
+
+/* the precision, or "plan" if it is chosen by the planner */
+const char * request_label(json_t *root)
+{
+    json_t *precision = json_object_get(root, "precision");
+    if (json_is_string(precision))
+    {
+        return json_string_value(precision);
+    }
+    if (json_object_get(root, "memory_limit") ||
+        json_object_get(root, "guarantee"))
+    {
+        return "plan";
+    }
+    return "high";
+}
 
-int main(void)
+json_t * shared_stats(void *userdata)
+{
+    align_shared_struct *shared = userdata;
+    json_t *j_out;
+    pthread_mutex_lock(shared->lock);
+    j_out = json_pack("{s:I, s:I, s:I, s:I, s:I}",
+            "model_contexts", (json_int_t) shared->cache->len,
+            "model_context_limit", (json_int_t) shared->cache->limit,
+            "cache_hits", (json_int_t) shared->cache->hits,
+            "cache_misses", (json_int_t) shared->cache->misses,
+            "cache_evictions", (json_int_t) shared->cache->evictions);
+    pthread_mutex_unlock(shared->lock);
+    return j_out;
+}
+
+
+
+int main(int argc, char *argv[])
 {
     json_hom_t hom;
+    tkf91_model_context_cache_t cache;
+    align_shared_t shared;
+    pthread_mutex_t lock;
+    result_cache_t results;
+    int i, jsonl, batch, pipeline, order, usage, nargs, has_contexts;
+    const char *serve;
+    const char *input;
+    const char *cache_dir;
+    slong nthreads, cache_bytes, contexts;
+    int result;
+
     hom->userdata = NULL;
     hom->clear = NULL;
     hom->f = run;
-    int result = run_json_script(hom);
+
+    jsonl = 0;
+    batch = 0;
+    pipeline = 0;
+    serve = NULL;
+    input = NULL;
+    order = BATCH_ORDER_INPUT;
+    nthreads = plan_available_threads();
+    cache_dir = NULL;
+    cache_bytes = JSON_RESULT_CACHE_BYTES;
+    contexts = ALIGN_CONTEXTS;
+    has_contexts = 0;
+    usage = 0;
+    nargs = argc;
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--jsonl"))
+        {
+            jsonl = 1;
+        }
+        else if (!strcmp(argv[i], "--batch"))
+        {
+            batch = 1;
+        }
+        else if (!strcmp(argv[i], "--pipeline"))
+        {
+            pipeline = 1;
+        }
+        else if (!strncmp(argv[i], "--input=", 8))
+        {
+            input = argv[i] + 8;
+        }
+        else if (!strncmp(argv[i], "--serve=", 8))
+        {
+            serve = argv[i] + 8;
+        }
+        else if (!strncmp(argv[i], "--threads=", 10))
+        {
+            nthreads = atol(argv[i] + 10);
+            usage |= (nthreads < 1);
+        }
+        else if (!strncmp(argv[i], "--contexts=", 11))
+        {
+            /* the context limit goes with any of the modes with a cache */
+            contexts = atol(argv[i] + 11);
+            usage |= (contexts < 1);
+            has_contexts = 1;
+            nargs--;
+        }
+        else if (!strcmp(argv[i], "--order=input"))
+        {
+            order = BATCH_ORDER_INPUT;
+        }
+        else if (!strcmp(argv[i], "--order=completion"))
+        {
+            order = BATCH_ORDER_COMPLETION;
+        }
+        else if (!strcmp(argv[i], "--memory"))
+        {
+            /* nothing has been allocated yet; this goes with any mode */
+            memstats_install();
+            nargs--;
+        }
+        else if (!json_result_cache_option(&cache_dir, &cache_bytes, argv[i]))
+        {
+            /* the cache options go with any of the modes */
+            nargs--;
+        }
+        else
+        {
+            usage = 1;
+        }
+    }
+    if (usage ||
+        (jsonl + batch + pipeline + (serve != NULL) + (input != NULL) > 1) ||
+        (!batch && !pipeline && !serve &&
+         (nargs > 1 + jsonl + (input != NULL))) ||
+        (serve && nargs > 3) ||
+        (has_contexts && !jsonl && !batch && !pipeline && !serve))
+    {
+        fprintf(stderr, "usage: %s [--input=FILE | "
+                "{--jsonl | {--batch | --pipeline} [--threads=N] "
+                "[--order=input|completion] | --serve=PATH "
+                "[--threads=N]} [--contexts=N]] "
+                "[--cache=DIR [--cache-bytes=N]] [--memory]\n",
+                argv[0]);
+        return 1;
+    }
+
+    shared->cache = NULL;
+    shared->lock = NULL;
+    shared->results = NULL;
+    if (cache_dir)
+    {
+        if (result_cache_init(results, cache_dir, cache_bytes))
+        {
+            return 1;
+        }
+        shared->results = results;
+    }
+    hom->userdata = shared;
+
+    if (jsonl)
+    {
+        tkf91_model_context_cache_init(cache, contexts);
+        shared->cache = cache;
+        result = run_json_lines(hom);
+        tkf91_model_context_cache_clear(cache);
+    }
+    else if (batch || pipeline)
+    {
+        tkf91_model_context_cache_init(cache, contexts);
+        shared->cache = cache;
+        shared->lock = &lock;
+        pthread_mutex_init(&lock, NULL);
+        if (batch)
+        {
+            result = run_json_batch(hom, request_cost, nthreads, order);
+        }
+        else
+        {
+            result = run_json_pipeline(hom, nthreads, order);
+        }
+        pthread_mutex_destroy(&lock);
+        tkf91_model_context_cache_clear(cache);
+    }
+    else if (serve)
+    {
+        tkf91_model_context_cache_init(cache, contexts);
+        shared->cache = cache;
+        shared->lock = &lock;
+        pthread_mutex_init(&lock, NULL);
+        result = run_json_server(hom, serve, nthreads,
+                request_label, shared_stats);
+        pthread_mutex_destroy(&lock);
+        tkf91_model_context_cache_clear(cache);
+    }
+    else
+    {
+        result = run_stream(shared, input);
+    }
+
+    if (shared->results)
+    {
+        result_cache_clear(results);
+    }
 
     flint_cleanup();
     return result;
@@ -0,0 +1,381 @@
+/*
+ * Align all pairs of sequences of a FASTA file.
+ *
+ * The input is a json object with the model "parameters" and the name
+ * of a "fasta" file. Every pair of its sequences is aligned on a pool
+ * of threads ("threads", by default one per processor), starting with
+ * the largest tableaux. If a "queries" FASTA file is also given, then
+ * each query sequence is aligned to each sequence of the "fasta" file
+ * instead. The optional "precision" is as in 'arbtkf91-align'.
+ *
+ * The log probabilities of the alignments are written to the file
+ * named by "matrix_out", with a row for each sequence (or query)
+ * and a column for each sequence. Because the tkf91 model is
+ * time-reversible, the matrix of all pairs is symmetric, and its
+ * diagonal is not computed. The "format" is either "tsv" (default),
+ * with the sequence names in the first row and column and "nan"
+ * for entries that are not computed, or "binary": a header like that
+ * of the tableau files followed by the rows of native doubles.
+ *
+ * If "alignments_out" is given, then the alignments are also written
+ * to that file, one pair per line, as tab separated names,
+ * log probability and the two aligned sequences.
+ *
+ * The sequences are read from memory-mapped files and encoded once,
+ * and every pair shares one model context.
+ * The output reports the numbers of sequences, pairs and threads,
+ * and the wall clock seconds spent aligning.
+ *
+ * If the solver fails for some pairs, their entries are "nan" and they
+ * have no alignment line, and the output is instead an error response
+ * with the status of the first such pair and the number of "failed_pairs".
+ */
+
+#include <math.h>
+#include <time.h>
+#include <stdint.h>
+
+#include "flint/flint.h"
+#include "flint/fmpq.h"
+
+#include "jansson.h"
+
+#include "runjson.h"
+#include "jsonutil.h"
+#include "tkf91_dp_f.h"
+#include "tkf91_dp_d.h"
+#include "tkf91_dp_r.h"
+#include "tkf91_dp_auto.h"
+#include "tkf91_dp_bound.h"
+#include "tkf91_model_context.h"
+#include "model_params.h"
+#include "json_model_params.h"
+#include "plan.h"
+#include "allpairs.h"
+#include "fasta.h"
+
+
+#define MATRIX_FILE_MAGIC "arbtkf91-matrix"
+#define MATRIX_FILE_VERSION 1
+
+/* the header is written in native byte order */
+typedef struct
+{
+    char magic[24];
+    int64_t version;
+    int64_t nrows;
+    int64_t ncols;
+} matrix_file_header_struct;
+
+static int write_matrix_tsv(const char *filename, const double *m,
+        const fasta_struct *rows, const fasta_struct *cols);
+static int write_matrix_binary(const char *filename, const double *m,
+        slong nrows, slong ncols);
+
+
+int
+write_matrix_tsv(const char *filename, const double *m,
+        const fasta_struct *rows, const fasta_struct *cols)
+{
+    FILE *fout;
+    slong i, j;
+    int code;
+
+    fout = fopen(filename, "w");
+    if (fout == NULL)
+    {
+        fprintf(stderr, "failed to open %s for writing\n", filename);
+        return 1;
+    }
+    for (j = 0; j < cols->len; j++)
+    {
+        fprintf(fout, "\t%s", cols->names[j]);
+    }
+    fprintf(fout, "\n");
+    for (i = 0; i < rows->len; i++)
+    {
+        fprintf(fout, "%s", rows->names[i]);
+        for (j = 0; j < cols->len; j++)
+        {
+            if (isnan(m[i * cols->len + j]))
+            {
+                fprintf(fout, "\tnan");
+            }
+            else
+            {
+                fprintf(fout, "\t%.17g", m[i * cols->len + j]);
+            }
+        }
+        fprintf(fout, "\n");
+    }
+    code = ferror(fout);
+    if (fclose(fout) || code)
+    {
+        fprintf(stderr, "failed to write the matrix file %s\n", filename);
+        return 1;
+    }
+    return 0;
+}
+
+int
+write_matrix_binary(const char *filename, const double *m,
+        slong nrows, slong ncols)
+{
+    matrix_file_header_struct header;
+    FILE *fout;
+    int code;
+
+    memset(&header, 0, sizeof(header));
+    strncpy(header.magic, MATRIX_FILE_MAGIC, sizeof(header.magic) - 1);
+    header.version = MATRIX_FILE_VERSION;
+    header.nrows = nrows;
+    header.ncols = ncols;
+
+    fout = fopen(filename, "wb");
+    if (fout == NULL)
+    {
+        fprintf(stderr, "failed to open %s for writing\n", filename);
+        return 1;
+    }
+    code = 0;
+    if (fwrite(&header, sizeof(header), 1, fout) != 1)
+    {
+        code = 1;
+    }
+    if (!code && nrows && ncols &&
+        fwrite(m, sizeof(double), nrows * ncols, fout) !=
+        (size_t) (nrows * ncols))
+    {
+        code = 1;
+    }
+    if (fclose(fout) || code)
+    {
+        fprintf(stderr, "failed to write the matrix file %s\n", filename);
+        return 1;
+    }
+    return 0;
+}
+
+
+json_t *run(void * userdata, json_t *root);
+
+json_t *run(void * userdata, json_t *root)
+{
+    json_t *j_out;
+    json_t *parameters;
+    model_params_t p;
+    tkf91_model_context_t ctx;
+    fasta_t database, queries;
+    const fasta_struct *rows;
+    allpairs_t s;
+    tkf91_dp_fn f;
+    int use_tableau, trace;
+    FILE *alignments;
+    double *m;
+    const char * fasta_filename;
+    const char * queries_filename;
+    const char * precision;
+    const char * matrix_filename;
+    const char * format;
+    const char * alignments_filename;
+    json_int_t threads;
+    slong i, k, used, failed;
+    struct timespec start, finish;
+    double seconds;
+    json_error_t err;
+    size_t flags;
+    int result, binary;
+
+    if (userdata)
+    {
+        fprintf(stderr, "error: unexpected userdata\n");
+        abort();
+    }
+
+    /* default values of optional json arguments */
+    queries_filename = NULL;
+    precision = NULL;
+    format = NULL;
+    alignments_filename = NULL;
+    threads = plan_available_threads();
+
+    flags = JSON_STRICT;
+    result = json_unpack_ex(root, &err, flags,
+            "{s:o, s:s, s:s, s?s, s?s, s?I, s?s, s?s}",
+            "parameters", &parameters,
+            "fasta", &fasta_filename,
+            "matrix_out", &matrix_filename,
+            "queries", &queries_filename,
+            "precision", &precision,
+            "threads", &threads,
+            "format", &format,
+            "alignments_out", &alignments_filename);
+    if (result)
+    {
+        return json_error_response("on line %d: %s", err.line, err.text);
+    }
+
+    binary = 0;
+    if (format != NULL)
+    {
+        if (strcmp(format, "binary") == 0)
+        {
+            binary = 1;
+        }
+        else if (strcmp(format, "tsv") != 0)
+        {
+            return json_error_response("expected the format string "
+                    "to be one of {tsv | binary}");
+        }
+    }
+    if (threads < 1)
+    {
+        return json_error_response("expected at least one thread");
+    }
+
+    /* the tableau-based precisions need the traceback anyway */
+    use_tableau = 1;
+    trace = 1;
+    if (precision == NULL || strcmp(precision, "high") == 0) {
+        f = tkf91_dp_high;
+    }
+    else if (strcmp(precision, "float") == 0) {
+        f = tkf91_dp_f;
+        use_tableau = 0;
+    }
+    else if (strcmp(precision, "double") == 0) {
+        f = tkf91_dp_d;
+        use_tableau = 0;
+        trace = (alignments_filename != NULL);
+    }
+    else if (strcmp(precision, "mag") == 0) {
+        f = tkf91_dp_mag;
+    }
+    else if (strcmp(precision, "auto") == 0) {
+        f = tkf91_dp_auto;
+    }
+    else {
+        return json_error_response("expected the precision string "
+                "to be one of {float | double | mag | high | auto}");
+    }
+
+    /* an invalid request is answered before any pair is aligned */
+    model_params_init(p);
+    fasta_init(database);
+    fasta_init(queries);
+    m = NULL;
+    result = _json_get_model_params_ex(p, parameters, &err, flags);
+    if (result)
+    {
+        j_out = json_error_response("on line %d: %s", err.line, err.text);
+        goto invalid;
+    }
+    result = model_params_validate(p);
+    if (result)
+    {
+        j_out = json_error_response("invalid model parameters");
+        goto invalid;
+    }
+
+    /* read and encode each sequence once */
+    if (fasta_read(database, fasta_filename) ||
+        (queries_filename != NULL && fasta_read(queries, queries_filename)))
+    {
+        j_out = json_error_response("failed to read the fasta files");
+        goto invalid;
+    }
+    rows = (queries_filename != NULL) ? queries : database;
+    for (k = 0; k < 2; k++)
+    {
+        const fasta_struct *fa = k ? database : queries;
+        for (i = 0; i < fa->len; i++)
+        {
+            if (!fa->lens[i])
+            {
+                j_out = json_error_response("expected the sequence %s "
+                        "to have length at least 1", fa->names[i]);
+                goto invalid;
+            }
+        }
+    }
+
+    m = flint_malloc(FLINT_MAX(1, rows->len * database->len) *
+            sizeof(double));
+
+    alignments = NULL;
+    if (alignments_filename != NULL)
+    {
+        alignments = fopen(alignments_filename, "w");
+        if (alignments == NULL)
+        {
+            j_out = json_error_response("failed to open %s for writing",
+                    alignments_filename);
+            goto invalid;
+        }
+    }
+
+    tkf91_model_context_init(ctx, p);
+    allpairs_init(s, ctx, f, use_tableau, trace, rows, database);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    used = allpairs_run(s, (slong) threads, alignments);
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+    seconds = (finish.tv_sec - start.tv_sec) +
+        1e-9 * (finish.tv_nsec - start.tv_nsec);
+    allpairs_get_matrix(m, s);
+
+    j_out = NULL;
+    if (alignments != NULL && fclose(alignments))
+    {
+        j_out = json_error_response("failed to write "
+                "the alignments file %s", alignments_filename);
+    }
+    result = binary ?
+        write_matrix_binary(matrix_filename, m, rows->len, database->len) :
+        write_matrix_tsv(matrix_filename, m, rows, database);
+    if (result && !j_out)
+    {
+        j_out = json_error_response("failed to write the matrix file %s",
+                matrix_filename);
+    }
+
+    result = allpairs_status(&failed, s);
+    if (!j_out && failed)
+    {
+        j_out = _json_solver_error(result);
+        json_object_set_new(j_out, "failed_pairs",
+                json_integer((json_int_t) failed));
+    }
+    else if (!j_out)
+    {
+        j_out = json_pack("{s:I, s:I, s:I, s:I, s:f}",
+                "sequences", (json_int_t) database->len,
+                "queries", (json_int_t) queries->len,
+                "pairs", (json_int_t) s->npairs,
+                "threads", (json_int_t) used,
+                "seconds", seconds);
+    }
+
+    allpairs_clear(s);
+    tkf91_model_context_clear(ctx);
+invalid:
+    flint_free(m);
+    fasta_clear(database);
+    fasta_clear(queries);
+    model_params_clear(p);
+
+    return j_out;
+}
+
+
+int main(void)
+{
+    json_hom_t hom;
+    hom->userdata = NULL;
+    hom->clear = NULL;
+    hom->f = run;
+    int result = run_json_script(hom);
+
+    flint_cleanup();
+    return result;
+}
@@ -6,10 +6,61 @@
  * {
  * "ticks_per_second" : integer,
  * "elapsed_ticks" : [integer, integer, ..., integer],
+ * "timings" : [timing, timing, ..., timing],
  * "sequence_a" : string,
  * "sequence_b" : string
  * }
  *
+ * The elapsed ticks are the processor time of each sample.
+ * Each timing object breaks the corresponding sample down by phase:
+ * {
+ * "wall_seconds" : number,
+ * "cpu_seconds" : number,
+ * "phases" : [
+ *   {"phase" : string, "level" : integer,
+ *    "wall_seconds" : number, "cpu_seconds" : number},
+ *   ...]
+ * }
+ * where the sample totals use the monotonic wall clock and the processor
+ * time of the whole process, and each phase reports the wall time and
+ * the cpu time of the thread that ran it, in the order the phases ended.
+ * The phases are the model setup steps ("setup_expressions",
+ * "setup_generators", "setup_program", "setup_hnf", "setup_logs"),
+ * and the "forward", "backward", "verification" and "traceback" steps
+ * of the solver. The "level" is the precision level of the step,
+ * -1 for mag_t bounds, and it is omitted for the steps that do not
+ * depend on a precision level.
+ *
+ * If "counters" is true, then the hardware performance counters
+ * (see 'perf_counters.h') are read around each sample and each phase,
+ * and the timing objects and the phases get a "counters" object with
+ * the counts, the counts per tableau cell (except for the setup steps)
+ * and the instructions per cycle. The output lists the counters that
+ * could be opened in "counters_available", and whether the kernel ever
+ * put them on the hardware in "counters_running". The "counters" objects
+ * are omitted if none could be opened, and for the phases during which
+ * they were not running, rather than reported as zero counts.
+ * The counters count the thread that reads the input, so the phases run
+ * by the worker threads of the 'auto' precision have no counters.
+ *
+ * With the --memory option the heap is accounted as in 'memstats.h'.
+ * Each timing object and each phase then gets a "memory" object with
+ * the "heap_peak_bytes" that the heap use of its thread rose to above
+ * its level at the start, and the number of "allocations" and their
+ * total "allocated_bytes". The timing object of a sample or of the
+ * setup also gets "process_heap_peak_bytes", which counts every thread,
+ * and the output gets the "peak_resident_bytes" of the process.
+ *
+ * As in 'arbtkf91-align', if "precision" is not provided but
+ * "memory_limit" or "guarantee" is provided, then a planner chooses
+ * the precision and memory strategy, and the output gets
+ * an additional "plan" object describing the choice.
+ *
+ * By default each sample includes building the model context
+ * from the parameters. If "shared_context" is true, then the context
+ * is built once before the samples are taken, and the time spent
+ * building it is reported separately as "setup_ticks", with its phases
+ * in "setup_timing".
  */
 
 #include <time.h>
@@ -24,18 +75,130 @@
 #include "tkf91_dp_f.h"
 #include "tkf91_dp_d.h"
 #include "tkf91_dp_r.h"
+#include "tkf91_dp_auto.h"
 #include "tkf91_dp_bound.h"
-#include "tkf91_rgenerators.h"
+#include "tkf91_model_context.h"
 #include "tkf91_generator_indices.h"
 #include "model_params.h"
 #include "json_model_params.h"
+#include "plan.h"
 
 
 
-void
-solve(tkf91_dp_fn f, solution_t sol, double rtol, const model_params_t p,
+int
+solve(tkf91_dp_fn f, solution_t sol, int trace, double rtol,
+        tkf91_model_context_t ctx, timing_ptr timing,
         const slong *A, slong len_A, const slong *B, slong len_B);
 
+static json_t *_counters_json(const perf_counters_t counters,
+        const double *counts, slong cells);
+static json_t *_memory_json(const timing_phase_struct *x);
+static json_t *_timing_json(const timing_t timing,
+        const timing_phase_struct *total, double cpu_seconds, slong cells,
+        slong process_heap_peak_bytes);
+
+
+json_t *
+_counters_json(const perf_counters_t counters,
+        const double *counts, slong cells)
+{
+    json_t *j;
+    char name[64];
+    int c;
+
+    j = json_object();
+    for (c = 0; c < PERF_COUNTERS; c++)
+    {
+        if (!perf_counter_available(counters, c))
+        {
+            continue;
+        }
+        json_object_set_new(j, perf_counter_name(c), json_real(counts[c]));
+        if (cells > 0)
+        {
+            snprintf(name, sizeof(name), "%s_per_cell", perf_counter_name(c));
+            json_object_set_new(j, name, json_real(counts[c] / cells));
+        }
+    }
+    if (perf_counter_available(counters, PERF_COUNTER_CYCLES) &&
+        perf_counter_available(counters, PERF_COUNTER_INSTRUCTIONS) &&
+        counts[PERF_COUNTER_CYCLES] > 0)
+    {
+        json_object_set_new(j, "instructions_per_cycle",
+                json_real(counts[PERF_COUNTER_INSTRUCTIONS] /
+                    counts[PERF_COUNTER_CYCLES]));
+    }
+    return j;
+}
+
+json_t *
+_memory_json(const timing_phase_struct *x)
+{
+    return json_pack("{s:I, s:I, s:I}",
+            "heap_peak_bytes", (json_int_t) x->heap_peak_bytes,
+            "allocations", (json_int_t) x->allocations,
+            "allocated_bytes", (json_int_t) x->allocated_bytes);
+}
+
+json_t *
+_timing_json(const timing_t timing,
+        const timing_phase_struct *total, double cpu_seconds, slong cells,
+        slong process_heap_peak_bytes)
+{
+    json_t *j, *phases, *phase, *memory;
+    const timing_phase_struct *x;
+    int counted;
+    slong i;
+
+    /* counters are reported only if at least one of them is available */
+    counted = (timing->counters && perf_counters_available(timing->counters));
+
+    phases = json_array();
+    for (i = 0; i < timing->len; i++)
+    {
+        x = timing->phases + i;
+        phase = json_pack("{s:s, s:f, s:f}",
+                "phase", x->phase,
+                "wall_seconds", x->wall_seconds,
+                "cpu_seconds", x->cpu_seconds);
+        if (x->level != TIMING_NO_LEVEL)
+        {
+            json_object_set_new(phase, "level",
+                    json_integer((json_int_t) x->level));
+        }
+        if (counted && x->counted)
+        {
+            /* the setup steps do not depend on the tableau size */
+            json_object_set_new(phase, "counters",
+                    _counters_json(timing->counters, x->counts,
+                        strncmp(x->phase, "setup_", 6) ? cells : 0));
+        }
+        if (x->accounted)
+        {
+            json_object_set_new(phase, "memory", _memory_json(x));
+        }
+        json_array_append_new(phases, phase);
+    }
+
+    j = json_pack("{s:f, s:f, s:o}",
+            "wall_seconds", total->wall_seconds,
+            "cpu_seconds", cpu_seconds,
+            "phases", phases);
+    if (counted && total->counted)
+    {
+        json_object_set_new(j, "counters",
+                _counters_json(timing->counters, total->counts, cells));
+    }
+    if (total->accounted)
+    {
+        memory = _memory_json(total);
+        json_object_set_new(memory, "process_heap_peak_bytes",
+                json_integer((json_int_t) process_heap_peak_bytes));
+        json_object_set_new(j, "memory", memory);
+    }
+    return j;
+}
+
 
 json_t *run(void * userdata, json_t *root);
 
@@ -47,13 +210,19 @@ json_t *run(void * userdata, json_t *root)
     slong *A;
     slong *B;
     solution_t sol;
-    int result;
+    int result, status;
     int samples;
     json_t * parameters;
     const char * sequence_a;
     const char * sequence_b;
     const char * precision;
     double rtol;
+    json_int_t memory_limit;
+    const char * guarantee_string;
+    int guarantee, use_plan, trace;
+    int shared_context;
+    int use_counters;
+    plan_t plan;
     json_error_t err;
     size_t flags;
     slong nrows, ncols;
@@ -67,49 +236,97 @@ json_t *run(void * userdata, json_t *root)
     /* default values of optional json arguments */
     rtol = 0;
     precision = NULL;
+    memory_limit = -1;
+    guarantee_string = NULL;
+    shared_context = 0;
+    use_counters = 0;
 
     flags = JSON_STRICT;
     result = json_unpack_ex(root, &err, flags,
-            "{s:o, s:s, s:s, s:i, s?F, s?s}",
+            "{s:o, s:s, s:s, s:i, s?F, s?s, s?I, s?s, s?b, s?b}",
             "parameters", &parameters,
             "sequence_a", &sequence_a,
             "sequence_b", &sequence_b,
             "samples", &samples,
             "rtol", &rtol,
-            "precision", &precision);
+            "precision", &precision,
+            "memory_limit", &memory_limit,
+            "guarantee", &guarantee_string,
+            "shared_context", &shared_context,
+            "counters", &use_counters);
     if (result)
     {
-        fprintf(stderr, "error: on line %d: %s\n", err.line, err.text);
-        abort();
+        return json_error_response("on line %d: %s", err.line, err.text);
+    }
+    if (samples < 1)
+    {
+        return json_error_response("expected at least one sample");
     }
 
+    /* an invalid request is answered before the first sample */
     model_params_init(p);
+    plan_init(plan);
+    A = NULL;
+    B = NULL;
     result = _json_get_model_params_ex(p, parameters, &err, flags);
     if (result)
     {
-        fprintf(stderr, "error: on line %d: %s\n", err.line, err.text);
-        abort();
+        j_out = json_error_response("on line %d: %s", err.line, err.text);
+        goto invalid;
     }
     result = model_params_validate(p);
     if (result)
     {
-        fprintf(stderr, "invalid model parameters\n");
-        abort();
+        j_out = json_error_response("invalid model parameters");
+        goto invalid;
     }
 
     /* read the two unaligned sequences */
 
     len_A = strlen(sequence_a);
     A = flint_malloc(len_A * sizeof(slong));
-    _fill_sequence_vector(A, sequence_a, len_A);
+    result = _fill_sequence_vector(A, sequence_a, len_A);
 
     len_B = strlen(sequence_b);
     B = flint_malloc(len_B * sizeof(slong));
-    _fill_sequence_vector(B, sequence_b, len_B);
+    result |= _fill_sequence_vector(B, sequence_b, len_B);
+
+    if (result || !len_A || !len_B)
+    {
+        j_out = json_error_response(result ?
+                "unrecognized nucleotide in the sequences" :
+                "expected both sequences to have length at least 1");
+        goto invalid;
+    }
 
     nrows = len_A + 1;
     ncols = len_B + 1;
 
+    /* let the planner choose the precision if requested */
+    trace = 1;
+    use_plan = (precision == NULL &&
+            (memory_limit >= 0 || guarantee_string != NULL));
+    if (use_plan)
+    {
+        guarantee = PLAN_GUARANTEE_CERTIFIED;
+        if (guarantee_string != NULL &&
+            plan_guarantee_from_string(&guarantee, guarantee_string))
+        {
+            j_out = json_error_response("expected the guarantee string "
+                    "to be one of {'score' | 'alignment' | 'certified'}");
+            goto invalid;
+        }
+        if (plan_choose(plan, len_A, len_B, (slong) memory_limit,
+                    guarantee, plan_available_threads()))
+        {
+            j_out = json_error_response("no dynamic programming strategy "
+                    "fits within the memory limit");
+            goto invalid;
+        }
+        precision = plan->precision;
+        trace = (plan->memory != PLAN_MEMORY_LINEAR_SPACE);
+    }
+
     /* dispatch */
     tkf91_dp_fn f = NULL;
     int requires_tableau = 0;
@@ -122,6 +339,10 @@ json_t *run(void * userdata, json_t *root)
     }
     else if (strcmp(precision, "double") == 0) {
         f = tkf91_dp_d;
+        if (use_plan && plan->memory == PLAN_MEMORY_CHECKPOINTED)
+        {
+            f = tkf91_dp_d_checkpointed;
+        }
     }
     else if (strcmp(precision, "mag") == 0) {
         f = tkf91_dp_mag;
@@ -131,104 +352,222 @@ json_t *run(void * userdata, json_t *root)
         f = tkf91_dp_high;
         requires_tableau = 1;
     }
+    else if (strcmp(precision, "auto") == 0) {
+        f = tkf91_dp_auto;
+        requires_tableau = 1;
+    }
     else
     {
-        fprintf(stderr, "expected the precision string to be one of ");
-        fprintf(stderr, "{'float' | 'double' | 'mag' | 'high'}\n");
-        abort();
+        j_out = json_error_response("expected the precision string to be "
+                "one of {'float' | 'double' | 'mag' | 'high' | 'auto'}");
+        goto invalid;
     }
 
     int i;
-    clock_t start, diff;
-    json_t *elapsed_ticks;
+    clock_t start, diff, setup;
+    timing_mark_t mark_start;
+    timing_phase_struct total;
+    memstats_t heap_start, heap_end;
+    timing_t timing;
+    perf_counters_t counters;
+    json_t *elapsed_ticks, *timings, *setup_timing;
     elapsed_ticks = json_array();
+    timings = json_array();
+    setup_timing = NULL;
     dp_mat_t tableau;
+    tkf91_model_context_t ctx;
+    timing_init(timing);
+    if (use_counters)
+    {
+        perf_counters_init(counters);
+        timing_set_counters(timing, counters);
+    }
+    setup = 0;
+    if (shared_context)
+    {
+        memstats_reset_peak();
+        memstats_get(heap_start);
+        timing_mark(timing, mark_start);
+        start = clock();
+        tkf91_model_context_init_timing(ctx, p, timing);
+        setup = clock() - start;
+        timing_finish(timing, &total, "setup", TIMING_NO_LEVEL, mark_start);
+        memstats_get(heap_end);
+        setup_timing = _timing_json(timing, &total,
+                (double) setup / CLOCKS_PER_SEC, 0,
+                heap_end->peak - heap_start->current);
+    }
     for (i = 0; i < samples; i++)
     {
+        timing_reset(timing);
+        memstats_reset_peak();
+        memstats_get(heap_start);
+        timing_mark(timing, mark_start);
         start = clock();
+        if (!shared_context)
+        {
+            tkf91_model_context_init_timing(ctx, p, timing);
+        }
         solution_init(sol, len_A + len_B);
         if (requires_tableau)
         {
             dp_mat_init(tableau, nrows, ncols);
             sol->mat = tableau;
         }
-        solve(f, sol, rtol, p, A, len_A, B, len_B);
+        status = solve(f, sol, trace, rtol, ctx, timing,
+                A, len_A, B, len_B);
         if (requires_tableau)
         {
             dp_mat_clear(tableau);
         }
+        if (!shared_context)
+        {
+            tkf91_model_context_clear(ctx);
+        }
+        if (status)
+        {
+            break;
+        }
         if (i < samples - 1)
         {
             solution_clear(sol);
         }
         diff = clock() - start;
+        timing_finish(timing, &total, "sample", TIMING_NO_LEVEL, mark_start);
+        memstats_get(heap_end);
         json_array_append_new(elapsed_ticks, json_integer((json_int_t) diff));
+        json_array_append_new(timings, _timing_json(timing, &total,
+                    (double) diff / CLOCKS_PER_SEC, nrows * ncols,
+                    heap_end->peak - heap_start->current));
     }
 
-    j_out = json_pack("{s:i, s:o, s:s, s:s}",
+    /* a failed sample fails the benchmark */
+    if (status)
+    {
+        j_out = _json_solver_error(status);
+        json_decref(elapsed_ticks);
+        json_decref(timings);
+        json_decref(setup_timing);
+        if (use_counters)
+        {
+            perf_counters_clear(counters);
+        }
+        timing_clear(timing);
+        if (shared_context)
+        {
+            tkf91_model_context_clear(ctx);
+        }
+        goto end;
+    }
+
+    j_out = json_pack("{s:i, s:o, s:o, s:s, s:s}",
             "ticks_per_second", (json_int_t) CLOCKS_PER_SEC,
             "elapsed_ticks", elapsed_ticks,
-            "sequence_a", sol->A,
-            "sequence_b", sol->B);
+            "timings", timings,
+            "sequence_a", sol->A ? sol->A : "",
+            "sequence_b", sol->B ? sol->B : "");
+
+    if (use_counters)
+    {
+        json_t *available = json_array();
+        int c;
+        for (c = 0; c < PERF_COUNTERS; c++)
+        {
+            if (perf_counter_available(counters, c))
+            {
+                json_array_append_new(available,
+                        json_string(perf_counter_name(c)));
+            }
+        }
+        json_object_set_new(j_out, "counters_available", available);
+        json_object_set_new(j_out, "counters_running",
+                json_boolean(perf_counters_running(counters)));
+        perf_counters_clear(counters);
+    }
+    timing_clear(timing);
+
+    if (memstats_installed())
+    {
+        json_object_set_new(j_out, "peak_resident_bytes",
+                json_integer((json_int_t) memstats_peak_resident()));
+    }
+
+    if (shared_context)
+    {
+        tkf91_model_context_clear(ctx);
+        json_object_set_new(j_out, "setup_ticks",
+                json_integer((json_int_t) setup));
+        json_object_set_new(j_out, "setup_timing", setup_timing);
+    }
+
+    if (use_plan)
+    {
+        json_object_set_new(j_out, "plan", json_pack(
+                    "{s:s, s:s, s:I, s:I}",
+                    "precision", plan->precision,
+                    "memory", plan_memory_string(plan->memory),
+                    "threads", (json_int_t) plan->threads,
+                    "estimated_bytes", (json_int_t) plan->estimated_bytes));
+    }
 
+end:
+    solution_clear(sol);
+invalid:
     flint_free(A);
     flint_free(B);
-    solution_clear(sol);
     model_params_clear(p);
+    plan_clear(plan);
 
     return j_out;
 }
 
 
 
-void
-solve(tkf91_dp_fn f, solution_t sol, double rtol, const model_params_t p,
+/* returns the status of the solver */
+int
+solve(tkf91_dp_fn f, solution_t sol, int trace, double rtol,
+        tkf91_model_context_t ctx, timing_ptr timing,
         const slong *A, slong szA, const slong *B, slong szB)
 {
-    tkf91_rationals_t r;
-    tkf91_expressions_t expressions;
-    tkf91_generator_indices_t generators;
-    fmpz_mat_t mat;
-    expr_ptr * expressions_table;
+    const tkf91_generator_indices_struct * generators;
     request_t req;
 
-    /* expressions registry and (refining) generator registry */
-    reg_t er;
-    rgen_reg_ptr gr;
-
-    reg_init(er);
-    tkf91_rationals_init(r, p->lambda, p->mu, p->tau, p->pi);
-    tkf91_expressions_init(expressions, er, r);
-
-    gr = rgen_reg_new();
-    tkf91_rgenerators_init(generators, gr, r, expressions, A, szA, B, szB);
-    rgen_reg_finalize(gr, er);
-    fmpz_mat_init(mat, rgen_reg_nrows(gr), rgen_reg_ncols(gr));
-    rgen_reg_get_matrix(mat, gr);
-
-    rgen_reg_clear(gr);
-    tkf91_rationals_clear(r);
-
-    expressions_table = reg_vec(er);
+    generators = tkf91_model_context_generators(ctx, A, szA, B, szB);
+    if (!generators)
+    {
+        return TKF91_ERROR_DIMENSIONS;
+    }
 
     /* init request object */
-    req->trace = 1;
+    req->trace = trace;
+    req->budget = NULL;
+    req->checkpoint = NULL;
+    req->ctx = ctx;
+    req->timing = timing;
+    req->diagnostics = NULL;
     req->rtol = rtol;
 
-    f(sol, req, mat, expressions_table, generators, A, szA, B, szB);
-
-    fmpz_mat_clear(mat);
-    flint_free(expressions_table);
-
-    reg_clear(er);
-    tkf91_expressions_clear(expressions);
+    return f(sol, req, ctx->mat, ctx->expressions_table, generators,
+            A, szA, B, szB);
 }
 
 
 
-int main(void)
+int main(int argc, char *argv[])
 {
     json_hom_t hom;
+
+    /* the heap accounting must see every allocation */
+    if (argc == 2 && !strcmp(argv[1], "--memory"))
+    {
+        memstats_install();
+    }
+    else if (argc != 1)
+    {
+        fprintf(stderr, "usage: %s [--memory]\n", argv[0]);
+        return 1;
+    }
+
     hom->userdata = NULL;
     hom->clear = NULL;
     hom->f = run;
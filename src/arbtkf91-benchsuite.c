@@ -0,0 +1,627 @@
+/*
+ * Benchmark every precision tier over a sweep of sequence lengths.
+ * The json format is used for both the input and the output.
+ *
+ * input:
+ * {
+ * "parameters" : object,
+ * "lengths" : [integer, ...],          (default [10, 100, ..., 100000])
+ * "precisions" : [string, ...],        (default all of the tiers)
+ * "warmup" : integer,                  (default 1)
+ * "samples" : integer,                 (default 5)
+ * "seed" : integer,                    (default 0)
+ * "time_limit" : number,               (default 10 seconds)
+ * "memory_limit" : integer,            (default 4 GiB)
+ * "baseline" : string,                 (optional file name)
+ * "threshold" : number                 (default 0.1)
+ * }
+ *
+ * For each length a pair of related sequences is generated: a random
+ * sequence and a copy with random substitutions and indels. The pairs
+ * depend only on the seed, so runs with the same input are comparable.
+ * One model context is built before the sweep, and each sample times
+ * the solver alone, with the traceback, on the monotonic wall clock.
+ * The warmup runs are not recorded.
+ *
+ * A tier skips the lengths whose estimated memory use exceeds the
+ * memory limit, and the lengths whose median time, extrapolated
+ * quadratically from the last length that was run, exceeds the time limit.
+ *
+ * output:
+ * {
+ * "results" : [
+ *   {"precision" : string, "length" : integer, "cells" : integer,
+ *    "median_seconds" : number, "mad_seconds" : number,
+ *    "min_seconds", "p05_seconds", "p25_seconds",
+ *    "p75_seconds", "p95_seconds", "max_seconds" : number,
+ *    "cells_per_second" : number}
+ *   or {"precision" : string, "length" : integer, "skipped" : string}
+ *   or {"precision" : string, "length" : integer, "error" : string,
+ *    "status" : integer} if the solver failed,
+ *   ...],
+ * "scaling" : [{"precision" : string, "exponent" : number,
+ *    "points" : integer}, ...]
+ * }
+ * where the scaling exponent of a tier is fitted to its median times
+ * of at least a millisecond (or to all of them if there are fewer than
+ * two such times); see 'bench_stats.h'.
+ *
+ * The "baseline" names the output of an earlier run. Each result
+ * that is also in the baseline gets "baseline_median_seconds" and the
+ * "ratio" of the medians, and it is listed in "regressions" if its
+ * median is slower by more than the relative threshold and by more than
+ * twice the sum of the two MADs, so that noisy timings are not reported.
+ * The exit status is nonzero if anything regressed or failed.
+ */
+
+#include <math.h>
+#include <stdint.h>
+
+#include "flint/flint.h"
+#include "flint/fmpq.h"
+
+#include "jansson.h"
+
+#include "runjson.h"
+#include "jsonutil.h"
+#include "tkf91_dp_f.h"
+#include "tkf91_dp_d.h"
+#include "tkf91_dp_r.h"
+#include "tkf91_dp_auto.h"
+#include "tkf91_dp_bound.h"
+#include "tkf91_model_context.h"
+#include "tkf91_generator_indices.h"
+#include "model_params.h"
+#include "json_model_params.h"
+#include "plan.h"
+#include "timing.h"
+#include "bench_stats.h"
+
+
+#define SUITE_DEFAULT_WARMUP 1
+#define SUITE_DEFAULT_SAMPLES 5
+#define SUITE_DEFAULT_TIME_LIMIT 10.0
+#define SUITE_DEFAULT_MEMORY_LIMIT (WORD(1) << 32)
+#define SUITE_DEFAULT_THRESHOLD 0.1
+
+/* shorter times are dominated by overheads, not by the tableau */
+#define SUITE_MIN_SCALING_SECONDS 1e-3
+
+typedef struct
+{
+    const char *precision;
+    tkf91_dp_fn f;
+    int requires_tableau;
+} tier_struct;
+
+static const tier_struct _tiers[] = {
+    {"float", tkf91_dp_f, 0},
+    {"double", tkf91_dp_d, 0},
+    {"mag", tkf91_dp_mag, 1},
+    {"high", tkf91_dp_high, 1},
+    {"auto", tkf91_dp_auto, 1}};
+
+static const slong _ntiers = sizeof(_tiers) / sizeof(tier_struct);
+
+static const slong _default_lengths[] = {10, 100, 1000, 10000, 100000};
+
+static const slong _ndefault_lengths =
+    sizeof(_default_lengths) / sizeof(slong);
+
+/* the userdata, set when a result regressed or the solver failed */
+typedef struct
+{
+    int regressed;
+    int failed;
+} suite_status_struct;
+
+
+static const tier_struct * _tier(const char *precision);
+static uint64_t _next(uint64_t *state);
+static void _random_pair(slong *A, slong *plen_A, slong *B, slong *plen_B,
+        slong n, uint64_t *state);
+static int _sample(double *seconds, const tier_struct *t,
+        tkf91_model_context_t ctx,
+        const slong *A, slong len_A, const slong *B, slong len_B);
+static int _baseline_point(double *median, double *mad,
+        const json_t *baseline, const char *precision, slong length);
+
+json_t *run(void * userdata, json_t *root);
+
+
+const tier_struct *
+_tier(const char *precision)
+{
+    slong i;
+    for (i = 0; i < _ntiers; i++)
+    {
+        if (!strcmp(_tiers[i].precision, precision))
+        {
+            return _tiers + i;
+        }
+    }
+    return NULL;
+}
+
+uint64_t
+_next(uint64_t *state)
+{
+    /*
+     * splitmix64, so that the sequences do not depend on the
+     * random number generator of the installed flint version
+     */
+    uint64_t z;
+    *state += UINT64_C(0x9e3779b97f4a7c15);
+    z = *state;
+    z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return z ^ (z >> 31);
+}
+
+void
+_random_pair(slong *A, slong *plen_A, slong *B, slong *plen_B,
+        slong n, uint64_t *state)
+{
+    /*
+     * B has room for 2n characters. Each character of A is deleted
+     * or preceded by an insertion with probability 1/20 each,
+     * and substituted with probability 1/10.
+     */
+    slong i, len_B;
+    uint64_t r;
+
+    for (i = 0; i < n; i++)
+    {
+        A[i] = (slong) (_next(state) % 4);
+    }
+
+    len_B = 0;
+    for (i = 0; i < n; i++)
+    {
+        r = _next(state) % 20;
+        if (r == 0)
+        {
+            continue;
+        }
+        if (r == 1)
+        {
+            B[len_B++] = (slong) (_next(state) % 4);
+        }
+        if (r == 2 || r == 3)
+        {
+            B[len_B++] = (slong) (_next(state) % 4);
+        }
+        else
+        {
+            B[len_B++] = A[i];
+        }
+    }
+    if (!len_B)
+    {
+        B[len_B++] = (slong) (_next(state) % 4);
+    }
+
+    *plen_A = n;
+    *plen_B = len_B;
+}
+
+/* returns the status of the solver */
+int
+_sample(double *seconds, const tier_struct *t, tkf91_model_context_t ctx,
+        const slong *A, slong len_A, const slong *B, slong len_B)
+{
+    const tkf91_generator_indices_struct * generators;
+    solution_t sol;
+    dp_mat_t tableau;
+    request_t req;
+    timing_mark_t start, end;
+    int status;
+
+    generators = tkf91_model_context_generators(ctx, A, len_A, B, len_B);
+
+    req->trace = 1;
+    req->rtol = 0;
+    req->budget = NULL;
+    req->checkpoint = NULL;
+    req->ctx = ctx;
+    req->timing = NULL;
+    req->diagnostics = NULL;
+
+    timing_mark(NULL, start);
+    solution_init(sol, len_A + len_B);
+    if (t->requires_tableau)
+    {
+        dp_mat_init(tableau, len_A + 1, len_B + 1);
+        sol->mat = tableau;
+    }
+    status = t->f(sol, req, ctx->mat, ctx->expressions_table, generators,
+            A, len_A, B, len_B);
+    if (t->requires_tableau)
+    {
+        dp_mat_clear(tableau);
+    }
+    solution_clear(sol);
+    timing_mark(NULL, end);
+
+    *seconds = end->wall - start->wall;
+    return status;
+}
+
+int
+_baseline_point(double *median, double *mad,
+        const json_t *baseline, const char *precision, slong length)
+{
+    const json_t *results, *x, *p, *n, *m, *d;
+    size_t i;
+
+    results = json_object_get(baseline, "results");
+    for (i = 0; i < json_array_size(results); i++)
+    {
+        x = json_array_get(results, i);
+        p = json_object_get(x, "precision");
+        n = json_object_get(x, "length");
+        m = json_object_get(x, "median_seconds");
+        d = json_object_get(x, "mad_seconds");
+        if (json_is_string(p) && !strcmp(json_string_value(p), precision) &&
+            json_is_integer(n) && json_integer_value(n) == length &&
+            json_is_number(m) && json_is_number(d))
+        {
+            *median = json_number_value(m);
+            *mad = json_number_value(d);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+
+json_t *run(void * userdata, json_t *root)
+{
+    suite_status_struct *status;
+    json_t *j_out, *j_lengths, *j_precisions, *parameters, *baseline;
+    json_t *results, *scaling, *regressions, *point;
+    model_params_t p;
+    tkf91_model_context_t ctx;
+    const tier_struct **tiers;
+    slong *lengths;
+    slong ntiers, nlengths, i, j, k, npoints, nfit;
+    slong *A, *B;
+    slong len_A, len_B, max_length, cells;
+    int warmup, samples, result;
+    json_int_t seed, memory_limit;
+    double time_limit, threshold;
+    double *times, *sizes, *medians, *fit_sizes, *fit_times;
+    double previous, exponent, base_median, base_mad;
+    slong previous_length;
+    int failure;
+    const char *baseline_file;
+    const char *skipped;
+    bench_summary_t s;
+    uint64_t state;
+    json_error_t err;
+    size_t flags;
+
+    status = userdata;
+
+    /* default values of optional json arguments */
+    j_lengths = NULL;
+    j_precisions = NULL;
+    warmup = SUITE_DEFAULT_WARMUP;
+    samples = SUITE_DEFAULT_SAMPLES;
+    seed = 0;
+    time_limit = SUITE_DEFAULT_TIME_LIMIT;
+    memory_limit = SUITE_DEFAULT_MEMORY_LIMIT;
+    baseline_file = NULL;
+    threshold = SUITE_DEFAULT_THRESHOLD;
+
+    flags = JSON_STRICT;
+    result = json_unpack_ex(root, &err, flags,
+            "{s:o, s?o, s?o, s?i, s?i, s?I, s?F, s?I, s?s, s?F}",
+            "parameters", &parameters,
+            "lengths", &j_lengths,
+            "precisions", &j_precisions,
+            "warmup", &warmup,
+            "samples", &samples,
+            "seed", &seed,
+            "time_limit", &time_limit,
+            "memory_limit", &memory_limit,
+            "baseline", &baseline_file,
+            "threshold", &threshold);
+    if (result)
+    {
+        return json_error_response("on line %d: %s", err.line, err.text);
+    }
+    if (warmup < 0 || samples < 1)
+    {
+        return json_error_response("expected a nonnegative number of "
+                "warmup runs and a positive number of samples");
+    }
+
+    /* an invalid request is answered before the sweep */
+    model_params_init(p);
+    lengths = NULL;
+    tiers = NULL;
+    result = _json_get_model_params_ex(p, parameters, &err, flags);
+    if (result)
+    {
+        j_out = json_error_response("on line %d: %s", err.line, err.text);
+        goto invalid;
+    }
+    result = model_params_validate(p);
+    if (result)
+    {
+        j_out = json_error_response("invalid model parameters");
+        goto invalid;
+    }
+
+    /* the sequence lengths */
+    if (j_lengths)
+    {
+        nlengths = json_array_size(j_lengths);
+        lengths = flint_malloc(FLINT_MAX(nlengths, 1) * sizeof(slong));
+        for (j = 0; j < nlengths; j++)
+        {
+            point = json_array_get(j_lengths, j);
+            if (!json_is_integer(point) || json_integer_value(point) < 1)
+            {
+                j_out = json_error_response("expected the lengths "
+                        "to be positive integers");
+                goto invalid;
+            }
+            lengths[j] = (slong) json_integer_value(point);
+        }
+    }
+    else
+    {
+        nlengths = _ndefault_lengths;
+        lengths = flint_malloc(nlengths * sizeof(slong));
+        for (j = 0; j < nlengths; j++)
+        {
+            lengths[j] = _default_lengths[j];
+        }
+    }
+
+    /* the precision tiers */
+    if (j_precisions)
+    {
+        ntiers = json_array_size(j_precisions);
+        tiers = flint_malloc(FLINT_MAX(ntiers, 1) * sizeof(tier_struct *));
+        for (i = 0; i < ntiers; i++)
+        {
+            point = json_array_get(j_precisions, i);
+            if (!json_is_string(point) ||
+                !(tiers[i] = _tier(json_string_value(point))))
+            {
+                j_out = json_error_response("expected the precision "
+                        "strings to be in "
+                        "{'float' | 'double' | 'mag' | 'high' | 'auto'}");
+                goto invalid;
+            }
+        }
+    }
+    else
+    {
+        ntiers = _ntiers;
+        tiers = flint_malloc(ntiers * sizeof(tier_struct *));
+        for (i = 0; i < ntiers; i++)
+        {
+            tiers[i] = _tiers + i;
+        }
+    }
+
+    baseline = NULL;
+    if (baseline_file)
+    {
+        baseline = json_load_file(baseline_file, 0, &err);
+        if (!baseline)
+        {
+            j_out = json_error_response("failed to read the baseline %s: %s",
+                    baseline_file, err.text);
+            goto invalid;
+        }
+    }
+
+    max_length = 1;
+    for (j = 0; j < nlengths; j++)
+    {
+        max_length = FLINT_MAX(max_length, lengths[j]);
+    }
+    A = flint_malloc(max_length * sizeof(slong));
+    B = flint_malloc(2 * max_length * sizeof(slong));
+    times = flint_malloc(samples * sizeof(double));
+    sizes = flint_malloc(FLINT_MAX(nlengths, 1) * sizeof(double));
+    medians = flint_malloc(FLINT_MAX(nlengths, 1) * sizeof(double));
+    fit_sizes = flint_malloc(FLINT_MAX(nlengths, 1) * sizeof(double));
+    fit_times = flint_malloc(FLINT_MAX(nlengths, 1) * sizeof(double));
+
+    tkf91_model_context_init(ctx, p);
+
+    results = json_array();
+    scaling = json_array();
+    regressions = json_array();
+    for (i = 0; i < ntiers; i++)
+    {
+        npoints = 0;
+        previous = -1;
+        previous_length = 0;
+        for (j = 0; j < nlengths; j++)
+        {
+            /* the same pair of sequences for every tier */
+            state = (uint64_t) seed ^ ((uint64_t) lengths[j] << 32);
+            _random_pair(A, &len_A, B, &len_B, lengths[j], &state);
+            cells = (len_A + 1) * (len_B + 1);
+
+            skipped = NULL;
+            if (plan_estimate_bytes(tiers[i]->precision,
+                        PLAN_MEMORY_FULL_TABLEAU, len_A, len_B) >
+                    memory_limit)
+            {
+                skipped = "memory_limit";
+            }
+            else if (previous >= 0 && previous * pow(
+                        (double) lengths[j] / previous_length, 2) > time_limit)
+            {
+                skipped = "time_limit";
+            }
+            if (skipped)
+            {
+                json_array_append_new(results, json_pack("{s:s, s:I, s:s}",
+                            "precision", tiers[i]->precision,
+                            "length", (json_int_t) lengths[j],
+                            "skipped", skipped));
+                continue;
+            }
+
+            failure = 0;
+            for (k = 0; k < warmup && !failure; k++)
+            {
+                failure = _sample(times, tiers[i], ctx, A, len_A, B, len_B);
+            }
+            for (k = 0; k < samples && !failure; k++)
+            {
+                failure = _sample(times + k,
+                        tiers[i], ctx, A, len_A, B, len_B);
+            }
+            if (failure)
+            {
+                point = _json_solver_error(failure);
+                json_object_set_new(point, "precision",
+                        json_string(tiers[i]->precision));
+                json_object_set_new(point, "length",
+                        json_integer((json_int_t) lengths[j]));
+                json_array_append_new(results, point);
+                status->failed = 1;
+                continue;
+            }
+            bench_summarize(s, times, samples);
+            previous = s->median;
+            previous_length = lengths[j];
+
+            point = json_pack("{s:s, s:I, s:I, s:f, s:f, s:f, s:f, s:f, "
+                    "s:f, s:f, s:f, s:f}",
+                    "precision", tiers[i]->precision,
+                    "length", (json_int_t) lengths[j],
+                    "cells", (json_int_t) cells,
+                    "median_seconds", s->median,
+                    "mad_seconds", s->mad,
+                    "min_seconds", s->min,
+                    "p05_seconds", s->p05,
+                    "p25_seconds", s->p25,
+                    "p75_seconds", s->p75,
+                    "p95_seconds", s->p95,
+                    "max_seconds", s->max,
+                    "cells_per_second",
+                    s->median > 0 ? cells / s->median : 0.0);
+
+            if (baseline && !_baseline_point(&base_median, &base_mad,
+                        baseline, tiers[i]->precision, lengths[j]))
+            {
+                json_object_set_new(point, "baseline_median_seconds",
+                        json_real(base_median));
+                if (base_median > 0)
+                {
+                    json_object_set_new(point, "ratio",
+                            json_real(s->median / base_median));
+                }
+                if (s->median > (1 + threshold) * base_median &&
+                    s->median - base_median > 2 * (s->mad + base_mad))
+                {
+                    flint_fprintf(stderr, "regression: %s at length %wd: "
+                            "%g seconds, baseline %g seconds\n",
+                            tiers[i]->precision, lengths[j],
+                            s->median, base_median);
+                    json_array_append(regressions, point);
+                    status->regressed = 1;
+                }
+            }
+            json_array_append_new(results, point);
+
+            sizes[npoints] = lengths[j];
+            medians[npoints] = s->median;
+            npoints++;
+        }
+
+        /* fit the scaling exponent to the times that are long enough */
+        nfit = 0;
+        for (k = 0; k < npoints; k++)
+        {
+            if (medians[k] >= SUITE_MIN_SCALING_SECONDS)
+            {
+                fit_sizes[nfit] = sizes[k];
+                fit_times[nfit] = medians[k];
+                nfit++;
+            }
+        }
+        if (nfit < 2)
+        {
+            nfit = 0;
+            for (k = 0; k < npoints; k++)
+            {
+                if (medians[k] > 0)
+                {
+                    fit_sizes[nfit] = sizes[k];
+                    fit_times[nfit] = medians[k];
+                    nfit++;
+                }
+            }
+        }
+        if (!bench_scaling_exponent(&exponent, fit_sizes, fit_times, nfit))
+        {
+            json_array_append_new(scaling, json_pack("{s:s, s:f, s:I}",
+                        "precision", tiers[i]->precision,
+                        "exponent", exponent,
+                        "points", (json_int_t) nfit));
+        }
+    }
+
+    j_out = json_pack("{s:o, s:o}",
+            "results", results,
+            "scaling", scaling);
+    if (baseline)
+    {
+        json_object_set_new(j_out, "threshold", json_real(threshold));
+        json_object_set_new(j_out, "regressions", regressions);
+        json_decref(baseline);
+    }
+    else
+    {
+        json_decref(regressions);
+    }
+
+    tkf91_model_context_clear(ctx);
+    flint_free(A);
+    flint_free(B);
+    flint_free(times);
+    flint_free(sizes);
+    flint_free(medians);
+    flint_free(fit_sizes);
+    flint_free(fit_times);
+invalid:
+    flint_free(lengths);
+    flint_free(tiers);
+    model_params_clear(p);
+
+    return j_out;
+}
+
+
+int main(void)
+{
+    json_hom_t hom;
+    suite_status_struct status;
+    int result;
+
+    status.regressed = 0;
+    status.failed = 0;
+    hom->userdata = &status;
+    hom->clear = NULL;
+    hom->f = run;
+    result = run_json_script(hom);
+    if (!result && (status.regressed || status.failed))
+    {
+        result = 1;
+    }
+
+    flint_cleanup();
+    return result;
+}
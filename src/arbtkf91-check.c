@@ -7,6 +7,20 @@
  * "alignment_is_optimal" : bool,
  * "alignment_is_canonical" : bool
  * }
+ *
+ * The optional "certification" and "plan" members written by
+ * 'arbtkf91-align' are accepted in the input and ignored, so that
+ * the output of the alignment tool can be checked directly.
+ *
+ * The optional "tableau_in" and "tableau_out" inputs name files
+ * that hold a certified tableau; see 'arbtkf91-align'.
+ *
+ * With --serve=PATH the requests are served on a Unix domain socket
+ * at that path instead; see 'jsonserver.h'.
+ *
+ * With --cache=DIR and optionally --cache-bytes=N the results are kept
+ * in an on-disk cache as in 'arbtkf91-align', except for the requests
+ * with tableau files.
  */
 
 #include <time.h>
@@ -17,15 +31,18 @@
 #include "jansson.h"
 
 #include "runjson.h"
+#include "jsonserver.h"
 #include "jsonutil.h"
 #include "tkf91_dp_bound.h"
 #include "tkf91_dp_r.h"
-#include "tkf91_rgenerators.h"
+#include "tkf91_model_context.h"
 #include "tkf91_generator_indices.h"
 #include "model_params.h"
 #include "json_model_params.h"
 #include "bound_mat.h"
 #include "printutil.h"
+#include "tableau_file.h"
+#include "json_result_cache.h"
 
 
 typedef struct
@@ -73,8 +90,8 @@ sequence_pair_init(sequence_pair_t x, alignment_t aln)
 {
     slong i;
     slong value;
-    x->A = malloc(aln->len * sizeof(slong));
-    x->B = malloc(aln->len * sizeof(slong));
+    x->A = flint_malloc(aln->len * sizeof(slong));
+    x->B = flint_malloc(aln->len * sizeof(slong));
     x->len_A = 0;
     x->len_B = 0;
     
@@ -98,15 +115,15 @@ sequence_pair_init(sequence_pair_t x, alignment_t aln)
 void
 sequence_pair_clear(sequence_pair_t x)
 {
-    free(x->A);
-    free(x->B);
+    flint_free(x->A);
+    flint_free(x->B);
 }
 
 
 
 
 
-void
+int
 solve(solution_t sol, const model_params_t p,
         const sequence_pair_t sequences);
 
@@ -124,29 +141,42 @@ json_t *run(void * userdata, json_t *root)
     slong *B;
     solution_t sol;
     dp_mat_t tableau;
-    int result;
+    int result, status;
     const char * sequence_a;
     const char * sequence_b;
     json_t * parameters;
+    json_t * certification;
+    json_t * plan;
+    const char * tableau_in;
+    const char * tableau_out;
+    result_key_t key;
+    result_key_t result_key;
+    result_cache_struct *results;
+    int cached;
     json_error_t err;
     size_t flags;
     slong nrows, ncols;
 
-    if (userdata)
-    {
-        fprintf(stderr, "error: unexpected userdata\n");
-        abort();
-    }
+    /* the userdata is the result cache, if any */
+    results = userdata;
 
     flags = JSON_STRICT;
-    result = json_unpack_ex(root, &err, flags, "{s:o, s:s, s:s}",
+    certification = NULL;
+    plan = NULL;
+    tableau_in = NULL;
+    tableau_out = NULL;
+    result = json_unpack_ex(root, &err, flags,
+            "{s:o, s:s, s:s, s?o, s?o, s?s, s?s}",
             "parameters", &parameters,
             "sequence_a", &sequence_a,
-            "sequence_b", &sequence_b);
+            "sequence_b", &sequence_b,
+            "certification", &certification,
+            "plan", &plan,
+            "tableau_in", &tableau_in,
+            "tableau_out", &tableau_out);
     if (result)
     {
-        fprintf(stderr, "error: on line %d: %s\n", err.line, err.text);
-        abort();
+        return json_error_response("on line %d: %s", err.line, err.text);
     }
 
     /* read the model parameter values */
@@ -154,34 +184,65 @@ json_t *run(void * userdata, json_t *root)
     result = _json_get_model_params_ex(p, parameters, &err, flags);
     if (result)
     {
-        fprintf(stderr, "error: on line %d: %s\n", err.line, err.text);
-        abort();
+        model_params_clear(p);
+        return json_error_response("on line %d: %s", err.line, err.text);
     }
     result = model_params_validate(p);
     if (result)
     {
-        fprintf(stderr, "invalid model parameters\n");
-        abort();
+        model_params_clear(p);
+        return json_error_response("invalid model parameters");
     }
 
     /* read the two aligned sequences */
 
     len_A = strlen(sequence_a);
     A = flint_malloc(len_A * sizeof(slong));
-    _fill_sequence_vector(A, sequence_a, len_A);
+    result = _fill_sequence_vector(A, sequence_a, len_A);
 
     len_B = strlen(sequence_b);
     B = flint_malloc(len_B * sizeof(slong));
-    _fill_sequence_vector(B, sequence_b, len_B);
+    result |= _fill_sequence_vector(B, sequence_b, len_B);
 
-    if (len_A != len_B)
+    if (result || len_A != len_B)
     {
-        fprintf(stderr, "error: alignment rows have different lengths\n");
-        abort();
+        flint_free(A);
+        flint_free(B);
+        model_params_clear(p);
+        return json_error_response(result ?
+                "unrecognized nucleotide in the alignment" :
+                "alignment rows have different lengths");
     }
 
     alignment_init(aln, A, B, len_A);
     sequence_pair_init(sequences, aln);
+    if (!sequences->len_A || !sequences->len_B)
+    {
+        model_params_clear(p);
+        alignment_clear(aln);
+        sequence_pair_clear(sequences);
+        return json_error_response("expected both sequences "
+                "to have length at least 1");
+    }
+
+    /* look for the result of the same request in the result cache */
+    cached = (results && tableau_in == NULL && tableau_out == NULL);
+    if (cached)
+    {
+        result_key_init(result_key, "arbtkf91-check");
+        result_key_params(result_key, p);
+        result_key_slong_vec(result_key, aln->A, aln->len);
+        result_key_slong_vec(result_key, aln->B, aln->len);
+        j_out = json_result_cache_get(results, result_key);
+        if (j_out)
+        {
+            result_key_clear(result_key);
+            model_params_clear(p);
+            alignment_clear(aln);
+            sequence_pair_clear(sequences);
+            return j_out;
+        }
+    }
 
     /* init the solution object */
     nrows = sequences->len_A + 1;
@@ -193,7 +254,44 @@ json_t *run(void * userdata, json_t *root)
     sol->mat = tableau;
 
     /* do enough of the traceback to get the solution mask */
-    solve(sol, p, sequences);
+    tableau_file_key_init(key, p,
+            sequences->A, sequences->len_A,
+            sequences->B, sequences->len_B);
+    if (tableau_in != NULL)
+    {
+        int certified;
+        slong level;
+        if (tableau_file_read(tableau_in, key, sol->mat, &certified, &level))
+        {
+            j_out = json_error_response("failed to read the tableau in %s",
+                    tableau_in);
+            goto end;
+        }
+        if (!certified)
+        {
+            j_out = json_error_response("the tableau in %s "
+                    "is not certified", tableau_in);
+            goto end;
+        }
+        sol->optimality_flag = 1;
+        sol->level = level;
+    }
+    else
+    {
+        status = solve(sol, p, sequences);
+        if (status)
+        {
+            j_out = _json_solver_error(status);
+            goto end;
+        }
+    }
+    if (tableau_out != NULL && tableau_file_write(tableau_out, key,
+                sol->mat, sol->optimality_flag, sol->level))
+    {
+        j_out = json_error_response("failed to write the tableau to %s",
+                tableau_out);
+        goto end;
+    }
 
     int optimal;
     int canonical;
@@ -205,6 +303,17 @@ json_t *run(void * userdata, json_t *root)
             "alignment_is_optimal", optimal,
             "alignment_is_canonical", canonical);
 
+    if (cached)
+    {
+        json_result_cache_put(results, result_key, j_out);
+    }
+
+end:
+    if (cached)
+    {
+        result_key_clear(result_key);
+    }
+    result_key_clear(key);
     solution_clear(sol);
     model_params_clear(p);
     alignment_clear(aln);
@@ -216,63 +325,99 @@ json_t *run(void * userdata, json_t *root)
 
 
 
-void
+/* returns the status of the solver */
+int
 solve(solution_t sol, const model_params_t p,
         const sequence_pair_t sequences)
 {
-    tkf91_rationals_t r;
-    tkf91_expressions_t expressions;
-    tkf91_generator_indices_t generators;
-    fmpz_mat_t mat;
-    expr_ptr * expressions_table;
+    tkf91_model_context_t ctx;
+    const tkf91_generator_indices_struct * generators;
     request_t req;
+    int status;
     slong *A = sequences->A;
     slong szA = sequences->len_A;
     slong *B = sequences->B;
     slong szB = sequences->len_B;
 
-    /* expressions registry and (refining) generator registry */
-    reg_t er;
-    rgen_reg_ptr gr;
-
-    reg_init(er);
-    tkf91_rationals_init(r, p->lambda, p->mu, p->tau, p->pi);
-    tkf91_expressions_init(expressions, er, r);
-
-    gr = rgen_reg_new();
-    tkf91_rgenerators_init(generators, gr, r, expressions, A, szA, B, szB);
-    rgen_reg_finalize(gr, er);
-    fmpz_mat_init(mat, rgen_reg_nrows(gr), rgen_reg_ncols(gr));
-    rgen_reg_get_matrix(mat, gr);
-
-    rgen_reg_clear(gr);
-    tkf91_rationals_clear(r);
-
-    expressions_table = reg_vec(er);
+    /* the model context is shared by every pair of first characters */
+    tkf91_model_context_init(ctx, p);
+    generators = tkf91_model_context_generators(ctx, A, szA, B, szB);
+    if (!generators)
+    {
+        tkf91_model_context_clear(ctx);
+        return TKF91_ERROR_DIMENSIONS;
+    }
 
     /* init request object */
     req->trace = 1;
-
-    tkf91_dp_high(
-            sol, req, mat, expressions_table, generators,
+    req->budget = NULL;
+    req->checkpoint = NULL;
+    req->timing = NULL;
+    req->diagnostics = NULL;
+    req->ctx = ctx;
+
+    status = tkf91_dp_high(
+            sol, req, ctx->mat, ctx->expressions_table, generators,
             A, szA, B, szB);
 
-    fmpz_mat_clear(mat);
-    flint_free(expressions_table);
-
-    reg_clear(er);
-    tkf91_expressions_clear(expressions);
+    tkf91_model_context_clear(ctx);
+    return status;
 }
 
 
 
-int main(void)
+int main(int argc, char *argv[])
 {
     json_hom_t hom;
+    result_cache_t results;
+    const char *serve;
+    const char *cache_dir;
+    slong cache_bytes;
+    int i, result;
+
     hom->userdata = NULL;
     hom->clear = NULL;
     hom->f = run;
-    int result = run_json_script(hom);
+
+    serve = NULL;
+    cache_dir = NULL;
+    cache_bytes = JSON_RESULT_CACHE_BYTES;
+    for (i = 1; i < argc; i++)
+    {
+        if (!strncmp(argv[i], "--serve=", 8))
+        {
+            serve = argv[i] + 8;
+        }
+        else if (json_result_cache_option(&cache_dir, &cache_bytes, argv[i]))
+        {
+            fprintf(stderr, "usage: %s [--serve=PATH] "
+                    "[--cache=DIR [--cache-bytes=N]]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (cache_dir)
+    {
+        if (result_cache_init(results, cache_dir, cache_bytes))
+        {
+            return 1;
+        }
+        hom->userdata = results;
+    }
+
+    if (serve)
+    {
+        result = run_json_server(hom, serve, 0, NULL, NULL);
+    }
+    else
+    {
+        result = run_json_script(hom);
+    }
+
+    if (cache_dir)
+    {
+        result_cache_clear(results);
+    }
 
     flint_cleanup();
     return result;
@@ -4,6 +4,16 @@
  * although that seems somewhat silly in this case because the
  * output is just a single number that is likely so large that it
  * cannot even be represented in json except as a string.
+ *
+ * The optional "tableau_in" and "tableau_out" inputs name files
+ * that hold a certified tableau; see 'arbtkf91-align'.
+ *
+ * With --serve=PATH the requests are served on a Unix domain socket
+ * at that path instead; see 'jsonserver.h'.
+ *
+ * With --cache=DIR and optionally --cache-bytes=N the results are kept
+ * in an on-disk cache as in 'arbtkf91-align', except for the requests
+ * with tableau files.
  */
 
 #include "flint/flint.h"
@@ -12,16 +22,19 @@
 #include "jansson.h"
 
 #include "runjson.h"
+#include "jsonserver.h"
 #include "jsonutil.h"
 #include "tkf91_dp_r.h"
-#include "tkf91_rgenerators.h"
+#include "tkf91_model_context.h"
 #include "tkf91_generator_indices.h"
 #include "model_params.h"
 #include "json_model_params.h"
 #include "count_solutions.h"
+#include "tableau_file.h"
+#include "json_result_cache.h"
 
 
-void solve(fmpz_t res, solution_t sol, const model_params_t p,
+int solve(fmpz_t res, solution_t sol, const model_params_t p,
         const slong *A, slong szA, const slong *B, slong szB);
 
 
@@ -35,7 +48,7 @@ json_t *run(void * userdata, json_t *root)
     slong *A;
     slong *B;
     solution_t sol;
-    int result;
+    int result, status;
     json_t *parameters;
     const char * sequence_a;
     const char * sequence_b;
@@ -43,48 +56,84 @@ json_t *run(void * userdata, json_t *root)
     size_t flags;
     slong nrows, ncols;
     dp_mat_t tableau;
+    const char * tableau_in;
+    const char * tableau_out;
+    result_key_t key;
+    result_key_t result_key;
+    result_cache_struct *results;
+    int cached;
 
-    if (userdata)
-    {
-        fprintf(stderr, "error: unexpected userdata\n");
-        abort();
-    }
+    /* the userdata is the result cache, if any */
+    results = userdata;
+
+    tableau_in = NULL;
+    tableau_out = NULL;
 
     flags = JSON_STRICT;
     result = json_unpack_ex(root, &err, flags,
-            "{s:o, s:s, s:s}",
+            "{s:o, s:s, s:s, s?s, s?s}",
             "parameters", &parameters,
             "sequence_a", &sequence_a,
-            "sequence_b", &sequence_b);
+            "sequence_b", &sequence_b,
+            "tableau_in", &tableau_in,
+            "tableau_out", &tableau_out);
     if (result)
     {
-        fprintf(stderr, "error: on line %d: %s\n", err.line, err.text);
-        abort();
+        return json_error_response("on line %d: %s", err.line, err.text);
     }
 
     model_params_init(p);
     result = _json_get_model_params_ex(p, parameters, &err, flags);
     if (result)
     {
-        fprintf(stderr, "error: on line %d: %s\n", err.line, err.text);
-        abort();
+        model_params_clear(p);
+        return json_error_response("on line %d: %s", err.line, err.text);
     }
     result = model_params_validate(p);
     if (result)
     {
-        fprintf(stderr, "invalid model parameters\n");
-        abort();
+        model_params_clear(p);
+        return json_error_response("invalid model parameters");
     }
 
     /* read the two unaligned sequences */
 
     len_A = strlen(sequence_a);
     A = flint_malloc(len_A * sizeof(slong));
-    _fill_sequence_vector(A, sequence_a, len_A);
+    result = _fill_sequence_vector(A, sequence_a, len_A);
 
     len_B = strlen(sequence_b);
     B = flint_malloc(len_B * sizeof(slong));
-    _fill_sequence_vector(B, sequence_b, len_B);
+    result |= _fill_sequence_vector(B, sequence_b, len_B);
+
+    if (result || !len_A || !len_B)
+    {
+        flint_free(A);
+        flint_free(B);
+        model_params_clear(p);
+        return json_error_response(result ?
+                "unrecognized nucleotide in the sequences" :
+                "expected both sequences to have length at least 1");
+    }
+
+    /* look for the result of the same request in the result cache */
+    cached = (results && tableau_in == NULL && tableau_out == NULL);
+    if (cached)
+    {
+        result_key_init(result_key, "arbtkf91-count");
+        result_key_params(result_key, p);
+        result_key_slong_vec(result_key, A, len_A);
+        result_key_slong_vec(result_key, B, len_B);
+        j_out = json_result_cache_get(results, result_key);
+        if (j_out)
+        {
+            result_key_clear(result_key);
+            flint_free(A);
+            flint_free(B);
+            model_params_clear(p);
+            return j_out;
+        }
+    }
 
     nrows = len_A + 1;
     ncols = len_B + 1;
@@ -93,16 +142,71 @@ json_t *run(void * userdata, json_t *root)
     sol->mat = tableau;
 
     char * solution_count_string;
+    status = 0;
+    solution_count_string = NULL;
+    j_out = NULL;
     {
         fmpz_t count;
         fmpz_init(count);
-        solve(count, sol, p, A, len_A, B, len_B);
-        solution_count_string = fmpz_get_str(NULL, 10, count);
+        tableau_file_key_init(key, p, A, len_A, B, len_B);
+        if (tableau_in != NULL)
+        {
+            int certified;
+            slong level;
+            if (tableau_file_read(tableau_in, key, tableau,
+                        &certified, &level))
+            {
+                j_out = json_error_response("failed to read "
+                        "the tableau in %s", tableau_in);
+            }
+            else if (!certified)
+            {
+                j_out = json_error_response("the tableau in %s "
+                        "is not certified", tableau_in);
+            }
+            else
+            {
+                sol->optimality_flag = 1;
+                sol->level = level;
+                count_solutions(count, tableau);
+            }
+        }
+        else
+        {
+            status = solve(count, sol, p, A, len_A, B, len_B);
+        }
+        if (status)
+        {
+            j_out = _json_solver_error(status);
+        }
+        if (!j_out && tableau_out != NULL && tableau_file_write(tableau_out,
+                    key, tableau, sol->optimality_flag, sol->level))
+        {
+            j_out = json_error_response("failed to write "
+                    "the tableau to %s", tableau_out);
+        }
+        if (!j_out)
+        {
+            solution_count_string = fmpz_get_str(NULL, 10, count);
+        }
         fmpz_clear(count);
+        result_key_clear(key);
     }
 
-    j_out = json_pack("{s:s}",
-            "number_of_optimal_alignments", solution_count_string);
+    /* the error response, if any, is not cached */
+    if (solution_count_string)
+    {
+        j_out = json_pack("{s:s}",
+                "number_of_optimal_alignments", solution_count_string);
+        if (cached)
+        {
+            json_result_cache_put(results, result_key, j_out);
+        }
+    }
+    if (cached)
+    {
+        result_key_clear(result_key);
+    }
 
     flint_free(solution_count_string);
     flint_free(A);
@@ -116,58 +220,99 @@ json_t *run(void * userdata, json_t *root)
 
 
 
-void
+/* returns the status of the solver, counting only if it succeeded */
+int
 solve(fmpz_t res, solution_t sol, const model_params_t p,
         const slong *A, slong szA, const slong *B, slong szB)
 {
-    tkf91_rationals_t r;
-    tkf91_expressions_t expressions;
-    tkf91_generator_indices_t generators;
-    fmpz_mat_t mat;
-    expr_ptr * expressions_table;
+    tkf91_model_context_t ctx;
+    const tkf91_generator_indices_struct * generators;
     request_t req;
+    int status;
 
-    /* expressions registry and (refining) generator registry */
-    reg_t er;
-    rgen_reg_ptr gr;
-
-    reg_init(er);
-    tkf91_rationals_init(r, p->lambda, p->mu, p->tau, p->pi);
-    tkf91_expressions_init(expressions, er, r);
-
-    gr = rgen_reg_new();
-    tkf91_rgenerators_init(generators, gr, r, expressions, A, szA, B, szB);
-    rgen_reg_finalize(gr, er);
-    fmpz_mat_init(mat, rgen_reg_nrows(gr), rgen_reg_ncols(gr));
-    rgen_reg_get_matrix(mat, gr);
-
-    rgen_reg_clear(gr);
-    tkf91_rationals_clear(r);
-
-    expressions_table = reg_vec(er);
+    /* the model context is shared by every pair of first characters */
+    tkf91_model_context_init(ctx, p);
+    generators = tkf91_model_context_generators(ctx, A, szA, B, szB);
+    if (!generators)
+    {
+        tkf91_model_context_clear(ctx);
+        return TKF91_ERROR_DIMENSIONS;
+    }
 
     /* init request object */
     req->trace = 1;
+    req->budget = NULL;
+    req->checkpoint = NULL;
+    req->timing = NULL;
+    req->diagnostics = NULL;
+    req->ctx = ctx;
+
+    status = tkf91_dp_high(sol, req,
+            ctx->mat, ctx->expressions_table, generators,
+            A, szA, B, szB);
+    if (!status)
+    {
+        count_solutions(res, sol->mat);
+    }
 
-    tkf91_dp_high(sol, req, mat, expressions_table, generators, A, szA, B, szB);
-    count_solutions(res, sol->mat);
-
-    fmpz_mat_clear(mat);
-    flint_free(expressions_table);
-
-    reg_clear(er);
-    tkf91_expressions_clear(expressions);
+    tkf91_model_context_clear(ctx);
+    return status;
 }
 
 
 
-int main(void)
+int main(int argc, char *argv[])
 {
     json_hom_t hom;
+    result_cache_t results;
+    const char *serve;
+    const char *cache_dir;
+    slong cache_bytes;
+    int i, result;
+
     hom->userdata = NULL;
     hom->clear = NULL;
     hom->f = run;
-    int result = run_json_script(hom);
+
+    serve = NULL;
+    cache_dir = NULL;
+    cache_bytes = JSON_RESULT_CACHE_BYTES;
+    for (i = 1; i < argc; i++)
+    {
+        if (!strncmp(argv[i], "--serve=", 8))
+        {
+            serve = argv[i] + 8;
+        }
+        else if (json_result_cache_option(&cache_dir, &cache_bytes, argv[i]))
+        {
+            fprintf(stderr, "usage: %s [--serve=PATH] "
+                    "[--cache=DIR [--cache-bytes=N]]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (cache_dir)
+    {
+        if (result_cache_init(results, cache_dir, cache_bytes))
+        {
+            return 1;
+        }
+        hom->userdata = results;
+    }
+
+    if (serve)
+    {
+        result = run_json_server(hom, serve, 0, NULL, NULL);
+    }
+    else
+    {
+        result = run_json_script(hom);
+    }
+
+    if (cache_dir)
+    {
+        result_cache_clear(results);
+    }
 
     flint_cleanup();
     return result;
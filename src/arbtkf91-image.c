@@ -1,5 +1,16 @@
 /*
  * Visualize the tableau.
+ *
+ * The optional "tableau_in" and "tableau_out" inputs name files
+ * that hold a certified tableau; see 'arbtkf91-align'.
+ *
+ * The "image_mode" is "full", "simple", or "unresolved" for a heatmap
+ * of the cells that were left unresolved by the rounds of refinement
+ * at increasing precision; see 'diagnostics.h'. This mode shows where
+ * the certification effort goes, so it needs a solve, not a tableau_in.
+ *
+ * With --serve=PATH the requests are served on a Unix domain socket
+ * at that path instead; see 'jsonserver.h'.
  */
 
 #include "flint/flint.h"
@@ -8,21 +19,22 @@
 #include "jansson.h"
 
 #include "runjson.h"
+#include "jsonserver.h"
 #include "jsonutil.h"
 #include "tkf91_dp_r.h"
-#include "tkf91_rgenerators.h"
+#include "tkf91_model_context.h"
 #include "tkf91_generator_indices.h"
 #include "model_params.h"
 #include "json_model_params.h"
 #include "printutil.h"
 #include "dp.h"
 #include "vis.h"
+#include "tableau_file.h"
 
 
 
-void
-solve(solution_t sol, int image_mode_full, const char * image_filename,
-        const model_params_t p,
+int
+solve(solution_t sol, const model_params_t p, diagnostics_ptr diagnostics,
         const slong *A, slong len_A, const slong *B, slong len_B);
 
 
@@ -30,18 +42,24 @@ json_t *run(void * userdata, json_t *root);
 
 json_t *run(void * userdata, json_t *root)
 {
+    json_t *j_out;
     model_params_t p;
     slong len_A, len_B;
     slong *A;
     slong *B;
     solution_t sol;
-    int result;
+    int result, status;
     json_t * parameters;
     const char * sequence_a;
     const char * sequence_b;
     const char * image_filename;
     const char * image_mode;
     int image_mode_full;
+    int image_mode_unresolved;
+    diagnostics_t diagnostics;
+    const char * tableau_in;
+    const char * tableau_out;
+    result_key_t key;
     json_error_t err;
     size_t flags;
 
@@ -51,35 +69,27 @@ json_t *run(void * userdata, json_t *root)
         abort();
     }
 
+    tableau_in = NULL;
+    tableau_out = NULL;
+
     flags = JSON_STRICT;
-    result = json_unpack_ex(root, &err, flags, "{s:o, s:s, s:s, s:s, s:s}",
+    result = json_unpack_ex(root, &err, flags,
+            "{s:o, s:s, s:s, s:s, s:s, s?s, s?s}",
             "parameters", &parameters,
             "image_mode", &image_mode,
             "image_filename", &image_filename,
             "sequence_a", &sequence_a,
-            "sequence_b", &sequence_b);
+            "sequence_b", &sequence_b,
+            "tableau_in", &tableau_in,
+            "tableau_out", &tableau_out);
     if (result)
     {
-        fprintf(stderr, "error: on line %d: %s\n", err.line, err.text);
-        abort();
-    }
-
-    /* read the model parameter values */
-    model_params_init(p);
-    result = _json_get_model_params_ex(p, parameters, &err, flags);
-    if (result)
-    {
-        fprintf(stderr, "error: on line %d: %s\n", err.line, err.text);
-        abort();
-    }
-    result = model_params_validate(p);
-    if (result)
-    {
-        fprintf(stderr, "invalid model parameters\n");
-        abort();
+        return json_error_response("on line %d: %s", err.line, err.text);
     }
 
     /* read the image mode */
+    image_mode_full = 0;
+    image_mode_unresolved = 0;
     if (strcmp(image_mode, "simple") == 0)
     {
         image_mode_full = 0;
@@ -88,21 +98,55 @@ json_t *run(void * userdata, json_t *root)
     {
         image_mode_full = 1;
     }
+    else if (strcmp(image_mode, "unresolved") == 0)
+    {
+        image_mode_unresolved = 1;
+    }
     else
     {
-        fprintf(stderr, "error: expected image_mode : {full,simple}\n");
-        abort();
+        return json_error_response("expected image_mode : "
+                "{full,simple,unresolved}");
+    }
+    if (image_mode_unresolved && tableau_in != NULL)
+    {
+        return json_error_response("the unresolved image mode "
+                "requires a solve, not a tableau_in");
+    }
+
+    /* read the model parameter values */
+    model_params_init(p);
+    result = _json_get_model_params_ex(p, parameters, &err, flags);
+    if (result)
+    {
+        model_params_clear(p);
+        return json_error_response("on line %d: %s", err.line, err.text);
+    }
+    result = model_params_validate(p);
+    if (result)
+    {
+        model_params_clear(p);
+        return json_error_response("invalid model parameters");
     }
 
     /* read the two unaligned sequences */
 
     len_A = strlen(sequence_a);
     A = flint_malloc(len_A * sizeof(slong));
-    _fill_sequence_vector(A, sequence_a, len_A);
+    result = _fill_sequence_vector(A, sequence_a, len_A);
 
     len_B = strlen(sequence_b);
     B = flint_malloc(len_B * sizeof(slong));
-    _fill_sequence_vector(B, sequence_b, len_B);
+    result |= _fill_sequence_vector(B, sequence_b, len_B);
+
+    if (result || !len_A || !len_B)
+    {
+        flint_free(A);
+        flint_free(B);
+        model_params_clear(p);
+        return json_error_response(result ?
+                "unrecognized nucleotide in the sequences" :
+                "expected both sequences to have length at least 1");
+    }
 
     solution_init(sol, len_A + len_B);
 
@@ -113,84 +157,143 @@ json_t *run(void * userdata, json_t *root)
     dp_mat_init(tableau, nrows, ncols);
     sol->mat = tableau;
 
-    solve(sol, image_mode_full, image_filename, p, A, len_A, B, len_B);
+    diagnostics_init(diagnostics);
+    diagnostics_keep_map(diagnostics);
+
+    tableau_file_key_init(key, p, A, len_A, B, len_B);
+    if (tableau_in != NULL)
+    {
+        int certified;
+        slong level;
+        if (tableau_file_read(tableau_in, key, tableau, &certified, &level))
+        {
+            j_out = json_error_response("failed to read the tableau in %s",
+                    tableau_in);
+            goto end;
+        }
+        if (!certified)
+        {
+            j_out = json_error_response("the tableau in %s "
+                    "is not certified", tableau_in);
+            goto end;
+        }
+        sol->optimality_flag = 1;
+        sol->level = level;
+    }
+    else
+    {
+        status = solve(sol, p, image_mode_unresolved ? diagnostics : NULL,
+                A, len_A, B, len_B);
+        if (status)
+        {
+            j_out = _json_solver_error(status);
+            goto end;
+        }
+    }
+    if (tableau_out != NULL && tableau_file_write(tableau_out, key,
+                tableau, sol->optimality_flag, sol->level))
+    {
+        j_out = json_error_response("failed to write the tableau to %s",
+                tableau_out);
+        goto end;
+    }
+
+    /* create the tableau png image; there is no other output */
+    j_out = NULL;
+    if (image_mode_unresolved)
+    {
+        result = write_unresolved_image(
+                image_filename, sol->mat, diagnostics, "tkf91 unresolved");
+    }
+    else if (image_mode_full)
+    {
+        result = write_tableau_image(
+                image_filename, sol->mat, "tkf91 tableau");
+    }
+    else
+    {
+        result = write_simple_tableau_image(
+                image_filename, sol->mat, "tkf91 tableau");
+    }
+    if (result)
+    {
+        j_out = json_error_response("failed to write the image %s",
+                image_filename);
+    }
 
+end:
+    result_key_clear(key);
     flint_free(A);
     flint_free(B);
     solution_clear(sol);
     model_params_clear(p);
     dp_mat_clear(tableau);
+    diagnostics_clear(diagnostics);
 
-    return NULL;
+    return j_out;
 }
 
 
 
-void
-solve(solution_t sol, int image_mode_full, const char * image_filename,
-        const model_params_t p,
+/* returns the status of the solver */
+int
+solve(solution_t sol, const model_params_t p, diagnostics_ptr diagnostics,
         const slong *A, slong szA, const slong *B, slong szB)
 {
-    tkf91_rationals_t r;
-    tkf91_expressions_t expressions;
-    tkf91_generator_indices_t generators;
-    fmpz_mat_t mat;
-    expr_ptr * expressions_table;
+    tkf91_model_context_t ctx;
+    const tkf91_generator_indices_struct * generators;
     request_t req;
+    int status;
 
-    /* expressions registry and (refining) generator registry */
-    reg_t er;
-    rgen_reg_ptr gr;
-
-    reg_init(er);
-    tkf91_rationals_init(r, p->lambda, p->mu, p->tau, p->pi);
-    tkf91_expressions_init(expressions, er, r);
-
-    gr = rgen_reg_new();
-    tkf91_rgenerators_init(generators, gr, r, expressions, A, szA, B, szB);
-    rgen_reg_finalize(gr, er);
-    fmpz_mat_init(mat, rgen_reg_nrows(gr), rgen_reg_ncols(gr));
-    rgen_reg_get_matrix(mat, gr);
-
-    rgen_reg_clear(gr);
-    tkf91_rationals_clear(r);
-
-    expressions_table = reg_vec(er);
+    /* the model context is shared by every pair of first characters */
+    tkf91_model_context_init(ctx, p);
+    generators = tkf91_model_context_generators(ctx, A, szA, B, szB);
+    if (!generators)
+    {
+        tkf91_model_context_clear(ctx);
+        return TKF91_ERROR_DIMENSIONS;
+    }
 
     /* init request object ... this is beginning to look vestigial */
     req->trace = 1;
-
-    tkf91_dp_high(sol, req, mat, expressions_table, generators,
+    req->budget = NULL;
+    req->checkpoint = NULL;
+    req->timing = NULL;
+    req->diagnostics = diagnostics;
+    req->ctx = ctx;
+
+    status = tkf91_dp_high(sol, req,
+            ctx->mat, ctx->expressions_table, generators,
             A, szA, B, szB);
 
-    /* create the tableau png image */
-    if (image_mode_full)
-    {
-        write_tableau_image(
-                image_filename, sol->mat, "tkf91 tableau");
-    }
-    else
-    {
-        write_simple_tableau_image(
-                image_filename, sol->mat, "tkf91 tableau");
-    }
-
-    fmpz_mat_clear(mat);
-    flint_free(expressions_table);
-
-    reg_clear(er);
-    tkf91_expressions_clear(expressions);
+    tkf91_model_context_clear(ctx);
+    return status;
 }
 
 
 
-int main(void)
+int main(int argc, char *argv[])
 {
     json_hom_t hom;
+    int result;
+
     hom->userdata = NULL;
     hom->clear = NULL;
     hom->f = run;
-    int result = run_json_script(hom);
+
+    if (argc == 2 && !strncmp(argv[1], "--serve=", 8))
+    {
+        result = run_json_server(hom, argv[1] + 8, 0, NULL, NULL);
+    }
+    else if (argc > 1)
+    {
+        fprintf(stderr, "usage: %s [--serve=PATH]\n", argv[0]);
+        return 1;
+    }
+    else
+    {
+        result = run_json_script(hom);
+    }
 
     flint_cleanup();
     return result;
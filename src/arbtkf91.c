@@ -0,0 +1,337 @@
+/*
+ * Implementation of the C interface declared in arbtkf91.h.
+ * The opaque structures wrap the model parameters and context,
+ * and the solution with its aligned rows.
+ */
+
+#include "flint/flint.h"
+#include "flint/fmpq.h"
+
+#include "arb.h"
+
+#include "arbtkf91.h"
+#include "budget.h"
+#include "dp.h"
+#include "model_params.h"
+#include "tkf91_dp.h"
+#include "tkf91_dp_auto.h"
+#include "tkf91_dp_bound.h"
+#include "tkf91_dp_d.h"
+#include "tkf91_dp_f.h"
+#include "tkf91_dp_r.h"
+#include "tkf91_model_context.h"
+
+
+struct arbtkf91_model_struct
+{
+    model_params_t p;
+    tkf91_model_context_t ctx;
+};
+
+struct arbtkf91_solution_struct
+{
+    solution_t sol;
+};
+
+
+static int _set_rational(fmpq_t res, const arbtkf91_rational *x);
+static slong * _decode(const unsigned char *codes, size_t len);
+
+
+int
+_set_rational(fmpq_t res, const arbtkf91_rational *x)
+{
+    if (x->den <= 0)
+    {
+        return ARBTKF91_ERROR_INVALID;
+    }
+    fmpq_set_si(res, x->num, (ulong) x->den);
+    return ARBTKF91_OK;
+}
+
+slong *
+_decode(const unsigned char *codes, size_t len)
+{
+    /* return NULL if a code is not a nucleotide code */
+    size_t i;
+    slong *v;
+    v = flint_malloc(FLINT_MAX(1, len) * sizeof(slong));
+    for (i = 0; i < len; i++)
+    {
+        if (codes[i] > 3)
+        {
+            flint_free(v);
+            return NULL;
+        }
+        v[i] = codes[i];
+    }
+    return v;
+}
+
+
+const char *
+arbtkf91_strerror(int status)
+{
+    if (status == ARBTKF91_ERROR_INVALID)
+    {
+        return "invalid model parameters, sequences or options";
+    }
+    return tkf91_error_string(status);
+}
+
+void
+arbtkf91_options_init(arbtkf91_options *options)
+{
+    options->precision = ARBTKF91_PRECISION_HIGH;
+    options->trace = 1;
+    options->rtol = 0;
+    options->deadline_ms = -1;
+    options->cancel = NULL;
+}
+
+int
+arbtkf91_encode(unsigned char *codes, const char *s, size_t len)
+{
+    size_t i;
+    for (i = 0; i < len; i++)
+    {
+        switch (s[i])
+        {
+            case 'A': case 'a':
+                codes[i] = 0;
+                break;
+            case 'C': case 'c':
+                codes[i] = 1;
+                break;
+            case 'G': case 'g':
+                codes[i] = 2;
+                break;
+            case 'T': case 't':
+                codes[i] = 3;
+                break;
+            default:
+                if (('A' <= s[i] && s[i] <= 'Z') ||
+                    ('a' <= s[i] && s[i] <= 'z'))
+                {
+                    codes[i] = 0;
+                }
+                else
+                {
+                    return ARBTKF91_ERROR_INVALID;
+                }
+        }
+    }
+    return ARBTKF91_OK;
+}
+
+
+int
+arbtkf91_model_create(arbtkf91_model **model, const arbtkf91_params *params)
+{
+    arbtkf91_model *m;
+    slong i;
+    int result;
+
+    *model = NULL;
+
+    m = flint_malloc(sizeof(arbtkf91_model));
+    model_params_init(m->p);
+    result = 0;
+    result |= _set_rational(m->p->lambda, &params->lambda);
+    result |= _set_rational(m->p->mu, &params->mu);
+    result |= _set_rational(m->p->tau, &params->tau);
+    for (i = 0; i < 4; i++)
+    {
+        result |= _set_rational(m->p->pi + i, params->pi + i);
+    }
+    if (result || model_params_validate(m->p))
+    {
+        model_params_clear(m->p);
+        flint_free(m);
+        return ARBTKF91_ERROR_INVALID;
+    }
+
+    tkf91_model_context_init(m->ctx, m->p);
+    *model = m;
+    return ARBTKF91_OK;
+}
+
+void
+arbtkf91_model_free(arbtkf91_model *model)
+{
+    if (model)
+    {
+        tkf91_model_context_clear(model->ctx);
+        model_params_clear(model->p);
+        flint_free(model);
+    }
+}
+
+
+int
+arbtkf91_solve(arbtkf91_solution **solution,
+        const arbtkf91_model *model,
+        const unsigned char *A, size_t len_A,
+        const unsigned char *B, size_t len_B,
+        const arbtkf91_options *options)
+{
+    arbtkf91_solution *s;
+    const tkf91_generator_indices_struct * generators;
+    tkf91_dp_fn f;
+    int use_tableau;
+    dp_mat_t tableau;
+    budget_t budget;
+    request_t req;
+    slong *vA, *vB;
+    int status;
+
+    *solution = NULL;
+
+    switch (options->precision)
+    {
+        case ARBTKF91_PRECISION_FLOAT:
+            f = tkf91_dp_f;
+            use_tableau = 0;
+            break;
+        case ARBTKF91_PRECISION_DOUBLE:
+            f = tkf91_dp_d;
+            use_tableau = 0;
+            break;
+        case ARBTKF91_PRECISION_MAG:
+            f = tkf91_dp_mag;
+            use_tableau = 1;
+            break;
+        case ARBTKF91_PRECISION_HIGH:
+            f = tkf91_dp_high;
+            use_tableau = 1;
+            break;
+        case ARBTKF91_PRECISION_AUTO:
+            f = tkf91_dp_auto;
+            use_tableau = 1;
+            break;
+        default:
+            return ARBTKF91_ERROR_INVALID;
+    }
+
+    vA = _decode(A, len_A);
+    vB = _decode(B, len_B);
+    generators = NULL;
+    if (vA && vB)
+    {
+        generators = tkf91_model_context_generators(
+                model->ctx, vA, len_A, vB, len_B);
+    }
+    if (!generators)
+    {
+        flint_free(vA);
+        flint_free(vB);
+        return ARBTKF91_ERROR_INVALID;
+    }
+
+    s = flint_malloc(sizeof(arbtkf91_solution));
+    solution_init(s->sol, len_A + len_B);
+    if (use_tableau)
+    {
+        dp_mat_init(tableau, len_A + 1, len_B + 1);
+        s->sol->mat = tableau;
+    }
+
+    budget_init(budget);
+    if (options->deadline_ms >= 0)
+    {
+        budget_set_deadline_ms(budget, (slong) options->deadline_ms);
+    }
+    if (options->cancel)
+    {
+        budget_set_cancel(budget, options->cancel);
+    }
+
+    req->trace = options->trace;
+    req->rtol = options->rtol;
+    req->budget = budget;
+    req->checkpoint = NULL;
+    req->timing = NULL;
+    req->diagnostics = NULL;
+    req->ctx = model->ctx;
+
+    /* the solvers only read the generator matrix of the shared model */
+    status = f(s->sol, req,
+            (fmpz_mat_struct *) model->ctx->mat,
+            model->ctx->expressions_table,
+            generators, vA, len_A, vB, len_B);
+
+    /* the tableau is not part of the solution that can be accessed */
+    if (use_tableau)
+    {
+        dp_mat_clear(tableau);
+        s->sol->mat = NULL;
+    }
+    budget_clear(budget);
+    flint_free(vA);
+    flint_free(vB);
+
+    if (status)
+    {
+        arbtkf91_solution_free(s);
+        return status;
+    }
+
+    *solution = s;
+    return ARBTKF91_OK;
+}
+
+void
+arbtkf91_solution_free(arbtkf91_solution *solution)
+{
+    if (solution)
+    {
+        solution_clear(solution->sol);
+        flint_free(solution);
+    }
+}
+
+
+const char *
+arbtkf91_solution_a(const arbtkf91_solution *solution)
+{
+    return solution->sol->A ? solution->sol->A : "";
+}
+
+const char *
+arbtkf91_solution_b(const arbtkf91_solution *solution)
+{
+    return solution->sol->B ? solution->sol->B : "";
+}
+
+void
+arbtkf91_solution_log_probability(const arbtkf91_solution *solution,
+        double *mid, double *rad)
+{
+    const arb_struct *x = solution->sol->log_probability;
+    *mid = arf_get_d(arb_midref(x), ARF_RND_NEAR);
+    *rad = mag_get_d(arb_radref(x));
+}
+
+int
+arbtkf91_solution_verified(const arbtkf91_solution *solution)
+{
+    return solution->sol->optimality_flag;
+}
+
+int
+arbtkf91_solution_interrupted(const arbtkf91_solution *solution)
+{
+    return solution->sol->interrupted;
+}
+
+long
+arbtkf91_solution_level(const arbtkf91_solution *solution)
+{
+    return solution->sol->level;
+}
+
+long
+arbtkf91_solution_unresolved(const arbtkf91_solution *solution)
+{
+    return solution->sol->unresolved;
+}
@@ -0,0 +1,134 @@
+#ifndef ARBTKF91_H
+#define ARBTKF91_H
+
+/*
+ * C interface of the arbtkf91 library, for aligning sequence pairs
+ * from within another process instead of through the json tools.
+ *
+ * A model is built once from the tkf91 parameters and may then be
+ * used to align any number of sequence pairs, also concurrently from
+ * several threads, because solving only reads the model.
+ * Sequences are given as arrays of nucleotide codes
+ * (A=0, C=1, G=2, T=3), which arbtkf91_encode computes from a string.
+ *
+ * Functions that can fail return ARBTKF91_OK or an error code,
+ * which arbtkf91_strerror describes. This header does not depend
+ * on the flint or arb headers.
+ */
+
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* status codes; the first ones match the solver error codes */
+#define ARBTKF91_OK 0
+#define ARBTKF91_ERROR_REQUEST 1
+#define ARBTKF91_ERROR_DIMENSIONS 2
+#define ARBTKF91_ERROR_PRECISION 3
+#define ARBTKF91_ERROR_THREAD 4
+#define ARBTKF91_ERROR_INVALID 5
+
+/* precision tiers, as in the "precision" option of arbtkf91-align */
+#define ARBTKF91_PRECISION_FLOAT 0
+#define ARBTKF91_PRECISION_DOUBLE 1
+#define ARBTKF91_PRECISION_MAG 2
+#define ARBTKF91_PRECISION_HIGH 3
+#define ARBTKF91_PRECISION_AUTO 4
+
+
+typedef struct
+{
+    long num;
+    long den;
+} arbtkf91_rational;
+
+typedef struct
+{
+    arbtkf91_rational lambda;
+    arbtkf91_rational mu;
+    arbtkf91_rational tau;
+    arbtkf91_rational pi[4];
+} arbtkf91_params;
+
+/*
+ * Request options. The tableau-based tiers (mag, high and auto)
+ * require the traceback. Only the double precision tier can compute
+ * the score without the traceback. A negative deadline means no deadline,
+ * and the optional cancel flag stops the tableau-based tiers
+ * when it becomes nonzero. Both also stop the double precision tier,
+ * whose interrupted solution then has empty rows and no score.
+ */
+typedef struct
+{
+    int precision;
+    int trace;
+    double rtol;
+    long deadline_ms;
+    volatile int *cancel;
+} arbtkf91_options;
+
+typedef struct arbtkf91_model_struct arbtkf91_model;
+typedef struct arbtkf91_solution_struct arbtkf91_solution;
+
+
+const char * arbtkf91_strerror(int status);
+
+/* set the defaults: high precision with traceback, and no deadline */
+void arbtkf91_options_init(arbtkf91_options *options);
+
+/*
+ * Encode a nucleotide string of the given length.
+ * Ambiguous nucleotide letters are encoded as A, as in the json tools.
+ */
+int arbtkf91_encode(unsigned char *codes, const char *s, size_t len);
+
+int arbtkf91_model_create(arbtkf91_model **model,
+        const arbtkf91_params *params);
+void arbtkf91_model_free(arbtkf91_model *model);
+
+/*
+ * Align two nonempty encoded sequences. On success *solution is set
+ * to a new solution that must be freed with arbtkf91_solution_free.
+ * On failure *solution is set to NULL.
+ */
+int arbtkf91_solve(arbtkf91_solution **solution,
+        const arbtkf91_model *model,
+        const unsigned char *A, size_t len_A,
+        const unsigned char *B, size_t len_B,
+        const arbtkf91_options *options);
+void arbtkf91_solution_free(arbtkf91_solution *solution);
+
+/* the aligned rows with '-' for gaps, or empty strings without trace */
+const char * arbtkf91_solution_a(const arbtkf91_solution *solution);
+const char * arbtkf91_solution_b(const arbtkf91_solution *solution);
+
+/*
+ * The log probability ball, as a midpoint and a radius. The tableau
+ * tiers score the traced alignment; the ball is indeterminate (a NaN
+ * midpoint) if the solver was stopped before it had an alignment.
+ */
+void arbtkf91_solution_log_probability(const arbtkf91_solution *solution,
+        double *mid, double *rad);
+
+/*
+ * Nonzero if the alignment was verified to be optimal, and nonzero
+ * if the deadline or the cancel flag stopped the solver early.
+ * The level is the last refinement precision level of a tableau-based
+ * tier (-1 for the mag_t bounds), and unresolved counts the tableau
+ * cells for which more than one candidate remains.
+ */
+int arbtkf91_solution_verified(const arbtkf91_solution *solution);
+int arbtkf91_solution_interrupted(const arbtkf91_solution *solution);
+long arbtkf91_solution_level(const arbtkf91_solution *solution);
+long arbtkf91_solution_unresolved(const arbtkf91_solution *solution);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
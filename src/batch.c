@@ -0,0 +1,232 @@
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "batch.h"
+
+
+/* the remaining tasks of a worker are tasks[head] .. tasks[tail-1] */
+typedef struct
+{
+    slong *tasks;
+    slong head;
+    slong tail;
+    pthread_mutex_t lock;
+} batch_deque_struct;
+
+typedef struct
+{
+    batch_deque_struct *deques;
+    slong nworkers;
+    batch_task_fn task;
+    batch_emit_fn emit;
+    void *userdata;
+
+    /* the emit mutex guards the finished flags and the next index */
+    int order;
+    pthread_mutex_t emit_lock;
+    char *finished;
+    slong next;
+} batch_pool_struct;
+
+typedef struct
+{
+    batch_pool_struct *pool;
+    slong worker;
+} batch_worker_struct;
+
+typedef struct
+{
+    double cost;
+    slong index;
+} batch_item_struct;
+
+
+static int _item_cmp(const void *a, const void *b);
+static slong _take(batch_pool_struct *pool, slong worker);
+static void _finish(batch_pool_struct *pool, slong index);
+static void * _worker(void *arg);
+
+
+int
+_item_cmp(const void *a, const void *b)
+{
+    /* decreasing cost, then increasing index */
+    const batch_item_struct *x = a;
+    const batch_item_struct *y = b;
+    if (x->cost != y->cost)
+    {
+        return (x->cost < y->cost) ? 1 : -1;
+    }
+    return (x->index < y->index) ? -1 : (x->index > y->index);
+}
+
+slong
+_take(batch_pool_struct *pool, slong worker)
+{
+    batch_deque_struct *d;
+    slong i, index;
+
+    /* the largest remaining task of the worker itself */
+    d = pool->deques + worker;
+    index = -1;
+    pthread_mutex_lock(&d->lock);
+    if (d->head < d->tail)
+    {
+        index = d->tasks[d->head++];
+    }
+    pthread_mutex_unlock(&d->lock);
+    if (index >= 0)
+    {
+        return index;
+    }
+
+    /*
+     * Otherwise steal the smallest remaining task of another worker,
+     * which is the one that the owner would have run last.
+     * No tasks are added while the pool runs, so a worker
+     * that finds every deque empty is finished.
+     */
+    for (i = 1; i < pool->nworkers && index < 0; i++)
+    {
+        d = pool->deques + (worker + i) % pool->nworkers;
+        pthread_mutex_lock(&d->lock);
+        if (d->head < d->tail)
+        {
+            index = d->tasks[--d->tail];
+        }
+        pthread_mutex_unlock(&d->lock);
+    }
+    return index;
+}
+
+void
+_finish(batch_pool_struct *pool, slong index)
+{
+    pthread_mutex_lock(&pool->emit_lock);
+    if (pool->order == BATCH_ORDER_COMPLETION)
+    {
+        pool->emit(pool->userdata, index);
+    }
+    else
+    {
+        /* emit the finished prefix of the input */
+        pool->finished[index] = 1;
+        while (pool->finished[pool->next])
+        {
+            pool->emit(pool->userdata, pool->next);
+            pool->finished[pool->next] = 0;
+            pool->next++;
+        }
+    }
+    pthread_mutex_unlock(&pool->emit_lock);
+}
+
+void *
+_worker(void *arg)
+{
+    batch_worker_struct *w = arg;
+    batch_pool_struct *pool = w->pool;
+    slong index;
+
+    while ((index = _take(pool, w->worker)) >= 0)
+    {
+        pool->task(pool->userdata, index, w->worker);
+        _finish(pool, index);
+    }
+
+    /* release the thread-local caches used by flint and arb */
+    if (w->worker)
+    {
+        flint_cleanup();
+    }
+    return NULL;
+}
+
+
+slong
+batch_run(slong n, const double *cost, slong nthreads, int order,
+        batch_task_fn task, batch_emit_fn emit, void *userdata)
+{
+    batch_pool_struct pool[1];
+    batch_worker_struct *workers;
+    batch_item_struct *items;
+    pthread_t *threads;
+    slong i, capacity, nworkers, ncreated;
+
+    if (n <= 0)
+    {
+        return 0;
+    }
+    nworkers = FLINT_MAX(1, FLINT_MIN(nthreads, n));
+
+    /* deal the tasks out in order of decreasing cost */
+    items = flint_malloc(n * sizeof(batch_item_struct));
+    for (i = 0; i < n; i++)
+    {
+        items[i].cost = cost ? cost[i] : 0;
+        items[i].index = i;
+    }
+    qsort(items, n, sizeof(batch_item_struct), _item_cmp);
+
+    capacity = (n + nworkers - 1) / nworkers;
+    pool->deques = flint_malloc(nworkers * sizeof(batch_deque_struct));
+    for (i = 0; i < nworkers; i++)
+    {
+        pool->deques[i].tasks = flint_malloc(capacity * sizeof(slong));
+        pool->deques[i].head = 0;
+        pool->deques[i].tail = 0;
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    }
+    for (i = 0; i < n; i++)
+    {
+        batch_deque_struct *d = pool->deques + (i % nworkers);
+        d->tasks[d->tail++] = items[i].index;
+    }
+    flint_free(items);
+
+    pool->nworkers = nworkers;
+    pool->task = task;
+    pool->emit = emit;
+    pool->userdata = userdata;
+    pool->order = order;
+    pthread_mutex_init(&pool->emit_lock, NULL);
+    pool->finished = flint_calloc(n + 1, sizeof(char));
+    pool->next = 0;
+
+    workers = flint_malloc(nworkers * sizeof(batch_worker_struct));
+    threads = flint_malloc(nworkers * sizeof(pthread_t));
+    for (i = 0; i < nworkers; i++)
+    {
+        workers[i].pool = pool;
+        workers[i].worker = i;
+    }
+
+    /* the calling thread is worker 0 */
+    ncreated = 0;
+    for (i = 1; i < nworkers; i++)
+    {
+        if (pthread_create(threads + ncreated, NULL, _worker, workers + i))
+        {
+            break;
+        }
+        ncreated++;
+    }
+    _worker(workers);
+    for (i = 0; i < ncreated; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (i = 0; i < nworkers; i++)
+    {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        flint_free(pool->deques[i].tasks);
+    }
+    pthread_mutex_destroy(&pool->emit_lock);
+    flint_free(pool->deques);
+    flint_free(pool->finished);
+    flint_free(workers);
+    flint_free(threads);
+
+    return ncreated + 1;
+}
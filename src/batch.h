@@ -0,0 +1,49 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+/*
+ * A pool of worker threads for running a batch of independent tasks
+ * of very different sizes, such as alignments of sequence pairs.
+ *
+ * The tasks are sorted by decreasing estimated cost and dealt out
+ * to per-worker deques, so that every worker starts with its largest
+ * tasks. A worker takes tasks from the front of its own deque, and when
+ * its deque is empty it steals from the back of the other deques,
+ * so that no worker is left idle while tasks remain.
+ *
+ * Each finished task is passed to the emit function, either as soon
+ * as it is finished or in the input order. The emit calls are
+ * serialized, but they may come from any of the worker threads.
+ */
+
+#include "flint/flint.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BATCH_ORDER_INPUT 0
+#define BATCH_ORDER_COMPLETION 1
+
+/* run the task with the given index on the worker with the given index */
+typedef void (*batch_task_fn)(void *userdata, slong index, slong worker);
+
+/* report the finished task with the given index */
+typedef void (*batch_emit_fn)(void *userdata, slong index);
+
+/*
+ * Run the n tasks on at most nthreads workers, one of which is the
+ * calling thread, and return the number of workers that were used.
+ * If some threads cannot be created then the other workers steal
+ * their tasks, so every task is run exactly once in any case.
+ */
+slong batch_run(slong n, const double *cost, slong nthreads, int order,
+        batch_task_fn task, batch_emit_fn emit, void *userdata);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,95 @@
+#include <stdlib.h>
+#include <math.h>
+
+#include "bench_stats.h"
+
+
+static int _cmp_double(const void *a, const void *b);
+
+int
+_cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+
+double
+bench_quantile(const double *sorted, slong n, double q)
+{
+    double h;
+    slong i;
+
+    h = q * (n - 1);
+    i = (slong) floor(h);
+    if (i >= n - 1)
+    {
+        return sorted[n - 1];
+    }
+    return sorted[i] + (h - i) * (sorted[i + 1] - sorted[i]);
+}
+
+void
+bench_summarize(bench_summary_t s, double *x, slong n)
+{
+    double *dev;
+    slong i;
+
+    qsort(x, n, sizeof(double), _cmp_double);
+    s->n = n;
+    s->min = x[0];
+    s->max = x[n - 1];
+    s->median = bench_quantile(x, n, 0.5);
+    s->p05 = bench_quantile(x, n, 0.05);
+    s->p25 = bench_quantile(x, n, 0.25);
+    s->p75 = bench_quantile(x, n, 0.75);
+    s->p95 = bench_quantile(x, n, 0.95);
+
+    /* the median of the absolute deviations from the median */
+    dev = flint_malloc(n * sizeof(double));
+    for (i = 0; i < n; i++)
+    {
+        dev[i] = fabs(x[i] - s->median);
+    }
+    qsort(dev, n, sizeof(double), _cmp_double);
+    s->mad = bench_quantile(dev, n, 0.5);
+    flint_free(dev);
+}
+
+int
+bench_scaling_exponent(double *exponent,
+        const double *sizes, const double *times, slong n)
+{
+    double mx, my, sxx, sxy, dx;
+    slong i;
+
+    if (n < 2)
+    {
+        return 1;
+    }
+
+    mx = my = 0;
+    for (i = 0; i < n; i++)
+    {
+        mx += log(sizes[i]);
+        my += log(times[i]);
+    }
+    mx /= n;
+    my /= n;
+
+    sxx = sxy = 0;
+    for (i = 0; i < n; i++)
+    {
+        dx = log(sizes[i]) - mx;
+        sxx += dx * dx;
+        sxy += dx * (log(times[i]) - my);
+    }
+    if (sxx == 0)
+    {
+        return 1;
+    }
+
+    *exponent = sxy / sxx;
+    return 0;
+}
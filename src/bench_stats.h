@@ -0,0 +1,58 @@
+#ifndef BENCH_STATS_H
+#define BENCH_STATS_H
+
+/*
+ * Robust summaries of benchmark samples.
+ *
+ * Timings are skewed by scheduling and cache effects, so a sample is
+ * summarized by its median and its median absolute deviation (MAD)
+ * rather than by its mean and standard deviation, together with a few
+ * percentiles. The percentiles interpolate linearly between the order
+ * statistics.
+ *
+ * The scaling exponent is the least squares slope of the logarithm of
+ * the time against the logarithm of the problem size, so a quadratic
+ * algorithm has an exponent close to 2 once the sizes are large enough.
+ */
+
+#include "flint/flint.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    slong n;
+    double min;
+    double max;
+    double median;
+    double mad;
+    double p05;
+    double p25;
+    double p75;
+    double p95;
+} bench_summary_struct;
+typedef bench_summary_struct bench_summary_t[1];
+
+/* sort the n > 0 values in place and summarize them */
+void bench_summarize(bench_summary_t s, double *x, slong n);
+
+/* the q-quantile of n > 0 sorted values, for q between 0 and 1 */
+double bench_quantile(const double *sorted, slong n, double q);
+
+/*
+ * Set the exponent of the power law fitted to the n positive
+ * sizes and times, and return nonzero if there are fewer than
+ * two distinct sizes.
+ */
+int bench_scaling_exponent(double *exponent,
+        const double *sizes, const double *times, slong n);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
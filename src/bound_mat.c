@@ -5,6 +5,7 @@
 #include "dp.h"
 #include "bound_mat.h"
 #include "unused.h"
+#include "tkf91_model_context.h"
 
 
 static void *_init(void *userdata, size_t num);
@@ -27,7 +28,10 @@ static int _visit_center(void *userdata, dp_mat_t mat,
 
 
 
-/* the tableau cell visitor sees this data */
+/*
+ * The tableau cell visitor sees this data.
+ * The round is NULL unless the consensus failures are being counted.
+ */
 typedef struct
 {
     tkf91_generator_vecs_ptr h;
@@ -36,6 +40,7 @@ typedef struct
     fmpz *m2;
     const slong *A;
     const slong *B;
+    diagnostics_round_struct *round;
 } utility_struct;
 typedef utility_struct utility_t[1];
 typedef utility_struct * utility_ptr;
@@ -43,11 +48,13 @@ typedef utility_struct * utility_ptr;
 static void utility_clear(utility_t p);
 static void utility_init(utility_t p,
         tkf91_generator_vecs_t h,
-        const slong *A, const slong *B);
+        const slong *A, const slong *B,
+        diagnostics_round_struct *round);
 
 void
 utility_init(utility_t p, tkf91_generator_vecs_t h,
-        const slong *A, const slong *B)
+        const slong *A, const slong *B,
+        diagnostics_round_struct *round)
 {
     p->h = h;
     slong rank = tkf91_generator_vecs_rank(p->h);
@@ -56,6 +63,7 @@ utility_init(utility_t p, tkf91_generator_vecs_t h,
     p->m2 = _fmpz_vec_init(rank);
     p->A = A;
     p->B = B;
+    p->round = round;
 }
 
 void
@@ -206,6 +214,7 @@ _visit_center(void *userdata, dp_mat_t mat,
 }
 
 
+/* return 0, or the flag of the first max without consensus */
 int
 _visit_check_consensus(
         void *userdata, dp_mat_t mat,
@@ -225,22 +234,22 @@ _visit_check_consensus(
     {
         if ((x & DP_MAX2_M1) && (x & DP_MAX2_M2))
         {
-            if (!_fmpz_vec_equal(p->m1, p->m2, rank)) return -1;
+            if (!_fmpz_vec_equal(p->m1, p->m2, rank)) return DP_MAX2;
         }
     }
     if (x & DP_MAX3)
     {
         if ((x & DP_MAX3_M0) && (x & DP_MAX3_M1))
         {
-            if (!_fmpz_vec_equal(p->m0, p->m1, rank)) return -1;
+            if (!_fmpz_vec_equal(p->m0, p->m1, rank)) return DP_MAX3;
         }
         if ((x & DP_MAX3_M1) && (x & DP_MAX3_M2))
         {
-            if (!_fmpz_vec_equal(p->m1, p->m2, rank)) return -1;
+            if (!_fmpz_vec_equal(p->m1, p->m2, rank)) return DP_MAX3;
         }
         if ((x & DP_MAX3_M2) && (x & DP_MAX3_M0))
         {
-            if (!_fmpz_vec_equal(p->m2, p->m0, rank)) return -1;
+            if (!_fmpz_vec_equal(p->m2, p->m0, rank)) return DP_MAX3;
         }
     }
     return 0;
@@ -298,6 +307,7 @@ _visit(
         slong i, slong j,
         void *curr, void *top, void *diag, void *left)
 {
+    utility_ptr p = userdata;
     int result;
 
     /*
@@ -319,12 +329,18 @@ _visit(
     /*
      * For max2 and max3, if the max is interesting then check
      * for consensus among candidates.
-     * If there is no consensus then return a nonzero integer.
+     * If there is no consensus then return a nonzero integer,
+     * unless the failures are being counted, in which case
+     * the first remaining candidate stands in for the max.
      */
     result = _visit_check_consensus(userdata, mat, i, j, curr, top, diag, left);
     if (result)
     {
-        return result;
+        if (!p->round)
+        {
+            return -1;
+        }
+        diagnostics_add_failure(p->round, i, j, result == DP_MAX3);
     }
 
     /* Update the cell data. */
@@ -347,7 +363,9 @@ tkf91_dp_verify_symbolically(
         dp_mat_t tableau,
         expr_ptr * expressions_table,
         const slong *A,
-        const slong *B)
+        const slong *B,
+        const request_t req,
+        diagnostics_round_struct *round)
 {
     /* Inputs:
      *   mat : the generator matrix -- mat_ij where i is a generator index
@@ -358,25 +376,40 @@ tkf91_dp_verify_symbolically(
      *          max likelihood traceback, and with directional links
      *          indicating which direction(s) are best, backwards,
      *          from each cell.
+     *   req : the request; its budget optionally limits the work,
+     *          and if it runs out then the tableau is reported
+     *          as unverified. If the request has a model context
+     *          then its Hermite decomposition is used.
+     *   round : NULL, or the diagnostics of the refinement round,
+     *          in which case the whole tableau is checked and each
+     *          consensus failure is added to the round.
      */
     fmpz_mat_t H, V;
     slong rank;
     tkf91_generator_vecs_t h;
-    arb_ptr v;
+    arb_ptr v = NULL;
     slong level;
 
     level = 8;
 
-    /* Compute a Hermite decomposition of the generator matrix. */
-    /* U*mat = H ; U^-1 = V ; rank = rank(H) */
-    fmpz_mat_init(H, fmpz_mat_nrows(mat), fmpz_mat_ncols(mat));
-    fmpz_mat_init(V, fmpz_mat_nrows(mat), fmpz_mat_nrows(mat));
-    _fmpz_mat_hnf_inverse_transform(H, V, &rank, mat);
+    if (req->ctx)
+    {
+        rank = req->ctx->rank;
+        tkf91_generator_vecs_init(h, g, req->ctx->V, rank);
+    }
+    else
+    {
+        /* Compute a Hermite decomposition of the generator matrix. */
+        /* U*mat = H ; U^-1 = V ; rank = rank(H) */
+        fmpz_mat_init(H, fmpz_mat_nrows(mat), fmpz_mat_ncols(mat));
+        fmpz_mat_init(V, fmpz_mat_nrows(mat), fmpz_mat_nrows(mat));
+        _fmpz_mat_hnf_inverse_transform(H, V, &rank, mat);
 
-    tkf91_generator_vecs_init(h, g, V, rank);
+        tkf91_generator_vecs_init(h, g, V, rank);
 
-    v = _arb_vec_init(rank);
-    compute_hlogy(v, H, expressions_table, rank, level);
+        v = _arb_vec_init(rank);
+        compute_hlogy(v, H, expressions_table, rank, level);
+    }
 
     /* this block replaces the old call to the symbolic verification */
     int result;
@@ -384,23 +417,28 @@ tkf91_dp_verify_symbolically(
         forward_strategy_t s;
         utility_t util;
 
-        utility_init(util, h, A, B);
+        utility_init(util, h, A, B, round);
         s->init = _init;
         s->clear = _clear;
         s->visit = _visit;
         s->sz_celldata = (size_t) (2 * rank * sizeof(fmpz));
         s->userdata = util;
+        s->budget = req->budget;
+        s->checkpoint = NULL;
 
         result = dp_forward(tableau, s);
         utility_clear(util);
     }
 
-    _arb_vec_clear(v, rank);
-    fmpz_mat_clear(H);
-    fmpz_mat_clear(V);
+    if (!req->ctx)
+    {
+        _arb_vec_clear(v, rank);
+        fmpz_mat_clear(H);
+        fmpz_mat_clear(V);
+    }
     tkf91_generator_vecs_clear(h);
 
-    *verified = (result == 0);
+    *verified = (result == 0 && (!round || !round->failures));
 }
 
 
@@ -6,6 +6,8 @@
 
 #include "tkf91_generator_indices.h"
 #include "dp.h"
+#include "tkf91_dp.h"
+#include "diagnostics.h"
 
 
 
@@ -22,7 +24,9 @@ tkf91_dp_verify_symbolically(
         dp_mat_t tableau,
         expr_ptr * expressions_table,
         const slong *A,
-        const slong *B);
+        const slong *B,
+        const request_t req,
+        diagnostics_round_struct *round);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,77 @@
+#include "budget.h"
+
+
+void
+budget_init(budget_t b)
+{
+    b->has_deadline = 0;
+    b->deadline.tv_sec = 0;
+    b->deadline.tv_nsec = 0;
+    b->cancel = NULL;
+    b->parent = NULL;
+}
+
+void
+budget_clear(budget_t b)
+{
+    b->has_deadline = 0;
+    b->cancel = NULL;
+    b->parent = NULL;
+}
+
+void
+budget_set_deadline_ms(budget_t b, slong ms)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    b->deadline.tv_sec = now.tv_sec + ms / 1000;
+    b->deadline.tv_nsec = now.tv_nsec + (ms % 1000) * 1000000;
+    if (b->deadline.tv_nsec >= 1000000000)
+    {
+        b->deadline.tv_sec += 1;
+        b->deadline.tv_nsec -= 1000000000;
+    }
+    b->has_deadline = 1;
+}
+
+void
+budget_set_cancel(budget_t b, volatile int *cancel)
+{
+    b->cancel = cancel;
+}
+
+void
+budget_set_parent(budget_t b, const budget_struct *parent)
+{
+    b->parent = parent;
+}
+
+int
+budget_expired(const budget_t b)
+{
+    struct timespec now;
+
+    if (b->cancel && *(b->cancel))
+    {
+        return 1;
+    }
+
+    if (b->parent && budget_expired(b->parent))
+    {
+        return 1;
+    }
+
+    if (b->has_deadline)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > b->deadline.tv_sec ||
+            (now.tv_sec == b->deadline.tv_sec &&
+             now.tv_nsec >= b->deadline.tv_nsec))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
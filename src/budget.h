@@ -0,0 +1,44 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+/*
+ * A budget limits the work done by the dynamic programming passes.
+ * It may carry a wall clock deadline, and it may point to a
+ * cancellation flag that can be raised from elsewhere (for example
+ * from another thread). The forward pass checks the budget between rows,
+ * so a solver can stop early and report what it has learned so far.
+ * A budget also expires when its optional parent budget expires.
+ */
+
+#include <time.h>
+
+#include "flint/flint.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct budget_struct_tag
+{
+    int has_deadline;
+    struct timespec deadline;
+    volatile int *cancel;
+    const struct budget_struct_tag *parent;
+} budget_struct;
+typedef budget_struct budget_t[1];
+typedef budget_struct * budget_ptr;
+
+void budget_init(budget_t b);
+void budget_clear(budget_t b);
+void budget_set_deadline_ms(budget_t b, slong ms);
+void budget_set_cancel(budget_t b, volatile int *cancel);
+void budget_set_parent(budget_t b, const budget_struct *parent);
+int budget_expired(const budget_t b);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,85 @@
+#include "channel.h"
+
+
+void
+channel_init(channel_t ch, slong capacity)
+{
+    ch->alloc = FLINT_MAX(1, capacity);
+    ch->items = flint_malloc(ch->alloc * sizeof(void *));
+    ch->head = 0;
+    ch->len = 0;
+    ch->closed = 0;
+    pthread_mutex_init(&ch->lock, NULL);
+    pthread_cond_init(&ch->nonempty, NULL);
+    pthread_cond_init(&ch->nonfull, NULL);
+}
+
+void
+channel_clear(channel_t ch)
+{
+    pthread_mutex_destroy(&ch->lock);
+    pthread_cond_destroy(&ch->nonempty);
+    pthread_cond_destroy(&ch->nonfull);
+    flint_free(ch->items);
+}
+
+int
+channel_send(channel_t ch, void *item)
+{
+    int closed;
+    pthread_mutex_lock(&ch->lock);
+    while (ch->len == ch->alloc && !ch->closed)
+    {
+        pthread_cond_wait(&ch->nonfull, &ch->lock);
+    }
+    closed = ch->closed;
+    if (!closed)
+    {
+        ch->items[(ch->head + ch->len) % ch->alloc] = item;
+        ch->len++;
+        pthread_cond_signal(&ch->nonempty);
+    }
+    pthread_mutex_unlock(&ch->lock);
+    return closed;
+}
+
+int
+channel_recv(channel_t ch, void **pitem)
+{
+    int done;
+    pthread_mutex_lock(&ch->lock);
+    while (!ch->len && !ch->closed)
+    {
+        pthread_cond_wait(&ch->nonempty, &ch->lock);
+    }
+    done = !ch->len;
+    if (!done)
+    {
+        *pitem = ch->items[ch->head];
+        ch->head = (ch->head + 1) % ch->alloc;
+        ch->len--;
+        pthread_cond_signal(&ch->nonfull);
+    }
+    pthread_mutex_unlock(&ch->lock);
+    return done;
+}
+
+void
+channel_close(channel_t ch)
+{
+    pthread_mutex_lock(&ch->lock);
+    ch->closed = 1;
+    pthread_cond_broadcast(&ch->nonempty);
+    pthread_cond_broadcast(&ch->nonfull);
+    pthread_mutex_unlock(&ch->lock);
+}
+
+slong
+channel_len(channel_t ch)
+{
+    slong len;
+    pthread_mutex_lock(&ch->lock);
+    len = ch->len;
+    pthread_mutex_unlock(&ch->lock);
+    return len;
+}
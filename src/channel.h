@@ -0,0 +1,61 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+/*
+ * A bounded first-in first-out queue of pointers between threads,
+ * for connecting the stages of a pipeline.
+ *
+ * A sender blocks while the channel is full and a receiver blocks while
+ * it is empty, so a slow stage holds back the stages that feed it and
+ * the number of items between two stages stays bounded. Once the channel
+ * is closed, the receivers drain the remaining items and then stop.
+ */
+
+#include <pthread.h>
+
+#include "flint/flint.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the items are items[head] .. items[head+len-1] modulo alloc */
+typedef struct
+{
+    void **items;
+    slong alloc;
+    slong head;
+    slong len;
+    int closed;
+    pthread_mutex_t lock;
+    pthread_cond_t nonempty;
+    pthread_cond_t nonfull;
+} channel_struct;
+typedef channel_struct channel_t[1];
+typedef channel_struct * channel_ptr;
+
+void channel_init(channel_t ch, slong capacity);
+void channel_clear(channel_t ch);
+
+/* wait for room and add the item; return nonzero if the channel is closed */
+int channel_send(channel_t ch, void *item);
+
+/*
+ * Wait for an item and remove it; return nonzero instead
+ * if the channel is closed and no items are left.
+ */
+int channel_recv(channel_t ch, void **pitem);
+
+/* wake up the waiting threads; no more items can be sent */
+void channel_close(channel_t ch);
+
+/* the number of items waiting to be received */
+slong channel_len(channel_t ch);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+
+
+#define CHECKPOINT_MAGIC "arbtkf91-checkpoint"
+#define CHECKPOINT_VERSION 1
+
+/* the header is written in native byte order */
+typedef struct
+{
+    char magic[24];
+    int64_t version;
+    uint64_t key;
+    int64_t nrows;
+    int64_t ncols;
+    int64_t level;
+    int64_t row;
+} checkpoint_header_struct;
+
+
+static double
+_seconds_since(const struct timespec *t)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) (now.tv_sec - t->tv_sec) +
+           (double) (now.tv_nsec - t->tv_nsec) * 1e-9;
+}
+
+
+void
+checkpoint_init(checkpoint_t c, const char *filename,
+        double interval, uint64_t key)
+{
+    c->filename = filename;
+    c->interval = interval;
+    clock_gettime(CLOCK_MONOTONIC, &c->last);
+    c->key = key;
+    c->level = -1;
+    c->row = 0;
+    c->resumed = 0;
+}
+
+void
+checkpoint_clear(checkpoint_t c)
+{
+    c->filename = NULL;
+}
+
+int
+checkpoint_due(checkpoint_t c)
+{
+    return c->filename && _seconds_since(&c->last) >= c->interval;
+}
+
+int
+checkpoint_write(checkpoint_t c, const dp_mat_t mat, slong row)
+{
+    /*
+     * Write the tableau flags and the refinement state to the file.
+     * Return nonzero if the file could not be written,
+     * in which case the previous checkpoint (if any) is kept.
+     */
+    checkpoint_header_struct header;
+    char *tmpname;
+    FILE *fout;
+    size_t n;
+    int code;
+
+    if (!c->filename)
+    {
+        return 0;
+    }
+
+    memset(&header, 0, sizeof(header));
+    strncpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic) - 1);
+    header.version = CHECKPOINT_VERSION;
+    header.key = c->key;
+    header.nrows = dp_mat_nrows(mat);
+    header.ncols = dp_mat_ncols(mat);
+    header.level = c->level;
+    header.row = row;
+
+    tmpname = flint_malloc(strlen(c->filename) + 5);
+    strcpy(tmpname, c->filename);
+    strcat(tmpname, ".tmp");
+
+    code = 0;
+    fout = fopen(tmpname, "wb");
+    if (fout == NULL)
+    {
+        fprintf(stderr, "failed to open %s for writing\n", tmpname);
+        code = 1;
+        goto end;
+    }
+
+    n = (size_t) (header.nrows * header.ncols);
+    if (fwrite(&header, sizeof(header), 1, fout) != 1 ||
+        fwrite(mat->data, sizeof(dp_t), n, fout) != n)
+    {
+        fprintf(stderr, "failed to write the checkpoint %s\n", tmpname);
+        code = 1;
+    }
+
+    /*
+     * The data must reach the disk before the rename replaces the
+     * previous checkpoint, or a crash could leave an empty file.
+     */
+    if (!code && (fflush(fout) || fsync(fileno(fout))))
+    {
+        fprintf(stderr, "failed to sync the checkpoint %s\n", tmpname);
+        code = 1;
+    }
+    if (fclose(fout))
+    {
+        code = 1;
+    }
+    if (!code && rename(tmpname, c->filename))
+    {
+        fprintf(stderr, "failed to rename the checkpoint %s\n", tmpname);
+        code = 1;
+    }
+
+end:
+    flint_free(tmpname);
+    c->row = row;
+    clock_gettime(CLOCK_MONOTONIC, &c->last);
+    return code;
+}
+
+int
+checkpoint_read(checkpoint_t c, const char *filename, dp_mat_t mat)
+{
+    /*
+     * Read the tableau flags and the refinement state from the file.
+     * Return nonzero if the file cannot be read or if it does not
+     * match the key and the tableau dimensions.
+     */
+    checkpoint_header_struct header;
+    FILE *fin;
+    size_t n;
+    int code;
+
+    fin = fopen(filename, "rb");
+    if (fin == NULL)
+    {
+        fprintf(stderr, "failed to open %s for reading\n", filename);
+        return 1;
+    }
+
+    code = 0;
+    if (fread(&header, sizeof(header), 1, fin) != 1 ||
+        strncmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) ||
+        header.version != CHECKPOINT_VERSION)
+    {
+        fprintf(stderr, "%s is not a checkpoint file\n", filename);
+        code = 1;
+    }
+    else if (header.key != c->key ||
+             header.nrows != dp_mat_nrows(mat) ||
+             header.ncols != dp_mat_ncols(mat))
+    {
+        fprintf(stderr, "the checkpoint %s was written ", filename);
+        fprintf(stderr, "for different parameters or sequences\n");
+        code = 1;
+    }
+    else
+    {
+        n = (size_t) (header.nrows * header.ncols);
+        if (fread(mat->data, sizeof(dp_t), n, fin) != n)
+        {
+            fprintf(stderr, "the checkpoint %s is truncated\n", filename);
+            code = 1;
+        }
+    }
+    fclose(fin);
+
+    if (!code)
+    {
+        c->level = header.level;
+        c->row = header.row;
+        c->resumed = 1;
+    }
+    return code;
+}
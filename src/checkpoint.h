@@ -0,0 +1,59 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+/*
+ * Checkpoints of the refinement of a dynamic programming tableau.
+ *
+ * A checkpoint file records the tableau flags, the precision level of
+ * the refinement round in progress (-1 for the mag_t bounds round),
+ * and the forward pass row reached when the file was written,
+ * together with a key that identifies the model parameters and
+ * the sequences. Checkpoints are written between rounds, and during
+ * a forward pass at most once per interval. Files are written
+ * to a temporary name and then renamed, so an interrupted write
+ * leaves the previous checkpoint intact.
+ *
+ * The forward pass cell data is not saved, so a resumed run restarts
+ * the round in progress from its first row. The flags of the rows
+ * that had already been visited remain refined, and revisiting them
+ * is the only work that is repeated.
+ */
+
+#include <stdint.h>
+#include <time.h>
+
+#include "flint/flint.h"
+
+#include "dp.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    const char *filename;
+    double interval;
+    struct timespec last;
+    uint64_t key;
+    slong level;
+    slong row;
+    int resumed;
+} checkpoint_struct;
+typedef checkpoint_struct checkpoint_t[1];
+typedef checkpoint_struct * checkpoint_ptr;
+
+void checkpoint_init(checkpoint_t c, const char *filename,
+        double interval, uint64_t key);
+void checkpoint_clear(checkpoint_t c);
+int checkpoint_due(checkpoint_t c);
+int checkpoint_write(checkpoint_t c, const dp_mat_t mat, slong row);
+int checkpoint_read(checkpoint_t c, const char *filename, dp_mat_t mat);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
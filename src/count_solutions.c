@@ -80,6 +80,8 @@ count_solutions(fmpz_t res, dp_mat_t mat)
     s->visit = _visit;
     s->sz_celldata = sizeof(fmpz);
     s->userdata = res;
+    s->budget = NULL;
+    s->checkpoint = NULL;
 
     dp_forward(mat, s);
 }
@@ -0,0 +1,157 @@
+#include <string.h>
+
+#include "mag.h"
+
+#include "diagnostics.h"
+
+
+static void _count(slong *interesting, slong *candidates,
+        slong *unresolved, const dp_mat_t mat);
+
+void
+_count(slong *interesting, slong *candidates,
+        slong *unresolved, const dp_mat_t mat)
+{
+    slong n, k;
+    dp_t x;
+
+    *interesting = 0;
+    *candidates = 0;
+    *unresolved = 0;
+    n = dp_mat_nrows(mat) * dp_mat_ncols(mat);
+    for (k = 0; k < n; k++)
+    {
+        x = mat->data[k];
+        if (x & (DP_MAX3 | DP_MAX2))
+        {
+            *interesting += 1;
+        }
+        *candidates += !!(x & DP_MAX3_M0) + !!(x & DP_MAX3_M1) +
+                       !!(x & DP_MAX3_M2) + !!(x & DP_MAX2_M1) +
+                       !!(x & DP_MAX2_M2);
+        *unresolved += dp_is_unresolved(x);
+    }
+}
+
+
+void
+diagnostics_init(diagnostics_t d)
+{
+    d->rounds = NULL;
+    d->len = 0;
+    d->alloc = 0;
+    d->keep_map = 0;
+    d->map = NULL;
+    d->nrows = 0;
+    d->ncols = 0;
+}
+
+void
+diagnostics_clear(diagnostics_t d)
+{
+    flint_free(d->rounds);
+    flint_free(d->map);
+}
+
+void
+diagnostics_reset(diagnostics_t d)
+{
+    d->len = 0;
+    flint_free(d->map);
+    d->map = NULL;
+    d->nrows = 0;
+    d->ncols = 0;
+}
+
+void
+diagnostics_keep_map(diagnostics_t d)
+{
+    d->keep_map = 1;
+}
+
+slong
+diagnostics_prec(slong level)
+{
+    return level < 0 ? MAG_BITS : WORD(1) << level;
+}
+
+diagnostics_round_struct *
+diagnostics_begin(diagnostics_ptr d, slong level, const dp_mat_t mat)
+{
+    diagnostics_round_struct *round;
+    slong interesting, unresolved;
+
+    if (!d)
+    {
+        return NULL;
+    }
+    if (d->len == d->alloc)
+    {
+        d->alloc = FLINT_MAX(8, 2 * d->alloc);
+        d->rounds = flint_realloc(d->rounds,
+                d->alloc * sizeof(diagnostics_round_struct));
+    }
+    round = d->rounds + d->len;
+    d->len++;
+
+    memset(round, 0, sizeof(diagnostics_round_struct));
+    round->level = level;
+    round->prec = diagnostics_prec(level);
+    _count(&interesting, &round->candidates, &unresolved, mat);
+
+    /* a new tableau gets a new map */
+    if (d->keep_map && (!d->map ||
+        d->nrows != dp_mat_nrows(mat) || d->ncols != dp_mat_ncols(mat)))
+    {
+        d->nrows = dp_mat_nrows(mat);
+        d->ncols = dp_mat_ncols(mat);
+        flint_free(d->map);
+        d->map = flint_calloc(d->nrows * d->ncols, 1);
+    }
+    return round;
+}
+
+void
+diagnostics_end(diagnostics_ptr d, diagnostics_round_struct *round,
+        const dp_mat_t mat, int interrupted, int verified)
+{
+    slong n, k, before;
+
+    if (!d)
+    {
+        return;
+    }
+    before = round->candidates;
+    _count(&round->interesting, &round->candidates,
+            &round->unresolved, mat);
+    round->cleared = before - round->candidates;
+    round->interrupted = interrupted;
+    round->verified = verified;
+
+    if (d->map)
+    {
+        /* the levels stop well before the counts could overflow */
+        n = d->nrows * d->ncols;
+        for (k = 0; k < n; k++)
+        {
+            d->map[k] += dp_is_unresolved(mat->data[k]);
+        }
+    }
+}
+
+void
+diagnostics_add_failure(diagnostics_round_struct *round,
+        slong i, slong j, int max3)
+{
+    diagnostics_failure_struct *x;
+
+    if (round->failures_len < DIAGNOSTICS_FAILURE_CAP)
+    {
+        x = round->failure + round->failures_len;
+        x->i = i;
+        x->j = j;
+        x->max3 = max3;
+        round->failures_len++;
+    }
+    round->failures++;
+}
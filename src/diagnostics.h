@@ -0,0 +1,110 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+/*
+ * A collector of the certification effort of the high precision solver.
+ *
+ * Each round of the refinement, at one precision level, gets a record
+ * of the working precision, of how many tableau cells were interesting
+ * after the round, of how many candidate flags the round cleared and
+ * how many remain, of how many interesting cells were left unresolved,
+ * and of the outcome of the symbolic verification that followed it.
+ * A consensus failure is an interesting cell whose remaining candidates
+ * are numerically tied but not symbolically equal; so that all of the
+ * failures of a round are counted, the verification does not stop at
+ * the first failure when diagnostics are collected, and the locations
+ * of the first few failures of each round are kept.
+ *
+ * The collector can also keep a map of the tableau counting, for each
+ * cell, the rounds after which it was still unresolved; see 'vis.h'.
+ * The rounds of a solve are run one after another, so unlike the
+ * timing collector this one is not shared between threads.
+ */
+
+#include "flint/flint.h"
+
+#include "dp.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the number of consensus failure locations kept for each round */
+#define DIAGNOSTICS_FAILURE_CAP 16
+
+typedef struct
+{
+    slong i;
+    slong j;
+    int max3;
+} diagnostics_failure_struct;
+
+typedef struct
+{
+    slong level;
+    slong prec;
+    int interrupted;
+    int verified;
+    slong interesting;
+    slong candidates;
+    slong cleared;
+    slong unresolved;
+    slong failures;
+    slong failures_len;
+    diagnostics_failure_struct failure[DIAGNOSTICS_FAILURE_CAP];
+} diagnostics_round_struct;
+
+/* the map is NULL unless it is kept, with one count per tableau cell */
+typedef struct
+{
+    diagnostics_round_struct * rounds;
+    slong len;
+    slong alloc;
+    int keep_map;
+    unsigned char * map;
+    slong nrows;
+    slong ncols;
+} diagnostics_struct;
+typedef diagnostics_struct diagnostics_t[1];
+typedef diagnostics_struct * diagnostics_ptr;
+
+void diagnostics_init(diagnostics_t d);
+void diagnostics_clear(diagnostics_t d);
+
+/* forget the recorded rounds and the map */
+void diagnostics_reset(diagnostics_t d);
+
+/* keep the map of unresolved cells from the next round on */
+void diagnostics_keep_map(diagnostics_t d);
+
+/* the working precision in bits of a level, MAG_BITS at level -1 */
+slong diagnostics_prec(slong level);
+
+/*
+ * Start a round at the level, counting the candidate flags of the
+ * tableau before the round; return NULL if the collector is NULL.
+ * The round is finished by counting the tableau after the round and
+ * its verification, and until then the failures of its verification
+ * can be added to it.
+ */
+diagnostics_round_struct * diagnostics_begin(diagnostics_ptr d,
+        slong level, const dp_mat_t mat);
+void diagnostics_end(diagnostics_ptr d, diagnostics_round_struct *round,
+        const dp_mat_t mat, int interrupted, int verified);
+void diagnostics_add_failure(diagnostics_round_struct *round,
+        slong i, slong j, int max3);
+
+/* the number of rounds after which the cell was unresolved */
+static __inline__ slong
+diagnostics_map_entry(const diagnostics_t d, slong i, slong j)
+{
+    return d->map[i * d->ncols + j];
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
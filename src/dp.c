@@ -16,7 +16,7 @@ dp_mat_init(dp_mat_t mat, slong nrows, slong ncols)
      * All tableau cells are possible trace candidates.
      */
     slong n = nrows * ncols;
-    mat->data = malloc(n * sizeof(dp_t));
+    mat->data = flint_malloc(n * sizeof(dp_t));
     mat->nrows = nrows;
     mat->ncols = ncols;
     int i;
@@ -29,7 +29,7 @@ dp_mat_init(dp_mat_t mat, slong nrows, slong ncols)
 void
 dp_mat_clear(dp_mat_t mat)
 {
-    free(mat->data);
+    flint_free(mat->data);
 }
 
 void
@@ -39,33 +39,46 @@ dp_mat_get_alignment(char *sa, char *sb, slong *plen,
     /*
      * Do the traceback. The character arrays sa and sb
      * are assumed to have been already allocated.
+     * The column operations are written into sa first,
+     * and then expanded in place into the aligned sequences.
+     */
+    dp_mat_get_ops((unsigned char *) sa, plen, mat);
+    dp_ops_get_alignment(sa, sb, (unsigned char *) sa, *plen, A, B);
+}
+
+void
+dp_mat_get_ops(unsigned char *ops, slong *plen, dp_mat_t mat)
+{
+    /*
+     * Do the traceback, writing one operation per alignment column
+     * into the already allocated array.
+     * Moves that would leave the tableau are never taken;
+     * this matters only for tableaux whose forward pass was interrupted,
+     * where the boundary cells may still have all of their flags set.
      */
     slong i, j;
-    char ACGT[4] = "ACGT";
     slong len = 0;
+    unsigned char tmp;
     i = mat->nrows - 1;
     j = mat->ncols - 1;
     dp_t x;
     while (i > 0 || j > 0)
     {
         x = *dp_mat_entry(mat, i, j);
-        if (x & DP_MAX3_M0)
+        if (i > 0 && (x & DP_MAX3_M0))
         {
-            sa[len] = ACGT[A[i-1]];
-            sb[len] = '-';
+            ops[len] = DP_OP_DELETE;
             i--;
         }
-        else if (x & DP_MAX3_M1)
+        else if (i > 0 && j > 0 && (x & DP_MAX3_M1))
         {
-            sa[len] = ACGT[A[i-1]];
-            sb[len] = ACGT[B[j-1]];
+            ops[len] = DP_OP_MATCH;
             i--;
             j--;
         }
-        else if (x & DP_MAX3_M2)
+        else if (j > 0 && (x & DP_MAX3_M2))
         {
-            sa[len] = '-';
-            sb[len] = ACGT[B[j-1]];
+            ops[len] = DP_OP_INSERT;
             j--;
         }
         else
@@ -76,16 +89,70 @@ dp_mat_get_alignment(char *sa, char *sb, slong *plen,
         }
         len++;
     }
-    char tmp;
     for (i = 0; i < len/2; i++)
     {
         j = len - 1 - i;
-        tmp = sa[i]; sa[i] = sa[j]; sa[j] = tmp;
-        tmp = sb[i]; sb[i] = sb[j]; sb[j] = tmp;
+        tmp = ops[i]; ops[i] = ops[j]; ops[j] = tmp;
     }
     *plen = len;
 }
 
+void
+dp_ops_get_alignment(char *sa, char *sb,
+        const unsigned char *ops, slong len, const slong *A, const slong *B)
+{
+    /*
+     * Write the aligned sequences of the column operations.
+     * The operations may be stored in sa itself,
+     * because each of them is read before it is overwritten.
+     */
+    char ACGT[4] = "ACGT";
+    slong i, j, k;
+    i = 0;
+    j = 0;
+    for (k = 0; k < len; k++)
+    {
+        switch (ops[k])
+        {
+            case DP_OP_DELETE:
+                sa[k] = ACGT[A[i++]];
+                sb[k] = '-';
+                break;
+            case DP_OP_MATCH:
+                sa[k] = ACGT[A[i++]];
+                sb[k] = ACGT[B[j++]];
+                break;
+            default:
+                sa[k] = '-';
+                sb[k] = ACGT[B[j++]];
+        }
+    }
+    sa[len] = '\0';
+    sb[len] = '\0';
+}
+
+void
+dp_alignment_get_ops(unsigned char *ops,
+        const char *sa, const char *sb, slong len)
+{
+    slong k;
+    for (k = 0; k < len; k++)
+    {
+        if (sb[k] == '-')
+        {
+            ops[k] = DP_OP_DELETE;
+        }
+        else if (sa[k] == '-')
+        {
+            ops[k] = DP_OP_INSERT;
+        }
+        else
+        {
+            ops[k] = DP_OP_MATCH;
+        }
+    }
+}
+
 
 void
 dp_mat_backward(dp_mat_t mat)
@@ -164,6 +231,31 @@ dp_mat_backward(dp_mat_t mat)
 }
 
 
+slong
+dp_mat_count_unresolved(const dp_mat_t mat)
+{
+    /*
+     * Count the interesting cells for which the flags still leave
+     * more than one candidate for max3 or for max2.
+     * A tableau with no unresolved cells does not by itself
+     * certify anything, but the count measures how far an interrupted
+     * sequence of refinements is from finishing.
+     */
+    slong n, k, count;
+
+    n = dp_mat_nrows(mat) * dp_mat_ncols(mat);
+    count = 0;
+    for (k = 0; k < n; k++)
+    {
+        if (dp_is_unresolved(mat->data[k]))
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+
 void
 dp_mat_set(dp_mat_t mat, const dp_mat_t src)
 {
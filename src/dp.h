@@ -45,6 +45,16 @@
 #define DP_MAX2_M1 0x40
 #define DP_MAX2_M2 0x80
 
+/*
+ * The operations of the alignment columns, with sequence A as the
+ * reference as in a CIGAR string: a column with a character of each
+ * sequence (M), a character of B against a gap (I, an insertion),
+ * or a character of A against a gap (D, a deletion).
+ */
+#define DP_OP_MATCH  0
+#define DP_OP_INSERT 1
+#define DP_OP_DELETE 2
+
 
 #include "flint/flint.h"
 
@@ -86,6 +96,16 @@ dp_m2_is_interesting(dp_t x)
             ((x & DP_MAX2) && (x & DP_MAX2_M2)));
 }
 
+/* an interesting max with more than one candidate left */
+static __inline__ int
+dp_is_unresolved(dp_t x)
+{
+    int m3, m2;
+    m3 = !!(x & DP_MAX3_M0) + !!(x & DP_MAX3_M1) + !!(x & DP_MAX3_M2);
+    m2 = !!(x & DP_MAX2_M1) + !!(x & DP_MAX2_M2);
+    return (((x & DP_MAX3) && m3 > 1) || ((x & DP_MAX2) && m2 > 1));
+}
+
 
 
 static __inline__ slong
@@ -111,11 +131,17 @@ void dp_mat_clear(dp_mat_t mat);
 void dp_mat_set(dp_mat_t mat, const dp_mat_t src);
 void dp_mat_get_alignment(char *sa, char *sb, slong *plen,
         dp_mat_t mat, const slong *A, const slong *B);
+void dp_mat_get_ops(unsigned char *ops, slong *plen, dp_mat_t mat);
+void dp_ops_get_alignment(char *sa, char *sb,
+        const unsigned char *ops, slong len, const slong *A, const slong *B);
+void dp_alignment_get_ops(unsigned char *ops,
+        const char *sa, const char *sb, slong len);
 void dp_mat_fprint(FILE *stream, const dp_mat_t mat);
 void dp_mat_check_alignment(
         int *p_is_optimal, int *p_is_canonical,
         dp_mat_t mat, const slong *A, const slong *B, slong len);
 void dp_mat_backward(dp_mat_t mat);
+slong dp_mat_count_unresolved(const dp_mat_t mat);
 
 
 #ifdef __cplusplus
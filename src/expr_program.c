@@ -0,0 +1,419 @@
+#include "flint/flint.h"
+#include "flint/fmpq.h"
+#include "flint/fmpz_mat.h"
+#include "arb.h"
+#include "arb_mat.h"
+
+#include "femtocas.h"
+#include "expr_program.h"
+#include "hash.h"
+
+
+/*
+ * Open addressing tables used only during compilation.
+ * Each slot holds an instruction index, or -1 if the slot is empty.
+ * The address table also remembers the expression in each slot,
+ * whereas the structure table compares candidate instructions
+ * against the instructions already in the program.
+ */
+typedef struct
+{
+    slong *slots;
+    expr_ptr *keys;
+    slong alloc;
+    slong len;
+} _table_struct;
+typedef _table_struct _table_t[1];
+
+typedef struct
+{
+    expr_program_struct *prog;
+    _table_t by_address;
+    _table_t by_structure;
+} _compiler_struct;
+typedef _compiler_struct _compiler_t[1];
+
+static void _table_init(_table_t t, slong alloc);
+static void _table_clear(_table_t t);
+static uint64_t _hash_address(const expr_struct *x);
+static uint64_t _hash_instr(const expr_instr_struct *p);
+static int _instr_equal(const expr_instr_struct *p,
+        const expr_instr_struct *q);
+static slong _find_address(const _table_t t, expr_ptr x);
+static void _insert_address(_table_t t, expr_ptr x, slong index);
+static slong _find_structure(const _table_t t,
+        const expr_program_struct *prog, const expr_instr_struct *p);
+static void _insert_structure(_table_t t,
+        const expr_program_struct *prog, slong index);
+static slong _compile(_compiler_t c, expr_ptr x);
+
+
+void
+_table_init(_table_t t, slong alloc)
+{
+    slong i;
+    t->slots = flint_malloc(alloc * sizeof(slong));
+    t->keys = flint_malloc(alloc * sizeof(expr_ptr));
+    for (i = 0; i < alloc; i++)
+    {
+        t->slots[i] = -1;
+        t->keys[i] = NULL;
+    }
+    t->alloc = alloc;
+    t->len = 0;
+}
+
+void
+_table_clear(_table_t t)
+{
+    flint_free(t->slots);
+    flint_free(t->keys);
+}
+
+uint64_t
+_hash_address(const expr_struct *x)
+{
+    return hash_bytes(HASH_INIT, &x, sizeof(x));
+}
+
+uint64_t
+_hash_instr(const expr_instr_struct *p)
+{
+    uint64_t h = HASH_INIT;
+    h = hash_bytes(h, &(p->op), sizeof(p->op));
+    h = hash_bytes(h, &(p->a), sizeof(p->a));
+    h = hash_bytes(h, &(p->b), sizeof(p->b));
+    return hash_fmpq(h, &(p->q));
+}
+
+int
+_instr_equal(const expr_instr_struct *p, const expr_instr_struct *q)
+{
+    return p->op == q->op && p->a == q->a && p->b == q->b &&
+           fmpq_equal(&(p->q), &(q->q));
+}
+
+slong
+_find_address(const _table_t t, expr_ptr x)
+{
+    slong i;
+    i = (slong) (_hash_address(x) % (uint64_t) t->alloc);
+    while (t->slots[i] >= 0)
+    {
+        if (t->keys[i] == x)
+        {
+            return t->slots[i];
+        }
+        i = (i + 1) % t->alloc;
+    }
+    return -1;
+}
+
+void
+_insert_address(_table_t t, expr_ptr x, slong index)
+{
+    slong i;
+    if (2 * (t->len + 1) > t->alloc)
+    {
+        _table_t u;
+        _table_init(u, 2 * t->alloc);
+        for (i = 0; i < t->alloc; i++)
+        {
+            if (t->slots[i] >= 0)
+            {
+                _insert_address(u, t->keys[i], t->slots[i]);
+            }
+        }
+        _table_clear(t);
+        *t = *u;
+    }
+    i = (slong) (_hash_address(x) % (uint64_t) t->alloc);
+    while (t->slots[i] >= 0)
+    {
+        i = (i + 1) % t->alloc;
+    }
+    t->slots[i] = index;
+    t->keys[i] = x;
+    t->len++;
+}
+
+slong
+_find_structure(const _table_t t,
+        const expr_program_struct *prog, const expr_instr_struct *p)
+{
+    slong i;
+    i = (slong) (_hash_instr(p) % (uint64_t) t->alloc);
+    while (t->slots[i] >= 0)
+    {
+        if (_instr_equal(prog->instr + t->slots[i], p))
+        {
+            return t->slots[i];
+        }
+        i = (i + 1) % t->alloc;
+    }
+    return -1;
+}
+
+void
+_insert_structure(_table_t t, const expr_program_struct *prog, slong index)
+{
+    slong i;
+    if (2 * (t->len + 1) > t->alloc)
+    {
+        _table_t u;
+        _table_init(u, 2 * t->alloc);
+        for (i = 0; i < t->alloc; i++)
+        {
+            if (t->slots[i] >= 0)
+            {
+                _insert_structure(u, prog, t->slots[i]);
+            }
+        }
+        _table_clear(t);
+        *t = *u;
+    }
+    i = (slong) (_hash_instr(prog->instr + index) % (uint64_t) t->alloc);
+    while (t->slots[i] >= 0)
+    {
+        i = (i + 1) % t->alloc;
+    }
+    t->slots[i] = index;
+    t->len++;
+}
+
+slong
+_compile(_compiler_t c, expr_ptr x)
+{
+    /*
+     * Return the index of the instruction computing x,
+     * appending instructions for x and its arguments as necessary.
+     * Arguments are compiled before the expressions that use them,
+     * so the instructions are in topological order.
+     */
+    expr_program_struct *prog = c->prog;
+    expr_instr_struct tmp;
+    slong index, nargs;
+
+    index = _find_address(c->by_address, x);
+    if (index >= 0)
+    {
+        return index;
+    }
+
+    tmp.op = expr_op(x);
+    if (tmp.op == EXPR_OP_NONE)
+    {
+        flint_printf("expr_program: cannot compile an expression ");
+        flint_printf("without an operation code\n");
+        abort();
+    }
+    nargs = expr_op_nargs(tmp.op);
+    tmp.a = (nargs > 0) ? _compile(c, expr_arg(x, 0)) : -1;
+    tmp.b = (nargs > 1) ? _compile(c, expr_arg(x, 1)) : -1;
+    fmpq_init(&(tmp.q));
+    if (nargs == 0)
+    {
+        expr_get_fmpq(&(tmp.q), x);
+    }
+
+    index = _find_structure(c->by_structure, prog, &tmp);
+    if (index >= 0)
+    {
+        fmpq_clear(&(tmp.q));
+    }
+    else
+    {
+        if (prog->len == prog->alloc)
+        {
+            prog->alloc = FLINT_MAX(1, 2 * prog->alloc);
+            prog->instr = flint_realloc(prog->instr,
+                    prog->alloc * sizeof(expr_instr_struct));
+        }
+        index = prog->len;
+        prog->instr[index] = tmp;
+        prog->len++;
+        _insert_structure(c->by_structure, prog, index);
+    }
+
+    _insert_address(c->by_address, x, index);
+    return index;
+}
+
+
+void
+expr_program_init(expr_program_t prog, expr_ptr * table, slong n)
+{
+    _compiler_t c;
+    slong i;
+
+    prog->instr = NULL;
+    prog->len = 0;
+    prog->alloc = 0;
+    prog->noutputs = n;
+    prog->outputs = flint_malloc(FLINT_MAX(1, n) * sizeof(slong));
+
+    c->prog = prog;
+    _table_init(c->by_address, 16);
+    _table_init(c->by_structure, 16);
+
+    for (i = 0; i < n; i++)
+    {
+        prog->outputs[i] = _compile(c, table[i]);
+    }
+
+    _table_clear(c->by_address);
+    _table_clear(c->by_structure);
+}
+
+void
+expr_program_clear(expr_program_t prog)
+{
+    slong i;
+    for (i = 0; i < prog->len; i++)
+    {
+        fmpq_clear(&(prog->instr[i].q));
+    }
+    flint_free(prog->instr);
+    flint_free(prog->outputs);
+}
+
+
+void
+expr_program_eval(arb_ptr values, const expr_program_t prog, slong level)
+{
+    /*
+     * Each operation is evaluated at the same precision as the
+     * corresponding expr_eval method, so that the real balls agree
+     * with the tree-based evaluation up to rounding.
+     */
+    slong i, prec;
+    const expr_instr_struct *p;
+    arb_ptr z;
+
+    if (level < 0 || EXPR_CACHE_CAP <= level)
+    {
+        flint_printf("invalid log2 prec bits level %wd\n", level);
+        abort();
+    }
+    prec = 1 << level;
+
+    for (i = 0; i < prog->len; i++)
+    {
+        p = prog->instr + i;
+        z = values + i;
+        switch (p->op)
+        {
+            case EXPR_OP_FMPZ:
+                arb_set_fmpz(z, fmpq_numref(&(p->q)));
+                break;
+            case EXPR_OP_LOG_FMPZ:
+                arb_set_fmpz(z, fmpq_numref(&(p->q)));
+                arb_log(z, z, prec);
+                break;
+            case EXPR_OP_FMPQ:
+                arb_set_fmpq(z, &(p->q), prec);
+                break;
+            case EXPR_OP_LOG_FMPQ:
+                arb_set_fmpq(z, &(p->q), prec);
+                arb_log(z, z, prec);
+                break;
+            case EXPR_OP_EXP_FMPQ:
+                arb_set_fmpq(z, &(p->q), prec);
+                arb_exp(z, z, prec);
+                break;
+            case EXPR_OP_EXP:
+                arb_exp(z, values + p->a, prec);
+                break;
+            case EXPR_OP_NEG:
+                arb_neg(z, values + p->a);
+                break;
+            case EXPR_OP_LOG:
+                arb_log(z, values + p->a, prec);
+                break;
+            case EXPR_OP_LOG1P:
+                arb_log1p(z, values + p->a, prec);
+                break;
+            case EXPR_OP_LOG1M:
+                arb_neg(z, values + p->a);
+                arb_log1p(z, z, prec);
+                break;
+            case EXPR_OP_COMPLEMENT:
+                arb_sub_ui(z, values + p->a, 1, prec);
+                arb_neg(z, z);
+                break;
+            case EXPR_OP_ADD:
+                arb_add(z, values + p->a, values + p->b, prec);
+                break;
+            case EXPR_OP_MUL:
+                arb_mul(z, values + p->a, values + p->b, prec);
+                break;
+            case EXPR_OP_SUB:
+                arb_sub(z, values + p->a, values + p->b, prec);
+                break;
+            case EXPR_OP_DIV:
+                arb_div(z, values + p->a, values + p->b, prec);
+                break;
+            default:
+                flint_printf("expr_program: unknown operation %d\n", p->op);
+                abort();
+        }
+    }
+}
+
+void
+expr_program_eval_outputs(arb_ptr res, const expr_program_t prog,
+        slong level)
+{
+    slong i;
+    arb_ptr values;
+
+    values = _arb_vec_init(prog->len);
+    expr_program_eval(values, prog, level);
+    for (i = 0; i < prog->noutputs; i++)
+    {
+        arb_set(res + i, values + prog->outputs[i]);
+    }
+    _arb_vec_clear(values, prog->len);
+}
+
+void
+expr_program_eval_log_combinations(arb_mat_t res,
+        const expr_program_t prog, const fmpz_mat_t mat, slong level)
+{
+    slong i, j, nr, nc, prec;
+    arb_ptr logs;
+    const fmpz *e;
+
+    nr = fmpz_mat_nrows(mat);
+    nc = fmpz_mat_ncols(mat);
+    if (nc != prog->noutputs || arb_mat_nrows(res) != nr)
+    {
+        flint_printf("expr_program_eval_log_combinations: ");
+        flint_printf("incompatible dimensions\n");
+        abort();
+    }
+    prec = 1 << level;
+
+    logs = _arb_vec_init(nc);
+    expr_program_eval_outputs(logs, prog, level);
+    for (j = 0; j < nc; j++)
+    {
+        arb_log(logs + j, logs + j, prec);
+    }
+
+    /* the exponent matrix is sparse, so skip the zero entries */
+    for (i = 0; i < nr; i++)
+    {
+        arb_zero(arb_mat_entry(res, i, 0));
+        for (j = 0; j < nc; j++)
+        {
+            e = fmpz_mat_entry(mat, i, j);
+            if (!fmpz_is_zero(e))
+            {
+                arb_addmul_fmpz(arb_mat_entry(res, i, 0), logs + j, e, prec);
+            }
+        }
+    }
+
+    _arb_vec_clear(logs, nc);
+}
@@ -0,0 +1,88 @@
+/*
+ * A flattened femtocas evaluation program.
+ *
+ * A table of expressions is compiled into an array of instructions
+ * in topological order, with each distinct subexpression appearing
+ * only once; subexpressions are identified both by address and by
+ * structure (the operation, its arguments, and any constant).
+ * The whole table is then evaluated at a given precision level
+ * by a single sweep through the instructions,
+ * using one real ball per instruction.
+ *
+ * The compiled program copies everything it needs from the
+ * expressions, and it is not modified by evaluation,
+ * so it can be evaluated concurrently.
+ */
+
+#ifndef EXPR_PROGRAM_H
+#define EXPR_PROGRAM_H
+
+#include "flint/flint.h"
+#include "flint/fmpq.h"
+#include "flint/fmpz_mat.h"
+#include "arb.h"
+#include "arb_mat.h"
+
+#include "femtocas.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* a and b are instruction indices of the arguments, or -1 if unused */
+typedef struct
+{
+    int op;
+    slong a;
+    slong b;
+    fmpq q;
+} expr_instr_struct;
+
+typedef struct
+{
+    expr_instr_struct *instr;
+    slong len;
+    slong alloc;
+    slong *outputs;
+    slong noutputs;
+} expr_program_struct;
+typedef expr_program_struct expr_program_t[1];
+typedef expr_program_struct * expr_program_ptr;
+
+void expr_program_init(expr_program_t prog, expr_ptr * table, slong n);
+void expr_program_clear(expr_program_t prog);
+
+static __inline__ slong
+expr_program_length(const expr_program_t prog)
+{
+    return prog->len;
+}
+
+/*
+ * Evaluate every instruction at the given precision level.
+ * The values vector must have expr_program_length(prog) entries;
+ * the value of the k-th compiled expression is values[prog->outputs[k]].
+ */
+void expr_program_eval(arb_ptr values, const expr_program_t prog,
+        slong level);
+
+/* set the n entries of res to the compiled expressions */
+void expr_program_eval_outputs(arb_ptr res, const expr_program_t prog,
+        slong level);
+
+/*
+ * Set the (nrows x 1) matrix res to mat * log(x), where mat is
+ * an (nrows x n) integer exponent matrix and x is the column vector
+ * of compiled expressions.
+ */
+void expr_program_eval_log_combinations(arb_mat_t res,
+        const expr_program_t prog, const fmpz_mat_t mat, slong level);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
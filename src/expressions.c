@@ -1,7 +1,15 @@
 #include "expressions.h"
+#include "hash.h"
 #include "unused.h"
 
 
+static uint64_t _reg_hash(int op, expr_ptr a, expr_ptr b, const fmpq_t q);
+static uint64_t _reg_hash_expr(expr_ptr p);
+static expr_ptr _reg_find(reg_ptr x,
+        int op, expr_ptr a, expr_ptr b, const fmpq_t q);
+static void _reg_insert(reg_ptr x, expr_ptr p);
+
+
 void
 reg_node_init(reg_node_t x, slong index, expr_ptr p)
 {
@@ -25,6 +33,9 @@ reg_init(reg_ptr x)
     x->head = NULL;
     x->tail = NULL;
     x->size = 0;
+    x->slots = NULL;
+    x->nslots = 0;
+    x->nconsed = 0;
 }
 
 void
@@ -56,9 +67,13 @@ reg_clear(reg_ptr x)
         node = next;
         i++;
     }
+    flint_free(x->slots);
     x->head = NULL;
     x->tail = NULL;
     x->size = 0;
+    x->slots = NULL;
+    x->nslots = 0;
+    x->nconsed = 0;
 }
 
 expr_ptr
@@ -96,139 +111,297 @@ reg_vec(reg_ptr x)
     return vec;
 }
 
+void
+reg_freeze(reg_ptr x, slong level)
+{
+    reg_node_ptr node;
+    for (node = x->head; node; node = node->next)
+    {
+        expr_freeze(node->p, level);
+    }
+}
 
-void tkf91_expressions_init(
-        tkf91_expressions_ptr p,
-        reg_t reg,
-        const tkf91_rationals_t r)
+
+/*
+ * The hash-consing table is an open addressing table of expressions,
+ * kept at most half full.  The key of an expression is its operation,
+ * the addresses of its expression arguments, and its constant if any.
+ */
+
+uint64_t
+_reg_hash(int op, expr_ptr a, expr_ptr b, const fmpq_t q)
 {
-    /*
-     * Create a bunch of static single assignment expressions.
-     * Track all of them in an expressions registry;
-     * this will let the expressions be cleared later,
-     * and it will associate each expression with an array index.
-     * Give some of the expressions special names to be used
-     * later when the generators are defined.
-     */
-    slong i, j;
+    uint64_t h = HASH_INIT;
+    h = hash_bytes(h, &op, sizeof(op));
+    h = hash_bytes(h, &a, sizeof(a));
+    h = hash_bytes(h, &b, sizeof(b));
+    if (q)
+    {
+        h = hash_fmpq(h, q);
+    }
+    return h;
+}
 
-    /* factors related to sequence length equilibrium frequency */
+uint64_t
+_reg_hash_expr(expr_ptr p)
+{
+    uint64_t h;
+    slong nargs;
+    fmpq_t q;
+
+    nargs = expr_op_nargs(expr_op(p));
+    if (nargs)
     {
-        p->lambda_div_mu = reg_new(reg);
-        expr_fmpq(p->lambda_div_mu, r->lambda_div_mu);
+        return _reg_hash(expr_op(p),
+                expr_arg(p, 0), (nargs > 1) ? expr_arg(p, 1) : NULL, NULL);
+    }
+    fmpq_init(q);
+    expr_get_fmpq(q, p);
+    h = _reg_hash(expr_op(p), NULL, NULL, q);
+    fmpq_clear(q);
+    return h;
+}
+
+expr_ptr
+_reg_find(reg_ptr x, int op, expr_ptr a, expr_ptr b, const fmpq_t q)
+{
+    slong i;
+    expr_ptr p;
+    fmpq_t c;
+    int found;
 
-        p->one_minus_lambda_div_mu = reg_new(reg);
-        expr_fmpq(p->one_minus_lambda_div_mu, r->one_minus_lambda_div_mu);
+    if (!x->nslots)
+    {
+        return NULL;
     }
 
-    /* factors related to sequence composition */
+    fmpq_init(c);
+    found = 0;
+    i = (slong) (_reg_hash(op, a, b, q) % (uint64_t) x->nslots);
+    while (!found && (p = x->slots[i]) != NULL)
     {
-        expr_ptr alias;
-        for (i = 0; i < 4; i++)
+        if (expr_op(p) == op)
         {
-            alias = NULL;
-            for (j = 0; j < i; j++)
+            if (q)
             {
-                if (fmpq_equal(r->pi+i, r->pi+j))
-                {
-                    alias = p->pi[j];
-                    break;
-                }
+                expr_get_fmpq(c, p);
+                found = fmpq_equal(c, q);
             }
-            if (alias)
+            else
             {
-                p->pi[i] = alias;
+                found = (expr_arg(p, 0) == a &&
+                        (b == NULL || expr_arg(p, 1) == b));
             }
-            else
+        }
+        i = (i + 1) % x->nslots;
+    }
+    fmpq_clear(c);
+
+    return found ? p : NULL;
+}
+
+void
+_reg_insert(reg_ptr x, expr_ptr p)
+{
+    slong i;
+
+    if (2 * (x->nconsed + 1) > x->nslots)
+    {
+        expr_ptr * old = x->slots;
+        slong nold = x->nslots;
+
+        x->nslots = FLINT_MAX(16, 2 * nold);
+        x->slots = flint_calloc(x->nslots, sizeof(expr_ptr));
+        x->nconsed = 0;
+        for (i = 0; i < nold; i++)
+        {
+            if (old[i])
             {
-                p->pi[i] = reg_new(reg);
-                expr_fmpq(p->pi[i], r->pi+i);
+                _reg_insert(x, old[i]);
             }
         }
+        flint_free(old);
     }
 
-    /* factors related to the indel process involving beta */
+    i = (slong) (_reg_hash_expr(p) % (uint64_t) x->nslots);
+    while (x->slots[i])
     {
-        expr_ptr x_mu = reg_new(reg);
-        expr_fmpq(x_mu, r->mu);
+        i = (i + 1) % x->nslots;
+    }
+    x->slots[i] = p;
+    x->nconsed++;
+}
 
-        expr_ptr x_lambda = reg_new(reg);
-        expr_fmpq(x_lambda, r->lambda);
+expr_ptr
+reg_fmpz(reg_ptr x, const fmpz_t a)
+{
+    expr_ptr p;
+    fmpq_t q;
+
+    fmpq_init(q);
+    fmpz_set(fmpq_numref(q), a);
+    p = _reg_find(x, EXPR_OP_FMPZ, NULL, NULL, q);
+    fmpq_clear(q);
+    if (!p)
+    {
+        p = reg_new(x);
+        expr_fmpz(p, a);
+        _reg_insert(x, p);
+    }
+    return p;
+}
 
-        expr_ptr a = reg_new(reg);
-        expr_exp_fmpq(a, r->beta_exponent);
+expr_ptr
+reg_fmpq(reg_ptr x, const fmpq_t a)
+{
+    expr_ptr p = _reg_find(x, EXPR_OP_FMPQ, NULL, NULL, a);
+    if (!p)
+    {
+        p = reg_new(x);
+        expr_fmpq(p, a);
+        _reg_insert(x, p);
+    }
+    return p;
+}
 
-        expr_ptr num = reg_new(reg);
-        expr_complement(num, a);
+expr_ptr
+reg_exp_fmpq(reg_ptr x, const fmpq_t a)
+{
+    expr_ptr p = _reg_find(x, EXPR_OP_EXP_FMPQ, NULL, NULL, a);
+    if (!p)
+    {
+        p = reg_new(x);
+        expr_exp_fmpq(p, a);
+        _reg_insert(x, p);
+    }
+    return p;
+}
 
-        expr_ptr b = reg_new(reg);
-        expr_mul(b, x_lambda, a);
+expr_ptr
+reg_complement(reg_ptr x, expr_ptr a)
+{
+    expr_ptr p = _reg_find(x, EXPR_OP_COMPLEMENT, a, NULL, NULL);
+    if (!p)
+    {
+        p = reg_new(x);
+        expr_complement(p, a);
+        _reg_insert(x, p);
+    }
+    return p;
+}
 
-        expr_ptr den = reg_new(reg);
-        expr_sub(den, x_mu, b);
+expr_ptr
+reg_add(reg_ptr x, expr_ptr a, expr_ptr b)
+{
+    expr_ptr p = _reg_find(x, EXPR_OP_ADD, a, b, NULL);
+    if (!p)
+    {
+        p = reg_new(x);
+        expr_add(p, a, b);
+        _reg_insert(x, p);
+    }
+    return p;
+}
 
-        p->exp_neg_mu_tau = reg_new(reg);
-        expr_exp_fmpq(p->exp_neg_mu_tau, r->neg_mu_tau);
+expr_ptr
+reg_mul(reg_ptr x, expr_ptr a, expr_ptr b)
+{
+    expr_ptr p = _reg_find(x, EXPR_OP_MUL, a, b, NULL);
+    if (!p)
+    {
+        p = reg_new(x);
+        expr_mul(p, a, b);
+        _reg_insert(x, p);
+    }
+    return p;
+}
 
-        p->beta = reg_new(reg);
-        expr_div(p->beta, num, den);
+expr_ptr
+reg_sub(reg_ptr x, expr_ptr a, expr_ptr b)
+{
+    expr_ptr p = _reg_find(x, EXPR_OP_SUB, a, b, NULL);
+    if (!p)
+    {
+        p = reg_new(x);
+        expr_sub(p, a, b);
+        _reg_insert(x, p);
+    }
+    return p;
+}
 
-        p->lambda_beta = reg_new(reg);
-        expr_mul(p->lambda_beta, x_lambda, p->beta);
+expr_ptr
+reg_div(reg_ptr x, expr_ptr a, expr_ptr b)
+{
+    expr_ptr p = _reg_find(x, EXPR_OP_DIV, a, b, NULL);
+    if (!p)
+    {
+        p = reg_new(x);
+        expr_div(p, a, b);
+        _reg_insert(x, p);
+    }
+    return p;
+}
 
-        p->one_minus_lambda_beta = reg_new(reg);
-        expr_complement(p->one_minus_lambda_beta, p->lambda_beta);
 
-        p->mu_beta = reg_new(reg);
-        expr_mul(p->mu_beta, x_mu, p->beta);
+void tkf91_expressions_init(
+        tkf91_expressions_ptr p,
+        reg_t reg,
+        const tkf91_rationals_t r)
+{
+    /*
+     * Create a bunch of static single assignment expressions.
+     * Track all of them in an expressions registry;
+     * this will let the expressions be cleared later,
+     * and it will associate each expression with an array index.
+     * Give some of the expressions special names to be used
+     * later when the generators are defined.
+     * The registry hash-conses the expressions, so equal
+     * equilibrium frequencies share their expressions.
+     */
+    slong i;
+
+    /* factors related to sequence length equilibrium frequency */
+    {
+        p->lambda_div_mu = reg_fmpq(reg, r->lambda_div_mu);
+        p->one_minus_lambda_div_mu = reg_fmpq(reg, r->one_minus_lambda_div_mu);
+    }
 
-        expr_ptr c = reg_new(reg);
-        expr_add(c, p->exp_neg_mu_tau, p->mu_beta);
+    /* factors related to sequence composition */
+    {
+        for (i = 0; i < 4; i++)
+        {
+            p->pi[i] = reg_fmpq(reg, r->pi+i);
+        }
+    }
 
-        p->the_long_beta_expression = reg_new(reg);
-        expr_complement(p->the_long_beta_expression, c);
+    /* factors related to the indel process involving beta */
+    {
+        expr_ptr x_mu = reg_fmpq(reg, r->mu);
+        expr_ptr x_lambda = reg_fmpq(reg, r->lambda);
+        expr_ptr a = reg_exp_fmpq(reg, r->beta_exponent);
+        expr_ptr num = reg_complement(reg, a);
+        expr_ptr b = reg_mul(reg, x_lambda, a);
+        expr_ptr den = reg_sub(reg, x_mu, b);
+
+        p->exp_neg_mu_tau = reg_exp_fmpq(reg, r->neg_mu_tau);
+        p->beta = reg_div(reg, num, den);
+        p->lambda_beta = reg_mul(reg, x_lambda, p->beta);
+        p->one_minus_lambda_beta = reg_complement(reg, p->lambda_beta);
+        p->mu_beta = reg_mul(reg, x_mu, p->beta);
+
+        expr_ptr c = reg_add(reg, p->exp_neg_mu_tau, p->mu_beta);
+        p->the_long_beta_expression = reg_complement(reg, c);
     }
 
     /* factors related to point substitutions */
     {
-        expr_ptr exp_negdt = reg_new(reg);
-        expr_exp_fmpq(exp_negdt, r->negdt);
+        expr_ptr exp_negdt = reg_exp_fmpq(reg, r->negdt);
+        p->one_minus_exp_negdt = reg_complement(reg, exp_negdt);
 
-        p->one_minus_exp_negdt = reg_new(reg);
-        expr_complement(p->one_minus_exp_negdt, exp_negdt);
-
-        int alias_found;
-        expr_ptr match_alias, mismatch_alias;
         for (i = 0; i < 4; i++)
         {
-            alias_found = 0;
-            match_alias = NULL;
-            mismatch_alias = NULL;
-            for (j = 0; j < i; j++)
-            {
-                if (fmpq_equal(r->pi+i, r->pi+j))
-                {
-                    match_alias = p->match[j];
-                    mismatch_alias = p->mismatch[j];
-                    alias_found = 1;
-                    break;
-                }
-            }
-            if (alias_found)
-            {
-                p->match[i] = match_alias;
-                p->mismatch[i] = mismatch_alias;
-            }
-            else
-            {
-                expr_ptr a = reg_new(reg);
-                expr_mul(a, p->pi[i], p->one_minus_exp_negdt);
-
-                p->match[i] = reg_new(reg);
-                expr_add(p->match[i], exp_negdt, a);
-
-                p->mismatch[i] = a;
-            }
+            p->mismatch[i] = reg_mul(reg, p->pi[i], p->one_minus_exp_negdt);
+            p->match[i] = reg_add(reg, exp_negdt, p->mismatch[i]);
         }
     }
 }
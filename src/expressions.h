@@ -25,12 +25,19 @@ typedef reg_node_struct reg_node_t[1];
 /*
  * This structure manages the memory of all of its registry nodes
  * and all of the expression objects in those nodes.
+ * Expressions created by the reg_fmpz, reg_fmpq, ... constructors
+ * are hash-consed, so that registering an expression equal to one
+ * that is already registered returns the existing expression.
+ * Equality is structural, with arguments compared by address.
  */
 typedef struct
 {
     reg_node_ptr head;
     reg_node_ptr tail;
     slong size;
+    expr_ptr * slots;
+    slong nslots;
+    slong nconsed;
 } reg_struct;
 typedef reg_struct reg_t[1];
 typedef reg_struct * reg_ptr;
@@ -82,6 +89,19 @@ void reg_clear(reg_ptr x);
 expr_ptr reg_new(reg_ptr x);
 expr_ptr * reg_vec(reg_ptr x);
 
+/* freeze the caches of all registered expressions at the given level */
+void reg_freeze(reg_ptr x, slong level);
+
+/* hash-consing constructors of registered expressions */
+expr_ptr reg_fmpz(reg_ptr x, const fmpz_t a);
+expr_ptr reg_fmpq(reg_ptr x, const fmpq_t a);
+expr_ptr reg_exp_fmpq(reg_ptr x, const fmpq_t a);
+expr_ptr reg_complement(reg_ptr x, expr_ptr a);
+expr_ptr reg_add(reg_ptr x, expr_ptr a, expr_ptr b);
+expr_ptr reg_mul(reg_ptr x, expr_ptr a, expr_ptr b);
+expr_ptr reg_sub(reg_ptr x, expr_ptr a, expr_ptr b);
+expr_ptr reg_div(reg_ptr x, expr_ptr a, expr_ptr b);
+
 
 void tkf91_expressions_init(
         tkf91_expressions_ptr p,
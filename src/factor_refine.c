@@ -3,380 +3,466 @@
  * Eric Bach, James Driscoll, Jeffrey Shallit
  * Computer Sciences Technical Report #883
  * October 1989.
+ *
+ * The refinement is stored in contiguous arrays of (base, exponent) pairs.
+ * It is computed as a coprime base in the manner of
+ * D. J. Bernstein, "Factoring into coprimes in essentially linear time":
+ * the refinements of the two halves of the input are merged,
+ * and each merge uses batched gcds over product and remainder trees
+ * to split the bases of one set by the halves of the other set.
+ * Only a single pair of bases sharing all of their primes is refined
+ * by the pairwise algorithm of Bach, Driscoll and Shallit.
  */
+#include <string.h>
+
 #include "flint/fmpz.h"
+#include "flint/fmpz_vec.h"
 #include "factor_refine.h"
 
 
-#define fr_node_mref(x) (&(x)->m)
-
-typedef struct fr_node_struct
+typedef struct
 {
     fmpz m;
     ulong e;
-    struct fr_node_struct * next;
-} fr_node_struct;
-typedef fr_node_struct * fr_node_ptr;
-
-/* functions related to factor refinement nodes */
-void fr_node_init(fr_node_ptr x);
-void fr_node_init_fmpz_ui(fr_node_ptr x, const fmpz_t m, ulong e);
-void fr_node_clear(fr_node_ptr x);
-int fr_node_is_one(fr_node_ptr x);
-void fr_node_set_fmpz_ui(fr_node_ptr x, const fmpz_t m, ulong e);
-void fr_node_get_fmpz_ui(fmpz_t m, ulong * e, fr_node_ptr x);
-int fr_node_base_cmp(const fr_node_ptr x, const fr_node_ptr y);
-int fr_node_base_pcmp(const void * a, const void * b);
-
-/* functions related to lists of factor refinement nodes */
-slong fr_node_list_length(fr_node_ptr x);
-void fr_node_list_pop_front(fr_node_ptr *phead, fr_node_ptr *ptail);
-void fr_node_list_concat(fr_node_ptr *phead, fr_node_ptr *ptail,
-        fr_node_ptr rhead, fr_node_ptr rtail);
-void fr_node_list_clear(fr_node_ptr head);
-void fr_node_list_print(fr_node_ptr head);
+} fr_pair_struct;
+
+typedef struct
+{
+    fr_pair_struct *p;
+    slong len;
+    slong alloc;
+} fr_vec_struct;
+typedef fr_vec_struct fr_vec_t[1];
+
+/* product tree of the bases of an array of pairs, with the leaves first */
+typedef struct
+{
+    fmpz **levels;
+    slong *lens;
+    slong depth;
+} fr_tree_struct;
+typedef fr_tree_struct fr_tree_t[1];
+
+#define fr_tree_root(T) ((T)->levels[(T)->depth - 1])
+
+/* functions related to arrays of factor refinement pairs */
+void fr_vec_init(fr_vec_t v);
+void fr_vec_clear(fr_vec_t v);
+void fr_vec_fit_length(fr_vec_t v, slong len);
+void fr_vec_append(fr_vec_t v, const fmpz_t m, ulong e);
+void fr_vec_extend(fr_vec_t v, const fr_pair_struct *x, slong len);
+void fr_vec_insert(fr_vec_t v, slong i, const fmpz_t m, ulong e);
+void fr_vec_truncate(fr_vec_t v, slong len);
+void fr_vec_remove_ones(fr_vec_t v);
+int fr_pair_is_one(const fr_pair_struct *x);
+int fr_pair_base_pcmp(const void * a, const void * b);
+
+/* functions related to product trees */
+void fr_tree_init(fr_tree_t T, const fr_pair_struct *v, slong len);
+void fr_tree_clear(fr_tree_t T);
+void fr_tree_remainders(fmpz *r, const fr_tree_t T, const fmpz_t x);
 
 /* fmpz_factor_t convenience function */
 int _fmpz_factor_sgn(const fmpz_factor_t f);
 
 /* functions related to the actual algorithms of interest */
-void pair_refine_unreduced(fr_node_ptr *phead,
-        fmpz_t m1, ulong e1, fmpz_t m2, ulong e2);
-void remove_ones(fr_node_ptr *phead, fr_node_ptr *ptail, fr_node_ptr ohead);
-void pair_refine(fr_node_ptr *phead, fr_node_ptr *ptail,
-        fmpz_t m1, ulong e1, fmpz_t m2, ulong e2);
-void augment_refinement(fr_node_ptr *phead, fr_node_ptr *ptail,
-        const fmpz_t m_jp1, ulong e_jp1,
-        fr_node_ptr L_j, fr_node_ptr L_j_tail);
+void pair_refine(fr_vec_t res,
+        const fmpz_t m1, ulong e1, const fmpz_t m2, ulong e2);
+void coprime_parts(fr_vec_t out, fr_vec_t in,
+        const fr_pair_struct *v, const fr_tree_t T, const fmpz_t x);
+void coprime_merge(fr_vec_t res,
+        const fr_pair_struct *a, slong alen,
+        const fr_pair_struct *b, slong blen);
+void coprime_refine(fr_vec_t res, const fr_pair_struct *v, slong len);
 
 
 void
-fr_node_init(fr_node_ptr x)
+fr_vec_init(fr_vec_t v)
 {
-    fmpz_init(fr_node_mref(x));
-    x->e = 0;
-    x->next = NULL;
+    v->p = NULL;
+    v->len = 0;
+    v->alloc = 0;
 }
 
 void
-fr_node_init_fmpz_ui(fr_node_ptr x, const fmpz_t m, ulong e)
+fr_vec_clear(fr_vec_t v)
 {
-    fmpz_init_set(fr_node_mref(x), m);
-    x->e = e;
-    x->next = NULL;
+    fr_vec_truncate(v, 0);
+    flint_free(v->p);
+    v->p = NULL;
+    v->alloc = 0;
 }
 
 void
-fr_node_clear(fr_node_ptr x)
+fr_vec_fit_length(fr_vec_t v, slong len)
 {
-    fmpz_clear(fr_node_mref(x));
-    x->e = 0;
-    x->next = NULL;
+    if (len > v->alloc)
+    {
+        len = FLINT_MAX(len, 2 * v->alloc);
+        v->p = flint_realloc(v->p, len * sizeof(fr_pair_struct));
+        v->alloc = len;
+    }
 }
 
-int
-fr_node_is_one(fr_node_ptr x)
+void
+fr_vec_append(fr_vec_t v, const fmpz_t m, ulong e)
 {
-    /* follow the fmpz_pow_ui convention 0^0 = 1 */
-    return (x->e == WORD(0) || fmpz_is_one(fr_node_mref(x)));
+    fr_vec_insert(v, v->len, m, e);
 }
 
 void
-fr_node_set_fmpz_ui(fr_node_ptr x, const fmpz_t m, ulong e)
+fr_vec_extend(fr_vec_t v, const fr_pair_struct *x, slong len)
 {
-    fmpz_set(fr_node_mref(x), m);
-    x->e = e;
+    slong i;
+    fr_vec_fit_length(v, v->len + len);
+    for (i = 0; i < len; i++)
+    {
+        fr_vec_append(v, &(x[i].m), x[i].e);
+    }
 }
 
 void
-fr_node_get_fmpz_ui(fmpz_t m, ulong * e, fr_node_ptr x)
+fr_vec_insert(fr_vec_t v, slong i, const fmpz_t m, ulong e)
 {
-    fmpz_set(m, fr_node_mref(x));
-    *e = x->e;
+    /* the pairs are moved as plain memory; each fmpz keeps its data */
+    fr_vec_fit_length(v, v->len + 1);
+    memmove(v->p + i + 1, v->p + i, (v->len - i) * sizeof(fr_pair_struct));
+    fmpz_init_set(&(v->p[i].m), m);
+    v->p[i].e = e;
+    v->len++;
 }
 
-int
-fr_node_base_cmp(const fr_node_ptr x, const fr_node_ptr y)
+void
+fr_vec_truncate(fr_vec_t v, slong len)
 {
-    return fmpz_cmp(fr_node_mref(x), fr_node_mref(y));
+    slong i;
+    for (i = len; i < v->len; i++)
+    {
+        fmpz_clear(&(v->p[i].m));
+    }
+    v->len = FLINT_MIN(v->len, len);
+}
+
+void
+fr_vec_remove_ones(fr_vec_t v)
+{
+    slong i, n;
+    for (i = n = 0; i < v->len; i++)
+    {
+        if (fr_pair_is_one(v->p + i))
+        {
+            fmpz_clear(&(v->p[i].m));
+        }
+        else
+        {
+            v->p[n++] = v->p[i];
+        }
+    }
+    v->len = n;
 }
 
 int
-fr_node_base_pcmp(const void * a, const void * b)
+fr_pair_is_one(const fr_pair_struct *x)
 {
-    /* intended for qsorting an array of node pointers */
-    fr_node_ptr x = *( (fr_node_ptr *) a);
-    fr_node_ptr y = *( (fr_node_ptr *) b);
-    return fr_node_base_cmp(x, y);
+    /* follow the fmpz_pow_ui convention 0^0 = 1 */
+    return (x->e == WORD(0) || fmpz_is_one(&(x->m)));
 }
 
-slong
-fr_node_list_length(fr_node_ptr x)
+int
+fr_pair_base_pcmp(const void * a, const void * b)
 {
-    slong count;
-    count = 0;
-    while (x)
-    {
-        count++;
-        x = x->next;
-    }
-    return count;
+    /* intended for qsorting an array of pairs */
+    const fr_pair_struct *x = a;
+    const fr_pair_struct *y = b;
+    return fmpz_cmp(&(x->m), &(y->m));
 }
 
+
 void
-fr_node_list_pop_front(fr_node_ptr *phead, fr_node_ptr *ptail)
+fr_tree_init(fr_tree_t T, const fr_pair_struct *v, slong len)
 {
-    fr_node_ptr tmp;
+    /* len must be positive, and the leaves are the absolute values */
+    slong depth, k, j, n;
 
-    if (phead == ptail)
+    for (depth = 1, n = len; n > 1; n = (n + 1) / 2)
     {
-        flint_printf("aliasing issue...\n");
-        abort();
+        depth++;
     }
+    T->depth = depth;
+    T->levels = flint_malloc(depth * sizeof(fmpz *));
+    T->lens = flint_malloc(depth * sizeof(slong));
 
-    if (*phead)
+    T->lens[0] = len;
+    T->levels[0] = _fmpz_vec_init(len);
+    for (j = 0; j < len; j++)
     {
-
-        if (*phead == *ptail)
+        fmpz_abs(T->levels[0] + j, &(v[j].m));
+    }
+    for (k = 1; k < depth; k++)
+    {
+        fmpz *prev = T->levels[k-1];
+        T->lens[k] = (T->lens[k-1] + 1) / 2;
+        T->levels[k] = _fmpz_vec_init(T->lens[k]);
+        for (j = 0; j < T->lens[k]; j++)
         {
-            *ptail = NULL;
+            if (2*j + 1 < T->lens[k-1])
+            {
+                fmpz_mul(T->levels[k] + j, prev + 2*j, prev + 2*j + 1);
+            }
+            else
+            {
+                fmpz_set(T->levels[k] + j, prev + 2*j);
+            }
         }
-
-        tmp = (*phead)->next;
-        fr_node_clear(*phead);
-        flint_free(*phead);
-        *phead = tmp;
     }
 }
 
 void
-fr_node_list_concat(fr_node_ptr *phead, fr_node_ptr *ptail,
-        fr_node_ptr rhead, fr_node_ptr rtail)
+fr_tree_clear(fr_tree_t T)
 {
-    /* if the second list is empty then do nothing */
-    if (!rhead)
-    {
-        return;
-    }
-
-    /* if the first list is empty then use the second list */
-    if (!(*phead))
+    slong k;
+    for (k = 0; k < T->depth; k++)
     {
-        *phead = rhead;
-        *ptail = rtail;
-        return;
+        _fmpz_vec_clear(T->levels[k], T->lens[k]);
     }
-
-    /* neither list is empty so connect the tail to the head */
-    (*ptail)->next = rhead;
-    *ptail = rtail;
+    flint_free(T->levels);
+    flint_free(T->lens);
 }
 
 void
-fr_node_list_clear(fr_node_ptr head)
+fr_tree_remainders(fmpz *r, const fr_tree_t T, const fmpz_t x)
 {
-    fr_node_ptr curr, next;
-    curr = head;
-    while (curr)
+    /*
+     * Set r[j] to x modulo the leaf j, reducing x modulo the nodes
+     * from the root down to the leaves.
+     */
+    fmpz *curr, *next;
+    slong k, j;
+
+    curr = _fmpz_vec_init(1);
+    fmpz_mod(curr, x, fr_tree_root(T));
+    for (k = T->depth - 2; k >= 0; k--)
     {
-        next = curr->next;
-        fr_node_clear(curr);
-        flint_free(curr);
+        next = _fmpz_vec_init(T->lens[k]);
+        for (j = 0; j < T->lens[k]; j++)
+        {
+            fmpz_mod(next + j, curr + j/2, T->levels[k] + j);
+        }
+        _fmpz_vec_clear(curr, T->lens[k+1]);
         curr = next;
     }
+    _fmpz_vec_set(r, curr, T->lens[0]);
+    _fmpz_vec_clear(curr, T->lens[0]);
 }
 
-void
-fr_node_list_print(fr_node_ptr head)
-{
-    fr_node_ptr curr;
-
-    curr = head;
-    while (curr)
-    {
-        fmpz_print(fr_node_mref(curr));
-        flint_printf("^%wu ", curr->e);
-        curr = curr->next;
-    }
-    flint_printf("\n");
-}
 
 void
-pair_refine_unreduced(fr_node_ptr *phead,
-        fmpz_t m1, ulong e1,
-        fmpz_t m2, ulong e2)
+pair_refine(fr_vec_t res,
+        const fmpz_t m1, ulong e1,
+        const fmpz_t m2, ulong e2)
 {
-    fr_node_ptr head, tail, curr, next, neo;
+    /*
+     * Replace the contents of res with the refinement of the pair,
+     * inserting the gcd between each pair of adjacent non-unit bases
+     * until all adjacent bases are coprime.
+     */
     fmpz_t d;
+    slong i;
     int boring;
 
+    fr_vec_truncate(res, 0);
     if (fmpz_is_one(m1) && fmpz_is_one(m2))
     {
-        *phead = NULL;
         return;
     }
 
     fmpz_init(d);
-
-    head = flint_malloc(sizeof(fr_node_struct));
-    fr_node_init_fmpz_ui(head, m1, e1);
-
-    tail = flint_malloc(sizeof(fr_node_struct));
-    fr_node_init_fmpz_ui(tail, m2, e2);
-
-    head->next = tail;
+    fr_vec_append(res, m1, e1);
+    fr_vec_append(res, m2, e2);
 
     boring = 0;
     while (!boring)
     {
-        curr = head;
-        next = curr->next;
-
         boring = 1;
-        while (next)
+        i = 0;
+        while (i < res->len - 1)
         {
-            if (!fr_node_is_one(curr) && !fr_node_is_one(next))
+            fr_pair_struct *curr = res->p + i;
+            fr_pair_struct *next = res->p + i + 1;
+            if (!fr_pair_is_one(curr) && !fr_pair_is_one(next))
             {
-                fmpz_gcd(d, fr_node_mref(curr), fr_node_mref(next));
-                fmpz_divexact(fr_node_mref(curr), fr_node_mref(curr), d);
-                fmpz_divexact(fr_node_mref(next), fr_node_mref(next), d);
-
-                neo = flint_malloc(sizeof(fr_node_struct));
-                fr_node_init(neo);
-                fmpz_set(fr_node_mref(neo), d);
-                neo->e = curr->e + next->e;
-
-                curr->next = neo;
-                neo->next = next;
-
-                next = neo;
+                fmpz_gcd(d, &(curr->m), &(next->m));
+                fmpz_divexact(&(curr->m), &(curr->m), d);
+                fmpz_divexact(&(next->m), &(next->m), d);
+                fr_vec_insert(res, i + 1, d, curr->e + next->e);
                 boring = 0;
             }
             else
             {
-                curr = next;
-                next = next->next;
+                i++;
             }
         }
     }
 
     fmpz_clear(d);
-    *phead = head;
+    fr_vec_remove_ones(res);
 }
 
 void
-remove_ones(fr_node_ptr *phead, fr_node_ptr *ptail, fr_node_ptr ohead)
+coprime_parts(fr_vec_t out, fr_vec_t in,
+        const fr_pair_struct *v, const fr_tree_t T, const fmpz_t x)
 {
-    fr_node_ptr head, curr, ocurr, onext;
+    /*
+     * Split each base m of v, whose product tree is T, into the part c
+     * that is coprime to x and the part m / c made of the primes of x.
+     * The nontrivial parts are appended to out and to in respectively,
+     * with the exponent of m.
+     * The first gcd is gcd(m, x mod m), and each of the following gcds
+     * removes the remaining powers of the primes that were found.
+     */
+    fmpz *r;
+    fmpz_t c, d;
+    slong i, len;
 
-    if (!ohead)
-    {
-        *phead = NULL;
-        *ptail = NULL;
-        return;
-    }
+    len = T->lens[0];
+    r = _fmpz_vec_init(len);
+    fr_tree_remainders(r, T, x);
 
-    head = NULL;
-    curr = NULL;
-    ocurr = ohead;
-    while (ocurr)
+    fmpz_init(c);
+    fmpz_init(d);
+    for (i = 0; i < len; i++)
     {
-        onext = ocurr->next;
-
-        if (fr_node_is_one(ocurr))
+        fmpz_set(c, T->levels[0] + i);
+        fmpz_gcd(d, c, r + i);
+        while (!fmpz_is_one(d))
         {
-            fr_node_clear(ocurr);
-            flint_free(ocurr);
+            fmpz_divexact(c, c, d);
+            fmpz_gcd(d, c, d);
         }
-        else
+        if (!fmpz_is_one(c))
         {
-            if (!head)
-            {
-                head = ocurr;
-                curr = ocurr;
-            }
-            else
-            {
-                curr->next = ocurr;
-                curr = curr->next;
-            }
+            fr_vec_append(out, c, v[i].e);
+        }
+        fmpz_divexact(d, T->levels[0] + i, c);
+        if (!fmpz_is_one(d))
+        {
+            fr_vec_append(in, d, v[i].e);
         }
-        ocurr = onext;
     }
-    curr->next = NULL;
-
-    *phead = head;
-    *ptail = curr;
-}
-
-void
-pair_refine(fr_node_ptr *phead, fr_node_ptr *ptail,
-        fmpz_t m1, ulong e1,
-        fmpz_t m2, ulong e2)
-{
-    pair_refine_unreduced(phead, m1, e1, m2, e2);
-    remove_ones(phead, ptail, *phead);
+    fmpz_clear(c);
+    fmpz_clear(d);
+    _fmpz_vec_clear(r, len);
 }
 
 void
-augment_refinement(fr_node_ptr *phead, fr_node_ptr *ptail,
-        const fmpz_t m_jp1, ulong e_jp1,
-        fr_node_ptr L_j, fr_node_ptr L_j_tail)
+coprime_merge(fr_vec_t res,
+        const fr_pair_struct *a, slong alen,
+        const fr_pair_struct *b, slong blen)
 {
     /*
-     * m_jp1 must have absolute value greater than 1,
-     * and its sign will be discarded.
-     * This function is destructive to the existing refinement L_j
+     * Append to res the refinement of the union of a and b,
+     * each of which has pairwise coprime bases greater than 1.
+     * The parts of the bases that are coprime to the product of the other
+     * set are already refined. Each of the remaining parts of one set
+     * has only primes of the other set, so halving the larger set splits
+     * each base of the smaller set into coprime parts that are merged
+     * with the two halves independently.
      */
+    fr_tree_t ta, tb, tx;
+    fr_vec_t a_in, b_in, y1, y2;
+    fr_vec_struct *x, *y;
+    slong h;
 
-    fr_node_ptr L_jp1, L_jp1_tail, L_prime, L_prime_tail, neo;
-    fmpz_t m;
-    ulong e;
+    if (alen == 0 || blen == 0)
+    {
+        fr_vec_extend(res, a, alen);
+        fr_vec_extend(res, b, blen);
+        return;
+    }
 
-    /* initialize (m, e) <- (m_{j+1}, 1), L_{j+1} <- empty list */
-    fmpz_init(m);
-    fmpz_abs(m, m_jp1);
-    e = e_jp1;
-    L_jp1 = NULL;
-    L_jp1_tail = NULL;
-    L_prime = NULL;
-    L_prime_tail = NULL;
+    fr_vec_init(a_in);
+    fr_vec_init(b_in);
+    fr_tree_init(ta, a, alen);
+    fr_tree_init(tb, b, blen);
+    coprime_parts(res, a_in, a, ta, fr_tree_root(tb));
+    coprime_parts(res, b_in, b, tb, fr_tree_root(ta));
+    fr_tree_clear(ta);
+    fr_tree_clear(tb);
 
-    while (L_j && !fmpz_is_one(m))
+    if (a_in->len == 0 || b_in->len == 0)
+    {
+        /* the sets share no primes, so both are empty */
+        fr_vec_extend(res, a_in->p, a_in->len);
+        fr_vec_extend(res, b_in->p, b_in->len);
+    }
+    else if (a_in->len == 1 && b_in->len == 1)
     {
-        if (!fr_node_is_one(L_j))
+        fr_vec_init(y1);
+        pair_refine(y1, &(a_in->p[0].m), a_in->p[0].e,
+                &(b_in->p[0].m), b_in->p[0].e);
+        fr_vec_extend(res, y1->p, y1->len);
+        fr_vec_clear(y1);
+    }
+    else
+    {
+        if (a_in->len >= b_in->len)
         {
-            /* L' <- Pair-Refine((m, e), First(L_j)) */
-            pair_refine(&L_prime, &L_prime_tail, m, e,
-                        fr_node_mref(L_j), L_j->e);
-
-            /* (m, e) <- First(L') */
-            fr_node_get_fmpz_ui(m, &e, L_prime);
-
-            /* L' <- Rest(L') */
-            fr_node_list_pop_front(&L_prime, &L_prime_tail);
-
-            /* L_{j+1} <- Concat(L_{j+1}, L') */
-            fr_node_list_concat(&L_jp1, &L_jp1_tail, L_prime, L_prime_tail);
+            x = a_in;
+            y = b_in;
         }
-
-        /* L_j <- Rest(L_j) */
-        fr_node_list_pop_front(&L_j, &L_j_tail);
+        else
+        {
+            x = b_in;
+            y = a_in;
+        }
+        h = x->len / 2;
+
+        /* y1 has the primes of the first half of x, y2 those of the rest */
+        fr_vec_init(y1);
+        fr_vec_init(y2);
+        fr_tree_init(tx, x->p, h);
+        fr_tree_init(ta, y->p, y->len);
+        coprime_parts(y2, y1, y->p, ta, fr_tree_root(tx));
+        fr_tree_clear(tx);
+        fr_tree_clear(ta);
+
+        coprime_merge(res, y1->p, y1->len, x->p, h);
+        coprime_merge(res, y2->p, y2->len, x->p + h, x->len - h);
+        fr_vec_clear(y1);
+        fr_vec_clear(y2);
     }
 
-    /* create a single-element list like [(m, e)] */
-    neo = flint_malloc(sizeof(fr_node_struct));
-    fr_node_init_fmpz_ui(neo, m, e);
-
-    /* L_{j+1} <- Concat(L_{j+1}, Rest(L_j), [(m, e)]) */
-    fr_node_list_pop_front(&L_j, &L_j_tail);
-    fr_node_list_concat(&L_jp1, &L_jp1_tail, L_j, L_j_tail);
-    fr_node_list_concat(&L_jp1, &L_jp1_tail, neo, neo);
+    fr_vec_clear(a_in);
+    fr_vec_clear(b_in);
+}
 
-    /* output list of pairs (n_i, e_i) in L_{j+1} with n_i != 1 */
-    remove_ones(phead, ptail, L_jp1);
+void
+coprime_refine(fr_vec_t res, const fr_pair_struct *v, slong len)
+{
+    /*
+     * Append to res the refinement of the pairs of v, whose bases must
+     * have absolute value greater than 1, by merging the refinements
+     * of the two halves of v.
+     */
+    fr_vec_t left, right;
+    slong h;
 
-    fmpz_clear(m);
+    if (len == 1)
+    {
+        fr_vec_append(res, &(v->m), v->e);
+        fmpz_abs(&(res->p[res->len - 1].m), &(res->p[res->len - 1].m));
+    }
+    else if (len > 1)
+    {
+        h = len / 2;
+        fr_vec_init(left);
+        fr_vec_init(right);
+        coprime_refine(left, v, h);
+        coprime_refine(right, v + h, len - h);
+        coprime_merge(res, left->p, left->len, right->p, right->len);
+        fr_vec_clear(left);
+        fr_vec_clear(right);
+    }
 }
 
 
@@ -415,7 +501,7 @@ void
 fmpz_factor_refine(fmpz_factor_t res, const fmpz_factor_t f)
 {
     int s;
-    fr_node_ptr L, L_tail, curr;
+    fr_vec_t inputs, L;
     slong i, len;
     fmpz * b;
     ulong e;
@@ -429,28 +515,26 @@ fmpz_factor_refine(fmpz_factor_t res, const fmpz_factor_t f)
         return;
     }
 
-    /* compute the refinement as a linked list */
-    for (L = L_tail = NULL, i = 0; i < f->num; i++)
+    /* collect the nontrivial bases */
+    fr_vec_init(inputs);
+    for (i = 0; i < f->num; i++)
     {
         b = f->p+i;
         e = f->exp[i];
         if (e != WORD(0) && !fmpz_is_pm1(b))
         {
-            augment_refinement(&L, &L_tail, b, e, L, L_tail);
+            fr_vec_append(inputs, b, e);
         }
     }
 
-    /* this is the length of the list of refined factors */
-    len = fr_node_list_length(L);
+    /* compute the coprime base with the accumulated exponents */
+    fr_vec_init(L);
+    coprime_refine(L, inputs->p, inputs->len);
+    fr_vec_clear(inputs);
 
-    /* make a sorted array of pointers to the refined factor nodes */
-    fr_node_ptr * qsort_arr;
-    qsort_arr = flint_malloc(sizeof(fr_node_ptr) * len);
-    for (i = 0, curr = L; i < len; i++, curr = curr->next)
-    {
-        qsort_arr[i] = curr;
-    }
-    qsort(qsort_arr, len, sizeof(fr_node_ptr), fr_node_base_pcmp);
+    /* sort the refined factors by base */
+    len = L->len;
+    qsort(L->p, len, sizeof(fr_pair_struct), fr_pair_base_pcmp);
 
     /* set the length, sign, bases, and exponents of the output structure */
     _fmpz_factor_fit_length(res, len);
@@ -458,11 +542,9 @@ fmpz_factor_refine(fmpz_factor_t res, const fmpz_factor_t f)
     res->sign = s;
     for (i = 0; i < len; i++)
     {
-        curr = qsort_arr[i];
-        fmpz_set(res->p+i, fr_node_mref(curr));
-        res->exp[i] = curr->e;
+        fmpz_set(res->p+i, &(L->p[i].m));
+        res->exp[i] = L->p[i].e;
     }
 
-    flint_free(qsort_arr);
-    fr_node_list_clear(L);
+    fr_vec_clear(L);
 }
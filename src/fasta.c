@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "fasta.h"
+
+
+static void _append(fasta_t f, const char *name, slong name_len,
+        slong *seq, slong len);
+static int _encode(slong *v, slong *plen, const char *s, const char *end);
+static int _parse(fasta_t f, const char *data, size_t size,
+        const char *filename);
+
+
+void
+_append(fasta_t f, const char *name, slong name_len, slong *seq, slong len)
+{
+    if (f->len == f->alloc)
+    {
+        f->alloc = FLINT_MAX(16, 2 * f->alloc);
+        f->names = flint_realloc(f->names, f->alloc * sizeof(char *));
+        f->seqs = flint_realloc(f->seqs, f->alloc * sizeof(slong *));
+        f->lens = flint_realloc(f->lens, f->alloc * sizeof(slong));
+    }
+    f->names[f->len] = flint_malloc(name_len + 1);
+    memcpy(f->names[f->len], name, name_len);
+    f->names[f->len][name_len] = '\0';
+    f->seqs[f->len] = seq;
+    f->lens[f->len] = len;
+    f->len++;
+}
+
+int
+_encode(slong *v, slong *plen, const char *s, const char *end)
+{
+    /* return the offending character, or zero on success */
+    slong n = 0;
+    for (; s < end; s++)
+    {
+        switch (*s)
+        {
+            case 'A': case 'a':
+                v[n++] = 0;
+                break;
+            case 'C': case 'c':
+                v[n++] = 1;
+                break;
+            case 'G': case 'g':
+                v[n++] = 2;
+                break;
+            case 'T': case 't':
+                v[n++] = 3;
+                break;
+            case '-': case '.':
+                break;
+            default:
+                if (isalpha((unsigned char) *s))
+                {
+                    v[n++] = 0;
+                }
+                else if (!isspace((unsigned char) *s))
+                {
+                    return *s;
+                }
+        }
+    }
+    *plen = n;
+    return 0;
+}
+
+int
+_parse(fasta_t f, const char *data, size_t size, const char *filename)
+{
+    const char *p, *q, *end, *name, *name_end, *line_end;
+    slong *seq;
+    slong len;
+    int c;
+
+    p = data;
+    end = data + size;
+    while (p < end && isspace((unsigned char) *p))
+    {
+        p++;
+    }
+    if (p == end || *p != '>')
+    {
+        fprintf(stderr, "%s is not a FASTA file\n", filename);
+        return 1;
+    }
+
+    while (p < end)
+    {
+        /* the name is the first word of the header line */
+        line_end = memchr(p, '\n', end - p);
+        line_end = line_end ? line_end : end;
+        name = p + 1;
+        while (name < line_end && (*name == ' ' || *name == '\t'))
+        {
+            name++;
+        }
+        name_end = name;
+        while (name_end < line_end && !isspace((unsigned char) *name_end))
+        {
+            name_end++;
+        }
+
+        /* the sequence lines end at the next header line */
+        p = (line_end < end) ? line_end + 1 : end;
+        q = p;
+        while (q < end && *q != '>')
+        {
+            q = memchr(q, '\n', end - q);
+            q = q ? q + 1 : end;
+        }
+
+        seq = flint_malloc(FLINT_MAX(1, q - p) * sizeof(slong));
+        c = _encode(seq, &len, p, q);
+        if (c)
+        {
+            fprintf(stderr, "unexpected character '%c' in the ", c);
+            fprintf(stderr, "FASTA record %.*s of %s\n",
+                    (int) (name_end - name), name, filename);
+            flint_free(seq);
+            return 1;
+        }
+        _append(f, name, name_end - name, seq, len);
+        p = q;
+    }
+
+    return 0;
+}
+
+
+void
+fasta_init(fasta_t f)
+{
+    f->names = NULL;
+    f->seqs = NULL;
+    f->lens = NULL;
+    f->len = 0;
+    f->alloc = 0;
+}
+
+void
+fasta_clear(fasta_t f)
+{
+    slong i;
+    for (i = 0; i < f->len; i++)
+    {
+        flint_free(f->names[i]);
+        flint_free(f->seqs[i]);
+    }
+    flint_free(f->names);
+    flint_free(f->seqs);
+    flint_free(f->lens);
+}
+
+int
+fasta_read(fasta_t f, const char *filename)
+{
+    struct stat st;
+    void *data;
+    int fd, code;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "failed to open %s for reading\n", filename);
+        return 1;
+    }
+    if (fstat(fd, &st) || st.st_size == 0)
+    {
+        fprintf(stderr, "%s is not a FASTA file\n", filename);
+        close(fd);
+        return 1;
+    }
+
+    /* the file is read once from start to end */
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        fprintf(stderr, "failed to map %s into memory\n", filename);
+        close(fd);
+        return 1;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    code = _parse(f, data, st.st_size, filename);
+
+    munmap(data, st.st_size);
+    close(fd);
+    return code;
+}
@@ -0,0 +1,47 @@
+#ifndef FASTA_H
+#define FASTA_H
+
+/*
+ * Nucleotide sequences read from a FASTA file.
+ *
+ * The file is memory-mapped and each record is encoded once into
+ * a vector of nucleotide codes (A=0, C=1, G=2, T=3), with ambiguous
+ * nucleotide letters encoded as A as in the json tools.
+ * Gap characters ('-' and '.') and whitespace are skipped, so that
+ * aligned FASTA files can be read as well. The name of a record is
+ * the first word of its header line.
+ */
+
+#include "flint/flint.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    char ** names;
+    slong ** seqs;
+    slong * lens;
+    slong len;
+    slong alloc;
+} fasta_struct;
+typedef fasta_struct fasta_t[1];
+
+void fasta_init(fasta_t f);
+void fasta_clear(fasta_t f);
+
+/*
+ * Append the records of the file to f.
+ * Return nonzero if the file cannot be read or is not a FASTA file
+ * of nucleotide sequences.
+ */
+int fasta_read(fasta_t f, const char *filename);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
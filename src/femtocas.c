@@ -11,6 +11,7 @@ void _expr_init(expr_ptr x);
 void _default_clear(expr_data_ptr p);
 void _default_print(expr_data_ptr p);
 void _default_eval(arb_t res, expr_data_ptr p, slong level);
+void _expr_fit_level(expr_ptr x, slong level);
 
 
 /* type-specific expression member functions */
@@ -61,32 +62,81 @@ _default_eval(arb_t res, expr_data_ptr p, slong level)
 void
 _expr_init(expr_ptr x)
 {
-    slong i;
-    for (i = 0; i < EXPR_CACHE_CAP; i++)
-    {
-        arb_init(x->cache+i);
-    }
-    x->cachesize = 0;
+    x->cache = NULL;
+    x->alloc = 0;
+    x->cached = 0;
+    x->hits = 0;
+    x->misses = 0;
     x->data = NULL;
     x->clear = &_default_clear;
     x->print = &_default_print;
     x->eval = &_default_eval;
+    x->op = EXPR_OP_NONE;
+    x->frozen = 0;
 }
 
 void
 expr_clear(expr_ptr x)
 {
-    slong i;
-    for (i = 0; i < EXPR_CACHE_CAP; i++)
+    if (x->cache)
     {
-        arb_clear(x->cache+i);
+        _arb_vec_clear(x->cache, x->alloc);
     }
-    x->cachesize = 0;
+    x->cache = NULL;
+    x->alloc = 0;
+    x->cached = 0;
+    x->hits = 0;
+    x->misses = 0;
     x->clear(x->data);
     x->data = NULL;
     x->clear = &_default_clear;
     x->print = &_default_print;
     x->eval = &_default_eval;
+    x->op = EXPR_OP_NONE;
+    x->frozen = 0;
+}
+
+/*
+ * Grow the cache so that it has a ball for the level.  Most expressions
+ * are only ever evaluated at a few low levels, so the cache is sized to
+ * the highest level requested so far rather than to EXPR_CACHE_CAP.
+ */
+void
+_expr_fit_level(expr_ptr x, slong level)
+{
+    slong i;
+    if (level < x->alloc)
+    {
+        return;
+    }
+    x->cache = flint_realloc(x->cache, (level + 1) * sizeof(arb_struct));
+    for (i = x->alloc; i <= level; i++)
+    {
+        arb_init(x->cache + i);
+    }
+    x->alloc = level + 1;
+}
+
+void
+expr_freeze(expr_ptr x, slong level)
+{
+    arb_t tmp;
+    slong k, nargs;
+
+    /* the arguments of a frozen expression are already frozen */
+    if (x->frozen)
+    {
+        return;
+    }
+    arb_init(tmp);
+    expr_eval(tmp, x, level);
+    arb_clear(tmp);
+    nargs = expr_op_nargs(x->op);
+    for (k = 0; k < nargs; k++)
+    {
+        expr_freeze(expr_arg(x, k), level);
+    }
+    x->frozen = 1;
 }
 
 void
@@ -98,19 +148,49 @@ expr_print(expr_ptr x)
 void
 expr_eval(arb_t res, expr_ptr x, slong level)
 {
+    ulong bit, higher;
     slong i;
     if (level < 0 || EXPR_CACHE_CAP <= level)
     {
         flint_printf("invalid log2 prec bits level %wd\n", level);
         abort();
     }
-    if (level >= x->cachesize)
+    bit = UWORD(1) << level;
+    if (x->frozen)
     {
-        for (i = x->cachesize; i < level+1; i++)
+        higher = x->cached >> level;
+        if (higher)
+        {
+            i = level + flint_ctz(higher);
+            arb_set_round(res, x->cache+i, 1 << level);
+        }
+        else
         {
-            x->eval(x->cache+i, x->data, i);
+            x->eval(res, x->data, level);
         }
-        x->cachesize = level+1;
+        return;
+    }
+    _expr_fit_level(x, level);
+    if (x->cached & bit)
+    {
+        x->hits++;
+    }
+    else
+    {
+        higher = x->cached >> (level + 1);
+        if (higher)
+        {
+            /* round the closest cached higher precision ball */
+            i = level + 1 + flint_ctz(higher);
+            arb_set_round(x->cache+level, x->cache+i, 1 << level);
+            x->hits++;
+        }
+        else
+        {
+            x->eval(x->cache+level, x->data, level);
+            x->misses++;
+        }
+        x->cached |= bit;
     }
     arb_set(res, x->cache+level);
 }
@@ -287,6 +367,70 @@ _expr_xx_print(expr_data_ptr data)
 
 
 
+/* inspect expressions */
+
+slong
+expr_op_nargs(int op)
+{
+    switch (op)
+    {
+        case EXPR_OP_EXP:
+        case EXPR_OP_NEG:
+        case EXPR_OP_LOG:
+        case EXPR_OP_LOG1P:
+        case EXPR_OP_LOG1M:
+        case EXPR_OP_COMPLEMENT:
+            return 1;
+        case EXPR_OP_ADD:
+        case EXPR_OP_MUL:
+        case EXPR_OP_SUB:
+        case EXPR_OP_DIV:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+expr_ptr
+expr_arg(expr_ptr x, slong k)
+{
+    slong nargs = expr_op_nargs(x->op);
+    if (k < 0 || k >= nargs)
+    {
+        flint_printf("expr_arg: invalid argument index %wd\n", k);
+        abort();
+    }
+    if (nargs == 1)
+    {
+        return ((_expr_x_ptr) x->data)->a;
+    }
+    return k ? ((_expr_xx_ptr) x->data)->b : ((_expr_xx_ptr) x->data)->a;
+}
+
+void
+expr_get_fmpq(fmpq_t res, expr_ptr x)
+{
+    switch (x->op)
+    {
+        case EXPR_OP_FMPZ:
+        case EXPR_OP_LOG_FMPZ:
+            fmpz_set(fmpq_numref(res), &(((_expr_i_ptr) x->data)->a));
+            fmpz_one(fmpq_denref(res));
+            break;
+        case EXPR_OP_FMPQ:
+        case EXPR_OP_LOG_FMPQ:
+        case EXPR_OP_EXP_FMPQ:
+            fmpq_set(res, &(((_expr_q_ptr) x->data)->a));
+            break;
+        default:
+            flint_printf("expr_get_fmpq: the expression has no constant\n");
+            abort();
+    }
+}
+
+
+
+
 /*
  * Constants and arithmetic are implemented here.
  * Each needs at least an evaluation function
@@ -306,6 +450,7 @@ void expr_fmpz(expr_ptr x, const fmpz_t a)
 {
     _expr_i_init(x, a);
     x->eval = &_expr_fmpz_eval;
+    x->op = EXPR_OP_FMPZ;
 }
 void _expr_fmpz_eval(arb_t z, expr_data_ptr data, slong level)
 {
@@ -319,6 +464,7 @@ void expr_log_fmpz(expr_ptr x, const fmpz_t a)
 {
     _expr_i_init(x, a);
     x->eval = &_expr_log_fmpz_eval;
+    x->op = EXPR_OP_LOG_FMPZ;
 }
 void _expr_log_fmpz_eval(arb_t z, expr_data_ptr data, slong level)
 {
@@ -336,6 +482,7 @@ void expr_fmpq(expr_ptr x, const fmpq_t a)
 {
     _expr_q_init(x, a);
     x->eval = &_expr_fmpq_eval;
+    x->op = EXPR_OP_FMPQ;
 }
 void _expr_fmpq_eval(arb_t z, expr_data_ptr data, slong level)
 {
@@ -349,6 +496,7 @@ void expr_log_fmpq(expr_ptr x, const fmpq_t a)
 {
     _expr_q_init(x, a);
     x->eval = &_expr_log_fmpq_eval;
+    x->op = EXPR_OP_LOG_FMPQ;
 }
 void _expr_log_fmpq_eval(arb_t z, expr_data_ptr data, slong level)
 {
@@ -363,6 +511,7 @@ void expr_exp_fmpq(expr_ptr x, const fmpq_t a)
 {
     _expr_q_init(x, a);
     x->eval = &_expr_exp_fmpq_eval;
+    x->op = EXPR_OP_EXP_FMPQ;
 }
 void _expr_exp_fmpq_eval(arb_t z, expr_data_ptr data, slong level)
 {
@@ -399,6 +548,7 @@ void expr_exp(expr_ptr x, expr_ptr a)
 {
     _expr_x_init(x, a);
     x->eval = &_expr_exp_eval;
+    x->op = EXPR_OP_EXP;
 }
 void _expr_exp_eval(arb_t z, expr_data_ptr data, slong level)
 {
@@ -413,6 +563,7 @@ void expr_neg(expr_ptr x, expr_ptr a)
 {
     _expr_x_init(x, a);
     x->eval = &_expr_neg_eval;
+    x->op = EXPR_OP_NEG;
 }
 void _expr_neg_eval(arb_t z, expr_data_ptr data, slong level)
 {
@@ -426,6 +577,7 @@ void expr_log(expr_ptr x, expr_ptr a)
 {
     _expr_x_init(x, a);
     x->eval = &_expr_log_eval;
+    x->op = EXPR_OP_LOG;
 }
 void _expr_log_eval(arb_t z, expr_data_ptr data, slong level)
 {
@@ -440,6 +592,7 @@ void expr_log1p(expr_ptr x, expr_ptr a)
 {
     _expr_x_init(x, a);
     x->eval = &_expr_log1p_eval;
+    x->op = EXPR_OP_LOG1P;
 }
 void _expr_log1p_eval(arb_t z, expr_data_ptr data, slong level)
 {
@@ -454,6 +607,7 @@ void expr_log1m(expr_ptr x, expr_ptr a)
 {
     _expr_x_init(x, a);
     x->eval = &_expr_log1m_eval;
+    x->op = EXPR_OP_LOG1M;
 }
 void _expr_log1m_eval(arb_t z, expr_data_ptr data, slong level)
 {
@@ -469,6 +623,7 @@ void expr_complement(expr_ptr x, expr_ptr a)
 {
     _expr_x_init(x, a);
     x->eval = &_expr_complement_eval;
+    x->op = EXPR_OP_COMPLEMENT;
 }
 void _expr_complement_eval(arb_t z, expr_data_ptr data, slong level)
 {
@@ -491,6 +646,7 @@ void expr_add(expr_ptr x, expr_ptr a, expr_ptr b)
 {
     _expr_xx_init(x, a, b);
     x->eval = &_expr_add_eval;
+    x->op = EXPR_OP_ADD;
 }
 void _expr_add_eval(arb_t z, expr_data_ptr data, slong level)
 {
@@ -511,6 +667,7 @@ void expr_mul(expr_ptr x, expr_ptr a, expr_ptr b)
 {
     _expr_xx_init(x, a, b);
     x->eval = &_expr_mul_eval;
+    x->op = EXPR_OP_MUL;
 }
 void _expr_mul_eval(arb_t z, expr_data_ptr data, slong level)
 {
@@ -531,6 +688,7 @@ void expr_sub(expr_ptr x, expr_ptr a, expr_ptr b)
 {
     _expr_xx_init(x, a, b);
     x->eval = &_expr_sub_eval;
+    x->op = EXPR_OP_SUB;
 }
 void _expr_sub_eval(arb_t z, expr_data_ptr data, slong level)
 {
@@ -551,6 +709,7 @@ void expr_div(expr_ptr x, expr_ptr a, expr_ptr b)
 {
     _expr_xx_init(x, a, b);
     x->eval = &_expr_div_eval;
+    x->op = EXPR_OP_DIV;
 }
 void _expr_div_eval(arb_t z, expr_data_ptr data, slong level)
 {
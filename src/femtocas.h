@@ -5,8 +5,10 @@
  * or actual C++ ...
  *
  * struct
- * x fixed-size array of cached real balls from internal precision doublings
- * x number of such cached precision doublings
+ * x array of cached real balls, indexed by precision level, allocated
+ *   only up to the highest level that was requested
+ * x bit mask of the precision levels that are in the cache
+ * x counters of cache hits and misses
  * x pointer to polymorphically defined data
  * x pointer to function to clear the polymorphically defined data
  * x pointer to function that prints given the data
@@ -28,9 +30,35 @@
 #include "flint/fmpq.h"
 #include "arb.h"
 
-/* cache at most this many evaluations */
+/*
+ * Cache at most this many evaluations, one for each precision level.
+ * Only the requested level is evaluated; a level that is not cached
+ * is obtained by rounding the next higher cached level, if any.
+ */
 #define EXPR_CACHE_CAP 30
 
+/*
+ * Operation codes identifying how an expression was constructed,
+ * so that expression trees can be inspected, for example to compile
+ * them into a flat evaluation program.
+ */
+#define EXPR_OP_NONE        0
+#define EXPR_OP_FMPZ        1
+#define EXPR_OP_LOG_FMPZ    2
+#define EXPR_OP_FMPQ        3
+#define EXPR_OP_LOG_FMPQ    4
+#define EXPR_OP_EXP_FMPQ    5
+#define EXPR_OP_EXP         6
+#define EXPR_OP_NEG         7
+#define EXPR_OP_LOG         8
+#define EXPR_OP_LOG1P       9
+#define EXPR_OP_LOG1M       10
+#define EXPR_OP_COMPLEMENT  11
+#define EXPR_OP_ADD         12
+#define EXPR_OP_MUL         13
+#define EXPR_OP_SUB         14
+#define EXPR_OP_DIV         15
+
 
 /*
  * Forward declaration of expr_struct_tag to allow declaration of expr_ptr.
@@ -53,12 +81,17 @@ typedef void (*expr_print_fn)(expr_data_ptr);
 typedef void (*expr_eval_fn)(arb_t, expr_data_ptr, slong);
 typedef struct expr_struct_tag
 {
-    arb_struct cache[EXPR_CACHE_CAP];
-    slong cachesize;
+    arb_ptr cache;
+    slong alloc;
+    ulong cached;
+    slong hits;
+    slong misses;
     expr_data_ptr data;
     expr_clear_fn clear;
     expr_print_fn print;
     expr_eval_fn eval;
+    int op;
+    int frozen;
     void *userdata;
 } expr_struct;
 typedef expr_struct expr_t[1];
@@ -103,6 +136,52 @@ void expr_print(expr_ptr x);
 void expr_eval(arb_t res, expr_ptr x, slong level);
 
 
+/* inspect the created expression */
+
+/* the number of expression arguments (0, 1, or 2) of the operation */
+slong expr_op_nargs(int op);
+
+static __inline__ int
+expr_op(const expr_struct *x)
+{
+    return x->op;
+}
+
+/* the k-th expression argument of a unary or binary operation */
+expr_ptr expr_arg(expr_ptr x, slong k);
+
+/* the constant argument of an operation on an fmpz or an fmpq */
+void expr_get_fmpq(fmpq_t res, expr_ptr x);
+
+/*
+ * Evaluations served from the cache (including by rounding a higher
+ * precision level) count as hits, and the others count as misses.
+ */
+static __inline__ slong
+expr_cache_hits(const expr_struct *x)
+{
+    return x->hits;
+}
+
+static __inline__ slong
+expr_cache_misses(const expr_struct *x)
+{
+    return x->misses;
+}
+
+/*
+ * Fill the cache of the expression at the given level, and then freeze
+ * the cache, recursively freezing its arguments in the same way first.
+ * Evaluating a frozen expression never writes to it or to any of its
+ * arguments: levels that are not cached are computed into the result
+ * only, and the hit and miss counts are not updated.  Frozen expressions
+ * may therefore be evaluated concurrently.  A level above every cached
+ * level is recomputed on every evaluation, so frozen expressions are
+ * meant to be evaluated at or below the level at which they were frozen.
+ */
+void expr_freeze(expr_ptr x, slong level);
+
+
 /* finally, clear the memory of the expression */
 
 void expr_clear(expr_ptr x);
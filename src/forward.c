@@ -13,6 +13,9 @@ dp_forward(dp_mat_t mat, forward_strategy_t strat)
      * If the visit callback ever returns a nonzero value,
      * then stop the iteration and return that result
      * after clearing the data.
+     * The budget, if any, is checked before each row is visited;
+     * if it has expired then stop and return FORWARD_INTERRUPTED.
+     * The checkpoint, if any, is also written between rows when due.
      */
     char *buffer;
     char *curr, *top, *diag, *left;
@@ -37,6 +40,15 @@ dp_forward(dp_mat_t mat, forward_strategy_t strat)
     result = 0;
     for (i = 0; i < nrows && !result; i++)
     {
+        if (strat->budget && budget_expired(strat->budget))
+        {
+            result = FORWARD_INTERRUPTED;
+            break;
+        }
+        if (strat->checkpoint && i > 0 && checkpoint_due(strat->checkpoint))
+        {
+            checkpoint_write(strat->checkpoint, mat, i);
+        }
         for (j = 0; j < ncols && !result; j++)
         {
             curr = row + j * sz_cell;
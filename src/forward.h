@@ -2,6 +2,8 @@
 #define FORWARD_H
 
 #include "dp.h"
+#include "budget.h"
+#include "checkpoint.h"
 
 
 #ifdef __cplusplus
@@ -17,6 +19,15 @@ typedef int (*forward_strategy_visit_t)(void *userdata,
         dp_mat_t mat, slong i, slong j,
         void *curr, void *top, void *diag, void *left);
 
+/*
+ * This value is returned by the forward pass when it stops early
+ * because its budget was exhausted or cancelled.
+ * The budget is optional; if it is NULL then the pass runs to completion.
+ * The checkpoint is also optional; if it is not NULL then the tableau
+ * is saved between rows whenever a checkpoint is due.
+ */
+#define FORWARD_INTERRUPTED 1
+
 typedef struct
 {
     forward_strategy_init_t init;
@@ -24,6 +35,8 @@ typedef struct
     forward_strategy_visit_t visit;
     size_t sz_celldata;
     void *userdata;
+    budget_ptr budget;
+    checkpoint_ptr checkpoint;
 } forward_strategy_struct;
 typedef forward_strategy_struct forward_strategy_t[1];
 typedef forward_strategy_struct * forward_strategy_ptr;
@@ -0,0 +1,60 @@
+#include <string.h>
+
+#include "hash.h"
+
+
+#define HASH_PRIME UINT64_C(1099511628211)
+
+
+uint64_t
+hash_bytes(uint64_t h, const void *data, size_t n)
+{
+    const unsigned char *p = data;
+    size_t i;
+    for (i = 0; i < n; i++)
+    {
+        h ^= (uint64_t) p[i];
+        h *= HASH_PRIME;
+    }
+    return h;
+}
+
+uint64_t
+hash_string(uint64_t h, const char *s)
+{
+    /* include the terminating null so that concatenations differ */
+    return hash_bytes(h, s, strlen(s) + 1);
+}
+
+uint64_t
+hash_fmpq(uint64_t h, const fmpq_t x)
+{
+    char *s;
+    s = fmpq_get_str(NULL, 10, x);
+    h = hash_string(h, s);
+    flint_free(s);
+    return h;
+}
+
+uint64_t
+hash_slong_vec(uint64_t h, const slong *v, slong n)
+{
+    /*
+     * Hash one byte per value, which suffices for nucleotide indices
+     * and keeps the hash of a sequence compact and platform independent.
+     * The length is mixed in last so that adjacent vectors are delimited.
+     */
+    slong i;
+    unsigned char c;
+    for (i = 0; i < n; i++)
+    {
+        c = (unsigned char) v[i];
+        h = hash_bytes(h, &c, 1);
+    }
+    for (i = 0; i < 8; i++)
+    {
+        c = (unsigned char) ((ulong) n >> (8 * i));
+        h = hash_bytes(h, &c, 1);
+    }
+    return h;
+}
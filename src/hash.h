@@ -0,0 +1,34 @@
+#ifndef HASH_H
+#define HASH_H
+
+/*
+ * 64-bit FNV-1a hashing, used to key files and caches by their inputs.
+ * The hash of a sequence of values is computed by threading
+ * the hash state through the functions below, starting with HASH_INIT.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "flint/flint.h"
+#include "flint/fmpq.h"
+
+
+#define HASH_INIT UINT64_C(14695981039346656037)
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint64_t hash_bytes(uint64_t h, const void *data, size_t n);
+uint64_t hash_string(uint64_t h, const char *s);
+uint64_t hash_fmpq(uint64_t h, const fmpq_t x);
+uint64_t hash_slong_vec(uint64_t h, const slong *v, slong n);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
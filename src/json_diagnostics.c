@@ -0,0 +1,47 @@
+#include "json_diagnostics.h"
+
+
+static json_t * _json_round(const diagnostics_round_struct *x);
+
+json_t *
+_json_round(const diagnostics_round_struct *x)
+{
+    json_t *j_round, *j_failures;
+    slong k;
+
+    j_failures = json_array();
+    for (k = 0; k < x->failures_len; k++)
+    {
+        json_array_append_new(j_failures, json_pack("{s:I, s:I, s:s}",
+                    "i", (json_int_t) x->failure[k].i,
+                    "j", (json_int_t) x->failure[k].j,
+                    "max", x->failure[k].max3 ? "max3" : "max2"));
+    }
+
+    j_round = json_pack("{s:I, s:I, s:b, s:b, s:I, s:I, s:I, s:I, s:I, s:o}",
+            "level", (json_int_t) x->level,
+            "precision_bits", (json_int_t) x->prec,
+            "interrupted", x->interrupted,
+            "verified", x->verified,
+            "interesting_cells", (json_int_t) x->interesting,
+            "candidate_flags", (json_int_t) x->candidates,
+            "cleared_flags", (json_int_t) x->cleared,
+            "unresolved_cells", (json_int_t) x->unresolved,
+            "consensus_failures", (json_int_t) x->failures,
+            "failure_cells", j_failures);
+    return j_round;
+}
+
+json_t *
+json_diagnostics(const diagnostics_t d)
+{
+    json_t *j_rounds;
+    slong k;
+
+    j_rounds = json_array();
+    for (k = 0; k < d->len; k++)
+    {
+        json_array_append_new(j_rounds, _json_round(d->rounds + k));
+    }
+    return j_rounds;
+}
@@ -0,0 +1,26 @@
+#ifndef JSON_DIAGNOSTICS_H
+#define JSON_DIAGNOSTICS_H
+
+/*
+ * The certification effort recorded by a diagnostics collector,
+ * as a json array with one object for each round of refinement;
+ * see 'diagnostics.h'.
+ */
+
+#include "jansson.h"
+
+#include "diagnostics.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+json_t * json_diagnostics(const diagnostics_t d);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
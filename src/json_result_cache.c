@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json_result_cache.h"
+
+
+int
+json_result_cache_option(const char **pdir, slong *plimit, const char *arg)
+{
+    if (!strncmp(arg, "--cache=", 8) && arg[8])
+    {
+        *pdir = arg + 8;
+        return 0;
+    }
+    if (!strncmp(arg, "--cache-bytes=", 14) && atol(arg + 14) > 0)
+    {
+        *plimit = atol(arg + 14);
+        return 0;
+    }
+    return 1;
+}
+
+json_t *
+json_result_cache_get(result_cache_t c, const result_key_t key)
+{
+    json_error_t error;
+    json_t *result;
+    char *data;
+    slong len;
+
+    data = result_cache_get(c, key, &len);
+    if (!data)
+    {
+        return NULL;
+    }
+    result = json_loadb(data, len, 0, &error);
+    flint_free(data);
+    return result;
+}
+
+void
+json_result_cache_put(result_cache_t c, const result_key_t key,
+        const json_t *result)
+{
+    char *s;
+    s = json_dumps(result, JSON_COMPACT);
+    if (s)
+    {
+        result_cache_put(c, key, s, strlen(s));
+        free(s);
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef JSON_RESULT_CACHE_H
+#define JSON_RESULT_CACHE_H
+
+/*
+ * The json results of the tools in the on-disk result cache;
+ * see 'result_cache.h'. The tools enable the cache with the
+ * --cache=DIR and --cache-bytes=N command line options.
+ */
+
+#include "jansson.h"
+
+#include "result_cache.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the default limit on the size of the cache directory */
+#define JSON_RESULT_CACHE_BYTES (WORD(1) << 30)
+
+/*
+ * Parse a cache command line option into the directory or the limit;
+ * return nonzero if the argument is not a cache option.
+ */
+int json_result_cache_option(const char **pdir, slong *plimit,
+        const char *arg);
+
+/* the cached result as a new json object, or NULL if it is absent */
+json_t * json_result_cache_get(result_cache_t c, const result_key_t key);
+
+/* store the result; failures are reported but otherwise ignored */
+void json_result_cache_put(result_cache_t c, const result_key_t key,
+        const json_t *result);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
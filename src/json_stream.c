@@ -0,0 +1,298 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "json_stream.h"
+#include "jsonutil.h"
+
+
+/* the block size used for reading streams */
+#define JSON_STREAM_BLOCK (1 << 20)
+
+/* what the scanner expects next in the top-level object */
+#define JSON_STREAM_OTHER 0
+#define JSON_STREAM_KEY 1
+#define JSON_STREAM_VALUE 2
+
+
+static void _append(json_stream_t s, const char *data, size_t len);
+static int _encode(json_stream_t s, const char *data, size_t len);
+static int _member(const char *key, int key_len);
+
+
+void
+_append(json_stream_t s, const char *data, size_t len)
+{
+    if (s->rest_len + len + 1 > s->rest_alloc)
+    {
+        s->rest_alloc = FLINT_MAX(2 * s->rest_alloc, s->rest_len + len + 1);
+        s->rest = flint_realloc(s->rest, s->rest_alloc);
+    }
+    memcpy(s->rest + s->rest_len, data, len);
+    s->rest_len += len;
+    s->rest[s->rest_len] = '\0';
+}
+
+int
+_encode(json_stream_t s, const char *data, size_t len)
+{
+    int m = s->member;
+    if (s->lens[m] + (slong) len > s->allocs[m])
+    {
+        s->allocs[m] = FLINT_MAX(2 * s->allocs[m], s->lens[m] + (slong) len);
+        s->seqs[m] = flint_realloc(s->seqs[m], s->allocs[m] * sizeof(slong));
+    }
+    if (_fill_sequence_vector(s->seqs[m] + s->lens[m], data, len))
+    {
+        return 1;
+    }
+    s->lens[m] += len;
+    return 0;
+}
+
+int
+_member(const char *key, int key_len)
+{
+    if (key_len == 10 && !memcmp(key, "sequence_a", 10))
+    {
+        return 0;
+    }
+    if (key_len == 10 && !memcmp(key, "sequence_b", 10))
+    {
+        return 1;
+    }
+    return -1;
+}
+
+
+void
+json_stream_init(json_stream_t s)
+{
+    s->rest = NULL;
+    s->rest_len = 0;
+    s->rest_alloc = 0;
+    s->seqs[0] = s->seqs[1] = NULL;
+    s->lens[0] = s->lens[1] = 0;
+    s->allocs[0] = s->allocs[1] = 0;
+    s->depth = 0;
+    s->expect = JSON_STREAM_OTHER;
+    s->in_string = 0;
+    s->escape = 0;
+    s->in_key = 0;
+    s->key_len = 0;
+    s->member = -1;
+    s->capture = 0;
+    _append(s, "", 0);
+}
+
+void
+json_stream_clear(json_stream_t s)
+{
+    flint_free(s->rest);
+    flint_free(s->seqs[0]);
+    flint_free(s->seqs[1]);
+}
+
+int
+json_stream_feed(json_stream_t s, const char *data, size_t len)
+{
+    size_t i, j, start;
+    char c;
+
+    start = 0;
+    for (i = 0; i < len; i++)
+    {
+        if (s->capture)
+        {
+            /* encode the sequence characters up to the closing quote */
+            j = i;
+            while (j < len && data[j] != '"' && data[j] != '\\')
+            {
+                j++;
+            }
+            if (_encode(s, data + i, j - i))
+            {
+                fprintf(stderr, "error: unrecognized nucleotide ");
+                fprintf(stderr, "in the sequences\n");
+                return 1;
+            }
+            i = j;
+            if (i == len)
+            {
+                start = len;
+                break;
+            }
+            if (data[i] == '\\')
+            {
+                fprintf(stderr, "error: escaped characters are not ");
+                fprintf(stderr, "allowed in the sequences\n");
+                return 1;
+            }
+            s->capture = 0;
+            s->expect = JSON_STREAM_OTHER;
+            start = i;
+            continue;
+        }
+
+        c = data[i];
+        if (s->in_string)
+        {
+            if (s->escape)
+            {
+                /* keys with escapes are not the sequence keys */
+                s->escape = 0;
+                s->key_len = sizeof(s->key);
+            }
+            else if (c == '\\')
+            {
+                s->escape = 1;
+            }
+            else if (c == '"')
+            {
+                s->in_string = 0;
+                if (s->in_key)
+                {
+                    s->in_key = 0;
+                    s->member = _member(s->key, s->key_len);
+                }
+            }
+            else if (s->in_key && s->key_len < (int) sizeof(s->key))
+            {
+                s->key[s->key_len++] = c;
+            }
+            continue;
+        }
+
+        switch (c)
+        {
+            case '"':
+                if (s->depth == 1 && s->expect == JSON_STREAM_KEY)
+                {
+                    s->in_key = 1;
+                    s->key_len = 0;
+                    s->expect = JSON_STREAM_OTHER;
+                }
+                else if (s->depth == 1 && s->expect == JSON_STREAM_VALUE &&
+                         s->member >= 0 && !s->seqs[s->member])
+                {
+                    /* keep the opening quote, and skip the string */
+                    _append(s, data + start, i + 1 - start);
+                    start = i + 1;
+                    s->capture = 1;
+                    s->seqs[s->member] = flint_malloc(sizeof(slong));
+                    s->allocs[s->member] = 1;
+                    break;
+                }
+                s->in_string = 1;
+                s->expect = JSON_STREAM_OTHER;
+                break;
+            case '{':
+            case '[':
+                s->depth++;
+                s->expect = (s->depth == 1 && c == '{') ?
+                    JSON_STREAM_KEY : JSON_STREAM_OTHER;
+                break;
+            case '}':
+            case ']':
+                s->depth--;
+                break;
+            case ':':
+                if (s->depth == 1)
+                {
+                    s->expect = JSON_STREAM_VALUE;
+                }
+                break;
+            case ',':
+                if (s->depth == 1)
+                {
+                    s->expect = JSON_STREAM_KEY;
+                    s->member = -1;
+                }
+                break;
+        }
+    }
+    if (start < len)
+    {
+        _append(s, data + start, len - start);
+    }
+    return 0;
+}
+
+int
+json_stream_read_file(json_stream_t s, const char *filename)
+{
+    struct stat st;
+    void *data;
+    int fd, code;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "failed to open %s for reading\n", filename);
+        return 1;
+    }
+    if (fstat(fd, &st))
+    {
+        fprintf(stderr, "failed to read %s\n", filename);
+        close(fd);
+        return 1;
+    }
+    if (st.st_size == 0)
+    {
+        close(fd);
+        return 0;
+    }
+
+    /* the mapped pages are only read, so they are not copied */
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        fprintf(stderr, "failed to map %s into memory\n", filename);
+        close(fd);
+        return 1;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    code = json_stream_feed(s, data, st.st_size);
+
+    munmap(data, st.st_size);
+    close(fd);
+    return code;
+}
+
+int
+json_stream_read(json_stream_t s, FILE *stream)
+{
+    char *block;
+    size_t n;
+    int code;
+
+    block = flint_malloc(JSON_STREAM_BLOCK);
+    code = 0;
+    while (!code && (n = fread(block, 1, JSON_STREAM_BLOCK, stream)) > 0)
+    {
+        code = json_stream_feed(s, block, n);
+    }
+    if (!code && ferror(stream))
+    {
+        fprintf(stderr, "error: failed to read the json input\n");
+        code = 1;
+    }
+    flint_free(block);
+    return code;
+}
+
+slong *
+json_stream_take_sequence(json_stream_t s, int which, slong *plen)
+{
+    slong *v = s->seqs[which];
+    *plen = s->lens[which];
+    s->seqs[which] = NULL;
+    s->lens[which] = 0;
+    s->allocs[which] = 0;
+    return v;
+}
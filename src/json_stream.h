@@ -0,0 +1,72 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+/*
+ * Read a json request with very long sequences without copying them.
+ *
+ * The json text is scanned as it is read, from a memory-mapped file or
+ * from a stream in large blocks. The string values of the top-level
+ * "sequence_a" and "sequence_b" members are encoded directly into
+ * sequence vectors as in _fill_sequence_vector, and the rest of the
+ * text is kept with those strings replaced by empty strings, so that
+ * the json parser only sees a small document. The peak memory is then
+ * close to the size of the encoded sequences.
+ */
+
+#include <stdio.h>
+
+#include "flint/flint.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    /* the json text without the sequence strings */
+    char * rest;
+    size_t rest_len;
+    size_t rest_alloc;
+
+    /* the encoded sequences, NULL if they were not found */
+    slong * seqs[2];
+    slong lens[2];
+    slong allocs[2];
+
+    /* scanner state */
+    slong depth;
+    int expect;
+    int in_string;
+    int escape;
+    int in_key;
+    char key[16];
+    int key_len;
+    int member;
+    int capture;
+} json_stream_struct;
+typedef json_stream_struct json_stream_t[1];
+
+void json_stream_init(json_stream_t s);
+void json_stream_clear(json_stream_t s);
+
+/* scan the next block of json text; return nonzero on error */
+int json_stream_feed(json_stream_t s, const char *data, size_t len);
+
+/* scan a whole file or stream; return nonzero on error */
+int json_stream_read_file(json_stream_t s, const char *filename);
+int json_stream_read(json_stream_t s, FILE *stream);
+
+/*
+ * Return the encoded sequence 0 ("sequence_a") or 1 ("sequence_b"),
+ * which must then be freed by the caller with flint_free,
+ * or NULL if the text had no such string member.
+ */
+slong * json_stream_take_sequence(json_stream_t s, int which, slong *plen);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
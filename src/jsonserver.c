@@ -0,0 +1,646 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "jansson.h"
+
+#include "channel.h"
+#include "jsonserver.h"
+
+
+/* the number of distinct latency classes that are tracked */
+#define JSON_SERVER_CLASSES 16
+
+/* the number of requests of a connection that may be unanswered */
+#define JSON_SERVER_WINDOW 64
+
+typedef struct
+{
+    char label[32];
+    slong count;
+    double seconds;
+    double wait_seconds;
+    slong histogram[JSON_SERVER_BUCKETS];
+} json_server_class_struct;
+
+/*
+ * A client connection, referenced by its reader thread and by each of
+ * its requests that has not been answered yet. The requests are numbered
+ * in the order they are read, and a response that is finished before
+ * the responses of earlier requests waits in the window until they are
+ * sent; the reader waits while the window is full. The connection lock
+ * guards the window, and the thread that finds the next response in the
+ * window sends the responses that are ready while the others go on.
+ */
+typedef struct
+{
+    FILE *stream;
+    int fd;
+    slong refs;
+    slong sent;
+    int flushing;
+    int failed;
+    char *window[JSON_SERVER_WINDOW];
+    pthread_mutex_t lock;
+    pthread_cond_t room;
+} json_server_connection_struct;
+
+/*
+ * A request waiting in the queue for a worker, with the time
+ * at which it was read.
+ */
+typedef struct
+{
+    json_server_connection_struct *conn;
+    slong index;
+    json_t *data;
+    struct timespec received;
+} json_server_request_struct;
+
+/*
+ * A reader thread per connection parses its request lines and sends
+ * them to the bounded request queue, from which the workers take them
+ * one request at a time, so the requests of one busy connection are
+ * spread over the workers and a connection does not hold a worker
+ * while its client is idle. The mutex guards the counters,
+ * the number of open connections and the latency classes.
+ */
+typedef struct
+{
+    json_hom_ptr hom;
+    json_label_fn_t label;
+    json_stats_fn_t stats;
+    int listener;
+
+    channel_t requests;
+
+    pthread_mutex_t lock;
+    pthread_cond_t closed;
+    slong open;
+    int stopping;
+
+    struct timespec start;
+    slong connections;
+    slong handled;
+    slong active;
+    slong errors;
+    json_server_class_struct classes[JSON_SERVER_CLASSES];
+    slong nclasses;
+} json_server_struct;
+
+typedef struct
+{
+    json_server_struct *server;
+    json_server_connection_struct *conn;
+} json_server_reader_struct;
+
+
+static double _seconds_since(const struct timespec *start);
+static int _send_line(int fd, const char *s);
+static void _record(json_server_struct *server, const char *label,
+        double seconds, double wait_seconds);
+static json_t * _stats(json_server_struct *server);
+static json_t * _handle(json_server_struct *server,
+        json_server_request_struct *request, int *stop);
+static void _respond(json_server_connection_struct *conn, slong index,
+        json_t *j_out);
+static void _release(json_server_struct *server,
+        json_server_connection_struct *conn);
+static void * _reader(void *arg);
+static void * _worker(void *arg);
+
+
+double
+_seconds_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) +
+        1e-9 * (now.tv_nsec - start->tv_nsec);
+}
+
+int
+_send_line(int fd, const char *s)
+{
+    /* a client that went away must not stop the server with SIGPIPE */
+    size_t len;
+    ssize_t n;
+    len = strlen(s);
+    while (len)
+    {
+        n = send(fd, s, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return 1;
+        }
+        s += n;
+        len -= n;
+    }
+    return send(fd, "\n", 1, MSG_NOSIGNAL) != 1;
+}
+
+int
+json_server_bucket(double seconds)
+{
+    double ms;
+    int k;
+    ms = 1000 * seconds;
+    for (k = 0; k < JSON_SERVER_BUCKETS - 1 && ms >= 1; k++)
+    {
+        ms /= 2;
+    }
+    return k;
+}
+
+void
+_record(json_server_struct *server, const char *label,
+        double seconds, double wait_seconds)
+{
+    json_server_class_struct *c;
+    slong i;
+
+    /* the server lock is held */
+    label = label ? label : "default";
+    c = NULL;
+    for (i = 0; i < server->nclasses && !c; i++)
+    {
+        if (!strncmp(server->classes[i].label, label,
+                    sizeof(c->label) - 1))
+        {
+            c = server->classes + i;
+        }
+    }
+    if (!c)
+    {
+        /* the last class collects the labels that do not fit */
+        i = FLINT_MIN(server->nclasses, JSON_SERVER_CLASSES - 1);
+        c = server->classes + i;
+        if (i == server->nclasses)
+        {
+            memset(c, 0, sizeof(json_server_class_struct));
+            strncpy(c->label, (i == JSON_SERVER_CLASSES - 1) ?
+                    "other" : label, sizeof(c->label) - 1);
+            server->nclasses++;
+        }
+    }
+    c->count++;
+    c->seconds += seconds;
+    c->wait_seconds += wait_seconds;
+    c->histogram[json_server_bucket(seconds)]++;
+}
+
+json_t *
+_stats(json_server_struct *server)
+{
+    json_t *j_out, *latency, *histogram;
+    json_server_class_struct *c;
+    slong i, k, queued;
+
+    queued = channel_len(server->requests);
+    pthread_mutex_lock(&server->lock);
+    latency = json_object();
+    for (i = 0; i < server->nclasses; i++)
+    {
+        c = server->classes + i;
+        histogram = json_array();
+        for (k = 0; k < JSON_SERVER_BUCKETS; k++)
+        {
+            json_array_append_new(histogram,
+                    json_integer((json_int_t) c->histogram[k]));
+        }
+        json_object_set_new(latency, c->label, json_pack(
+                    "{s:I, s:f, s:f, s:o}",
+                    "count", (json_int_t) c->count,
+                    "mean_seconds", c->seconds / c->count,
+                    "mean_wait_seconds", c->wait_seconds / c->count,
+                    "histogram_ms", histogram));
+    }
+    j_out = json_pack("{s:I, s:I, s:I, s:I, s:I, s:I, s:f, s:o}",
+            "queue_depth", (json_int_t) queued,
+            "active_requests", (json_int_t) server->active,
+            "open_connections", (json_int_t) server->open,
+            "connections", (json_int_t) server->connections,
+            "requests", (json_int_t) server->handled,
+            "errors", (json_int_t) server->errors,
+            "uptime_seconds", _seconds_since(&server->start),
+            "latency", latency);
+    pthread_mutex_unlock(&server->lock);
+
+    if (server->stats)
+    {
+        json_object_set_new(j_out, "handler",
+                server->stats(server->hom->userdata));
+    }
+    return j_out;
+}
+
+json_t *
+_handle(json_server_struct *server, json_server_request_struct *request,
+        int *stop)
+{
+    json_t *j_in, *j_out;
+    const char *label;
+    double wait_seconds;
+
+    j_in = request->data;
+    if (json_object_size(j_in) == 1 && json_object_get(j_in, "stats"))
+    {
+        return _stats(server);
+    }
+    if (json_object_size(j_in) == 1 && json_object_get(j_in, "shutdown"))
+    {
+        *stop = 1;
+        return json_pack("{s:b}", "shutdown", 1);
+    }
+
+    label = server->label ? server->label(j_in) : NULL;
+    wait_seconds = _seconds_since(&request->received);
+    pthread_mutex_lock(&server->lock);
+    server->active++;
+    pthread_mutex_unlock(&server->lock);
+
+    j_out = server->hom->f(server->hom->userdata, j_in);
+    if (!j_out)
+    {
+        j_out = json_error_response("failed to get json object output");
+    }
+
+    /* the latency of a request includes its wait in the queue */
+    pthread_mutex_lock(&server->lock);
+    server->active--;
+    server->handled++;
+    server->errors += (json_error_message(j_out) != NULL);
+    _record(server, label, _seconds_since(&request->received),
+            wait_seconds);
+    pthread_mutex_unlock(&server->lock);
+
+    return j_out;
+}
+
+void
+_respond(json_server_connection_struct *conn, slong index, json_t *j_out)
+{
+    char *s_out;
+    int failed;
+
+    s_out = json_dumps(j_out, JSON_COMPACT);
+    json_decref(j_out);
+    if (!s_out)
+    {
+        s_out = strdup("{\"error\":\"failed to serialize the response\"}");
+    }
+
+    /*
+     * Send the responses that are next in the order of the requests.
+     * One thread at a time sends them, outside of the lock, so that
+     * the other workers do not wait for a slow client.
+     */
+    pthread_mutex_lock(&conn->lock);
+    conn->window[index % JSON_SERVER_WINDOW] = s_out;
+    if (conn->flushing)
+    {
+        pthread_mutex_unlock(&conn->lock);
+        return;
+    }
+    conn->flushing = 1;
+    while ((s_out = conn->window[conn->sent % JSON_SERVER_WINDOW]) != NULL)
+    {
+        conn->window[conn->sent % JSON_SERVER_WINDOW] = NULL;
+        failed = conn->failed;
+        pthread_mutex_unlock(&conn->lock);
+
+        if (!failed && _send_line(conn->fd, s_out))
+        {
+            /* stop reading from a client that cannot be answered */
+            shutdown(conn->fd, SHUT_RDWR);
+            failed = 1;
+        }
+        free(s_out);
+
+        pthread_mutex_lock(&conn->lock);
+        conn->failed |= failed;
+        conn->sent++;
+        pthread_cond_signal(&conn->room);
+    }
+    conn->flushing = 0;
+    pthread_mutex_unlock(&conn->lock);
+}
+
+void
+_release(json_server_struct *server, json_server_connection_struct *conn)
+{
+    slong refs;
+
+    pthread_mutex_lock(&conn->lock);
+    refs = --conn->refs;
+    pthread_mutex_unlock(&conn->lock);
+    if (refs)
+    {
+        return;
+    }
+
+    if (conn->stream)
+    {
+        fclose(conn->stream);
+    }
+    else
+    {
+        close(conn->fd);
+    }
+    pthread_mutex_destroy(&conn->lock);
+    pthread_cond_destroy(&conn->room);
+    flint_free(conn);
+
+    pthread_mutex_lock(&server->lock);
+    server->open--;
+    pthread_cond_signal(&server->closed);
+    pthread_mutex_unlock(&server->lock);
+}
+
+void *
+_reader(void *arg)
+{
+    json_server_reader_struct *reader = arg;
+    json_server_struct *server = reader->server;
+    json_server_connection_struct *conn = reader->conn;
+    json_server_request_struct *request;
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t len;
+    json_error_t error;
+    json_t *j_in;
+    slong index;
+    int failed;
+
+    flint_free(reader);
+    index = 0;
+    failed = 0;
+    while (!failed && (len = getline(&line, &capacity, conn->stream)) != -1)
+    {
+        while (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r'))
+        {
+            line[--len] = '\0';
+        }
+        if (!len)
+        {
+            continue;
+        }
+
+        /* wait for room in the window of unanswered requests */
+        pthread_mutex_lock(&conn->lock);
+        while (index - conn->sent >= JSON_SERVER_WINDOW && !conn->failed)
+        {
+            pthread_cond_wait(&conn->room, &conn->lock);
+        }
+        failed = conn->failed;
+        conn->refs++;
+        pthread_mutex_unlock(&conn->lock);
+        if (failed)
+        {
+            _release(server, conn);
+            break;
+        }
+
+        j_in = json_loads(line, 0, &error);
+        if (!j_in)
+        {
+            pthread_mutex_lock(&server->lock);
+            server->errors++;
+            pthread_mutex_unlock(&server->lock);
+            _respond(conn, index,
+                    json_error_response("%s", error.text));
+            _release(server, conn);
+            index++;
+            continue;
+        }
+
+        request = flint_malloc(sizeof(json_server_request_struct));
+        request->conn = conn;
+        request->index = index;
+        request->data = j_in;
+        clock_gettime(CLOCK_MONOTONIC, &request->received);
+        if (channel_send(server->requests, request))
+        {
+            /* the workers are gone */
+            json_decref(j_in);
+            flint_free(request);
+            _release(server, conn);
+            break;
+        }
+        index++;
+    }
+
+    free(line);
+    _release(server, conn);
+    return NULL;
+}
+
+void *
+_worker(void *arg)
+{
+    json_server_struct *server = arg;
+    json_server_request_struct *request;
+    json_server_connection_struct *conn;
+    json_t *j_out;
+    void *item;
+    int stop;
+
+    while (!channel_recv(server->requests, &item))
+    {
+        request = item;
+        conn = request->conn;
+        stop = 0;
+        j_out = _handle(server, request, &stop);
+        json_decref(request->data);
+        _respond(conn, request->index, j_out);
+        _release(server, conn);
+        flint_free(request);
+
+        if (stop)
+        {
+            /* wake up the listening thread blocked in accept */
+            pthread_mutex_lock(&server->lock);
+            server->stopping = 1;
+            pthread_mutex_unlock(&server->lock);
+            shutdown(server->listener, SHUT_RDWR);
+        }
+    }
+
+    /* release the thread-local caches used by flint and arb */
+    flint_cleanup();
+    return NULL;
+}
+
+
+int
+run_json_server(json_hom_t hom, const char *path, slong nthreads,
+        json_label_fn_t label, json_stats_fn_t stats)
+{
+    json_server_struct server[1];
+    json_server_connection_struct *conn;
+    json_server_reader_struct *reader;
+    struct sockaddr_un addr;
+    pthread_attr_t attr;
+    pthread_t *threads;
+    pthread_t thread;
+    slong i, ncreated;
+    struct stat st;
+    int fd, err, stop;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "error: the socket path %s is too long\n", path);
+        return 1;
+    }
+
+    /* a socket left by a previous server is replaced, nothing else is */
+    if (lstat(path, &st) == 0)
+    {
+        if (!S_ISSOCK(st.st_mode))
+        {
+            fprintf(stderr, "error: %s exists and is not a socket\n", path);
+            return 1;
+        }
+        unlink(path);
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    server->listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server->listener < 0)
+    {
+        fprintf(stderr, "error: failed to create a socket\n");
+        return 1;
+    }
+    if (bind(server->listener, (struct sockaddr *) &addr, sizeof(addr)) ||
+        listen(server->listener, 64))
+    {
+        fprintf(stderr, "error: failed to listen on %s\n", path);
+        close(server->listener);
+        return 1;
+    }
+
+    if (nthreads < 1)
+    {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = (n > 0) ? (slong) n : 1;
+    }
+
+    server->hom = hom;
+    server->label = label;
+    server->stats = stats;
+    channel_init(server->requests, 4 * nthreads);
+    pthread_mutex_init(&server->lock, NULL);
+    pthread_cond_init(&server->closed, NULL);
+    server->open = 0;
+    server->stopping = 0;
+    clock_gettime(CLOCK_MONOTONIC, &server->start);
+    server->connections = 0;
+    server->handled = 0;
+    server->active = 0;
+    server->errors = 0;
+    server->nclasses = 0;
+
+    threads = flint_malloc(nthreads * sizeof(pthread_t));
+    ncreated = 0;
+    for (i = 0; i < nthreads; i++)
+    {
+        if (pthread_create(threads + ncreated, NULL, _worker, server))
+        {
+            break;
+        }
+        ncreated++;
+    }
+    if (!ncreated)
+    {
+        fprintf(stderr, "error: failed to create a worker thread\n");
+        server->stopping = 1;
+    }
+
+    /* the readers are detached; the server waits for their connections */
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    stop = server->stopping;
+    while (!stop)
+    {
+        fd = accept(server->listener, NULL, NULL);
+        err = errno;
+        pthread_mutex_lock(&server->lock);
+        if (fd >= 0 && !server->stopping)
+        {
+            server->open++;
+            server->connections++;
+        }
+        else if (fd >= 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+        else if (err != EINTR && err != ECONNABORTED)
+        {
+            server->stopping = 1;
+        }
+        stop = server->stopping;
+        pthread_mutex_unlock(&server->lock);
+        if (fd < 0)
+        {
+            continue;
+        }
+
+        conn = flint_malloc(sizeof(json_server_connection_struct));
+        conn->fd = fd;
+        conn->stream = fdopen(fd, "r");
+        conn->refs = 1;
+        conn->sent = 0;
+        conn->flushing = 0;
+        conn->failed = 0;
+        memset(conn->window, 0, sizeof(conn->window));
+        pthread_mutex_init(&conn->lock, NULL);
+        pthread_cond_init(&conn->room, NULL);
+        reader = flint_malloc(sizeof(json_server_reader_struct));
+        reader->server = server;
+        reader->conn = conn;
+        if (!conn->stream ||
+            pthread_create(&thread, &attr, _reader, reader))
+        {
+            flint_free(reader);
+            _release(server, conn);
+        }
+    }
+    pthread_attr_destroy(&attr);
+
+    /* the workers answer the requests of the open connections */
+    pthread_mutex_lock(&server->lock);
+    while (server->open)
+    {
+        pthread_cond_wait(&server->closed, &server->lock);
+    }
+    pthread_mutex_unlock(&server->lock);
+    channel_close(server->requests);
+    for (i = 0; i < ncreated; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    close(server->listener);
+    unlink(path);
+    channel_clear(server->requests);
+    pthread_mutex_destroy(&server->lock);
+    pthread_cond_destroy(&server->closed);
+    flint_free(threads);
+
+    return 0;
+}
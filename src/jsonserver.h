@@ -0,0 +1,73 @@
+#ifndef JSONSERVER_H
+#define JSONSERVER_H
+
+/*
+ * A long-lived server for a json homomorphism, so that local clients
+ * do not pay for process startup and model setup on every request.
+ *
+ * The server listens on a Unix domain socket. A client connection
+ * carries any number of requests, one compact json object per line,
+ * and gets one response line for each request in the same order.
+ * Each connection has a reader thread that parses its lines into a
+ * shared bounded queue of requests, and a pool of worker threads takes
+ * the requests from the queue one at a time, so the requests of one
+ * connection may be answered concurrently and an idle connection does
+ * not hold a worker. The homomorphism must therefore be thread-safe;
+ * the workers live as long as the server, so their thread-local flint
+ * and arb caches stay warm.
+ *
+ * Two requests are answered by the server itself:
+ * {"stats": true} reports the number of requests waiting for a worker,
+ * the number of requests in progress, the connection and request counts,
+ * per-class latency histograms measured from the time each request was
+ * read, including its wait in the queue, and the statistics of the handler;
+ * {"shutdown": true} stops accepting connections, and the server
+ * returns once the open connections have been closed.
+ *
+ * A line that is not json gets an error response {"error": string},
+ * and the homomorphism reports an invalid request with an error response
+ * in the same way (see 'runjson.h'), so a bad request does not affect
+ * the other requests or the server.
+ */
+
+#include "jansson.h"
+
+#include "runjson.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the number of latency histogram buckets; see json_server_bucket */
+#define JSON_SERVER_BUCKETS 24
+
+/* the latency class of a request, or NULL for the default class */
+typedef const char *(*json_label_fn_t)(json_t *data);
+
+/* statistics of the json homomorphism, as a new json object */
+typedef json_t *(*json_stats_fn_t)(void *userdata);
+
+/*
+ * Bucket 0 counts the requests that took less than one millisecond,
+ * and bucket k > 0 counts those that took at least 2^(k-1) and less
+ * than 2^k milliseconds. The last bucket also counts longer requests.
+ */
+int json_server_bucket(double seconds);
+
+/*
+ * Serve the homomorphism on a Unix domain socket at the given path,
+ * replacing a socket left at that path, with nthreads worker threads
+ * (one per processor if nthreads < 1). The label and stats functions
+ * may be NULL. Return nonzero if the socket cannot be set up, or if
+ * the path exists and is not a socket.
+ */
+int run_json_server(json_hom_t hom, const char *path, slong nthreads,
+        json_label_fn_t label, json_stats_fn_t stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -2,15 +2,17 @@
 #include <stdio.h>
 
 #include "jsonutil.h"
+#include "runjson.h"
+#include "tkf91_dp.h"
 
 
 
-void
+int
 _fill_sequence_vector(slong *v, const char *str, slong n)
 {
     /* treat N as A following the questionable choice
      * in a reference implementation */
-    int i;
+    slong i;
     for (i = 0; i < n; i++)
     {
         switch(str[i])
@@ -42,12 +44,11 @@ _fill_sequence_vector(slong *v, const char *str, slong n)
                 }
                 else
                 {
-                    fprintf(stderr, "unrecognized nucleotide ");
-                    fprintf(stderr, "ascii %d\n", (int) str[i]);
-                    abort();
+                    return 1;
                 }
         }
     }
+    return 0;
 }
 
 
@@ -96,7 +97,11 @@ _json_object_get_sequence(slong *plen, const json_t *object, const char *key)
     len = json_string_length(tmp);
 
     s = flint_malloc(len * sizeof(slong));
-    _fill_sequence_vector(s, value, len);
+    if (_fill_sequence_vector(s, value, len))
+    {
+        fprintf(stderr, "error: unrecognized nucleotide in '%s'\n", key);
+        abort();
+    }
 
     *plen = (slong) len;
     return s;
@@ -135,3 +140,13 @@ _json_object_get_fmpq(fmpq_t res, const json_t *object,
     d = _json_object_get_si(object, key_d);
     fmpq_set_si(res, n, d);
 }
+
+
+json_t *
+_json_solver_error(int status)
+{
+    json_t *j_out;
+    j_out = json_error_response("%s", tkf91_error_string(status));
+    json_object_set_new(j_out, "status", json_integer(status));
+    return j_out;
+}
@@ -15,7 +15,12 @@ extern "C" {
 
 const char * _json_object_get_string(const json_t *object, const char *key);
 
-void _fill_sequence_vector(slong *v, const char *str, slong n);
+/*
+ * Encode the nucleotides (a, c, g, t, -) as (0, 1, 2, 3, -1), treating
+ * other letters as a; returns nonzero if a character is not a letter
+ * or a gap, in which case the encoding is unspecified.
+ */
+int _fill_sequence_vector(slong *v, const char *str, slong n);
 
 slong *
 _json_object_get_sequence(slong *plen, const json_t *object, const char *key);
@@ -25,6 +30,12 @@ slong _json_object_get_si(const json_t *object, const char *key);
 void _json_object_get_fmpq(fmpq_t res, const json_t *object,
         const char *key_n, const char *key_d);
 
+/*
+ * The error response (see 'runjson.h') of a solver that returned
+ * the nonzero status, with the status in its "status" member.
+ */
+json_t * _json_solver_error(int status);
+
 
 
 #ifdef __cplusplus
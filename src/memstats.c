@@ -0,0 +1,218 @@
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include "gmp.h"
+
+#include "memstats.h"
+
+
+/* the size header keeps the blocks aligned as malloc aligns them */
+#define MEMSTATS_HEADER 16
+
+static int _installed = 0;
+static memstats_struct _process = {0, 0, 0, 0};
+static __thread memstats_struct _thread = {0, 0, 0, 0};
+
+static void _add(memstats_struct *m, slong delta, slong allocated);
+static void _count(slong delta, slong allocated);
+static void * _alloc(size_t size);
+static void * _calloc(size_t num, size_t size);
+static void * _realloc(void *ptr, size_t size);
+static void _free(void *ptr);
+static void * _gmp_realloc(void *ptr, size_t old_size, size_t new_size);
+static void _gmp_free(void *ptr, size_t size);
+
+
+void
+_add(memstats_struct *m, slong delta, slong allocated)
+{
+    m->current += delta;
+    if (m->current > m->peak)
+    {
+        m->peak = m->current;
+    }
+    if (allocated >= 0)
+    {
+        m->allocations++;
+        m->allocated_bytes += allocated;
+    }
+}
+
+void
+_count(slong delta, slong allocated)
+{
+    slong current, peak;
+
+    /* a negative allocated size means that nothing was allocated */
+    _add(&_thread, delta, allocated);
+
+    /* the process counts are shared, so they are updated atomically */
+    current = __atomic_add_fetch(&_process.current, delta, __ATOMIC_RELAXED);
+    peak = __atomic_load_n(&_process.peak, __ATOMIC_RELAXED);
+    while (current > peak && !__atomic_compare_exchange_n(&_process.peak,
+                &peak, current, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+    if (allocated >= 0)
+    {
+        __atomic_add_fetch(&_process.allocations, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&_process.allocated_bytes, allocated,
+                __ATOMIC_RELAXED);
+    }
+}
+
+void *
+_alloc(size_t size)
+{
+    char *p = malloc(size + MEMSTATS_HEADER);
+    if (!p)
+    {
+        return NULL;
+    }
+    *(size_t *) p = size;
+    _count((slong) size, (slong) size);
+    return p + MEMSTATS_HEADER;
+}
+
+void *
+_calloc(size_t num, size_t size)
+{
+    char *p;
+    if (size && num > ((size_t) -1 - MEMSTATS_HEADER) / size)
+    {
+        return NULL;
+    }
+    size *= num;
+    p = calloc(1, size + MEMSTATS_HEADER);
+    if (!p)
+    {
+        return NULL;
+    }
+    *(size_t *) p = size;
+    _count((slong) size, (slong) size);
+    return p + MEMSTATS_HEADER;
+}
+
+void *
+_realloc(void *ptr, size_t size)
+{
+    char *p;
+    size_t old_size;
+    if (!ptr)
+    {
+        return _alloc(size);
+    }
+    p = (char *) ptr - MEMSTATS_HEADER;
+    old_size = *(size_t *) p;
+    p = realloc(p, size + MEMSTATS_HEADER);
+    if (!p)
+    {
+        return NULL;
+    }
+    *(size_t *) p = size;
+    _count((slong) size - (slong) old_size, (slong) size);
+    return p + MEMSTATS_HEADER;
+}
+
+void
+_free(void *ptr)
+{
+    char *p;
+    if (!ptr)
+    {
+        return;
+    }
+    p = (char *) ptr - MEMSTATS_HEADER;
+    _count(-(slong) *(size_t *) p, -1);
+    free(p);
+}
+
+void *
+_gmp_realloc(void *ptr, size_t old_size, size_t new_size)
+{
+    (void) old_size;
+    return _realloc(ptr, new_size);
+}
+
+void
+_gmp_free(void *ptr, size_t size)
+{
+    (void) size;
+    _free(ptr);
+}
+
+
+void
+memstats_install(void)
+{
+    if (_installed)
+    {
+        return;
+    }
+    __flint_set_memory_functions(_alloc, _calloc, _realloc, _free);
+    mp_set_memory_functions(_alloc, _gmp_realloc, _gmp_free);
+    _installed = 1;
+}
+
+int
+memstats_installed(void)
+{
+    return _installed;
+}
+
+void
+memstats_get(memstats_t m)
+{
+    m->current = __atomic_load_n(&_process.current, __ATOMIC_RELAXED);
+    m->peak = __atomic_load_n(&_process.peak, __ATOMIC_RELAXED);
+    m->allocations = __atomic_load_n(&_process.allocations,
+            __ATOMIC_RELAXED);
+    m->allocated_bytes = __atomic_load_n(&_process.allocated_bytes,
+            __ATOMIC_RELAXED);
+}
+
+void
+memstats_reset_peak(void)
+{
+    __atomic_store_n(&_process.peak,
+            __atomic_load_n(&_process.current, __ATOMIC_RELAXED),
+            __ATOMIC_RELAXED);
+}
+
+slong
+memstats_peak_resident(void)
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage))
+    {
+        return -1;
+    }
+#ifdef __APPLE__
+    return (slong) usage.ru_maxrss;
+#else
+    /* kilobytes on Linux and the BSDs */
+    return (slong) usage.ru_maxrss * 1024;
+#endif
+}
+
+void
+memstats_mark(memstats_mark_t m)
+{
+    m->current = _thread.current;
+    m->saved_peak = _thread.peak;
+    m->allocations = _thread.allocations;
+    m->allocated_bytes = _thread.allocated_bytes;
+    _thread.peak = _thread.current;
+}
+
+void
+memstats_interval(memstats_t m, const memstats_mark_t start)
+{
+    m->current = _thread.current - start->current;
+    m->peak = _thread.peak - start->current;
+    m->allocations = _thread.allocations - start->allocations;
+    m->allocated_bytes = _thread.allocated_bytes - start->allocated_bytes;
+
+    /* the enclosing interval has seen this peak too */
+    _thread.peak = FLINT_MAX(_thread.peak, start->saved_peak);
+}
@@ -0,0 +1,72 @@
+#ifndef MEMSTATS_H
+#define MEMSTATS_H
+
+/*
+ * Heap accounting through the memory functions of flint and gmp.
+ *
+ * Once installed, every allocation made with flint_malloc and friends,
+ * which includes the allocations of arb and of the tableaux and cell
+ * buffers of the solvers, and every allocation made by gmp, is counted.
+ * Each block carries a small header with its size, so the accounting
+ * must be installed before flint or gmp allocate anything, and it
+ * cannot be removed. Allocations made directly with malloc, such as
+ * those of the json library, are not counted.
+ *
+ * The process counts the bytes in use and their peak, which can be
+ * reset, and the number and total size of the allocations. The process
+ * counts are updated with atomic operations rather than under a lock,
+ * so concurrent allocations do not contend for one, and a read of
+ * them while other threads allocate is not a single snapshot. Each thread
+ * also counts its own, so that intervals of work on one thread, such as
+ * the phases of a solve, can be measured while other threads allocate.
+ * The peak of an interval is the most that the bytes in use by the
+ * thread rose above their level at the start of the interval; the
+ * intervals of a thread must be nested.
+ */
+
+#include "flint/flint.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    slong current;
+    slong peak;
+    slong allocations;
+    slong allocated_bytes;
+} memstats_struct;
+typedef memstats_struct memstats_t[1];
+
+typedef struct
+{
+    slong current;
+    slong saved_peak;
+    slong allocations;
+    slong allocated_bytes;
+} memstats_mark_struct;
+typedef memstats_mark_struct memstats_mark_t[1];
+
+/* install the accounting, before anything is allocated */
+void memstats_install(void);
+int memstats_installed(void);
+
+/* the counts of the process, and a reset of its peak */
+void memstats_get(memstats_t m);
+void memstats_reset_peak(void);
+
+/* the peak resident set size of the process in bytes, or -1 */
+slong memstats_peak_resident(void);
+
+/* start and end an interval on the calling thread */
+void memstats_mark(memstats_mark_t m);
+void memstats_interval(memstats_t m, const memstats_mark_t start);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
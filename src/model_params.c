@@ -1,6 +1,7 @@
 #include "flint/flint.h"
 
 #include "model_params.h"
+#include "hash.h"
 
 
 void
@@ -29,6 +30,39 @@ model_params_clear(model_params_t p)
     }
 }
 
+void
+model_params_set(model_params_t res, const model_params_t p)
+{
+    slong i;
+    fmpq_set(res->lambda, p->lambda);
+    fmpq_set(res->mu, p->mu);
+    fmpq_set(res->tau, p->tau);
+    for (i = 0; i < 4; i++)
+    {
+        fmpq_set(res->pi+i, p->pi+i);
+    }
+}
+
+int
+model_params_equal(const model_params_t p, const model_params_t q)
+{
+    slong i;
+    if (!fmpq_equal(p->lambda, q->lambda) ||
+        !fmpq_equal(p->mu, q->mu) ||
+        !fmpq_equal(p->tau, q->tau))
+    {
+        return 0;
+    }
+    for (i = 0; i < 4; i++)
+    {
+        if (!fmpq_equal(p->pi+i, q->pi+i))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
 
 void
 model_params_print(const model_params_t p)
@@ -45,6 +79,21 @@ model_params_print(const model_params_t p)
 
 
 
+uint64_t
+model_params_hash(uint64_t h, const model_params_t p)
+{
+    slong i;
+    h = hash_fmpq(h, p->lambda);
+    h = hash_fmpq(h, p->mu);
+    h = hash_fmpq(h, p->tau);
+    for (i = 0; i < 4; i++)
+    {
+        h = hash_fmpq(h, p->pi+i);
+    }
+    return h;
+}
+
+
 static int _assert_fmpq_positive(const fmpq_t x, const char *name);
 
 int
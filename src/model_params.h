@@ -1,6 +1,8 @@
 #ifndef MODEL_PARAMS_H
 #define MODEL_PARAMS_H
 
+#include <stdint.h>
+
 #include "flint/flint.h"
 #include "flint/fmpq.h"
 
@@ -22,7 +24,10 @@ typedef model_params_struct * model_params_ptr;
 
 void model_params_init(model_params_t p);
 void model_params_clear(model_params_t p);
+void model_params_set(model_params_t res, const model_params_t p);
+int model_params_equal(const model_params_t p, const model_params_t q);
 void model_params_print(const model_params_t p);
+uint64_t model_params_hash(uint64_t h, const model_params_t p);
 
 /* complain on stderr and return a nonzero value if parameters are invalid */
 int model_params_validate(const model_params_t p);
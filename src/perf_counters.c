@@ -0,0 +1,158 @@
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "perf_counters.h"
+
+
+static const char * _names[PERF_COUNTERS] = {
+    "cycles", "instructions", "cache_misses", "branch_misses"};
+
+static int _open(int counter, int group);
+static int _read_group(uint64_t *buf, const perf_counters_t c);
+
+int
+_open(int counter, int group)
+{
+#ifdef __linux__
+    static const uint64_t configs[PERF_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES};
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[counter];
+    attr.read_format = PERF_FORMAT_GROUP |
+                       PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    /* this thread, on any cpu, as the leader or a member of the group */
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+#else
+    (void) counter;
+    (void) group;
+    return -1;
+#endif
+}
+
+int
+_read_group(uint64_t *buf, const perf_counters_t c)
+{
+    /*
+     * The number of counters, the time enabled and the time running
+     * of the group, and then the values in the order they were opened.
+     * Return nonzero if the group cannot be read.
+     */
+    ssize_t size;
+    if (c->leader < 0)
+    {
+        return 1;
+    }
+    size = (3 + c->len) * sizeof(uint64_t);
+    return read(c->fd[c->leader], buf, size) != size;
+}
+
+
+void
+perf_counters_init(perf_counters_t c)
+{
+    int i;
+
+    /*
+     * The first counter that can be opened, normally the cycles, leads
+     * the group, and the others join it, so that the kernel schedules
+     * them together and their ratios are taken over the same time.
+     */
+    c->leader = -1;
+    c->len = 0;
+    for (i = 0; i < PERF_COUNTERS; i++)
+    {
+        c->fd[i] = _open(i, (c->leader < 0) ? -1 : c->fd[c->leader]);
+        c->slot[i] = -1;
+        if (c->fd[i] >= 0)
+        {
+            if (c->leader < 0)
+            {
+                c->leader = i;
+            }
+            c->slot[i] = c->len;
+            c->len++;
+        }
+    }
+}
+
+void
+perf_counters_clear(perf_counters_t c)
+{
+    int i;
+
+    /* the members are closed before the leader */
+    for (i = PERF_COUNTERS - 1; i >= 0; i--)
+    {
+        if (c->fd[i] >= 0)
+        {
+            close(c->fd[i]);
+        }
+    }
+}
+
+int
+perf_counter_available(const perf_counters_t c, int counter)
+{
+    return c->fd[counter] >= 0;
+}
+
+int
+perf_counters_available(const perf_counters_t c)
+{
+    return c->len;
+}
+
+int
+perf_counters_running(const perf_counters_t c)
+{
+    uint64_t buf[3 + PERF_COUNTERS];
+    return !_read_group(buf, c) && buf[2] > 0;
+}
+
+void
+perf_counters_read(double *counts, double *running, const perf_counters_t c)
+{
+    uint64_t buf[3 + PERF_COUNTERS];
+    double scale;
+    int i, ok;
+
+    /* scale the counts of a group that was multiplexed */
+    ok = !_read_group(buf, c);
+    scale = 1;
+    if (ok && buf[2] > 0 && buf[2] < buf[1])
+    {
+        scale = (double) buf[1] / buf[2];
+    }
+    *running = ok ? (double) buf[2] : 0;
+    for (i = 0; i < PERF_COUNTERS; i++)
+    {
+        counts[i] = 0;
+        if (ok && c->slot[i] >= 0)
+        {
+            counts[i] = (double) buf[3 + c->slot[i]] * scale;
+        }
+    }
+}
+
+const char *
+perf_counter_name(int counter)
+{
+    return _names[counter];
+}
@@ -0,0 +1,81 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+/*
+ * Hardware performance counters of the calling thread.
+ *
+ * On Linux the cycles, instructions, cache misses and branch misses
+ * are counted in user space with perf_event_open. A counter that
+ * cannot be opened, because the kernel, the hardware, a virtual machine
+ * or perf_event_paranoid does not allow it, is simply unavailable,
+ * and on other systems no counter is available. The counters are
+ * opened as one group, led by the cycles counter if it is available,
+ * so the kernel schedules them onto the hardware together and they all
+ * count over the same time; when it multiplexes the group with other
+ * events, the counts are scaled by the fraction of the time that the
+ * group was running.
+ *
+ * The counters count the thread that opened them, from the time they
+ * are opened; the difference between two reads counts the work done
+ * by that thread in between.
+ */
+
+#include "flint/flint.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PERF_COUNTER_CYCLES 0
+#define PERF_COUNTER_INSTRUCTIONS 1
+#define PERF_COUNTER_CACHE_MISSES 2
+#define PERF_COUNTER_BRANCH_MISSES 3
+#define PERF_COUNTERS 4
+
+/*
+ * The leader is the index of the counter that leads the group, or -1,
+ * and the slot of a counter is its position in the values of the group.
+ */
+typedef struct
+{
+    int fd[PERF_COUNTERS];
+    int slot[PERF_COUNTERS];
+    int leader;
+    int len;
+} perf_counters_struct;
+typedef perf_counters_struct perf_counters_t[1];
+typedef perf_counters_struct * perf_counters_ptr;
+
+/* open the counters of the calling thread */
+void perf_counters_init(perf_counters_t c);
+void perf_counters_clear(perf_counters_t c);
+
+/* the number of counters that could be opened */
+int perf_counters_available(const perf_counters_t c);
+int perf_counter_available(const perf_counters_t c, int counter);
+
+/*
+ * Nonzero if the group has been running on the hardware; a group that
+ * the kernel could not schedule, for example because another program
+ * is using the hardware counters, counts nothing.
+ */
+int perf_counters_running(const perf_counters_t c);
+
+/*
+ * Set counts to the current counts, or zero for the unavailable counters,
+ * and running to the nanoseconds that the group has been running on the
+ * hardware; an interval in which running does not grow counted nothing.
+ */
+void perf_counters_read(double *counts, double *running,
+        const perf_counters_t c);
+
+/* a name such as "cache_misses" */
+const char * perf_counter_name(int counter);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,207 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "plan.h"
+
+
+/*
+ * Rough per-cell and per-column memory costs of the engines.
+ * The float and double tableaux store three values per cell.
+ * The flag tableau used by the interval engines stores one byte
+ * per cell, and the forward passes keep two rows of cell data
+ * whose size depends on the engine and on the precision level;
+ * a generous constant is used for those rows.
+ */
+#define PLAN_FLOAT_CELL_BYTES (3 * sizeof(float))
+#define PLAN_DOUBLE_CELL_BYTES (3 * sizeof(double))
+#define PLAN_FLAG_CELL_BYTES 1
+#define PLAN_ROW_CELL_BYTES 1024
+
+/* the portfolio engine runs this many threads */
+#define PLAN_AUTO_THREADS 3
+
+
+typedef struct
+{
+    int guarantee;
+    const char *precision;
+    int memory;
+    slong threads;
+} plan_candidate_struct;
+
+/* candidates in order of preference for each guarantee */
+static const plan_candidate_struct _candidates[] = {
+    {PLAN_GUARANTEE_SCORE, "double", PLAN_MEMORY_LINEAR_SPACE, 1},
+    {PLAN_GUARANTEE_ALIGNMENT, "double", PLAN_MEMORY_FULL_TABLEAU, 1},
+    {PLAN_GUARANTEE_ALIGNMENT, "float", PLAN_MEMORY_FULL_TABLEAU, 1},
+    {PLAN_GUARANTEE_ALIGNMENT, "mag", PLAN_MEMORY_FULL_TABLEAU, 1},
+    {PLAN_GUARANTEE_ALIGNMENT, "double", PLAN_MEMORY_CHECKPOINTED, 1},
+    {PLAN_GUARANTEE_CERTIFIED, "auto", PLAN_MEMORY_FULL_TABLEAU,
+        PLAN_AUTO_THREADS},
+    {PLAN_GUARANTEE_CERTIFIED, "high", PLAN_MEMORY_FULL_TABLEAU, 1}};
+
+static const slong _ncandidates =
+    sizeof(_candidates) / sizeof(plan_candidate_struct);
+
+
+void
+plan_init(plan_t plan)
+{
+    plan->precision = NULL;
+    plan->memory = PLAN_MEMORY_FULL_TABLEAU;
+    plan->threads = 1;
+    plan->estimated_bytes = 0;
+}
+
+void
+plan_clear(plan_t plan)
+{
+    plan->precision = NULL;
+}
+
+slong
+plan_estimate_bytes(const char *precision, int memory,
+        slong len_A, slong len_B)
+{
+    slong nrows, ncols, cells, bytes, k;
+
+    nrows = len_A + 1;
+    ncols = len_B + 1;
+    cells = nrows * ncols;
+
+    /* the two aligned sequences of the solution */
+    bytes = 2 * (len_A + len_B + 1);
+
+    if (strcmp(precision, "float") == 0)
+    {
+        bytes += cells * PLAN_FLOAT_CELL_BYTES;
+    }
+    else if (strcmp(precision, "double") == 0)
+    {
+        if (memory == PLAN_MEMORY_LINEAR_SPACE)
+        {
+            bytes += 2 * ncols * PLAN_DOUBLE_CELL_BYTES;
+        }
+        else if (memory == PLAN_MEMORY_CHECKPOINTED)
+        {
+            /* the kept rows and a block of k + 1 rows */
+            k = (slong) sqrt((double) (nrows - 1)) + 1;
+            bytes += ((nrows - 1) / k + 1 + k + 1) *
+                ncols * PLAN_DOUBLE_CELL_BYTES;
+        }
+        else
+        {
+            bytes += cells * PLAN_DOUBLE_CELL_BYTES;
+        }
+    }
+    else if (strcmp(precision, "mag") == 0 ||
+             strcmp(precision, "high") == 0)
+    {
+        bytes += cells * PLAN_FLAG_CELL_BYTES;
+        bytes += 2 * ncols * PLAN_ROW_CELL_BYTES;
+    }
+    else if (strcmp(precision, "auto") == 0)
+    {
+        /*
+         * The result tableau and two worker flag tableaux, the full
+         * tableau kept for the traceback of the double precision worker
+         * until it finishes or is cancelled, and the aligned sequences
+         * of the solutions of the three workers.
+         */
+        bytes += 3 * cells * PLAN_FLAG_CELL_BYTES;
+        bytes += cells * PLAN_DOUBLE_CELL_BYTES;
+        bytes += 2 * 2 * ncols * PLAN_ROW_CELL_BYTES;
+        bytes += PLAN_AUTO_THREADS * 2 * (len_A + len_B + 1);
+    }
+    else
+    {
+        flint_printf("plan_estimate_bytes: unrecognized precision\n");
+        abort();
+    }
+
+    return bytes;
+}
+
+int
+plan_choose(plan_t plan, slong len_A, slong len_B,
+        slong memory_limit, int guarantee, slong available_threads)
+{
+    /*
+     * Pick the first candidate for the requested guarantee that fits
+     * within the memory limit and the available threads.
+     * A negative memory limit means that memory is not limited.
+     * Return nonzero if no candidate fits.
+     */
+    slong i, bytes;
+    const plan_candidate_struct *c;
+
+    for (i = 0; i < _ncandidates; i++)
+    {
+        c = _candidates + i;
+        if (c->guarantee != guarantee)
+        {
+            continue;
+        }
+        if (c->threads > 1 && c->threads > available_threads)
+        {
+            continue;
+        }
+        bytes = plan_estimate_bytes(c->precision, c->memory, len_A, len_B);
+        if (memory_limit >= 0 && bytes > memory_limit)
+        {
+            continue;
+        }
+        plan->precision = c->precision;
+        plan->memory = c->memory;
+        plan->threads = c->threads;
+        plan->estimated_bytes = bytes;
+        return 0;
+    }
+
+    return 1;
+}
+
+int
+plan_guarantee_from_string(int *guarantee, const char *s)
+{
+    if (strcmp(s, "score") == 0)
+    {
+        *guarantee = PLAN_GUARANTEE_SCORE;
+    }
+    else if (strcmp(s, "alignment") == 0)
+    {
+        *guarantee = PLAN_GUARANTEE_ALIGNMENT;
+    }
+    else if (strcmp(s, "certified") == 0)
+    {
+        *guarantee = PLAN_GUARANTEE_CERTIFIED;
+    }
+    else
+    {
+        return 1;
+    }
+    return 0;
+}
+
+const char *
+plan_memory_string(int memory)
+{
+    if (memory == PLAN_MEMORY_LINEAR_SPACE)
+    {
+        return "linear-space";
+    }
+    else if (memory == PLAN_MEMORY_CHECKPOINTED)
+    {
+        return "checkpointed";
+    }
+    return "full-tableau";
+}
+
+slong
+plan_available_threads(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (slong) n : 1;
+}
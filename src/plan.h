@@ -0,0 +1,63 @@
+#ifndef PLAN_H
+#define PLAN_H
+
+/*
+ * Choose a dynamic programming engine and memory strategy
+ * from the sequence lengths, a memory limit in bytes,
+ * and the guarantee requested by the caller.
+ *
+ * The guarantees are ordered from weakest to strongest:
+ * score : only the log probability of the best alignment is needed.
+ * alignment : an alignment is needed, but it need not be certified.
+ * certified : the alignment must be certified as optimal.
+ *
+ * The memory strategies are the full tableau, the two rows of a score
+ * pass (linear space), and the rows kept every sqrt(len_A) rows by the
+ * checkpointed double precision traceback (see 'tkf91_dp_d.h').
+ *
+ * The threads of a plan are the fixed number of threads run by the
+ * chosen engine; a candidate that needs more threads than the available
+ * processors is skipped. The number is reported, not tuned.
+ */
+
+#include "flint/flint.h"
+
+
+#define PLAN_GUARANTEE_SCORE 0
+#define PLAN_GUARANTEE_ALIGNMENT 1
+#define PLAN_GUARANTEE_CERTIFIED 2
+
+#define PLAN_MEMORY_FULL_TABLEAU 0
+#define PLAN_MEMORY_LINEAR_SPACE 1
+#define PLAN_MEMORY_CHECKPOINTED 2
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    const char *precision;
+    int memory;
+    slong threads;
+    slong estimated_bytes;
+} plan_struct;
+typedef plan_struct plan_t[1];
+
+void plan_init(plan_t plan);
+void plan_clear(plan_t plan);
+int plan_choose(plan_t plan, slong len_A, slong len_B,
+        slong memory_limit, int guarantee, slong available_threads);
+slong plan_estimate_bytes(const char *precision, int memory,
+        slong len_A, slong len_B);
+int plan_guarantee_from_string(int *guarantee, const char *s);
+const char * plan_memory_string(int memory);
+slong plan_available_threads(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,459 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "result_cache.h"
+#include "hash.h"
+
+
+#define RESULT_CACHE_MAGIC "arbtkf91-result"
+#define RESULT_CACHE_VERSION 2
+
+/* the number of hex digits in the name of a result file */
+#define RESULT_CACHE_NAME_LEN 32
+
+/* the temporary files of a writer that went away are removed after this */
+#define RESULT_CACHE_STALE_SECONDS 3600
+
+/* an eviction frees at least this fraction of the limit */
+#define RESULT_CACHE_EVICT_FRACTION 4
+
+/*
+ * The header is written in native byte order,
+ * and is followed by the key bytes and then by the result.
+ */
+typedef struct
+{
+    char magic[24];
+    int64_t version;
+    uint64_t key[2];
+    int64_t key_len;
+    int64_t len;
+} result_cache_header_struct;
+
+typedef struct
+{
+    char name[RESULT_CACHE_NAME_LEN + 1];
+    off_t size;
+    struct timespec mtime;
+} result_cache_entry_struct;
+
+
+static void _key_fit(result_key_t key, slong n);
+static void _key_append(result_key_t key, const void *data, slong n);
+static void _path(char *path, const result_cache_t c, const result_key_t key);
+static int _is_result_name(const char *name);
+static int _is_temporary_name(const char *name);
+static int _entry_cmp(const void *a, const void *b);
+static void _scan(result_cache_t c, slong target);
+
+
+void
+_key_fit(result_key_t key, slong n)
+{
+    if (key->len + n > key->alloc)
+    {
+        key->alloc = FLINT_MAX(key->len + n, 2 * key->alloc);
+        key->data = flint_realloc(key->data, key->alloc);
+    }
+}
+
+void
+_key_append(result_key_t key, const void *data, slong n)
+{
+    _key_fit(key, n);
+    memcpy(key->data + key->len, data, n);
+    key->len += n;
+}
+
+void
+result_key_init(result_key_t key, const char *tool)
+{
+    /* the two halves start from different states */
+    key->h[0] = hash_string(HASH_INIT, tool);
+    key->h[1] = hash_string(hash_string(HASH_INIT, RESULT_CACHE_MAGIC), tool);
+    key->data = NULL;
+    key->len = 0;
+    key->alloc = 0;
+    _key_append(key, tool, strlen(tool) + 1);
+}
+
+void
+result_key_clear(result_key_t key)
+{
+    flint_free(key->data);
+}
+
+void
+result_key_params(result_key_t key, const model_params_t p)
+{
+    const fmpq *x[7];
+    char *s;
+    slong i;
+
+    key->h[0] = model_params_hash(key->h[0], p);
+    key->h[1] = model_params_hash(key->h[1], p);
+
+    x[0] = p->lambda;
+    x[1] = p->mu;
+    x[2] = p->tau;
+    for (i = 0; i < 4; i++)
+    {
+        x[3 + i] = p->pi + i;
+    }
+    for (i = 0; i < 7; i++)
+    {
+        s = fmpq_get_str(NULL, 10, x[i]);
+        _key_append(key, s, strlen(s) + 1);
+        flint_free(s);
+    }
+}
+
+void
+result_key_slong_vec(result_key_t key, const slong *v, slong n)
+{
+    /*
+     * The length and then each value in zigzag base 128, least
+     * significant group first, so a nucleotide takes one byte.
+     */
+    unsigned char *out;
+    ulong u;
+    slong i, size;
+
+    key->h[0] = hash_slong_vec(key->h[0], v, n);
+    key->h[1] = hash_slong_vec(key->h[1], v, n);
+
+    /* count the bytes first, and then write them */
+    size = 0;
+    for (i = -1; i < n; i++)
+    {
+        u = (i < 0) ? (ulong) n : (((ulong) v[i]) << 1) ^ -(ulong) (v[i] < 0);
+        do
+        {
+            size++;
+            u >>= 7;
+        } while (u);
+    }
+    _key_fit(key, size);
+    out = key->data + key->len;
+    for (i = -1; i < n; i++)
+    {
+        u = (i < 0) ? (ulong) n : (((ulong) v[i]) << 1) ^ -(ulong) (v[i] < 0);
+        while (u >> 7)
+        {
+            *out++ = (u & 0x7f) | 0x80;
+            u >>= 7;
+        }
+        *out++ = u;
+    }
+    key->len += size;
+}
+
+void
+result_key_string(result_key_t key, const char *s)
+{
+    key->h[0] = hash_string(key->h[0], s);
+    key->h[1] = hash_string(key->h[1], s);
+    _key_append(key, s, strlen(s) + 1);
+}
+
+
+void
+_path(char *path, const result_cache_t c, const result_key_t key)
+{
+    sprintf(path, "%s/%016llx%016llx", c->dir,
+            (unsigned long long) key->h[0], (unsigned long long) key->h[1]);
+}
+
+int
+_is_temporary_name(const char *name)
+{
+    /* the names made by mkstemp in result_cache_put */
+    return !strncmp(name, "tmp.", 4) && strlen(name) == 10;
+}
+
+int
+_is_result_name(const char *name)
+{
+    /* temporary files and unrelated files are not results */
+    slong i;
+    for (i = 0; i < RESULT_CACHE_NAME_LEN; i++)
+    {
+        if (!((name[i] >= '0' && name[i] <= '9') ||
+              (name[i] >= 'a' && name[i] <= 'f')))
+        {
+            return 0;
+        }
+    }
+    return name[i] == '\0';
+}
+
+int
+_entry_cmp(const void *a, const void *b)
+{
+    /* least recently used first */
+    const result_cache_entry_struct *x = a;
+    const result_cache_entry_struct *y = b;
+    if (x->mtime.tv_sec != y->mtime.tv_sec)
+    {
+        return (x->mtime.tv_sec < y->mtime.tv_sec) ? -1 : 1;
+    }
+    if (x->mtime.tv_nsec != y->mtime.tv_nsec)
+    {
+        return (x->mtime.tv_nsec < y->mtime.tv_nsec) ? -1 : 1;
+    }
+    return strcmp(x->name, y->name);
+}
+
+void
+_scan(result_cache_t c, slong target)
+{
+    /*
+     * Measure the directory, removing the stale temporary files and,
+     * if the results exceed the target size, the least recently used
+     * results until they fit. Another process may be scanning at the
+     * same time, so files that have already been removed are ignored.
+     */
+    result_cache_entry_struct *entries;
+    slong len, alloc, i;
+    struct dirent *d;
+    struct stat st;
+    DIR *dir;
+    char *path;
+    off_t total;
+    time_t now;
+
+    dir = opendir(c->dir);
+    if (!dir)
+    {
+        return;
+    }
+    path = flint_malloc(strlen(c->dir) + 256 + 2);
+    now = time(NULL);
+
+    len = 0;
+    alloc = 0;
+    entries = NULL;
+    total = 0;
+    while ((d = readdir(dir)) != NULL)
+    {
+        if (_is_temporary_name(d->d_name))
+        {
+            sprintf(path, "%s/%s", c->dir, d->d_name);
+            if (!stat(path, &st) &&
+                st.st_mtime + RESULT_CACHE_STALE_SECONDS < now)
+            {
+                unlink(path);
+            }
+            continue;
+        }
+        if (!_is_result_name(d->d_name))
+        {
+            continue;
+        }
+        sprintf(path, "%s/%s", c->dir, d->d_name);
+        if (stat(path, &st))
+        {
+            continue;
+        }
+        if (len == alloc)
+        {
+            alloc = FLINT_MAX(64, 2 * alloc);
+            entries = flint_realloc(entries,
+                    alloc * sizeof(result_cache_entry_struct));
+        }
+        strcpy(entries[len].name, d->d_name);
+        entries[len].size = st.st_size;
+        entries[len].mtime = st.st_mtim;
+        total += st.st_size;
+        len++;
+    }
+    closedir(dir);
+
+    if (total > (off_t) target)
+    {
+        qsort(entries, len, sizeof(result_cache_entry_struct), _entry_cmp);
+        for (i = 0; i < len && total > (off_t) target; i++)
+        {
+            sprintf(path, "%s/%s", c->dir, entries[i].name);
+            unlink(path);
+            total -= entries[i].size;
+        }
+    }
+    __atomic_store_n(&c->size, (slong) total, __ATOMIC_RELAXED);
+
+    flint_free(entries);
+    flint_free(path);
+}
+
+
+int
+result_cache_init(result_cache_t c, const char *dir, slong limit)
+{
+    struct stat st;
+    if (mkdir(dir, 0777) && errno != EEXIST)
+    {
+        fprintf(stderr, "failed to create the cache directory %s\n", dir);
+        return 1;
+    }
+    if (stat(dir, &st) || !S_ISDIR(st.st_mode))
+    {
+        fprintf(stderr, "%s is not a directory\n", dir);
+        return 1;
+    }
+    c->dir = flint_malloc(strlen(dir) + 1);
+    strcpy(c->dir, dir);
+    c->limit = limit;
+    c->size = 0;
+    c->scanning = 0;
+    _scan(c, limit);
+    return 0;
+}
+
+void
+result_cache_clear(result_cache_t c)
+{
+    flint_free(c->dir);
+}
+
+char *
+result_cache_get(result_cache_t c, const result_key_t key, slong *plen)
+{
+    result_cache_header_struct header;
+    char *path, *data;
+    unsigned char *key_data;
+    FILE *fin;
+
+    path = flint_malloc(strlen(c->dir) + RESULT_CACHE_NAME_LEN + 2);
+    _path(path, c, key);
+    fin = fopen(path, "rb");
+    flint_free(path);
+    if (fin == NULL)
+    {
+        return NULL;
+    }
+
+    /*
+     * A file that does not hold the whole result is a miss,
+     * and so is a result of another key with the same hash.
+     */
+    data = NULL;
+    key_data = NULL;
+    if (fread(&header, sizeof(header), 1, fin) == 1 &&
+        !strncmp(header.magic, RESULT_CACHE_MAGIC, sizeof(header.magic)) &&
+        header.version == RESULT_CACHE_VERSION &&
+        header.key[0] == key->h[0] && header.key[1] == key->h[1] &&
+        header.key_len == key->len && header.len >= 0 &&
+        (key_data = flint_malloc(FLINT_MAX(1, key->len))) != NULL &&
+        fread(key_data, 1, key->len, fin) == (size_t) key->len &&
+        !memcmp(key_data, key->data, key->len))
+    {
+        data = flint_malloc(header.len + 1);
+        if (fread(data, 1, header.len, fin) != (size_t) header.len)
+        {
+            flint_free(data);
+            data = NULL;
+        }
+        else
+        {
+            data[header.len] = '\0';
+            *plen = (slong) header.len;
+
+            /* mark the result as recently used */
+            futimens(fileno(fin), NULL);
+        }
+    }
+    flint_free(key_data);
+    fclose(fin);
+    return data;
+}
+
+int
+result_cache_put(result_cache_t c, const result_key_t key,
+        const char *data, slong len)
+{
+    /*
+     * Write the result to a temporary file with a unique name
+     * and then rename it, so that readers never see a partially
+     * written result. Return nonzero on failure.
+     */
+    result_cache_header_struct header;
+    char *path, *tmpname;
+    FILE *fout;
+    int fd, code;
+
+    memset(&header, 0, sizeof(header));
+    strncpy(header.magic, RESULT_CACHE_MAGIC, sizeof(header.magic) - 1);
+    header.version = RESULT_CACHE_VERSION;
+    header.key[0] = key->h[0];
+    header.key[1] = key->h[1];
+    header.key_len = key->len;
+    header.len = len;
+
+    path = flint_malloc(strlen(c->dir) + RESULT_CACHE_NAME_LEN + 2);
+    _path(path, c, key);
+    tmpname = flint_malloc(strlen(c->dir) + 16);
+    sprintf(tmpname, "%s/tmp.XXXXXX", c->dir);
+
+    code = 0;
+    fd = mkstemp(tmpname);
+    fout = (fd < 0) ? NULL : fdopen(fd, "wb");
+    if (fout == NULL)
+    {
+        fprintf(stderr, "failed to create a file in %s\n", c->dir);
+        if (fd >= 0)
+        {
+            close(fd);
+            unlink(tmpname);
+        }
+        flint_free(path);
+        flint_free(tmpname);
+        return 1;
+    }
+    if (fwrite(&header, sizeof(header), 1, fout) != 1 ||
+        fwrite(key->data, 1, key->len, fout) != (size_t) key->len ||
+        (len && fwrite(data, 1, len, fout) != (size_t) len))
+    {
+        code = 1;
+    }
+    if (fclose(fout))
+    {
+        code = 1;
+    }
+    if (code)
+    {
+        fprintf(stderr, "failed to write the cached result %s\n", tmpname);
+        unlink(tmpname);
+    }
+    else if (rename(tmpname, path))
+    {
+        fprintf(stderr, "failed to rename the cached result %s\n", tmpname);
+        unlink(tmpname);
+        code = 1;
+    }
+
+    flint_free(path);
+    flint_free(tmpname);
+
+    /*
+     * Count the new file in the running size estimate, and once the
+     * estimate exceeds the limit let one thread measure the directory
+     * and evict a batch of results, down to a fraction of the limit,
+     * so the directory is not scanned on every write.
+     */
+    if (!code && __atomic_add_fetch(&c->size,
+                (slong) (sizeof(header) + key->len + len),
+                __ATOMIC_RELAXED) > c->limit &&
+        !__atomic_exchange_n(&c->scanning, 1, __ATOMIC_ACQUIRE))
+    {
+        _scan(c, c->limit - c->limit / RESULT_CACHE_EVICT_FRACTION);
+        __atomic_store_n(&c->scanning, 0, __ATOMIC_RELEASE);
+    }
+    return code;
+}
@@ -0,0 +1,92 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+/*
+ * An on-disk cache of the results of the tools, so that reruns of
+ * a pipeline do not repeat the dynamic programming for the requests
+ * that have been answered before.
+ *
+ * A result is stored in its own file in the cache directory, named by
+ * a 128-bit hash of a key that holds the tool, the exact rational
+ * parameters, the encoded sequences and the options that affect the
+ * result. The file also holds the bytes of the key itself, which are
+ * compared on lookup, so two keys with the same hash do not share
+ * a result.
+ * A result is written to a temporary file that is then renamed,
+ * so several processes can share one directory without locking;
+ * a reader sees either a whole result or none. Reading a result
+ * updates the modification time of its file.
+ *
+ * The directory is measured when the cache is opened, and each write
+ * adds to a running estimate of its size. Once the estimate exceeds
+ * the size limit, the directory is measured again and the least
+ * recently used results are removed in one batch, until the results
+ * fit within three quarters of the limit. The writes of the other
+ * processes sharing the directory are only seen by those measurements.
+ * The measurements also remove the temporary files that a writer that
+ * went away left behind, once they are an hour old.
+ */
+
+#include <stdint.h>
+
+#include "flint/flint.h"
+
+#include "model_params.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the hash and the canonical bytes of the key */
+typedef struct
+{
+    uint64_t h[2];
+    unsigned char * data;
+    slong len;
+    slong alloc;
+} result_key_struct;
+typedef result_key_struct result_key_t[1];
+
+void result_key_init(result_key_t key, const char *tool);
+void result_key_clear(result_key_t key);
+void result_key_params(result_key_t key, const model_params_t p);
+void result_key_slong_vec(result_key_t key, const slong *v, slong n);
+void result_key_string(result_key_t key, const char *s);
+
+/* the size is the running estimate, and may be updated by any thread */
+typedef struct
+{
+    char * dir;
+    slong limit;
+    slong size;
+    int scanning;
+} result_cache_struct;
+typedef result_cache_struct result_cache_t[1];
+typedef result_cache_struct * result_cache_ptr;
+
+/*
+ * Use the given directory, creating it if necessary, with a limit
+ * on the total size of the cached results in bytes.
+ * Return nonzero if the directory cannot be used.
+ */
+int result_cache_init(result_cache_t c, const char *dir, slong limit);
+void result_cache_clear(result_cache_t c);
+
+/*
+ * Return the cached result, which must be freed by the caller with
+ * flint_free and is followed by a null byte, or NULL if it is absent.
+ */
+char * result_cache_get(result_cache_t c, const result_key_t key,
+        slong *plen);
+
+/* store a result; return nonzero on failure */
+int result_cache_put(result_cache_t c, const result_key_t key,
+        const char *data, slong len);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -6,223 +6,271 @@
 #include "factor_refine.h"
 #include "expressions.h"
 #include "rgenerators.h"
+#include "hash.h"
 
 
 #define RGEN_STATUS_CLOSED 0
 #define RGEN_STATUS_OPEN 1
 #define RGEN_STATUS_FINALIZED 2
 
+#define RGEN_TERM_FMPQ 0
+#define RGEN_TERM_EXPR 1
 
 
-typedef struct rgen_fmpq_node_struct
-{
-    fmpq_t value;
-    fmpz_t count;
-    struct rgen_fmpq_node_struct * next;
-} rgen_fmpq_node_struct;
-typedef rgen_fmpq_node_struct * rgen_fmpq_node_ptr;
-typedef rgen_fmpq_node_struct rgen_fmpq_node_t[1];
-
-void rgen_fmpq_node_init(rgen_fmpq_node_t p);
-void rgen_fmpq_node_clear(rgen_fmpq_node_t p);
-
-
-typedef struct rgen_expr_node_struct
-{
-    expr_ptr p;
-    fmpz_t count;
-    struct rgen_expr_node_struct * next;
-} rgen_expr_node_struct;
-typedef rgen_expr_node_struct * rgen_expr_node_ptr;
-typedef rgen_expr_node_struct rgen_expr_node_t[1];
-
-void rgen_expr_node_init(rgen_expr_node_t p);
-void rgen_expr_node_clear(rgen_expr_node_t p);
-
-
-typedef struct rgen_reg_node_struct
-{
-    rgen_fmpq_node_ptr p_fmpq_head, p_fmpq_tail;
-    rgen_expr_node_ptr p_expr_head, p_expr_tail;
-    struct rgen_reg_node_struct * next;
-} rgen_reg_node_struct;
-typedef rgen_reg_node_struct * rgen_reg_node_ptr;
-typedef rgen_reg_node_struct rgen_reg_node_t[1];
-
-void rgen_reg_node_init(rgen_reg_node_t p);
-void rgen_reg_node_clear(rgen_reg_node_t p);
-void rgen_reg_node_add_fmpq(rgen_reg_node_ptr p, fmpq_t value, slong count);
-void rgen_reg_node_add_expr(rgen_reg_node_ptr p, expr_ptr expr, slong count);
-
-
+/*
+ * Each generator is a sparse row of counts, keyed either by
+ * a rational value or by a registered expression.
+ * The rational values are interned, so each distinct value
+ * is factored only once, and the terms of all of the generators
+ * are kept in a single array.  Open addressing tables map values
+ * and (generator, kind, key) triples to their array indices,
+ * so that repeated additions are merged in constant time.
+ * Each slot holds an array index, or -1 if the slot is empty.
+ */
 typedef struct
 {
-    fmpz_factor_t fac;
-    expr_ptr * base_expressions;
-} rgen_reg_refinement_struct;
-typedef rgen_reg_refinement_struct rgen_reg_refinement_t[1];
-typedef rgen_reg_refinement_struct * rgen_reg_refinement_ptr;
-
-void rgen_reg_refinement_init(rgen_reg_refinement_t p);
-void rgen_reg_refinement_clear(rgen_reg_refinement_t p);
+    slong row;
+    int kind;
+    slong key;
+    fmpz_t count;
+} rgen_term_struct;
 
 
 typedef struct rgen_reg_struct_tag
 {
     int status;
-    rgen_reg_node_ptr head;
-    rgen_reg_node_ptr tail;
     slong size;
-    rgen_reg_refinement_ptr refinement;
+
+    /* interned rational values */
+    fmpq * values;
+    slong nvalues;
+    slong values_alloc;
+    slong * value_slots;
+    slong nvalue_slots;
+
+    /* merged terms of all of the generators */
+    rgen_term_struct * terms;
+    slong nterms;
+    slong terms_alloc;
+    slong * term_slots;
+    slong nterm_slots;
+
+    /* the finalized matrix, restricted to its nonzero columns */
     reg_ptr reg;
+    fmpz_mat_t mat;
+    expr_ptr * columns;
+    slong ncols;
 } rgen_reg_struct;
 
 void rgen_reg_assert_status(rgen_reg_ptr g, int status);
 
+static uint64_t _term_hash(slong row, int kind, slong key);
+static slong * _slots_new(slong n);
+static void _rehash_values(rgen_reg_ptr g);
+static void _rehash_terms(rgen_reg_ptr g);
+static slong _intern_value(rgen_reg_ptr g, const fmpq_t value);
+static void _add_term(rgen_reg_ptr g, int kind, slong key, slong count);
+static void _value_exponents(fmpz_mat_t E, slong row,
+        const fmpq_t value, const fmpz_factor_t fac);
 
 
 
 
-
-void
-rgen_fmpq_node_init(rgen_fmpq_node_t p)
+uint64_t
+_term_hash(slong row, int kind, slong key)
 {
-    fmpq_init(p->value);
-    fmpz_init(p->count);
-    p->next = NULL;
+    uint64_t h = HASH_INIT;
+    h = hash_bytes(h, &row, sizeof(row));
+    h = hash_bytes(h, &kind, sizeof(kind));
+    h = hash_bytes(h, &key, sizeof(key));
+    return h;
 }
 
-void
-rgen_fmpq_node_clear(rgen_fmpq_node_t p)
+slong *
+_slots_new(slong n)
 {
-    fmpq_clear(p->value);
-    fmpz_clear(p->count);
-    p->next = NULL;
+    slong i;
+    slong * slots = flint_malloc(n * sizeof(slong));
+    for (i = 0; i < n; i++)
+    {
+        slots[i] = -1;
+    }
+    return slots;
 }
 
 void
-rgen_expr_node_init(rgen_expr_node_t p)
+_rehash_values(rgen_reg_ptr g)
 {
-    p->p = NULL;
-    fmpz_init(p->count);
-    p->next = NULL;
+    slong i, j;
+    flint_free(g->value_slots);
+    g->nvalue_slots = FLINT_MAX(16, 2 * g->nvalue_slots);
+    g->value_slots = _slots_new(g->nvalue_slots);
+    for (i = 0; i < g->nvalues; i++)
+    {
+        j = (slong) (hash_fmpq(HASH_INIT, g->values + i) %
+                (uint64_t) g->nvalue_slots);
+        while (g->value_slots[j] >= 0)
+        {
+            j = (j + 1) % g->nvalue_slots;
+        }
+        g->value_slots[j] = i;
+    }
 }
 
 void
-rgen_expr_node_clear(rgen_expr_node_t p)
+_rehash_terms(rgen_reg_ptr g)
 {
-    p->p = NULL;
-    fmpz_clear(p->count);
-    p->next = NULL;
+    slong i, j;
+    rgen_term_struct * t;
+    flint_free(g->term_slots);
+    g->nterm_slots = FLINT_MAX(16, 2 * g->nterm_slots);
+    g->term_slots = _slots_new(g->nterm_slots);
+    for (i = 0; i < g->nterms; i++)
+    {
+        t = g->terms + i;
+        j = (slong) (_term_hash(t->row, t->kind, t->key) %
+                (uint64_t) g->nterm_slots);
+        while (g->term_slots[j] >= 0)
+        {
+            j = (j + 1) % g->nterm_slots;
+        }
+        g->term_slots[j] = i;
+    }
 }
 
-
-
-
-void
-rgen_reg_node_add_fmpq(rgen_reg_node_ptr p, fmpq_t value, slong count)
+slong
+_intern_value(rgen_reg_ptr g, const fmpq_t value)
 {
-    rgen_fmpq_node_ptr node;
-    node = flint_malloc(sizeof(rgen_fmpq_node_struct));
-    rgen_fmpq_node_init(node);
-    fmpq_set(node->value, value);
-    fmpz_set_si(node->count, count);
+    slong i, j;
+
+    if (2 * (g->nvalues + 1) > g->nvalue_slots)
+    {
+        _rehash_values(g);
+    }
 
-    if (p->p_fmpq_head)
+    j = (slong) (hash_fmpq(HASH_INIT, value) % (uint64_t) g->nvalue_slots);
+    while ((i = g->value_slots[j]) >= 0)
     {
-        p->p_fmpq_tail->next = node;
-        p->p_fmpq_tail = node;
+        if (fmpq_equal(g->values + i, value))
+        {
+            return i;
+        }
+        j = (j + 1) % g->nvalue_slots;
     }
-    else
+
+    if (g->nvalues == g->values_alloc)
     {
-        p->p_fmpq_head = node;
-        p->p_fmpq_tail = node;
+        slong k;
+        g->values_alloc = FLINT_MAX(16, 2 * g->values_alloc);
+        g->values = flint_realloc(g->values, g->values_alloc * sizeof(fmpq));
+        for (k = g->nvalues; k < g->values_alloc; k++)
+        {
+            fmpq_init(g->values + k);
+        }
     }
+    i = g->nvalues;
+    fmpq_set(g->values + i, value);
+    g->nvalues++;
+    g->value_slots[j] = i;
+    return i;
 }
 
 void
-rgen_reg_node_add_expr(rgen_reg_node_ptr p, expr_ptr expr, slong count)
+_add_term(rgen_reg_ptr g, int kind, slong key, slong count)
 {
-    rgen_expr_node_ptr node;
-    node = flint_malloc(sizeof(rgen_expr_node_struct));
-    rgen_expr_node_init(node);
-    node->p = expr;
-    fmpz_set_si(node->count, count);
+    slong i, j, row;
+    rgen_term_struct * t;
 
-    if (p->p_expr_head)
+    if (2 * (g->nterms + 1) > g->nterm_slots)
     {
-        p->p_expr_tail->next = node;
-        p->p_expr_tail = node;
+        _rehash_terms(g);
+    }
+
+    /* the terms are added to the generator that is currently open */
+    row = g->size - 1;
+
+    j = (slong) (_term_hash(row, kind, key) % (uint64_t) g->nterm_slots);
+    while ((i = g->term_slots[j]) >= 0)
+    {
+        t = g->terms + i;
+        if (t->row == row && t->kind == kind && t->key == key)
+        {
+            if (count < 0)
+            {
+                fmpz_sub_ui(t->count, t->count, -count);
+            }
+            else
+            {
+                fmpz_add_ui(t->count, t->count, count);
+            }
+            return;
+        }
+        j = (j + 1) % g->nterm_slots;
     }
-    else
+
+    if (g->nterms == g->terms_alloc)
     {
-        p->p_expr_head = node;
-        p->p_expr_tail = node;
+        g->terms_alloc = FLINT_MAX(16, 2 * g->terms_alloc);
+        g->terms = flint_realloc(g->terms,
+                g->terms_alloc * sizeof(rgen_term_struct));
     }
+    i = g->nterms;
+    t = g->terms + i;
+    t->row = row;
+    t->kind = kind;
+    t->key = key;
+    fmpz_init(t->count);
+    fmpz_set_si(t->count, count);
+    g->nterms++;
+    g->term_slots[j] = i;
 }
 
 void
-rgen_reg_node_init(rgen_reg_node_t p)
+_value_exponents(fmpz_mat_t E, slong row,
+        const fmpq_t value, const fmpz_factor_t fac)
 {
-    p->p_fmpq_head = NULL;
-    p->p_fmpq_tail = NULL;
-    p->p_expr_head = NULL;
-    p->p_expr_tail = NULL;
-    p->next = NULL;
-}
+    /* the exponent of each refined factor in the rational value */
+    slong i;
+    fmpz * e;
+    fmpz_t x;
 
-void
-rgen_reg_node_clear(rgen_reg_node_t p)
-{
-    /* clear and delete all of the fmpq nodes */
+    fmpz_init(x);
+
+    fmpz_set(x, fmpq_numref(value));
+    for (i = 0; i < fac->num; i++)
     {
-        rgen_fmpq_node_ptr node, next;
-        node = p->p_fmpq_head;
-        while(node)
+        while (fmpz_divisible(x, fac->p+i))
         {
-            next = node->next;
-            rgen_fmpq_node_clear(node);
-            flint_free(node);
-            node = next;
+            e = fmpz_mat_entry(E, row, i);
+            fmpz_add_ui(e, e, 1);
+            fmpz_divexact(x, x, fac->p+i);
         }
     }
+    if (!fmpz_is_one(x))
+    {
+        flint_printf("numerator could not be reduced\n");
+        abort();
+    }
 
-    /* clear and delete all of the expr nodes */
+    fmpz_set(x, fmpq_denref(value));
+    for (i = 0; i < fac->num; i++)
     {
-        rgen_expr_node_ptr node, next;
-        node = p->p_expr_head;
-        while(node)
+        while (fmpz_divisible(x, fac->p+i))
         {
-            next = node->next;
-            rgen_expr_node_clear(node);
-            flint_free(node);
-            node = next;
+            e = fmpz_mat_entry(E, row, i);
+            fmpz_sub_ui(e, e, 1);
+            fmpz_divexact(x, x, fac->p+i);
         }
     }
+    if (!fmpz_is_one(x))
+    {
+        flint_printf("denominator could not be reduced\n");
+        abort();
+    }
 
-    p->p_fmpq_head = NULL;
-    p->p_fmpq_tail = NULL;
-    p->p_expr_head = NULL;
-    p->p_expr_tail = NULL;
-    p->next = NULL;
-}
-
-
-
-void
-rgen_reg_refinement_init(rgen_reg_refinement_t p)
-{
-    fmpz_factor_init(p->fac);
-    p->base_expressions = NULL;
+    fmpz_clear(x);
 }
 
-void
-rgen_reg_refinement_clear(rgen_reg_refinement_t p)
-{
-    fmpz_factor_clear(p->fac);
-    free(p->base_expressions);
-    p->base_expressions = NULL;
-}
 
 
 
@@ -241,11 +289,20 @@ rgen_reg_new()
     rgen_reg_ptr g;
     g = flint_malloc(sizeof(rgen_reg_struct));
     g->status = RGEN_STATUS_CLOSED;
-    g->head = NULL;
-    g->tail = NULL;
     g->size = 0;
-    g->refinement = NULL;
+    g->values = NULL;
+    g->nvalues = 0;
+    g->values_alloc = 0;
+    g->value_slots = NULL;
+    g->nvalue_slots = 0;
+    g->terms = NULL;
+    g->nterms = 0;
+    g->terms_alloc = 0;
+    g->term_slots = NULL;
+    g->nterm_slots = 0;
     g->reg = NULL;
+    g->columns = NULL;
+    g->ncols = 0;
     return g;
 }
 
@@ -253,38 +310,23 @@ rgen_reg_new()
 void rgen_open(rgen_reg_ptr g, slong *pidx)
 {
     rgen_reg_assert_status(g, RGEN_STATUS_CLOSED);
-
     *pidx = g->size;
-
-    rgen_reg_node_ptr node;
-    node = flint_malloc(sizeof(rgen_reg_node_struct));
-    rgen_reg_node_init(node);
-
-    if (g->head)
-    {
-        g->tail->next = node;
-        g->tail = node;
-    }
-    else
-    {
-        g->head = node;
-        g->tail = node;
-    }
-
     g->size += 1;
     g->status = RGEN_STATUS_OPEN;
 }
 
 void rgen_add_expr(rgen_reg_ptr g, expr_ptr expr, slong count)
 {
+    reg_node_ptr r;
     rgen_reg_assert_status(g, RGEN_STATUS_OPEN);
-    rgen_reg_node_add_expr(g->tail, expr, count);
+    r = expr->userdata;
+    _add_term(g, RGEN_TERM_EXPR, r->index, count);
 }
 
 void rgen_add_fmpq(rgen_reg_ptr g, fmpq_t value, slong count)
 {
     rgen_reg_assert_status(g, RGEN_STATUS_OPEN);
-    rgen_reg_node_add_fmpq(g->tail, value, count);
+    _add_term(g, RGEN_TERM_FMPQ, _intern_value(g, value), count);
 }
 
 void
@@ -298,71 +340,128 @@ rgen_close(rgen_reg_ptr g)
 void
 rgen_reg_finalize(rgen_reg_ptr g, reg_ptr reg)
 {
+    slong i, j, col;
+    fmpz_factor_t unrefined, fac;
+    fmpz_mat_t E, M;
+    expr_ptr * base_expressions;
+    expr_ptr * table;
+    slong * base_columns;
+    slong * column_map;
+    rgen_term_struct * t;
+
     rgen_reg_assert_status(g, RGEN_STATUS_CLOSED);
 
     g->reg = reg;
-    g->refinement = flint_malloc(sizeof(rgen_reg_struct));
-    rgen_reg_refinement_init(g->refinement);
-
-    int i;
-    rgen_reg_node_ptr gnode;
-    rgen_fmpq_node_ptr fnode;
 
     /*
-     * Allocate the fmpz vector as input for factor refinement.
-     * This will have twice the total number of fmpq nodes;
-     * it has an entry for each numerator and each denominator.
+     * The input for factor refinement has an entry for the numerator
+     * and the denominator of each distinct rational value.
      * Semantically, the input for factor refinement will be treated
      * as a set, so there is no need to preserve any kind of ordering.
      */
-    fmpz_factor_t unrefined;
     fmpz_factor_init(unrefined);
     unrefined->sign = 1;
+    for (i = 0; i < g->nvalues; i++)
+    {
+        _fmpz_factor_append(unrefined, fmpq_numref(g->values + i), 1);
+        _fmpz_factor_append(unrefined, fmpq_denref(g->values + i), 1);
+    }
+    fmpz_factor_init(fac);
+    fmpz_factor_refine(fac, unrefined);
+    fmpz_factor_clear(unrefined);
 
     /*
-     * Fill the fmpz vector by digging through the layers of node links
-     * and scavenging the numerators and denominators.
+     * Register the refined factors as expressions.
+     * The registry is hash-consed, so a factor that is already
+     * registered as an integer expression shares its column.
      */
-    for (gnode = g->head; gnode; gnode = gnode->next)
+    base_expressions = flint_malloc(FLINT_MAX(1, fac->num) * sizeof(expr_ptr));
+    base_columns = flint_malloc(FLINT_MAX(1, fac->num) * sizeof(slong));
+    for (i = 0; i < fac->num; i++)
     {
-        for (fnode = gnode->p_fmpq_head; fnode; fnode = fnode->next)
-        {
-            _fmpz_factor_append(unrefined, fmpq_numref(fnode->value), 1);
-            _fmpz_factor_append(unrefined, fmpq_denref(fnode->value), 1);
-        }
+        reg_node_ptr r;
+        base_expressions[i] = reg_fmpz(reg, fac->p+i);
+        r = base_expressions[i]->userdata;
+        base_columns[i] = r->index;
     }
 
-    /*
-    flint_printf("before refinement:\n");
-    fmpz_factor_print(unrefined);
-    flint_printf("\n");
-    */
-
-    fmpz_factor_refine(g->refinement->fac, unrefined);
-    fmpz_factor_clear(unrefined);
+    /* factor each distinct rational value only once */
+    fmpz_mat_init(E, g->nvalues, fac->num);
+    for (i = 0; i < g->nvalues; i++)
+    {
+        _value_exponents(E, i, g->values + i, fac);
+    }
 
-    /*
-    flint_printf("after refinement:\n");
-    fmpz_factor_print(g->refinement->fac);
-    flint_printf("\n");
-    */
+    /* the matrix with a column for every registered expression */
+    fmpz_mat_init(M, g->size, reg->size);
+    for (i = 0; i < g->nterms; i++)
+    {
+        t = g->terms + i;
+        if (t->kind == RGEN_TERM_EXPR)
+        {
+            fmpz * entry = fmpz_mat_entry(M, t->row, t->key);
+            fmpz_add(entry, entry, t->count);
+        }
+        else
+        {
+            for (j = 0; j < fac->num; j++)
+            {
+                const fmpz * e = fmpz_mat_entry(E, t->key, j);
+                if (!fmpz_is_zero(e))
+                {
+                    fmpz * entry = fmpz_mat_entry(M, t->row, base_columns[j]);
+                    fmpz_addmul(entry, e, t->count);
+                }
+            }
+        }
+    }
 
     /*
-     * Create an array of uninitialized expression pointers
-     * which will eventually hold the registered refined factor expressions.
+     * Keep only the columns that are used by some generator.
+     * The other registered expressions are intermediate values
+     * or constants that were refined into other factors,
+     * and the downstream linear algebra does not need them.
      */
-    g->refinement->base_expressions = flint_malloc(
-            g->refinement->fac->num * sizeof(expr_ptr));
+    column_map = flint_malloc(FLINT_MAX(1, reg->size) * sizeof(slong));
+    g->ncols = 0;
+    for (j = 0; j < reg->size; j++)
+    {
+        column_map[j] = -1;
+        for (i = 0; i < g->size; i++)
+        {
+            if (!fmpz_is_zero(fmpz_mat_entry(M, i, j)))
+            {
+                column_map[j] = g->ncols++;
+                break;
+            }
+        }
+    }
 
-    /* Register the refined factors as new expressions. */
-    expr_ptr expr;
-    for (i = 0; i < g->refinement->fac->num; i++)
+    table = reg_vec(reg);
+    g->columns = flint_malloc(FLINT_MAX(1, g->ncols) * sizeof(expr_ptr));
+    fmpz_mat_init(g->mat, g->size, g->ncols);
+    for (j = 0; j < reg->size; j++)
     {
-        expr = reg_new(reg);
-        expr_fmpz(expr, g->refinement->fac->p+i);
-        g->refinement->base_expressions[i] = expr;
+        col = column_map[j];
+        if (col >= 0)
+        {
+            g->columns[col] = table[j];
+            for (i = 0; i < g->size; i++)
+            {
+                fmpz_set(fmpz_mat_entry(g->mat, i, col),
+                         fmpz_mat_entry(M, i, j));
+            }
+        }
     }
 
+    flint_free(table);
+    flint_free(column_map);
+    flint_free(base_columns);
+    flint_free(base_expressions);
+    fmpz_mat_clear(M);
+    fmpz_mat_clear(E);
+    fmpz_factor_clear(fac);
+
     g->status = RGEN_STATUS_FINALIZED;
 }
 
@@ -377,7 +476,7 @@ slong
 rgen_reg_ncols(rgen_reg_ptr g)
 {
     rgen_reg_assert_status(g, RGEN_STATUS_FINALIZED);
-    return g->reg->size;
+    return g->ncols;
 }
 
 
@@ -393,107 +492,42 @@ rgen_reg_get_matrix(fmpz_mat_t mat, rgen_reg_ptr g)
         abort();
     }
 
-    fmpz_mat_zero(mat);
+    fmpz_mat_set(mat, g->mat);
+}
 
-    slong row, col;
-    rgen_reg_node_ptr gnode;
-    fmpz * entry;
-    reg_node_ptr r;
-    
-    /*
-     * Add entries that correspond to expressions
-     * that are not associated with factor refinements of rational numbers.
-     */
-    rgen_expr_node_ptr enode;
-    row = 0;
-    for (gnode = g->head; gnode; gnode = gnode->next)
+void
+rgen_reg_get_expressions(expr_ptr * table, rgen_reg_ptr g)
+{
+    slong j;
+    rgen_reg_assert_status(g, RGEN_STATUS_FINALIZED);
+    for (j = 0; j < g->ncols; j++)
     {
-        for (enode = gnode->p_expr_head; enode; enode = enode->next)
-        {
-            r = enode->p->userdata;
-            col = r->index;
-            entry = fmpz_mat_entry(mat, row, col);
-            fmpz_add(entry, entry, enode->count);
-        }
-        row++;
+        table[j] = g->columns[j];
     }
-
-    /*
-     * Add entries using the generator registry,
-     * the expressions registry, the vector of refined factors,
-     * and the vector giving the expressions corresponding to those factors.
-     */
-    rgen_fmpq_node_ptr fnode;
-    int i;
-    fmpz_t x;
-    fmpz_init(x);
-    row = 0;
-    for (gnode = g->head; gnode; gnode = gnode->next)
-    {
-        for (fnode = gnode->p_fmpq_head; fnode; fnode = fnode->next)
-        {
-            /* numerator */
-            fmpz_set(x, fmpq_numref(fnode->value));
-            for (i = 0; i < g->refinement->fac->num; i++)
-            {
-                while (fmpz_divisible(x, g->refinement->fac->p+i))
-                {
-                    r = g->refinement->base_expressions[i]->userdata;
-                    col = r->index;
-                    entry = fmpz_mat_entry(mat, row, col);
-                    fmpz_add(entry, entry, fnode->count);
-                    fmpz_divexact(x, x, g->refinement->fac->p+i);
-                }
-            }
-            if (!fmpz_is_one(x))
-            {
-                flint_printf("numerator could not be reduced\n");
-                abort();
-            }
-
-            /* denominator */
-            fmpz_set(x, fmpq_denref(fnode->value));
-            for (i = 0; i < g->refinement->fac->num; i++)
-            {
-                while (fmpz_divisible(x, g->refinement->fac->p+i))
-                {
-                    r = g->refinement->base_expressions[i]->userdata;
-                    col = r->index;
-                    entry = fmpz_mat_entry(mat, row, col);
-                    fmpz_sub(entry, entry, fnode->count);
-                    fmpz_divexact(x, x, g->refinement->fac->p+i);
-                }
-            }
-            if (!fmpz_is_one(x))
-            {
-                flint_printf("denominator could not be reduced\n");
-                abort();
-            }
-        }
-        row++;
-    }
-    fmpz_clear(x);
 }
 
 void
 rgen_reg_clear(rgen_reg_ptr g)
 {
+    slong i;
+
     rgen_reg_assert_status(g, RGEN_STATUS_FINALIZED);
 
-    /* clear and delete all of the nodes in the registry */
-    rgen_reg_node_ptr node, next;
-    node = g->head;
-    while(node)
+    for (i = 0; i < g->values_alloc; i++)
+    {
+        fmpq_clear(g->values + i);
+    }
+    for (i = 0; i < g->nterms; i++)
     {
-        next = node->next;
-        rgen_reg_node_clear(node);
-        flint_free(node);
-        node = next;
+        fmpz_clear(g->terms[i].count);
     }
+    flint_free(g->values);
+    flint_free(g->value_slots);
+    flint_free(g->terms);
+    flint_free(g->term_slots);
 
-    /* clear the refinement */
-    rgen_reg_refinement_clear(g->refinement);
-    flint_free(g->refinement);
+    fmpz_mat_clear(g->mat);
+    flint_free(g->columns);
 
     flint_free(g);
 }
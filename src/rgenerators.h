@@ -27,6 +27,7 @@ void rgen_reg_finalize(rgen_reg_ptr g, reg_ptr reg);
 slong rgen_reg_nrows(rgen_reg_ptr g);
 slong rgen_reg_ncols(rgen_reg_ptr g);
 void rgen_reg_get_matrix(fmpz_mat_t mat, rgen_reg_ptr g);
+void rgen_reg_get_expressions(expr_ptr * table, rgen_reg_ptr g);
 void rgen_reg_clear(rgen_reg_ptr g);
 
 
@@ -1,8 +1,12 @@
 #include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
 
 #include "jansson.h"
 
 #include "runjson.h"
+#include "channel.h"
 
 
 char *jsonwrap(void *userdata, const char *s_in);
@@ -75,35 +79,36 @@ char *fgets_dynamic(FILE *stream);
 
 /*
  * Reads unlimited input into a string that must be freed by the caller.
- * This is just a utility function.
+ * This is just a utility function. The input is read in blocks that
+ * fill the doubling buffer, so it is not scanned for its length.
  */
 char *fgets_dynamic(FILE *stream)
 {
-  int size = 0;
-  int capacity = 20;
-  char *s = calloc(capacity, sizeof(*s));
-  char *tail = s;
+  size_t size = 0;
+  size_t capacity = 1 << 16;
+  size_t n;
+  char *s = malloc(capacity);
 
   /* keep reading from the command line until EOF */
-  while (fgets(tail, capacity - size, stream)) {
-    /* fprintf(stderr, "debug: {size: %d, capacity: %d}\n", size, capacity);
-     */
-    size += strlen(tail);
-    if (size == capacity-1) {
+  while (s && (n = fread(s + size, 1, capacity - size - 1, stream)) > 0) {
+    size += n;
+    if (size == capacity - 1) {
       capacity <<= 1;
-      s = realloc(s, capacity * sizeof(*s));
+      s = realloc(s, capacity);
       if (!s) {
         fprintf(
             stderr,
-            "error: fgets_dynamic: failed to reallocate %d\n",
+            "error: fgets_dynamic: failed to reallocate %zu\n",
             capacity);
         return 0;
       }
     }
-    tail = s + size;
   }
 
   /* return the newly allocated and filled string */
+  if (s) {
+    s[size] = '\0';
+  }
   return s;
 }
 
@@ -148,11 +153,539 @@ run_string_script(string_hom_t hom)
 }
 
 
+json_t *
+json_error_response(const char *fmt, ...)
+{
+    char msg[1024];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(msg, sizeof(msg), fmt, ap);
+    va_end(ap);
+    return json_pack("{s:s}", "error", msg);
+}
+
+const char *
+json_error_message(const json_t *response)
+{
+    json_t *error = json_object_get(response, "error");
+    return json_is_string(error) ? json_string_value(error) : NULL;
+}
+
+
 int
 run_json_script(json_hom_t hom)
 {
-    string_hom_ptr p = json_induced_string_hom(hom);
-    int result = run_string_script(p);
-    free(p);
+    json_error_t error;
+    json_t *j_in;
+    json_t *j_out;
+    char *s_in;
+    char *s_out;
+    const char *msg;
+    int result;
+
+    s_in = fgets_dynamic(stdin);
+    if (!s_in)
+    {
+        fprintf(stderr, "error: failed to read string from stdin\n");
+        return -1;
+    }
+    j_in = json_loads(s_in, 0, &error);
+    free(s_in);
+    if (!j_in)
+    {
+        fprintf(stderr, "json error: on json line %d: %s\n",
+                error.line, error.text);
+        return -1;
+    }
+
+    /* an error response is reported like a failed command */
+    result = 0;
+    j_out = hom->f(hom->userdata, j_in);
+    msg = json_error_message(j_out);
+    if (msg)
+    {
+        fprintf(stderr, "error: %s\n", msg);
+        result = -1;
+    }
+    else if (j_out)
+    {
+        s_out = json_dumps(j_out, 0);
+        if (!s_out)
+        {
+            fprintf(stderr, "error: failed to dump ");
+            fprintf(stderr, "the json object to a string\n");
+            result = -1;
+        }
+        else
+        {
+            puts(s_out);
+            free(s_out);
+        }
+    }
+    json_decref(j_in);
+    json_decref(j_out);
     return result;
 }
+
+
+static char *_jsonl_error(const char *msg);
+static ssize_t _jsonl_getline(char **line, size_t *capacity, FILE *stream);
+
+char *
+_jsonl_error(const char *msg)
+{
+    json_t *j;
+    char *s;
+    j = json_error_response("%s", msg);
+    s = json_dumps(j, JSON_COMPACT);
+    json_decref(j);
+    return s;
+}
+
+/*
+ * Reads the next nonempty line without its trailing whitespace,
+ * returning its length, or -1 at the end of the stream.
+ */
+ssize_t
+_jsonl_getline(char **line, size_t *capacity, FILE *stream)
+{
+    ssize_t len;
+    char *s;
+    while ((len = getline(line, capacity, stream)) != -1)
+    {
+        s = *line;
+        while (len > 0 && (s[len-1] == '\n' || s[len-1] == '\r' ||
+                           s[len-1] == ' ' || s[len-1] == '\t'))
+        {
+            s[--len] = '\0';
+        }
+        if (len)
+        {
+            return len;
+        }
+    }
+    return -1;
+}
+
+int
+run_json_lines(json_hom_t hom)
+{
+    char *line = NULL;
+    size_t capacity = 0;
+    json_error_t error;
+    json_t *j_in;
+    json_t *j_out;
+    char *s_out;
+
+    /* read one request per line so that responses stream as they finish */
+    while (_jsonl_getline(&line, &capacity, stdin) != -1)
+    {
+        j_in = json_loads(line, 0, &error);
+        if (!j_in)
+        {
+            s_out = _jsonl_error(error.text);
+        }
+        else
+        {
+            j_out = hom->f(hom->userdata, j_in);
+            if (j_out)
+            {
+                s_out = json_dumps(j_out, JSON_COMPACT);
+            }
+            else
+            {
+                s_out = _jsonl_error("failed to get json object output");
+            }
+            json_decref(j_in);
+            json_decref(j_out);
+        }
+
+        if (!s_out)
+        {
+            fprintf(stderr, "error: failed to dump ");
+            fprintf(stderr, "the json object to a string\n");
+            free(line);
+            return -1;
+        }
+        puts(s_out);
+        fflush(stdout);
+        free(s_out);
+    }
+
+    free(line);
+    return 0;
+}
+
+
+/*
+ * The batch of json lines. An input line that could not be parsed
+ * has a NULL request and keeps its parser error message.
+ */
+typedef struct
+{
+    json_hom_ptr hom;
+    json_t **requests;
+    char **errors;
+    json_t **responses;
+    int failed;
+} json_batch_struct;
+
+static json_t * _json_batch_respond(json_hom_ptr hom,
+        json_t *request, const char *error, slong index, slong worker);
+static void _json_batch_task(void *userdata, slong index, slong worker);
+static void _json_batch_emit(void *userdata, slong index);
+
+/*
+ * The response to one line of a batch, or the error response
+ * if the line could not be parsed, with its "batch" member.
+ */
+json_t *
+_json_batch_respond(json_hom_ptr hom,
+        json_t *request, const char *error, slong index, slong worker)
+{
+    json_t *j_out;
+    struct timespec start, finish;
+    double seconds;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (request)
+    {
+        j_out = hom->f(hom->userdata, request);
+        if (!j_out)
+        {
+            j_out = json_pack("{s:s}",
+                    "error", "failed to get json object output");
+        }
+    }
+    else
+    {
+        j_out = json_pack("{s:s}", "error", error);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+    seconds = (finish.tv_sec - start.tv_sec) +
+        1e-9 * (finish.tv_nsec - start.tv_nsec);
+
+    /* the index identifies the request when responses are out of order */
+    json_object_set_new(j_out, "batch", json_pack("{s:I, s:I, s:f}",
+                "index", (json_int_t) index,
+                "worker", (json_int_t) worker,
+                "seconds", seconds));
+    return j_out;
+}
+
+void
+_json_batch_task(void *userdata, slong index, slong worker)
+{
+    json_batch_struct *b = userdata;
+    b->responses[index] = _json_batch_respond(b->hom,
+            b->requests[index], b->errors[index], index, worker);
+}
+
+void
+_json_batch_emit(void *userdata, slong index)
+{
+    json_batch_struct *b = userdata;
+    char *s_out;
+
+    s_out = json_dumps(b->responses[index], JSON_COMPACT);
+    if (s_out)
+    {
+        puts(s_out);
+        fflush(stdout);
+        free(s_out);
+    }
+    else
+    {
+        b->failed = 1;
+    }
+    json_decref(b->responses[index]);
+    json_decref(b->requests[index]);
+    free(b->errors[index]);
+    b->responses[index] = NULL;
+    b->requests[index] = NULL;
+    b->errors[index] = NULL;
+}
+
+int
+run_json_batch(json_hom_t hom, json_cost_fn_t cost,
+        slong nthreads, int order)
+{
+    json_batch_struct b[1];
+    char *line = NULL;
+    size_t capacity = 0;
+    json_error_t error;
+    double *costs;
+    slong i, n, alloc;
+
+    /* read the whole batch, so that the largest requests can go first */
+    n = 0;
+    alloc = 0;
+    b->requests = NULL;
+    b->errors = NULL;
+    while (_jsonl_getline(&line, &capacity, stdin) != -1)
+    {
+        if (n == alloc)
+        {
+            alloc = FLINT_MAX(16, 2 * alloc);
+            b->requests = realloc(b->requests, alloc * sizeof(json_t *));
+            b->errors = realloc(b->errors, alloc * sizeof(char *));
+        }
+        b->requests[n] = json_loads(line, 0, &error);
+        b->errors[n] = b->requests[n] ? NULL : strdup(error.text);
+        n++;
+    }
+    free(line);
+
+    costs = malloc(FLINT_MAX(1, n) * sizeof(double));
+    for (i = 0; i < n; i++)
+    {
+        costs[i] = b->requests[i] ? cost(b->requests[i]) : 0;
+    }
+
+    b->hom = hom;
+    b->responses = calloc(FLINT_MAX(1, n), sizeof(json_t *));
+    b->failed = 0;
+    batch_run(n, costs, nthreads, order,
+            _json_batch_task, _json_batch_emit, b);
+
+    free(costs);
+    free(b->requests);
+    free(b->errors);
+    free(b->responses);
+
+    if (b->failed)
+    {
+        fprintf(stderr, "error: failed to dump ");
+        fprintf(stderr, "the json object to a string\n");
+        return -1;
+    }
+    return 0;
+}
+
+
+/*
+ * A line of the pipeline. The reader parses the line, a solver
+ * replaces the request by the response, and the writer writes
+ * the response and frees the item.
+ */
+typedef struct
+{
+    slong index;
+    json_t *request;
+    char *error;
+    json_t *response;
+} json_pipeline_item_struct;
+
+/*
+ * The reader is the calling thread. The lock guards the number of
+ * lines written, so that the reader waits while the window of lines
+ * that have been read but not yet written is full; in the input order
+ * the writer keeps the lines that are finished early in the window.
+ */
+typedef struct
+{
+    json_hom_ptr hom;
+    int order;
+    channel_t requests;
+    channel_t responses;
+    json_pipeline_item_struct **window;
+    slong window_len;
+    pthread_mutex_t lock;
+    pthread_cond_t advanced;
+    slong written;
+    int failed;
+} json_pipeline_struct;
+
+typedef struct
+{
+    json_pipeline_struct *pipeline;
+    slong worker;
+} json_pipeline_worker_struct;
+
+static void * _json_pipeline_solve(void *arg);
+static void _json_pipeline_write(json_pipeline_struct *p,
+        json_pipeline_item_struct *item);
+static void * _json_pipeline_writer(void *arg);
+
+void *
+_json_pipeline_solve(void *arg)
+{
+    json_pipeline_worker_struct *w = arg;
+    json_pipeline_struct *p = w->pipeline;
+    json_pipeline_item_struct *item;
+    void *x;
+
+    while (!channel_recv(p->requests, &x))
+    {
+        item = x;
+        item->response = _json_batch_respond(p->hom,
+                item->request, item->error, item->index, w->worker);
+        channel_send(p->responses, item);
+    }
+
+    /* release the thread-local caches used by flint and arb */
+    flint_cleanup();
+    return NULL;
+}
+
+void
+_json_pipeline_write(json_pipeline_struct *p, json_pipeline_item_struct *item)
+{
+    char *s_out;
+
+    s_out = json_dumps(item->response, JSON_COMPACT);
+    if (s_out)
+    {
+        puts(s_out);
+        fflush(stdout);
+        free(s_out);
+    }
+    else
+    {
+        p->failed = 1;
+    }
+    json_decref(item->response);
+    json_decref(item->request);
+    free(item->error);
+    free(item);
+
+    pthread_mutex_lock(&p->lock);
+    p->written++;
+    pthread_cond_signal(&p->advanced);
+    pthread_mutex_unlock(&p->lock);
+}
+
+void *
+_json_pipeline_writer(void *arg)
+{
+    json_pipeline_struct *p = arg;
+    json_pipeline_item_struct *item;
+    slong next, k;
+    void *x;
+
+    /* only the writer changes the number of lines written */
+    next = 0;
+    while (!channel_recv(p->responses, &x))
+    {
+        item = x;
+        if (p->order == BATCH_ORDER_COMPLETION)
+        {
+            _json_pipeline_write(p, item);
+            continue;
+        }
+
+        /* write the finished prefix of the input */
+        p->window[item->index % p->window_len] = item;
+        k = next % p->window_len;
+        while (p->window[k] && p->window[k]->index == next)
+        {
+            item = p->window[k];
+            p->window[k] = NULL;
+            _json_pipeline_write(p, item);
+            next++;
+            k = next % p->window_len;
+        }
+    }
+    return NULL;
+}
+
+int
+run_json_pipeline(json_hom_t hom, slong nthreads, int order)
+{
+    json_pipeline_struct p[1];
+    json_pipeline_worker_struct *workers;
+    json_pipeline_item_struct *item;
+    pthread_t *threads;
+    pthread_t writer;
+    char *line = NULL;
+    size_t capacity = 0;
+    json_error_t error;
+    slong i, n, ncreated;
+
+    nthreads = FLINT_MAX(1, nthreads);
+    p->hom = hom;
+    p->order = order;
+    channel_init(p->requests, 2 * nthreads);
+    channel_init(p->responses, 2 * nthreads);
+    p->window_len = 8 * nthreads;
+    p->window = calloc(p->window_len, sizeof(json_pipeline_item_struct *));
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->advanced, NULL);
+    p->written = 0;
+    p->failed = 0;
+
+    workers = malloc(nthreads * sizeof(json_pipeline_worker_struct));
+    threads = malloc(nthreads * sizeof(pthread_t));
+    ncreated = 0;
+    if (!pthread_create(&writer, NULL, _json_pipeline_writer, p))
+    {
+        for (i = 0; i < nthreads; i++)
+        {
+            workers[ncreated].pipeline = p;
+            workers[ncreated].worker = ncreated;
+            if (pthread_create(threads + ncreated, NULL,
+                        _json_pipeline_solve, workers + ncreated))
+            {
+                break;
+            }
+            ncreated++;
+        }
+        if (!ncreated)
+        {
+            channel_close(p->responses);
+            pthread_join(writer, NULL);
+        }
+    }
+    if (!ncreated)
+    {
+        fprintf(stderr, "error: failed to create the pipeline threads\n");
+        p->failed = 1;
+    }
+
+    /* read and parse the lines while the solvers work on earlier lines */
+    n = 0;
+    while (ncreated && _jsonl_getline(&line, &capacity, stdin) != -1)
+    {
+        pthread_mutex_lock(&p->lock);
+        while (n - p->written >= p->window_len)
+        {
+            pthread_cond_wait(&p->advanced, &p->lock);
+        }
+        pthread_mutex_unlock(&p->lock);
+
+        item = malloc(sizeof(json_pipeline_item_struct));
+        item->index = n++;
+        item->request = json_loads(line, 0, &error);
+        item->error = item->request ? NULL : strdup(error.text);
+        item->response = NULL;
+        channel_send(p->requests, item);
+    }
+    free(line);
+
+    /* the solvers finish the queued lines, then the writer drains */
+    if (ncreated)
+    {
+        channel_close(p->requests);
+        for (i = 0; i < ncreated; i++)
+        {
+            pthread_join(threads[i], NULL);
+        }
+        channel_close(p->responses);
+        pthread_join(writer, NULL);
+    }
+
+    channel_clear(p->requests);
+    channel_clear(p->responses);
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->advanced);
+    free(p->window);
+    free(workers);
+    free(threads);
+
+    if (p->failed && ncreated)
+    {
+        fprintf(stderr, "error: failed to dump ");
+        fprintf(stderr, "the json object to a string\n");
+    }
+    return p->failed ? -1 : 0;
+}
@@ -7,6 +7,8 @@
 
 #include "jansson.h"
 
+#include "batch.h"
+
 
 /*
  * abuse C as a functional language
@@ -51,15 +53,66 @@ typedef struct
 typedef string_hom_struct string_hom_t[1];
 typedef string_hom_struct * string_hom_ptr;
 
+/*
+ * A json homomorphism reports an invalid request, or a request that
+ * could not be completed, by returning an error response: an object
+ * whose "error" member is a string describing the problem. It does not
+ * abort, so the other requests of a json lines stream, of a batch,
+ * of a pipeline or of a server are unaffected.
+ */
+json_t * json_error_response(const char *fmt, ...);
+
+/* the message of an error response, or NULL if it is not one */
+const char * json_error_message(const json_t *response);
+
 /* applies a string homomorphism to stdin->stdout */
 int run_string_script(string_hom_t hom);
 
 /* creates a string homomorphism induced by a json homomorphism */
 string_hom_ptr json_induced_string_hom(json_hom_t hom);
 
-/* induces and applies a string homomorphism to stdin->stdout */
+/*
+ * applies a json homomorphism to the json read from stdin,
+ * writing the response to stdout, or the message of an error response
+ * to stderr in which case the result is nonzero
+ */
 int run_json_script(json_hom_t hom);
 
+/*
+ * applies a json homomorphism to each nonempty line of stdin,
+ * writing one compact json line to stdout per input line
+ * and flushing it before the next input line is read;
+ * a line that is not json gets an error response, like a line
+ * that the homomorphism answers with one
+ */
+int run_json_lines(json_hom_t hom);
+
+/* estimates the cost of applying a json homomorphism to a json struct */
+typedef double (*json_cost_fn_t)(json_t *data);
+
+/*
+ * applies a thread-safe json homomorphism to every nonempty line
+ * of stdin on a pool of nthreads threads, starting with the lines
+ * of the largest estimated cost, and writes one compact json line
+ * per input line in the input order or in the order of completion
+ * (BATCH_ORDER_INPUT or BATCH_ORDER_COMPLETION); each output object
+ * gets a "batch" member with the input line index, the worker index
+ * and the wall clock seconds spent on the line
+ */
+int run_json_batch(json_hom_t hom, json_cost_fn_t cost,
+        slong nthreads, int order);
+
+/*
+ * applies a thread-safe json homomorphism to every nonempty line
+ * of stdin like run_json_batch, but as a pipeline that does not read
+ * the whole batch first: the calling thread reads and parses the lines
+ * while nthreads solver threads apply the homomorphism to earlier lines
+ * and a writer thread serializes and writes the finished lines, with
+ * bounded queues between the stages, so that the memory stays bounded
+ * by a window of lines proportional to the number of threads
+ */
+int run_json_pipeline(json_hom_t hom, slong nthreads, int order);
+
 
 #ifdef __cplusplus
 }
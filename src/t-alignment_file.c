@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <string.h>
+#include "flint/flint.h"
+#include "dp.h"
+#include "alignment_file.h"
+
+int main(void)
+{
+    int i;
+    const char *filename = "t-alignment_file.dat";
+    FLINT_TEST_INIT(state);
+
+    flint_printf("alignment_file....");
+    fflush(stdout);
+
+    /* a fixed alignment, as gapped strings, as ops, and as CIGAR */
+    {
+        const char *sa = "AC-GTTA";
+        const char *sb = "ACGG--A";
+        unsigned char ops[7];
+        char *cigar;
+
+        dp_alignment_get_ops(ops, sa, sb, 7);
+        cigar = alignment_ops_cigar(ops, 7);
+        if (strcmp(cigar, "2M1I1M2D1M"))
+        {
+            flint_printf("FAIL: (cigar)\n");
+            flint_printf("%s\n", cigar);
+            abort();
+        }
+        flint_free(cigar);
+
+        cigar = alignment_ops_cigar(ops, 0);
+        if (strcmp(cigar, ""))
+        {
+            flint_printf("FAIL: (empty cigar)\n");
+            abort();
+        }
+        flint_free(cigar);
+    }
+
+    for (i = 0; i < 100; i++)
+    {
+        slong len, len_A, len_B, k, na, nb;
+        slong len2, len_A2, len_B2;
+        slong *A, *B;
+        unsigned char *ops, *ops2;
+        char *sa, *sb;
+        double logp, logp2;
+        int certified;
+
+        /* random column operations, and random sequences that fit them */
+        len = n_randint(state, 100);
+        ops = flint_malloc(len + 1);
+        len_A = 0;
+        len_B = 0;
+        for (k = 0; k < len; k++)
+        {
+            ops[k] = (unsigned char) n_randint(state, 3);
+            len_A += (ops[k] != DP_OP_INSERT);
+            len_B += (ops[k] != DP_OP_DELETE);
+        }
+        A = flint_malloc((len_A + 1) * sizeof(slong));
+        B = flint_malloc((len_B + 1) * sizeof(slong));
+        for (k = 0; k < len_A; k++)
+        {
+            A[k] = n_randint(state, 4);
+        }
+        for (k = 0; k < len_B; k++)
+        {
+            B[k] = n_randint(state, 4);
+        }
+
+        /* expanding in place and converting back gives the same ops */
+        sa = flint_malloc(len + 1);
+        sb = flint_malloc(len + 1);
+        memcpy(sa, ops, len);
+        dp_ops_get_alignment(sa, sb, (unsigned char *) sa, len, A, B);
+        na = 0;
+        nb = 0;
+        for (k = 0; k < len; k++)
+        {
+            na += (sa[k] != '-');
+            nb += (sb[k] != '-');
+        }
+        if ((slong) strlen(sa) != len || (slong) strlen(sb) != len ||
+            na != len_A || nb != len_B)
+        {
+            flint_printf("FAIL: (expansion)\n");
+            abort();
+        }
+        ops2 = flint_malloc(len + 1);
+        dp_alignment_get_ops(ops2, sa, sb, len);
+        if (memcmp(ops, ops2, len))
+        {
+            flint_printf("FAIL: (ops from strings)\n");
+            abort();
+        }
+        flint_free(ops2);
+
+        /* write and read the packed file */
+        logp = -0.25 * i;
+        if (alignment_file_write(filename, ops, len, len_A, len_B,
+                    logp, i % 2))
+        {
+            flint_printf("FAIL: (write)\n");
+            abort();
+        }
+        if (alignment_file_read(filename, &ops2, &len2, &len_A2, &len_B2,
+                    &logp2, &certified))
+        {
+            flint_printf("FAIL: (read)\n");
+            abort();
+        }
+        if (len2 != len || len_A2 != len_A || len_B2 != len_B ||
+            logp2 != logp || certified != i % 2 ||
+            memcmp(ops, ops2, len))
+        {
+            flint_printf("FAIL: (round trip)\n");
+            abort();
+        }
+
+        flint_free(ops);
+        flint_free(ops2);
+        flint_free(A);
+        flint_free(B);
+        flint_free(sa);
+        flint_free(sb);
+    }
+
+    remove(filename);
+
+    FLINT_TEST_CLEANUP(state);
+
+    flint_printf("PASS\n");
+    return 0;
+}
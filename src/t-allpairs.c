@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <math.h>
+#include "flint/flint.h"
+#include "flint/fmpq.h"
+#include "model_params.h"
+#include "tkf91_model_context.h"
+#include "tkf91_dp_d.h"
+#include "tkf91_dp_r.h"
+#include "tkf91_dp_auto.h"
+#include "tkf91_dp_bound.h"
+#include "fasta.h"
+#include "allpairs.h"
+
+int main(void)
+{
+    const char *filename = "t-allpairs.fa";
+    const char *records[] = {
+        "ACGACTAGTCAGCTACGATCGACTCATTCAACTGACTGACATCGACTTA",
+        "AGAGAGTAATGCATACGCATGCATCTGCTATTCTGCTGCAGTGGTA",
+        "ACGTACGTTTGACCA",
+        "GGGACGACTAGTCAGCTAGATCGACTAACTGAC",
+        "T"};
+    const slong nrecords = sizeof(records) / sizeof(records[0]);
+    tkf91_dp_fn solvers[] = {tkf91_dp_high, tkf91_dp_mag, tkf91_dp_auto,
+        tkf91_dp_d_checkpointed};
+    const slong nsolvers = sizeof(solvers) / sizeof(solvers[0]);
+    model_params_t p;
+    tkf91_model_context_t ctx;
+    fasta_t fa;
+    allpairs_t s;
+    double *expected, *m;
+    slong i, j, k, n, failed;
+    FILE *f;
+
+    flint_printf("allpairs....");
+    fflush(stdout);
+
+    f = fopen(filename, "w");
+    for (k = 0; k < nrecords; k++)
+    {
+        flint_fprintf(f, ">seq%wd some description\n%s\n", k, records[k]);
+    }
+    fclose(f);
+    fasta_init(fa);
+    if (fasta_read(fa, filename) || fa->len != nrecords)
+    {
+        flint_printf("FAIL: (fasta)\n");
+        abort();
+    }
+    remove(filename);
+
+    /* the parameters of examples/in.json */
+    model_params_init(p);
+    fmpq_set_si(p->lambda, 1, 1);
+    fmpq_set_si(p->mu, 2, 1);
+    fmpq_set_si(p->tau, 1, 10);
+    for (k = 0; k < 4; k++)
+    {
+        fmpq_set_si(p->pi + k, 1, 4);
+    }
+    tkf91_model_context_init(ctx, p);
+
+    n = nrecords * nrecords;
+    expected = flint_malloc(n * sizeof(double));
+    m = flint_malloc(n * sizeof(double));
+
+    /* the double precision scores are the reference */
+    allpairs_init(s, ctx, tkf91_dp_d, 0, 0, fa, fa);
+    allpairs_run(s, 2, NULL);
+    allpairs_get_matrix(expected, s);
+    if (allpairs_status(&failed, s) || failed ||
+        s->npairs != nrecords * (nrecords - 1) / 2)
+    {
+        flint_printf("FAIL: (double precision)\n");
+        abort();
+    }
+    allpairs_clear(s);
+
+    for (i = 0; i < nrecords; i++)
+    {
+        for (j = 0; j < nrecords; j++)
+        {
+            double x = expected[i * nrecords + j];
+            if ((i == j) != isnan(x) || x != expected[j * nrecords + i] ||
+                (i != j && !(x < 0)))
+            {
+                flint_printf("FAIL: (reference matrix)\n");
+                flint_printf("i = %wd j = %wd x = %g\n", i, j, x);
+                abort();
+            }
+        }
+    }
+
+    /*
+     * The tableau tiers report the score of their traced path, which is
+     * optimal for the certified tiers and cannot be higher for mag.
+     * The checkpointed traceback reports the double precision score.
+     */
+    for (k = 0; k < nsolvers; k++)
+    {
+        allpairs_init(s, ctx, solvers[k], 1, 1, fa, fa);
+        allpairs_run(s, 3, NULL);
+        allpairs_get_matrix(m, s);
+        if (allpairs_status(&failed, s) || failed)
+        {
+            flint_printf("FAIL: (solver %wd)\n", k);
+            abort();
+        }
+        allpairs_clear(s);
+
+        for (i = 0; i < n; i++)
+        {
+            double x = m[i];
+            double y = expected[i];
+            double tol = 1e-6 * fabs(y);
+            if (isnan(x) != isnan(y) ||
+                (!isnan(y) && (solvers[k] == tkf91_dp_mag ?
+                    x - y > tol : fabs(x - y) > tol)))
+            {
+                flint_printf("FAIL: (solver %wd matrix)\n", k);
+                flint_printf("entry %wd: %g %g\n", i, x, y);
+                abort();
+            }
+        }
+    }
+
+    flint_free(expected);
+    flint_free(m);
+    tkf91_model_context_clear(ctx);
+    model_params_clear(p);
+    fasta_clear(fa);
+
+    flint_cleanup();
+    flint_printf("PASS\n");
+    return 0;
+}
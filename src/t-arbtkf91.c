@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "arbtkf91.h"
+
+int main(void)
+{
+    const char *a = "ACGACTAGTCAGCTACGATCGACTCATTCAACTGACTGACATCGACTTA";
+    const char *b = "AGAGAGTAATGCATACGCATGCATCTGCTATTCTGCTGCAGTGGTA";
+    unsigned char *A, *B;
+    size_t len_A, len_B;
+    arbtkf91_params params;
+    arbtkf91_model *model;
+    arbtkf91_options options;
+    arbtkf91_solution *high, *sol;
+    double mid, rad, high_mid, high_rad;
+    int i, status;
+
+    printf("arbtkf91....");
+    fflush(stdout);
+
+    /* the parameters of examples/in.json */
+    for (i = 0; i < 4; i++)
+    {
+        params.pi[i].num = 25;
+        params.pi[i].den = 100;
+    }
+    params.lambda.num = 1;
+    params.lambda.den = 1;
+    params.mu.num = 2;
+    params.mu.den = 1;
+    params.tau.num = 1;
+    params.tau.den = 10;
+
+    len_A = strlen(a);
+    len_B = strlen(b);
+    A = malloc(len_A);
+    B = malloc(len_B);
+    if (arbtkf91_encode(A, a, len_A) || arbtkf91_encode(B, b, len_B) ||
+        arbtkf91_encode(A, "AC-G", 4) != ARBTKF91_ERROR_INVALID)
+    {
+        printf("FAIL: (encode)\n");
+        abort();
+    }
+    arbtkf91_encode(A, a, len_A);
+
+    if (arbtkf91_model_create(&model, &params))
+    {
+        printf("FAIL: (model)\n");
+        abort();
+    }
+
+    /* the default high precision alignment is verified */
+    arbtkf91_options_init(&options);
+    status = arbtkf91_solve(&high, model, A, len_A, B, len_B, &options);
+    if (status || !arbtkf91_solution_verified(high) ||
+        arbtkf91_solution_interrupted(high) ||
+        strlen(arbtkf91_solution_a(high)) !=
+        strlen(arbtkf91_solution_b(high)) ||
+        strlen(arbtkf91_solution_a(high)) < len_A)
+    {
+        printf("FAIL: (high precision)\n");
+        printf("%s\n", arbtkf91_strerror(status));
+        abort();
+    }
+    arbtkf91_solution_log_probability(high, &high_mid, &high_rad);
+    if (!(high_mid < 0) || !(high_rad <= 1e-6 * fabs(high_mid)))
+    {
+        printf("FAIL: (high precision score)\n");
+        printf("%g +/- %g\n", high_mid, high_rad);
+        abort();
+    }
+
+    /*
+     * The other tiers agree on the score; the mag_t bounds may trace
+     * a path that is not optimal, which cannot score higher.
+     */
+    for (i = ARBTKF91_PRECISION_FLOAT; i <= ARBTKF91_PRECISION_AUTO; i++)
+    {
+        options.precision = i;
+        options.trace = (i != ARBTKF91_PRECISION_DOUBLE);
+        status = arbtkf91_solve(&sol, model, A, len_A, B, len_B, &options);
+        if (status)
+        {
+            printf("FAIL: (precision tier %d)\n", i);
+            printf("%s\n", arbtkf91_strerror(status));
+            abort();
+        }
+        arbtkf91_solution_log_probability(sol, &mid, &rad);
+        if (i == ARBTKF91_PRECISION_MAG ?
+            mid - high_mid > 1e-3 * fabs(high_mid) :
+            fabs(mid - high_mid) > 1e-3 * fabs(high_mid))
+        {
+            printf("FAIL: (precision tier %d score)\n", i);
+            printf("%g %g\n", mid, high_mid);
+            abort();
+        }
+        arbtkf91_solution_free(sol);
+    }
+
+    /* invalid inputs are reported without a solution */
+    arbtkf91_options_init(&options);
+    status = arbtkf91_solve(&sol, model, A, 0, B, len_B, &options);
+    if (status != ARBTKF91_ERROR_INVALID || sol != NULL)
+    {
+        printf("FAIL: (empty sequence)\n");
+        abort();
+    }
+    options.precision = -1;
+    status = arbtkf91_solve(&sol, model, A, len_A, B, len_B, &options);
+    if (status != ARBTKF91_ERROR_INVALID || sol != NULL)
+    {
+        printf("FAIL: (precision tier)\n");
+        abort();
+    }
+    options.precision = ARBTKF91_PRECISION_HIGH;
+    options.trace = 0;
+    status = arbtkf91_solve(&sol, model, A, len_A, B, len_B, &options);
+    if (status != ARBTKF91_ERROR_REQUEST || sol != NULL)
+    {
+        printf("FAIL: (traceback requirement)\n");
+        abort();
+    }
+
+    arbtkf91_solution_free(high);
+    arbtkf91_model_free(model);
+    free(A);
+    free(B);
+
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "flint/flint.h"
+#include "batch.h"
+
+typedef struct
+{
+    slong *runs;
+    slong *workers;
+    slong *emitted;
+    slong nemitted;
+} record_struct;
+
+static void
+_task(void *userdata, slong index, slong worker)
+{
+    record_struct *r = userdata;
+    slong k;
+    volatile slong x = 0;
+
+    /* uneven work, so that the workers steal from each other */
+    for (k = 0; k < 1000 * (index % 7); k++)
+    {
+        x += k;
+    }
+    r->runs[index]++;
+    r->workers[index] = worker;
+}
+
+static void
+_emit(void *userdata, slong index)
+{
+    record_struct *r = userdata;
+    r->emitted[r->nemitted++] = index;
+}
+
+int main(void)
+{
+    int i;
+    FLINT_TEST_INIT(state);
+
+    flint_printf("batch....");
+    fflush(stdout);
+
+    for (i = 0; i < 200; i++)
+    {
+        slong n, nthreads, used, k;
+        int order;
+        double *cost;
+        record_struct r[1];
+
+        n = n_randint(state, 100);
+        nthreads = n_randint(state, 8) + 1;
+        order = n_randint(state, 2) ? BATCH_ORDER_INPUT :
+                                      BATCH_ORDER_COMPLETION;
+
+        cost = flint_malloc((n + 1) * sizeof(double));
+        r->runs = flint_calloc(n + 1, sizeof(slong));
+        r->workers = flint_calloc(n + 1, sizeof(slong));
+        r->emitted = flint_calloc(n + 1, sizeof(slong));
+        r->nemitted = 0;
+        for (k = 0; k < n; k++)
+        {
+            cost[k] = (double) n_randint(state, 10);
+        }
+
+        used = batch_run(n, cost, nthreads, order, _task, _emit, r);
+
+        if (used > FLINT_MIN(n, nthreads) || (n && used < 1))
+        {
+            flint_printf("FAIL (workers)\n");
+            flint_printf("n = %wd nthreads = %wd used = %wd\n",
+                    n, nthreads, used);
+            abort();
+        }
+
+        /* every task runs once and is emitted once */
+        if (r->nemitted != n)
+        {
+            flint_printf("FAIL (emitted)\n");
+            flint_printf("n = %wd emitted = %wd\n", n, r->nemitted);
+            abort();
+        }
+        for (k = 0; k < n; k++)
+        {
+            if (r->runs[k] != 1 || r->workers[k] < 0 ||
+                r->workers[k] >= used)
+            {
+                flint_printf("FAIL (runs)\n");
+                flint_printf("k = %wd runs = %wd\n", k, r->runs[k]);
+                abort();
+            }
+            r->runs[k] = 0;
+        }
+        for (k = 0; k < n; k++)
+        {
+            if (order == BATCH_ORDER_INPUT && r->emitted[k] != k)
+            {
+                flint_printf("FAIL (input order)\n");
+                abort();
+            }
+            r->runs[r->emitted[k]]++;
+        }
+        for (k = 0; k < n; k++)
+        {
+            if (r->runs[k] != 1)
+            {
+                flint_printf("FAIL (completion order)\n");
+                abort();
+            }
+        }
+
+        /* a single worker runs the largest tasks first */
+        if (nthreads == 1 && order == BATCH_ORDER_COMPLETION)
+        {
+            for (k = 1; k < n; k++)
+            {
+                if (cost[r->emitted[k - 1]] < cost[r->emitted[k]])
+                {
+                    flint_printf("FAIL (largest first)\n");
+                    abort();
+                }
+            }
+        }
+
+        flint_free(cost);
+        flint_free(r->runs);
+        flint_free(r->workers);
+        flint_free(r->emitted);
+    }
+
+    FLINT_TEST_CLEANUP(state);
+    flint_printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <math.h>
+#include "flint/flint.h"
+#include "bench_stats.h"
+
+int main(void)
+{
+    int i;
+    FLINT_TEST_INIT(state);
+
+    flint_printf("bench_stats....");
+    fflush(stdout);
+
+    /* summaries of random samples with an odd number of values */
+    for (i = 0; i < 1000; i++)
+    {
+        bench_summary_t s;
+        double *x, *y;
+        slong n, k, below, above;
+
+        n = 2 * n_randint(state, 20) + 1;
+        x = flint_malloc(n * sizeof(double));
+        y = flint_malloc(n * sizeof(double));
+        for (k = 0; k < n; k++)
+        {
+            x[k] = (double) n_randint(state, 1000) / 7;
+            y[k] = x[k];
+        }
+        bench_summarize(s, x, n);
+
+        for (k = 1; k < n; k++)
+        {
+            if (x[k - 1] > x[k])
+            {
+                flint_printf("FAIL (sorted)\n");
+                abort();
+            }
+        }
+
+        /* the median is the middle value */
+        if (s->n != n || s->median != x[n / 2] ||
+            s->min != x[0] || s->max != x[n - 1])
+        {
+            flint_printf("FAIL (median)\n");
+            abort();
+        }
+        if (!(s->min <= s->p05 && s->p05 <= s->p25 &&
+              s->p25 <= s->median && s->median <= s->p75 &&
+              s->p75 <= s->p95 && s->p95 <= s->max))
+        {
+            flint_printf("FAIL (percentiles)\n");
+            abort();
+        }
+
+        /* at least half of the values are within the MAD of the median */
+        below = above = 0;
+        for (k = 0; k < n; k++)
+        {
+            below += (fabs(y[k] - s->median) <= s->mad);
+            above += (fabs(y[k] - s->median) >= s->mad);
+        }
+        if (2 * below < n || 2 * above < n)
+        {
+            flint_printf("FAIL (mad)\n");
+            flint_printf("n = %wd below = %wd above = %wd\n", n, below, above);
+            abort();
+        }
+
+        flint_free(x);
+        flint_free(y);
+    }
+
+    /* quantiles interpolate between the order statistics */
+    {
+        double x[] = {1, 2, 3, 5};
+        if (bench_quantile(x, 4, 0) != 1 || bench_quantile(x, 4, 1) != 5 ||
+            bench_quantile(x, 4, 0.5) != 2.5)
+        {
+            flint_printf("FAIL (quantile)\n");
+            abort();
+        }
+    }
+
+    /* the exponent of an exact power law is recovered */
+    for (i = 0; i < 1000; i++)
+    {
+        double sizes[8], times[8];
+        double e, c, exponent;
+        slong n, k;
+
+        n = n_randint(state, 7) + 2;
+        e = (double) n_randint(state, 400) / 100;
+        c = (double) (n_randint(state, 1000) + 1) / 1000;
+        for (k = 0; k < n; k++)
+        {
+            sizes[k] = 10 * (k + 1) * (n_randint(state, 3) + 1);
+            times[k] = c * pow(sizes[k], e);
+        }
+        if (bench_scaling_exponent(&exponent, sizes, times, n))
+        {
+            /* only possible when all of the sizes are equal */
+            for (k = 1; k < n; k++)
+            {
+                if (sizes[k] != sizes[0])
+                {
+                    flint_printf("FAIL (distinct sizes)\n");
+                    abort();
+                }
+            }
+            continue;
+        }
+        if (fabs(exponent - e) > 1e-9)
+        {
+            flint_printf("FAIL (exponent)\n");
+            flint_printf("expected %g got %g\n", e, exponent);
+            abort();
+        }
+    }
+
+    /* a single size has no exponent */
+    {
+        double sizes[] = {100, 100, 100};
+        double times[] = {1, 2, 3};
+        double exponent;
+        if (!bench_scaling_exponent(&exponent, sizes, times, 3) ||
+            !bench_scaling_exponent(&exponent, sizes, times, 1))
+        {
+            flint_printf("FAIL (single size)\n");
+            abort();
+        }
+    }
+
+    FLINT_TEST_CLEANUP(state);
+    flint_printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "flint/flint.h"
+#include "channel.h"
+
+/* each producer sends the integers from start to start + n - 1 */
+typedef struct
+{
+    channel_ptr ch;
+    slong start;
+    slong n;
+} producer_struct;
+
+/* each consumer counts the integers it receives */
+typedef struct
+{
+    channel_ptr ch;
+    slong *counts;
+    slong *last;
+    slong n;
+} consumer_struct;
+
+static void *
+_produce(void *arg)
+{
+    producer_struct *p = arg;
+    slong k;
+    for (k = 0; k < p->n; k++)
+    {
+        if (channel_send(p->ch, (void *) (size_t) (p->start + k + 1)))
+        {
+            flint_printf("FAIL (send)\n");
+            abort();
+        }
+    }
+    return NULL;
+}
+
+static void *
+_consume(void *arg)
+{
+    consumer_struct *c = arg;
+    void *item;
+    slong x, producer;
+    while (!channel_recv(c->ch, &item))
+    {
+        x = (slong) (size_t) item - 1;
+        c->counts[x]++;
+
+        /* the items of one producer arrive in order */
+        producer = x / c->n;
+        if (x <= c->last[producer])
+        {
+            flint_printf("FAIL (order)\n");
+            abort();
+        }
+        c->last[producer] = x;
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    int i;
+    FLINT_TEST_INIT(state);
+
+    flint_printf("channel....");
+    fflush(stdout);
+
+    for (i = 0; i < 100; i++)
+    {
+        channel_t ch;
+        slong nproducers, nconsumers, n, k, j, total;
+        producer_struct *producers;
+        consumer_struct *consumers;
+        pthread_t *threads;
+        slong *counts;
+        void *item;
+
+        nproducers = n_randint(state, 4) + 1;
+        nconsumers = n_randint(state, 4) + 1;
+        n = n_randint(state, 1000);
+        total = nproducers * n;
+        channel_init(ch, n_randint(state, 8) + 1);
+
+        counts = flint_calloc(total + 1, sizeof(slong));
+        producers = flint_malloc(nproducers * sizeof(producer_struct));
+        consumers = flint_malloc(nconsumers * sizeof(consumer_struct));
+        threads = flint_malloc((nproducers + nconsumers) * sizeof(pthread_t));
+
+        for (k = 0; k < nconsumers; k++)
+        {
+            consumers[k].ch = ch;
+            consumers[k].counts = flint_calloc(total + 1, sizeof(slong));
+            consumers[k].last = flint_malloc(nproducers * sizeof(slong));
+            consumers[k].n = FLINT_MAX(n, 1);
+            for (j = 0; j < nproducers; j++)
+            {
+                consumers[k].last[j] = -1;
+            }
+            pthread_create(threads + nproducers + k, NULL,
+                    _consume, consumers + k);
+        }
+        for (k = 0; k < nproducers; k++)
+        {
+            producers[k].ch = ch;
+            producers[k].start = k * n;
+            producers[k].n = n;
+            pthread_create(threads + k, NULL, _produce, producers + k);
+        }
+        for (k = 0; k < nproducers; k++)
+        {
+            pthread_join(threads[k], NULL);
+        }
+        channel_close(ch);
+        for (k = 0; k < nconsumers; k++)
+        {
+            pthread_join(threads[nproducers + k], NULL);
+        }
+
+        /* every item is received exactly once */
+        for (k = 0; k < nconsumers; k++)
+        {
+            for (j = 0; j < total; j++)
+            {
+                counts[j] += consumers[k].counts[j];
+            }
+            flint_free(consumers[k].counts);
+            flint_free(consumers[k].last);
+        }
+        for (k = 0; k < total; k++)
+        {
+            if (counts[k] != 1)
+            {
+                flint_printf("FAIL (received)\n");
+                flint_printf("k = %wd count = %wd\n", k, counts[k]);
+                abort();
+            }
+        }
+
+        /* a closed channel accepts no more items */
+        if (!channel_send(ch, counts) || !channel_recv(ch, &item) ||
+            channel_len(ch) != 0)
+        {
+            flint_printf("FAIL (closed)\n");
+            abort();
+        }
+
+        flint_free(counts);
+        flint_free(producers);
+        flint_free(consumers);
+        flint_free(threads);
+        channel_clear(ch);
+    }
+
+    FLINT_TEST_CLEANUP(state);
+    flint_printf("PASS\n");
+    return 0;
+}
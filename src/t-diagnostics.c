@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include "flint/flint.h"
+#include "dp.h"
+#include "diagnostics.h"
+
+static slong _popcount(dp_t x);
+
+slong
+_popcount(dp_t x)
+{
+    return !!(x & DP_MAX3_M0) + !!(x & DP_MAX3_M1) + !!(x & DP_MAX3_M2) +
+           !!(x & DP_MAX2_M1) + !!(x & DP_MAX2_M2);
+}
+
+int main(void)
+{
+    int i;
+    FLINT_TEST_INIT(state);
+
+    flint_printf("diagnostics....");
+    fflush(stdout);
+
+    if (diagnostics_prec(8) != 256 || diagnostics_prec(-1) <= 0)
+    {
+        flint_printf("FAIL (prec)\n");
+        abort();
+    }
+
+    /* the rounds of a collector without a map */
+    {
+        diagnostics_t d;
+        diagnostics_round_struct *round;
+        dp_mat_t mat;
+
+        diagnostics_init(d);
+        dp_mat_init(mat, 3, 4);
+        if (diagnostics_begin(NULL, 6, mat) != NULL)
+        {
+            flint_printf("FAIL (no collector)\n");
+            abort();
+        }
+        diagnostics_end(NULL, NULL, mat, 0, 0);
+        round = diagnostics_begin(d, -1, mat);
+        diagnostics_end(d, round, mat, 1, 0);
+        if (d->len != 1 || d->map != NULL || !d->rounds->interrupted ||
+            d->rounds->cleared != 0 || d->rounds->candidates != 5 * 12 ||
+            d->rounds->interesting != 12 || d->rounds->unresolved != 12)
+        {
+            flint_printf("FAIL (all candidates)\n");
+            abort();
+        }
+        dp_mat_clear(mat);
+        diagnostics_clear(d);
+    }
+
+    for (i = 0; i < 1000; i++)
+    {
+        diagnostics_t d;
+        diagnostics_round_struct *round;
+        dp_mat_t mat;
+        slong nrows, ncols, n, nrounds, r, k, f, nfailures;
+        slong candidates, interesting;
+        slong *tally;
+
+        nrows = n_randint(state, 10) + 1;
+        ncols = n_randint(state, 10) + 1;
+        n = nrows * ncols;
+        nrounds = n_randint(state, 8) + 1;
+
+        diagnostics_init(d);
+        diagnostics_keep_map(d);
+        if (n_randint(state, 2))
+        {
+            /* a reset collector starts with a new map */
+            dp_mat_init(mat, ncols + 1, nrows);
+            round = diagnostics_begin(d, 6, mat);
+            diagnostics_end(d, round, mat, 0, 0);
+            dp_mat_clear(mat);
+            diagnostics_reset(d);
+        }
+        dp_mat_init(mat, nrows, ncols);
+        tally = flint_calloc(n, sizeof(slong));
+
+        for (r = 0; r < nrounds; r++)
+        {
+            slong before;
+
+            before = 0;
+            for (k = 0; k < n; k++)
+            {
+                before += _popcount(mat->data[k]);
+            }
+            round = diagnostics_begin(d, r + 5, mat);
+
+            /* a round only clears flags */
+            for (k = 0; k < n; k++)
+            {
+                mat->data[k] &= (dp_t) n_randint(state, 256) |
+                                (dp_t) n_randint(state, 256);
+            }
+            nfailures = n_randint(state, 2 * DIAGNOSTICS_FAILURE_CAP);
+            for (f = 0; f < nfailures; f++)
+            {
+                diagnostics_add_failure(round,
+                        n_randint(state, nrows), n_randint(state, ncols),
+                        f % 2);
+            }
+            diagnostics_end(d, round, mat, 0, r == nrounds - 1);
+
+            candidates = interesting = 0;
+            for (k = 0; k < n; k++)
+            {
+                candidates += _popcount(mat->data[k]);
+                interesting += !!(mat->data[k] & (DP_MAX3 | DP_MAX2));
+                tally[k] += dp_is_unresolved(mat->data[k]);
+            }
+
+            round = d->rounds + r;
+            if (d->len != r + 1 || round->level != r + 5 ||
+                round->prec != WORD(1) << (r + 5) ||
+                round->candidates != candidates ||
+                round->cleared != before - candidates ||
+                round->interesting != interesting ||
+                round->unresolved != dp_mat_count_unresolved(mat) ||
+                round->verified != (r == nrounds - 1) ||
+                round->interrupted)
+            {
+                flint_printf("FAIL (round)\n");
+                flint_printf("i = %d r = %wd\n", i, r);
+                abort();
+            }
+            if (round->failures != nfailures ||
+                round->failures_len !=
+                    FLINT_MIN(nfailures, DIAGNOSTICS_FAILURE_CAP))
+            {
+                flint_printf("FAIL (failures)\n");
+                abort();
+            }
+            for (f = 0; f < round->failures_len; f++)
+            {
+                if (round->failure[f].max3 != f % 2 ||
+                    round->failure[f].i >= nrows ||
+                    round->failure[f].j >= ncols)
+                {
+                    flint_printf("FAIL (failure location)\n");
+                    abort();
+                }
+            }
+        }
+
+        if (d->nrows != nrows || d->ncols != ncols)
+        {
+            flint_printf("FAIL (map dimensions)\n");
+            abort();
+        }
+        for (k = 0; k < n; k++)
+        {
+            if (diagnostics_map_entry(d, k / ncols, k % ncols) != tally[k])
+            {
+                flint_printf("FAIL (map)\n");
+                flint_printf("i = %d k = %wd\n", i, k);
+                abort();
+            }
+        }
+
+        flint_free(tally);
+        dp_mat_clear(mat);
+        diagnostics_clear(d);
+    }
+
+    FLINT_TEST_CLEANUP(state);
+    flint_printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include "flint/flint.h"
+#include "flint/fmpq.h"
+#include "flint/fmpz_mat.h"
+#include "arb.h"
+#include "arb_mat.h"
+#include "femtocas.h"
+#include "expr_program.h"
+
+int main(void)
+{
+    int i;
+    FLINT_TEST_INIT(state);
+
+    flint_printf("expr_program....");
+    fflush(stdout);
+
+    for (i = 0; i < 100; i++)
+    {
+        slong level, k, len;
+        fmpq_t a, b, s, p;
+        expr_t x, y, x2, sum, sum2, prod, lprod, e;
+        expr_ptr table[4];
+        expr_program_t prog;
+        arb_ptr values;
+        arb_t tree;
+        fmpz_mat_t mat;
+        arb_mat_t res;
+
+        fmpq_init(a);
+        fmpq_init(b);
+        fmpq_init(s);
+        fmpq_init(p);
+        fmpq_set_si(a, n_randint(state, 100) + 1, n_randint(state, 100) + 1);
+        fmpq_set_si(b, n_randint(state, 100) + 1, n_randint(state, 100) + 1);
+        fmpq_add(s, a, b);
+        fmpq_mul(p, s, s);
+
+        /* x and x2 are equal constants, and sum and sum2 are equal sums */
+        expr_fmpq(x, a);
+        expr_fmpq(y, b);
+        expr_fmpq(x2, a);
+        expr_add(sum, x, y);
+        expr_add(sum2, x2, y);
+        expr_mul(prod, sum, sum2);
+        expr_log(lprod, prod);
+        expr_exp(e, lprod);
+
+        table[0] = sum;
+        table[1] = prod;
+        table[2] = e;
+        table[3] = x2;
+        expr_program_init(prog, table, 4);
+
+        /* x, y, sum, prod, lprod, e */
+        len = expr_program_length(prog);
+        if (len != 6 ||
+            prog->instr[prog->outputs[1]].a !=
+            prog->instr[prog->outputs[1]].b ||
+            prog->outputs[3] != prog->instr[prog->outputs[0]].a)
+        {
+            flint_printf("FAIL: (common subexpressions)\n");
+            flint_printf("length = %wd\n", len);
+            abort();
+        }
+
+        values = _arb_vec_init(len);
+        arb_init(tree);
+        for (level = 0; level < 10; level++)
+        {
+            expr_program_eval(values, prog, level);
+            if (!arb_contains_fmpq(values + prog->outputs[0], s) ||
+                !arb_contains_fmpq(values + prog->outputs[1], p) ||
+                !arb_contains_fmpq(values + prog->outputs[2], p) ||
+                !arb_contains_fmpq(values + prog->outputs[3], a))
+            {
+                flint_printf("FAIL: (containment)\n");
+                abort();
+            }
+            for (k = 0; k < 4; k++)
+            {
+                expr_eval(tree, table[k], level);
+                if (!arb_overlaps(tree, values + prog->outputs[k]))
+                {
+                    flint_printf("FAIL: (agreement with expr_eval)\n");
+                    abort();
+                }
+            }
+        }
+
+        /* log(sum^2 / x) */
+        fmpz_mat_init(mat, 1, 4);
+        fmpz_set_si(fmpz_mat_entry(mat, 0, 0), 2);
+        fmpz_set_si(fmpz_mat_entry(mat, 0, 3), -1);
+        arb_mat_init(res, 1, 1);
+        for (level = 4; level < 10; level++)
+        {
+            arb_t desired;
+            fmpq_t q;
+            arb_init(desired);
+            fmpq_init(q);
+            fmpq_div(q, p, a);
+            arb_set_fmpq(desired, q, 1 << level);
+            arb_log(desired, desired, 1 << level);
+            expr_program_eval_log_combinations(res, prog, mat, level);
+            if (!arb_overlaps(desired, arb_mat_entry(res, 0, 0)))
+            {
+                flint_printf("FAIL: (log combinations)\n");
+                abort();
+            }
+            arb_clear(desired);
+            fmpq_clear(q);
+        }
+
+        fmpz_mat_clear(mat);
+        arb_mat_clear(res);
+        arb_clear(tree);
+        _arb_vec_clear(values, len);
+        expr_program_clear(prog);
+        expr_clear(e);
+        expr_clear(lprod);
+        expr_clear(prod);
+        expr_clear(sum2);
+        expr_clear(sum);
+        expr_clear(x2);
+        expr_clear(y);
+        expr_clear(x);
+        fmpq_clear(a);
+        fmpq_clear(b);
+        fmpq_clear(s);
+        fmpq_clear(p);
+    }
+
+    FLINT_TEST_CLEANUP(state);
+
+    flint_printf("PASS\n");
+    return 0;
+}
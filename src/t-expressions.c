@@ -69,6 +69,48 @@ int main()
         fmpq_clear(pi+3);
     }
 
+    /* check the hash-consing constructors */
+    for (i = 0; i < 100; i++)
+    {
+        slong size;
+        fmpq_t a, b;
+        fmpz_t n;
+        reg_t reg;
+        expr_ptr x, y, z, w;
+
+        fmpq_init(a);
+        fmpq_init(b);
+        fmpz_init(n);
+        fmpq_set_si(a, n_randint(state, 10) + 1, n_randint(state, 10) + 1);
+        fmpq_set_si(b, n_randint(state, 10) + 1, n_randint(state, 10) + 1);
+        fmpz_set_ui(n, n_randint(state, 10) + 1);
+
+        reg_init(reg);
+        x = reg_fmpq(reg, a);
+        y = reg_fmpq(reg, b);
+        z = reg_add(reg, x, y);
+        w = reg_fmpz(reg, n);
+        size = reg->size;
+
+        if ((x == y) != fmpq_equal(a, b) ||
+            reg_fmpq(reg, a) != x ||
+            reg_fmpq(reg, b) != y ||
+            reg_add(reg, x, y) != z ||
+            reg_fmpz(reg, n) != w ||
+            reg_mul(reg, x, y) == z ||
+            reg_complement(reg, z) != reg_complement(reg, z) ||
+            reg->size != size + 2)
+        {
+            flint_printf("FAIL: (hash-consing)\n");
+            abort();
+        }
+
+        reg_clear(reg);
+        fmpq_clear(a);
+        fmpq_clear(b);
+        fmpz_clear(n);
+    }
+
     FLINT_TEST_CLEANUP(state);
 
     flint_printf("PASS\n");
@@ -1,3 +1,6 @@
+#include <string.h>
+#include <time.h>
+
 #include "flint/flint.h"
 #include "flint/fmpz.h"
 #include "flint/fmpz_vec.h"
@@ -7,6 +10,9 @@ void _fmpz_factor_randtest(fmpz_factor_t f, flint_rand_t state,
         slong num, mp_bitcnt_t bits);
 void _fmpz_factor_set(fmpz_factor_t z, const fmpz_factor_t x);
 int _fmpz_factor_equal(const fmpz_factor_t x, const fmpz_factor_t y);
+void _benchmark_bases(fmpz_factor_t f, flint_rand_t state,
+        slong n, int entangled);
+void _benchmark(flint_rand_t state);
 
 void
 _fmpz_factor_randtest(fmpz_factor_t f, flint_rand_t state,
@@ -96,11 +102,91 @@ _fmpz_factor_equal(const fmpz_factor_t x, const fmpz_factor_t y)
 }
 
 
-int main(void)
+void
+_benchmark_bases(fmpz_factor_t f, flint_rand_t state, slong n, int entangled)
+{
+    /*
+     * Either many large bases, most of which are coprime, with a few
+     * sharing factors from a small pool, or the entangled bases of
+     * rationals derived from floating point numbers: 53-bit mantissas
+     * times powers of 2 and 5, which all share those primes.
+     */
+    slong i;
+    fmpz_t x, y;
+
+    fmpz_init(x);
+    fmpz_init(y);
+    f->sign = 1;
+    for (i = 0; i < n; i++)
+    {
+        if (entangled)
+        {
+            fmpz_randtest_not_zero(x, state, 53);
+            fmpz_set_ui(y, 5);
+            fmpz_pow_ui(y, y, n_randint(state, 20));
+            fmpz_mul(x, x, y);
+            fmpz_set_ui(y, 2);
+            fmpz_pow_ui(y, y, n_randint(state, 60) + 1);
+            fmpz_mul(x, x, y);
+        }
+        else
+        {
+            fmpz_randtest_not_zero(x, state, 200);
+            if (n_randint(state, 10) == 0)
+            {
+                fmpz_mul_ui(x, x, n_randint(state, 1000) + 2);
+            }
+        }
+        _fmpz_factor_append(f, x, 1);
+    }
+    fmpz_clear(x);
+    fmpz_clear(y);
+}
+
+void
+_benchmark(flint_rand_t state)
+{
+    /* time the refinement of both kinds of bases */
+    slong n;
+    int entangled;
+    fmpz_factor_t f, g;
+    clock_t start;
+
+    for (entangled = 0; entangled < 2; entangled++)
+    {
+        for (n = 10; n <= 10000; n *= 10)
+        {
+            fmpz_factor_init(f);
+            fmpz_factor_init(g);
+            _benchmark_bases(f, state, n, entangled);
+
+            start = clock();
+            fmpz_factor_refine(g, f);
+            flint_printf("%wd %s bases: %wd refined factors "
+                    "in %.3f seconds\n",
+                    n, entangled ? "entangled" : "mostly coprime", g->num,
+                    (double) (clock() - start) / CLOCKS_PER_SEC);
+
+            fmpz_factor_clear(f);
+            fmpz_factor_clear(g);
+        }
+    }
+}
+
+
+int main(int argc, char *argv[])
 {
     int iter;
     FLINT_TEST_INIT(state);
 
+    /* 't-factor_refine bench' times the refinement instead of testing */
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+        _benchmark(state);
+        FLINT_TEST_CLEANUP(state);
+        return 0;
+    }
+
     flint_printf("factor_refine....");
     fflush(stdout);
 
@@ -113,6 +199,11 @@ int main(void)
 
         bits = n_randint(state, 80) + 2;
         num = n_randint(state, 10);
+        if (iter % 10 == 0)
+        {
+            /* enough bases for several levels of merges */
+            num = n_randint(state, 60);
+        }
 
         /* sample a factor structure that is probably not in canonical form */
         fmpz_factor_init(f);
@@ -151,6 +151,81 @@ int main(void)
         expr_clear(res);
     }
 
+    /* test that only the requested precision levels are evaluated */
+    {
+        fmpq_t a, b, desired;
+        expr_t x, y, s;
+        arb_t actual;
+
+        fmpq_init(a);
+        fmpq_init(b);
+        fmpq_init(desired);
+        fmpq_set_si(a, -2, 3);
+        fmpq_set_si(b, 5, 7);
+        fmpq_add(desired, a, b);
+        expr_fmpq(x, a);
+        expr_fmpq(y, b);
+        expr_add(s, x, y);
+        arb_init(actual);
+
+        expr_eval(actual, s, 12);
+        if (expr_cache_misses(s) != 1 || expr_cache_misses(x) != 1 ||
+            expr_cache_hits(s) != 0 || s->alloc != 13)
+        {
+            flint_printf("FAIL: (direct evaluation)\n");
+            abort();
+        }
+
+        /* lower levels are rounded from the cached level */
+        expr_eval(actual, s, 5);
+        expr_eval(actual, s, 5);
+        if (expr_cache_misses(s) != 1 || expr_cache_hits(s) != 2 ||
+            expr_cache_misses(x) != 1 ||
+            !arb_contains_fmpq(actual, desired))
+        {
+            flint_printf("FAIL: (rounded evaluation)\n");
+            abort();
+        }
+
+        /* higher levels are evaluated */
+        expr_eval(actual, s, 13);
+        if (expr_cache_misses(s) != 2 || expr_cache_misses(x) != 2 ||
+            !arb_contains_fmpq(actual, desired))
+        {
+            flint_printf("FAIL: (higher evaluation)\n");
+            abort();
+        }
+
+        /* frozen caches are read but never written */
+        {
+            ulong cached;
+            slong hits, misses;
+            expr_freeze(s, 13);
+            cached = s->cached;
+            hits = expr_cache_hits(s);
+            misses = expr_cache_misses(s);
+            expr_eval(actual, s, 3);
+            expr_eval(actual, s, 20);
+            if (s->cached != cached || s->alloc != 14 ||
+                !x->frozen || !y->frozen ||
+                expr_cache_hits(s) != hits ||
+                expr_cache_misses(s) != misses ||
+                !arb_contains_fmpq(actual, desired))
+            {
+                flint_printf("FAIL: (frozen evaluation)\n");
+                abort();
+            }
+        }
+
+        arb_clear(actual);
+        expr_clear(s);
+        expr_clear(x);
+        expr_clear(y);
+        fmpq_clear(a);
+        fmpq_clear(b);
+        fmpq_clear(desired);
+    }
+
     FLINT_TEST_CLEANUP(state);
 
     flint_printf("PASS\n");
@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <pthread.h>
+#include "flint/flint.h"
+#include "gmp.h"
+#include "memstats.h"
+
+/* each thread allocates and frees n blocks of its own */
+typedef struct
+{
+    slong n;
+    slong peak;
+    slong allocations;
+} allocator_struct;
+
+static void *
+_allocate(void *arg)
+{
+    allocator_struct *a = arg;
+    memstats_mark_t start;
+    memstats_t m;
+    void **blocks;
+    slong k;
+
+    memstats_mark(start);
+    blocks = flint_malloc(a->n * sizeof(void *));
+    for (k = 0; k < a->n; k++)
+    {
+        blocks[k] = flint_malloc(100);
+    }
+    for (k = 0; k < a->n; k++)
+    {
+        flint_free(blocks[k]);
+    }
+    flint_free(blocks);
+    memstats_interval(m, start);
+
+    a->peak = m->peak;
+    a->allocations = m->allocations;
+    if (m->current != 0)
+    {
+        flint_printf("FAIL (thread current)\n");
+        abort();
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    int i;
+
+    /* before anything is allocated */
+    memstats_install();
+
+    FLINT_TEST_INIT(state);
+
+    flint_printf("memstats....");
+    fflush(stdout);
+
+    /* random allocations, reallocations and frees */
+    for (i = 0; i < 100; i++)
+    {
+        memstats_t before, after;
+        memstats_mark_t start;
+        char *blocks[10];
+        slong sizes[10];
+        slong k, j, current, peak, allocations;
+
+        memstats_get(before);
+        memstats_mark(start);
+        for (k = 0; k < 10; k++)
+        {
+            blocks[k] = NULL;
+            sizes[k] = 0;
+        }
+        current = peak = allocations = 0;
+        for (j = 0; j < 100; j++)
+        {
+            k = n_randint(state, 10);
+            if (blocks[k] && n_randint(state, 2))
+            {
+                flint_free(blocks[k]);
+                current -= sizes[k];
+                blocks[k] = NULL;
+                sizes[k] = 0;
+            }
+            else
+            {
+                slong size = n_randint(state, 1000);
+                if (n_randint(state, 2))
+                {
+                    blocks[k] = flint_realloc(blocks[k], size);
+                }
+                else
+                {
+                    flint_free(blocks[k]);
+                    blocks[k] = flint_calloc(size, 1);
+                }
+                current += size - sizes[k];
+                sizes[k] = size;
+                allocations++;
+            }
+            peak = FLINT_MAX(peak, current);
+
+            /* the blocks are usable */
+            if (sizes[k])
+            {
+                blocks[k][0] = blocks[k][sizes[k] - 1] = 1;
+            }
+        }
+
+        {
+            memstats_t m;
+            memstats_interval(m, start);
+            memstats_get(after);
+            if (m->current != current || m->peak != peak ||
+                m->allocations != allocations ||
+                after->current - before->current != current)
+            {
+                flint_printf("FAIL (counts)\n");
+                flint_printf("current %wd %wd peak %wd %wd\n",
+                        m->current, current, m->peak, peak);
+                abort();
+            }
+        }
+
+        for (k = 0; k < 10; k++)
+        {
+            flint_free(blocks[k]);
+        }
+    }
+
+    /* nested intervals */
+    {
+        memstats_mark_t outer, inner;
+        memstats_t m;
+        void *a, *b, *c;
+
+        memstats_mark(outer);
+        a = flint_malloc(500);
+        memstats_mark(inner);
+        b = flint_malloc(300);
+        flint_free(b);
+        memstats_interval(m, inner);
+        if (m->peak != 300 || m->current != 0 || m->allocations != 1)
+        {
+            flint_printf("FAIL (inner)\n");
+            abort();
+        }
+        c = flint_malloc(200);
+        memstats_interval(m, outer);
+        if (m->peak != 800 || m->current != 700 || m->allocations != 3 ||
+            m->allocated_bytes != 1000)
+        {
+            flint_printf("FAIL (outer)\n");
+            flint_printf("peak %wd current %wd\n", m->peak, m->current);
+            abort();
+        }
+        flint_free(a);
+        flint_free(c);
+    }
+
+    /* gmp allocations are counted too */
+    {
+        memstats_mark_t start;
+        memstats_t m;
+        mpz_t x;
+
+        memstats_mark(start);
+        mpz_init(x);
+        mpz_setbit(x, 100000);
+        mpz_clear(x);
+        memstats_interval(m, start);
+        if (m->peak < 100000 / 8)
+        {
+            flint_printf("FAIL (gmp)\n");
+            flint_printf("peak %wd\n", m->peak);
+            abort();
+        }
+    }
+
+    /* the threads count their own allocations */
+    {
+        pthread_t threads[4];
+        allocator_struct allocators[4];
+        memstats_t before, after;
+        slong k;
+
+        memstats_get(before);
+        memstats_reset_peak();
+        for (k = 0; k < 4; k++)
+        {
+            allocators[k].n = 1000 * (k + 1);
+            pthread_create(threads + k, NULL, _allocate, allocators + k);
+        }
+        for (k = 0; k < 4; k++)
+        {
+            pthread_join(threads[k], NULL);
+        }
+        memstats_get(after);
+
+        for (k = 0; k < 4; k++)
+        {
+            slong n = allocators[k].n;
+            if (allocators[k].allocations != n + 1 ||
+                allocators[k].peak != n * (slong) (100 + sizeof(void *)))
+            {
+                flint_printf("FAIL (thread)\n");
+                abort();
+            }
+        }
+        if (after->current != before->current ||
+            after->allocations != before->allocations + 10000 + 4 ||
+            after->peak < before->current + 4000 * 100)
+        {
+            flint_printf("FAIL (process)\n");
+            abort();
+        }
+    }
+
+    if (memstats_peak_resident() <= 0)
+    {
+        flint_printf("FAIL (peak resident)\n");
+        abort();
+    }
+
+    FLINT_TEST_CLEANUP(state);
+    flint_printf("PASS\n");
+    return 0;
+}
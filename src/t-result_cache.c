@@ -0,0 +1,261 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "flint/flint.h"
+#include "result_cache.h"
+
+static void
+_remove_dir(const char *name)
+{
+    char path[512];
+    struct dirent *d;
+    DIR *dir = opendir(name);
+    if (dir)
+    {
+        while ((d = readdir(dir)) != NULL)
+        {
+            if (strcmp(d->d_name, ".") && strcmp(d->d_name, ".."))
+            {
+                sprintf(path, "%s/%s", name, d->d_name);
+                unlink(path);
+            }
+        }
+        closedir(dir);
+    }
+    rmdir(name);
+}
+
+static void
+_key(result_key_t key, slong i)
+{
+    /* the base 4 digits of the index, as if it were a sequence */
+    slong v[8];
+    slong k;
+    for (k = 0; k < 8; k++)
+    {
+        v[k] = (i >> (2 * k)) & 3;
+    }
+    result_key_init(key, "t-result_cache");
+    result_key_slong_vec(key, v, 8);
+    result_key_string(key, "options");
+}
+
+int main(void)
+{
+    int i;
+    const char *dirname = "t-result_cache.dir";
+    FLINT_TEST_INIT(state);
+
+    flint_printf("result_cache....");
+    fflush(stdout);
+
+    _remove_dir(dirname);
+
+    /* round trips, and misses for the keys that were not stored */
+    {
+        result_cache_t c;
+        result_key_t key;
+        char data[100];
+        char *s;
+        slong len, k;
+
+        if (result_cache_init(c, dirname, WORD(1) << 20))
+        {
+            flint_printf("FAIL (init)\n");
+            abort();
+        }
+        for (i = 0; i < 50; i++)
+        {
+            len = n_randint(state, 100);
+            for (k = 0; k < len; k++)
+            {
+                data[k] = 'a' + (i + k) % 26;
+            }
+            _key(key, i);
+            if (result_cache_put(c, key, data, len))
+            {
+                flint_printf("FAIL (put)\n");
+                abort();
+            }
+            s = result_cache_get(c, key, &k);
+            if (!s || k != len || memcmp(s, data, len) || s[len])
+            {
+                flint_printf("FAIL (get)\n");
+                abort();
+            }
+            flint_free(s);
+            result_key_clear(key);
+
+            _key(key, i + 1000);
+            if (result_cache_get(c, key, &k))
+            {
+                flint_printf("FAIL (miss)\n");
+                abort();
+            }
+            result_key_clear(key);
+        }
+        result_cache_clear(c);
+        _remove_dir(dirname);
+    }
+
+    /* keys with the same hash do not share a result */
+    {
+        result_cache_t c;
+        result_key_t a, b;
+        char *s;
+        slong len;
+
+        result_cache_init(c, dirname, WORD(1) << 20);
+        result_key_init(a, "t-result_cache");
+        result_key_string(a, "one");
+        result_key_init(b, "t-result_cache");
+        result_key_string(b, "two");
+        b->h[0] = a->h[0];
+        b->h[1] = a->h[1];
+
+        result_cache_put(c, a, "1", 1);
+        s = result_cache_get(c, b, &len);
+        if (s)
+        {
+            flint_printf("FAIL (collision)\n");
+            abort();
+        }
+        s = result_cache_get(c, a, &len);
+        if (!s || len != 1 || s[0] != '1')
+        {
+            flint_printf("FAIL (get after collision)\n");
+            abort();
+        }
+        flint_free(s);
+
+        result_key_clear(a);
+        result_key_clear(b);
+        result_cache_clear(c);
+        _remove_dir(dirname);
+    }
+
+    /* the least recently used results are evicted first */
+    {
+        result_cache_t c;
+        result_key_t a, b, d;
+        char data[1000];
+        char *s;
+        slong len;
+
+        memset(data, 'x', sizeof(data));
+        _key(a, 1);
+        _key(b, 2);
+        _key(d, 3);
+
+        /* room for two results but not for three */
+        result_cache_init(c, dirname, 3000);
+        result_cache_put(c, a, data, sizeof(data));
+        usleep(20000);
+        result_cache_put(c, b, data, sizeof(data));
+        usleep(20000);
+        s = result_cache_get(c, a, &len);
+        flint_free(s);
+        usleep(20000);
+        result_cache_put(c, d, data, sizeof(data));
+
+        s = result_cache_get(c, b, &len);
+        if (s)
+        {
+            flint_printf("FAIL (evicted)\n");
+            abort();
+        }
+        s = result_cache_get(c, a, &len);
+        if (!s)
+        {
+            flint_printf("FAIL (recently used)\n");
+            abort();
+        }
+        flint_free(s);
+        s = result_cache_get(c, d, &len);
+        if (!s)
+        {
+            flint_printf("FAIL (newest)\n");
+            abort();
+        }
+        flint_free(s);
+
+        result_key_clear(a);
+        result_key_clear(b);
+        result_key_clear(d);
+        result_cache_clear(c);
+        _remove_dir(dirname);
+    }
+
+    /* an eviction removes a batch of results */
+    {
+        result_cache_t c;
+        result_key_t key[4];
+        char data[1000];
+        char *s;
+        slong len, k;
+
+        memset(data, 'x', sizeof(data));
+
+        /* room for three results, evicting down to two */
+        result_cache_init(c, dirname, 4000);
+        for (k = 0; k < 4; k++)
+        {
+            _key(key[k], k);
+            result_cache_put(c, key[k], data, sizeof(data));
+            usleep(20000);
+        }
+        for (k = 0; k < 4; k++)
+        {
+            s = result_cache_get(c, key[k], &len);
+            if ((s != NULL) != (k >= 2))
+            {
+                flint_printf("FAIL (batch)\n");
+                flint_printf("k = %wd\n", k);
+                abort();
+            }
+            flint_free(s);
+            result_key_clear(key[k]);
+        }
+
+        result_cache_clear(c);
+        _remove_dir(dirname);
+    }
+
+    /* the stale temporary files are removed */
+    {
+        result_cache_t c;
+        struct timeval times[2];
+        char stale[256], fresh[256];
+        FILE *f;
+
+        mkdir(dirname, 0777);
+        sprintf(stale, "%s/tmp.aaaaaa", dirname);
+        sprintf(fresh, "%s/tmp.bbbbbb", dirname);
+        f = fopen(stale, "w");
+        fclose(f);
+        f = fopen(fresh, "w");
+        fclose(f);
+        gettimeofday(times, NULL);
+        times[0].tv_sec -= 2 * 3600;
+        times[1] = times[0];
+        utimes(stale, times);
+
+        result_cache_init(c, dirname, WORD(1) << 20);
+        if (!access(stale, F_OK) || access(fresh, F_OK))
+        {
+            flint_printf("FAIL (temporary files)\n");
+            abort();
+        }
+
+        result_cache_clear(c);
+        _remove_dir(dirname);
+    }
+
+    FLINT_TEST_CLEANUP(state);
+    flint_printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <string.h>
+#include "flint/flint.h"
+#include "dp.h"
+#include "model_params.h"
+#include "tableau_file.h"
+
+int main(void)
+{
+    int i;
+    const char *filename = "t-tableau_file.dat";
+    model_params_t p;
+    FLINT_TEST_INIT(state);
+
+    flint_printf("tableau_file....");
+    fflush(stdout);
+
+    model_params_init(p);
+    fmpq_set_si(p->lambda, 1, 1);
+    fmpq_set_si(p->mu, 2, 1);
+    fmpq_set_si(p->tau, 1, 10);
+    for (i = 0; i < 4; i++)
+    {
+        fmpq_set_si(p->pi + i, 1, 4);
+    }
+
+    for (i = 0; i < 100; i++)
+    {
+        slong nrows, ncols, k, n, level;
+        int certified;
+        dp_mat_t a, b;
+        dp_t x;
+        slong *A, *B;
+        result_key_t key, other;
+
+        nrows = n_randint(state, 30) + 1;
+        ncols = n_randint(state, 30) + 1;
+        n = nrows * ncols;
+        dp_mat_init(a, nrows, ncols);
+        dp_mat_init(b, nrows, ncols);
+
+        /* random sequences for the tableau dimensions */
+        A = flint_malloc(nrows * sizeof(slong));
+        B = flint_malloc(ncols * sizeof(slong));
+        for (k = 0; k < nrows - 1; k++)
+        {
+            A[k] = n_randint(state, 4);
+        }
+        for (k = 0; k < ncols - 1; k++)
+        {
+            B[k] = n_randint(state, 4);
+        }
+        tableau_file_key_init(key, p, A, nrows - 1, B, ncols - 1);
+
+        /* random flags, mostly constant over runs like a real tableau */
+        x = (dp_t) n_randint(state, 256);
+        for (k = 0; k < n; k++)
+        {
+            if (n_randint(state, 8) == 0)
+            {
+                x = (dp_t) n_randint(state, 256);
+            }
+            a->data[k] = x;
+        }
+
+        if (tableau_file_write(filename, key, a, i % 2, i - 1))
+        {
+            flint_printf("FAIL: (write)\n");
+            abort();
+        }
+
+        if (tableau_file_read(filename, key, b, &certified, &level))
+        {
+            flint_printf("FAIL: (read)\n");
+            abort();
+        }
+
+        if (memcmp(a->data, b->data, n * sizeof(dp_t)) ||
+            certified != i % 2 || level != i - 1)
+        {
+            flint_printf("FAIL: (round trip)\n");
+            abort();
+        }
+
+        /* a file written for different sequences must be rejected */
+        if (nrows > 1)
+        {
+            A[0] = (A[0] + 1) % 4;
+            tableau_file_key_init(other, p, A, nrows - 1, B, ncols - 1);
+            if (!tableau_file_read(filename, other, b, &certified, &level))
+            {
+                flint_printf("FAIL: (key mismatch)\n");
+                abort();
+            }
+
+            /* even if the hashes of the keys collide */
+            other->h[0] = key->h[0];
+            other->h[1] = key->h[1];
+            if (!tableau_file_read(filename, other, b, &certified, &level))
+            {
+                flint_printf("FAIL: (key collision)\n");
+                abort();
+            }
+            result_key_clear(other);
+        }
+
+        result_key_clear(key);
+        flint_free(A);
+        flint_free(B);
+        dp_mat_clear(a);
+        dp_mat_clear(b);
+    }
+
+    remove(filename);
+    model_params_clear(p);
+
+    FLINT_TEST_CLEANUP(state);
+
+    flint_printf("PASS\n");
+    return 0;
+}
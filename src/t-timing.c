@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "flint/flint.h"
+#include "timing.h"
+
+static const char * _names[] = {"forward", "backward", "traceback"};
+
+/* each thread records n phases into the shared collector */
+typedef struct
+{
+    timing_ptr t;
+    slong thread;
+    slong n;
+} recorder_struct;
+
+static void *
+_record(void *arg)
+{
+    recorder_struct *r = arg;
+    timing_mark_t start;
+    slong k;
+    for (k = 0; k < r->n; k++)
+    {
+        timing_mark(r->t, start);
+        timing_record(r->t, _names[k % 3], r->thread * r->n + k, start);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    int i;
+    perf_counters_t counters;
+
+    /* before anything is allocated */
+    memstats_install();
+
+    FLINT_TEST_INIT(state);
+
+    flint_printf("timing....");
+    fflush(stdout);
+
+    /* the counters may well be unavailable, but they can be read */
+    perf_counters_init(counters);
+    {
+        timing_t t;
+        timing_mark_t start;
+        volatile double y;
+        slong k, c;
+
+        timing_init(t);
+        timing_set_counters(t, counters);
+        timing_mark(t, start);
+        for (y = 0, k = 0; k < 100000; k++)
+        {
+            y += k;
+        }
+        timing_record(t, "forward", TIMING_NO_LEVEL, start);
+        if (t->len != 1 ||
+            (t->phases->counted && !perf_counters_running(counters)))
+        {
+            flint_printf("FAIL (counted)\n");
+            abort();
+        }
+        for (c = 0; c < PERF_COUNTERS; c++)
+        {
+            if (t->phases->counts[c] < 0 ||
+                (!perf_counter_available(counters, c) &&
+                 t->phases->counts[c] != 0))
+            {
+                flint_printf("FAIL (%s)\n", perf_counter_name(c));
+                abort();
+            }
+        }
+        /* a phase is counted only while the group was scheduled */
+        if (t->phases->counted &&
+            perf_counter_available(counters, PERF_COUNTER_INSTRUCTIONS) &&
+            t->phases->counts[PERF_COUNTER_INSTRUCTIONS] < 100000)
+        {
+            flint_printf("FAIL (too few instructions)\n");
+            abort();
+        }
+        timing_clear(t);
+    }
+
+    /* the phases of a thread get its allocations */
+    {
+        timing_t t;
+        timing_mark_t outer, inner;
+        timing_phase_struct total;
+        void *a, *b;
+
+        timing_init(t);
+        timing_mark(t, outer);
+        a = flint_malloc(1000);
+        timing_mark(t, inner);
+        b = flint_malloc(3000);
+        flint_free(b);
+        timing_record(t, "traceback", TIMING_NO_LEVEL, inner);
+        flint_free(a);
+        timing_finish(t, &total, "sample", TIMING_NO_LEVEL, outer);
+        if (t->len != 1 || !t->phases->accounted ||
+            t->phases->heap_peak_bytes != 3000 ||
+            t->phases->allocations != 1 ||
+            !total.accounted || total.heap_peak_bytes < 4000 ||
+            total.allocations < 2 || total.allocated_bytes < 4000)
+        {
+            flint_printf("FAIL (memory)\n");
+            abort();
+        }
+        timing_clear(t);
+    }
+
+    /* recording into no collector does nothing */
+    {
+        timing_mark_t start;
+        timing_mark(NULL, start);
+        timing_record(NULL, "forward", TIMING_NO_LEVEL, start);
+    }
+
+    for (i = 0; i < 100; i++)
+    {
+        timing_t t;
+        slong nthreads, n, k, total;
+        recorder_struct *recorders;
+        pthread_t *threads;
+        slong *counts;
+        const timing_phase_struct *x;
+
+        nthreads = n_randint(state, 4) + 1;
+        n = n_randint(state, 100);
+        total = nthreads * n;
+
+        timing_init(t);
+        if (n_randint(state, 2))
+        {
+            /* the counters of this thread are not read by the others */
+            timing_set_counters(t, counters);
+        }
+        if (n_randint(state, 2))
+        {
+            /* a reset collector is empty but can be reused */
+            timing_mark_t start;
+            timing_mark(NULL, start);
+            timing_record(t, "setup_hnf", TIMING_NO_LEVEL, start);
+            timing_reset(t);
+        }
+
+        recorders = flint_malloc(nthreads * sizeof(recorder_struct));
+        threads = flint_malloc(nthreads * sizeof(pthread_t));
+        for (k = 0; k < nthreads; k++)
+        {
+            recorders[k].t = t;
+            recorders[k].thread = k;
+            recorders[k].n = n;
+            pthread_create(threads + k, NULL, _record, recorders + k);
+        }
+        for (k = 0; k < nthreads; k++)
+        {
+            pthread_join(threads[k], NULL);
+        }
+
+        if (t->len != total)
+        {
+            flint_printf("FAIL (length)\n");
+            flint_printf("len = %wd total = %wd\n", t->len, total);
+            abort();
+        }
+
+        /* every phase is recorded once, with its name and times */
+        counts = flint_calloc(FLINT_MAX(total, 1), sizeof(slong));
+        for (k = 0; k < total; k++)
+        {
+            x = t->phases + k;
+            if (x->level < 0 || x->level >= total ||
+                x->phase != _names[(x->level % n) % 3])
+            {
+                flint_printf("FAIL (phase)\n");
+                flint_printf("k = %wd level = %wd\n", k, x->level);
+                abort();
+            }
+            if (x->wall_seconds < 0 || x->cpu_seconds < 0 || x->counted)
+            {
+                flint_printf("FAIL (time or counters)\n");
+                abort();
+            }
+            counts[x->level]++;
+        }
+        for (k = 0; k < total; k++)
+        {
+            if (counts[k] != 1)
+            {
+                flint_printf("FAIL (recorded)\n");
+                flint_printf("k = %wd count = %wd\n", k, counts[k]);
+                abort();
+            }
+        }
+
+        flint_free(counts);
+        flint_free(recorders);
+        flint_free(threads);
+        timing_clear(t);
+    }
+
+    perf_counters_clear(counters);
+    FLINT_TEST_CLEANUP(state);
+    flint_printf("PASS\n");
+    return 0;
+}
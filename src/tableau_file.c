@@ -0,0 +1,292 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tableau_file.h"
+
+
+#define TABLEAU_FILE_MAGIC "arbtkf91-tableau"
+#define TABLEAU_FILE_VERSION 2
+
+/*
+ * The header is written in native byte order,
+ * followed by the key_len bytes of the key.
+ */
+typedef struct
+{
+    char magic[24];
+    int64_t version;
+    uint64_t key[2];
+    int64_t key_len;
+    int64_t nrows;
+    int64_t ncols;
+    int64_t certified;
+    int64_t level;
+} tableau_file_header_struct;
+
+
+static int _write_varint(FILE *f, uint64_t x);
+static int _read_varint(FILE *f, uint64_t *px);
+static int _write_plane(FILE *f, const dp_t *data, uint64_t n, int bit);
+static int _read_plane(FILE *f, dp_t *data, uint64_t n, int bit);
+
+
+int
+_write_varint(FILE *f, uint64_t x)
+{
+    int c;
+    do
+    {
+        c = (int) (x & 0x7F);
+        x >>= 7;
+        if (x)
+        {
+            c |= 0x80;
+        }
+        if (putc(c, f) == EOF)
+        {
+            return 1;
+        }
+    } while (x);
+    return 0;
+}
+
+int
+_read_varint(FILE *f, uint64_t *px)
+{
+    int c, shift;
+    uint64_t x;
+    x = 0;
+    for (shift = 0; shift < 64; shift += 7)
+    {
+        c = getc(f);
+        if (c == EOF)
+        {
+            return 1;
+        }
+        x |= ((uint64_t) (c & 0x7F)) << shift;
+        if (!(c & 0x80))
+        {
+            *px = x;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int
+_write_plane(FILE *f, const dp_t *data, uint64_t n, int bit)
+{
+    /*
+     * Write the lengths of the alternating runs of clear and set bits,
+     * starting with a possibly empty run of clear bits.
+     */
+    uint64_t k, run;
+    int value, b;
+
+    value = 0;
+    run = 0;
+    for (k = 0; k < n; k++)
+    {
+        b = (data[k] >> bit) & 1;
+        if (b != value)
+        {
+            if (_write_varint(f, run))
+            {
+                return 1;
+            }
+            value = b;
+            run = 0;
+        }
+        run++;
+    }
+    return _write_varint(f, run);
+}
+
+int
+_read_plane(FILE *f, dp_t *data, uint64_t n, int bit)
+{
+    uint64_t k, run, total;
+    dp_t mask;
+    int value;
+
+    mask = (dp_t) (1 << bit);
+    value = 0;
+    total = 0;
+    while (total < n)
+    {
+        if (_read_varint(f, &run) || run > n - total)
+        {
+            return 1;
+        }
+        if (value)
+        {
+            for (k = total; k < total + run; k++)
+            {
+                data[k] |= mask;
+            }
+        }
+        total += run;
+        value = !value;
+    }
+    return 0;
+}
+
+
+void
+tableau_file_key_init(result_key_t key, const model_params_t p,
+        const slong *A, slong szA, const slong *B, slong szB)
+{
+    result_key_init(key, TABLEAU_FILE_MAGIC);
+    result_key_params(key, p);
+    result_key_slong_vec(key, A, szA);
+    result_key_slong_vec(key, B, szB);
+}
+
+int
+tableau_file_write(const char *filename, const result_key_t key,
+        const dp_mat_t mat, int certified, slong level)
+{
+    /*
+     * Write the tableau to a temporary file and then rename it,
+     * so that readers never see a partially written file.
+     * Return nonzero on failure.
+     */
+    tableau_file_header_struct header;
+    char *tmpname;
+    FILE *fout;
+    uint64_t n;
+    int bit, code;
+
+    memset(&header, 0, sizeof(header));
+    strncpy(header.magic, TABLEAU_FILE_MAGIC, sizeof(header.magic) - 1);
+    header.version = TABLEAU_FILE_VERSION;
+    header.key[0] = key->h[0];
+    header.key[1] = key->h[1];
+    header.key_len = key->len;
+    header.nrows = dp_mat_nrows(mat);
+    header.ncols = dp_mat_ncols(mat);
+    header.certified = certified;
+    header.level = level;
+
+    tmpname = flint_malloc(strlen(filename) + 5);
+    strcpy(tmpname, filename);
+    strcat(tmpname, ".tmp");
+
+    code = 0;
+    fout = fopen(tmpname, "wb");
+    if (fout == NULL)
+    {
+        fprintf(stderr, "failed to open %s for writing\n", tmpname);
+        flint_free(tmpname);
+        return 1;
+    }
+
+    n = (uint64_t) (header.nrows * header.ncols);
+    if (fwrite(&header, sizeof(header), 1, fout) != 1 ||
+        fwrite(key->data, 1, key->len, fout) != (size_t) key->len)
+    {
+        code = 1;
+    }
+    for (bit = 0; bit < 8 && !code; bit++)
+    {
+        code = _write_plane(fout, mat->data, n, bit);
+    }
+
+    /* the data must reach the disk before the rename publishes it */
+    if (!code && (fflush(fout) || fsync(fileno(fout))))
+    {
+        code = 1;
+    }
+    if (fclose(fout))
+    {
+        code = 1;
+    }
+    if (code)
+    {
+        fprintf(stderr, "failed to write the tableau file %s\n", tmpname);
+    }
+    else if (rename(tmpname, filename))
+    {
+        fprintf(stderr, "failed to rename the tableau file %s\n", tmpname);
+        code = 1;
+    }
+
+    flint_free(tmpname);
+    return code;
+}
+
+int
+tableau_file_read(const char *filename, const result_key_t key,
+        dp_mat_t mat, int *certified, slong *level)
+{
+    /*
+     * Read the tableau from the file.
+     * The tableau must already have the dimensions recorded in the file.
+     * Return nonzero if the file cannot be read, or if it was written
+     * for different parameters, sequences, or tableau dimensions.
+     */
+    tableau_file_header_struct header;
+    unsigned char *key_data;
+    FILE *fin;
+    uint64_t n;
+    int bit, code;
+
+    fin = fopen(filename, "rb");
+    if (fin == NULL)
+    {
+        fprintf(stderr, "failed to open %s for reading\n", filename);
+        return 1;
+    }
+
+    code = 0;
+    if (fread(&header, sizeof(header), 1, fin) != 1 ||
+        strncmp(header.magic, TABLEAU_FILE_MAGIC, sizeof(header.magic)) ||
+        header.version != TABLEAU_FILE_VERSION)
+    {
+        fprintf(stderr, "%s is not a tableau file\n", filename);
+        code = 1;
+    }
+    else
+    {
+        /* the hash and dimensions are checked before the key bytes */
+        code = (header.key[0] != key->h[0] || header.key[1] != key->h[1] ||
+                header.key_len != key->len ||
+                header.nrows != dp_mat_nrows(mat) ||
+                header.ncols != dp_mat_ncols(mat));
+        if (!code)
+        {
+            key_data = flint_malloc(FLINT_MAX(1, key->len));
+            code = (fread(key_data, 1, key->len, fin) != (size_t) key->len ||
+                    memcmp(key_data, key->data, key->len));
+            flint_free(key_data);
+        }
+        if (code)
+        {
+            fprintf(stderr, "the tableau file %s was written ", filename);
+            fprintf(stderr, "for different parameters or sequences\n");
+        }
+    }
+    if (!code)
+    {
+        n = (uint64_t) (header.nrows * header.ncols);
+        memset(mat->data, 0, n * sizeof(dp_t));
+        for (bit = 0; bit < 8 && !code; bit++)
+        {
+            code = _read_plane(fin, mat->data, n, bit);
+        }
+        if (code)
+        {
+            fprintf(stderr, "the tableau file %s is corrupt\n", filename);
+        }
+    }
+    fclose(fin);
+
+    if (!code)
+    {
+        *certified = (int) header.certified;
+        *level = (slong) header.level;
+    }
+    return code;
+}
@@ -0,0 +1,53 @@
+#ifndef TABLEAU_FILE_H
+#define TABLEAU_FILE_H
+
+/*
+ * A compact file format for a finished dynamic programming tableau,
+ * so that the tools can share the result of one expensive solve.
+ *
+ * The file starts with a header that records the tableau dimensions,
+ * whether the tableau was certified by symbolic verification,
+ * the precision level of its last refinement round, and the hash of
+ * a key that identifies the model parameters and the sequences.
+ * The canonical bytes of the key follow the header, and a file is only
+ * read for a key with the same bytes, because a certified tableau must
+ * not be trusted on a hash alone. They are followed by the eight flag planes of the tableau,
+ * one bit per cell each, compressed by run length encoding with
+ * variable length integers. The flags of a refined tableau
+ * are mostly constant over long runs of cells, so this is typically
+ * much smaller than the one byte per cell of the tableau in memory.
+ */
+
+#include <stdint.h>
+
+#include "flint/flint.h"
+
+#include "dp.h"
+#include "model_params.h"
+#include "result_cache.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Init the key of the model parameters and the sequences, holding their
+ * exact rationals and encoded values (see 'result_cache.h');
+ * clear it with result_key_clear.
+ */
+void tableau_file_key_init(result_key_t key, const model_params_t p,
+        const slong *A, slong szA, const slong *B, slong szB);
+
+int tableau_file_write(const char *filename, const result_key_t key,
+        const dp_mat_t mat, int certified, slong level);
+
+int tableau_file_read(const char *filename, const result_key_t key,
+        dp_mat_t mat, int *certified, slong *level);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
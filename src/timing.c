@@ -0,0 +1,128 @@
+#include <time.h>
+
+#include "timing.h"
+
+
+static double _seconds(clockid_t clock);
+static void _read(timing_ptr t, timing_mark_t m);
+
+double
+_seconds(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+void
+_read(timing_ptr t, timing_mark_t m)
+{
+    m->counted = (t && t->counters && pthread_equal(t->owner, pthread_self()));
+    if (m->counted)
+    {
+        perf_counters_read(m->counts, &m->running, t->counters);
+    }
+    m->wall = _seconds(CLOCK_MONOTONIC);
+    m->cpu = _seconds(CLOCK_THREAD_CPUTIME_ID);
+}
+
+
+void
+timing_init(timing_t t)
+{
+    t->phases = NULL;
+    t->len = 0;
+    t->alloc = 0;
+    pthread_mutex_init(&t->lock, NULL);
+    t->counters = NULL;
+}
+
+void
+timing_clear(timing_t t)
+{
+    flint_free(t->phases);
+    pthread_mutex_destroy(&t->lock);
+}
+
+void
+timing_reset(timing_t t)
+{
+    pthread_mutex_lock(&t->lock);
+    t->len = 0;
+    pthread_mutex_unlock(&t->lock);
+}
+
+void
+timing_set_counters(timing_t t, perf_counters_ptr counters)
+{
+    t->counters = counters;
+    t->owner = pthread_self();
+}
+
+void
+timing_mark(timing_ptr t, timing_mark_t m)
+{
+    _read(t, m);
+    m->accounted = (t && memstats_installed());
+    if (m->accounted)
+    {
+        memstats_mark(m->memory);
+    }
+}
+
+void
+timing_finish(timing_ptr t, timing_phase_struct *x,
+        const char *phase, slong level, const timing_mark_t start)
+{
+    timing_mark_t now;
+    memstats_t memory;
+    int i;
+
+    _read(t, now);
+    x->phase = phase;
+    x->level = level;
+    x->wall_seconds = now->wall - start->wall;
+    x->cpu_seconds = now->cpu - start->cpu;
+    /* the counts of a group that was not scheduled are not counts */
+    x->counted = (start->counted && now->counted &&
+            now->running > start->running);
+    for (i = 0; i < PERF_COUNTERS; i++)
+    {
+        x->counts[i] = x->counted ? now->counts[i] - start->counts[i] : 0;
+    }
+    x->accounted = start->accounted;
+    x->heap_peak_bytes = 0;
+    x->allocations = 0;
+    x->allocated_bytes = 0;
+    if (x->accounted)
+    {
+        memstats_interval(memory, start->memory);
+        x->heap_peak_bytes = memory->peak;
+        x->allocations = memory->allocations;
+        x->allocated_bytes = memory->allocated_bytes;
+    }
+}
+
+void
+timing_record(timing_ptr t, const char *phase, slong level,
+        const timing_mark_t start)
+{
+    timing_phase_struct x;
+
+    if (!t)
+    {
+        return;
+    }
+    timing_finish(t, &x, phase, level, start);
+
+    pthread_mutex_lock(&t->lock);
+    if (t->len == t->alloc)
+    {
+        t->alloc = FLINT_MAX(16, 2 * t->alloc);
+        t->phases = flint_realloc(t->phases,
+                t->alloc * sizeof(timing_phase_struct));
+    }
+    t->phases[t->len] = x;
+    t->len++;
+    pthread_mutex_unlock(&t->lock);
+}
@@ -0,0 +1,108 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+/*
+ * A collector of the wall clock and cpu times of the phases of a solve,
+ * such as the model setup steps, each forward pass at each precision
+ * level, the backward pass, the symbolic verification and the traceback.
+ *
+ * A phase is timed by taking a mark when it starts and recording it
+ * when it ends. The wall time is monotonic, and the cpu time is that of
+ * the thread that ran the phase, so that phases run by concurrent
+ * solvers are not charged for each other's work. Phases can be
+ * recorded from several threads, and recording into a NULL collector
+ * does nothing, so the solvers time their phases unconditionally.
+ *
+ * A collector can also read hardware performance counters around each
+ * phase. The counters count only the thread that set them, so they are
+ * recorded only for the phases that start and end on that thread,
+ * and only if the kernel had the counters on the hardware for some of
+ * the phase; otherwise the phase is not counted rather than zero.
+ * If the heap accounting of 'memstats.h' is installed, then each phase
+ * also gets the number and size of the allocations made by its thread,
+ * and the most that the heap use of that thread rose during the phase.
+ * The phases of a thread must then be nested.
+ */
+
+#include <pthread.h>
+
+#include "flint/flint.h"
+#include "perf_counters.h"
+#include "memstats.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the level of a phase that is not run at a precision level */
+#define TIMING_NO_LEVEL (-2)
+
+typedef struct
+{
+    double wall;
+    double cpu;
+    int counted;
+    double counts[PERF_COUNTERS];
+    double running;
+    int accounted;
+    memstats_mark_t memory;
+} timing_mark_struct;
+typedef timing_mark_struct timing_mark_t[1];
+
+typedef struct
+{
+    const char * phase;
+    slong level;
+    double wall_seconds;
+    double cpu_seconds;
+    int counted;
+    double counts[PERF_COUNTERS];
+    int accounted;
+    slong heap_peak_bytes;
+    slong allocations;
+    slong allocated_bytes;
+} timing_phase_struct;
+
+/* the phase names are static strings, in the order they were recorded */
+typedef struct
+{
+    timing_phase_struct * phases;
+    slong len;
+    slong alloc;
+    pthread_mutex_t lock;
+    perf_counters_ptr counters;
+    pthread_t owner;
+} timing_struct;
+typedef timing_struct timing_t[1];
+typedef timing_struct * timing_ptr;
+
+void timing_init(timing_t t);
+void timing_clear(timing_t t);
+
+/* forget the recorded phases */
+void timing_reset(timing_t t);
+
+/* read the counters, opened by the calling thread, around each phase */
+void timing_set_counters(timing_t t, perf_counters_ptr counters);
+
+/*
+ * The current monotonic wall time and cpu time of the calling thread,
+ * and the counts of the collector if it has counters of this thread.
+ */
+void timing_mark(timing_ptr t, timing_mark_t m);
+
+/* record a phase that started at the mark and ends now */
+void timing_record(timing_ptr t, const char *phase, slong level,
+        const timing_mark_t start);
+
+/* as above, but set the phase instead of recording it */
+void timing_finish(timing_ptr t, timing_phase_struct *x,
+        const char *phase, slong level, const timing_mark_t start);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -10,12 +10,17 @@
 void
 solution_init(solution_t x, slong aln_maxlen)
 {
-    x->A = flint_calloc(aln_maxlen + 1, sizeof(char));
-    x->B = flint_calloc(aln_maxlen + 1, sizeof(char));
+    x->A = NULL;
+    x->B = NULL;
+    x->ops = NULL;
     x->len = -1;
+    x->alloc = aln_maxlen;
     arb_init(x->log_probability);
     x->optimality_flag = 0;
     x->mat = NULL;
+    x->level = -1;
+    x->unresolved = 0;
+    x->interrupted = 0;
 }
 
 void
@@ -26,6 +31,54 @@ solution_clear(solution_t x)
     arb_clear(x->log_probability);
 }
 
+void
+solution_traceback(solution_t x, const slong *A, const slong *B)
+{
+    /* trace back through the tableau, into the ops array if any */
+    if (x->ops)
+    {
+        dp_mat_get_ops(x->ops, &(x->len), x->mat);
+    }
+    else
+    {
+        solution_fit_strings(x);
+        dp_mat_get_alignment(x->A, x->B, &(x->len), x->mat, A, B);
+    }
+}
+
+void
+solution_fit_strings(solution_t x)
+{
+    if (!x->A)
+    {
+        x->A = flint_calloc(x->alloc + 1, sizeof(char));
+        x->B = flint_calloc(x->alloc + 1, sizeof(char));
+    }
+}
+
+const char *
+tkf91_error_string(int status)
+{
+    switch (status)
+    {
+        case TKF91_SUCCESS:
+            return "success";
+        case TKF91_ERROR_REQUEST:
+            return "the request requires a traceback, "
+                   "a tableau, or a model context that was not provided";
+        case TKF91_ERROR_DIMENSIONS:
+            return "the sequence lengths are incompatible "
+                   "with the tableau dimensions";
+        case TKF91_ERROR_PRECISION:
+            return "the maximum precision level was reached "
+                   "before the alignment was verified";
+        case TKF91_ERROR_THREAD:
+            return "failed to create a thread";
+        default:
+            return "unknown error";
+    }
+}
+
 void
 solution_fprint(FILE * file, const solution_t x)
 {
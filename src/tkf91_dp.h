@@ -14,6 +14,10 @@
 
 #include "expressions.h"
 #include "dp.h"
+#include "budget.h"
+#include "checkpoint.h"
+#include "timing.h"
+#include "diagnostics.h"
 #include "tkf91_generator_indices.h"
 
 
@@ -26,21 +30,45 @@ extern "C" {
  * The construction and destruction is defined and performed
  * in the arbtk91.c module; the specific tkf91 dynamic programming
  * solvers themselves do not need to know about those functions.
+ *
+ * The level is the precision level of the last refinement round
+ * performed by a tableau-based solver, with -1 denoting the mag_t round.
+ * The interrupted flag is set if the request budget ran out before the
+ * solver finished, in which case the alignment is the best available
+ * so far and the unresolved count gives the number of tableau cells
+ * for which more than one candidate remains. A solver without a tableau
+ * has no alignment so far, so its interrupted solution has len -1.
+ *
+ * The ops array is NULL unless the caller wants the alignment as one
+ * DP_OP_* code per column instead of as the two gapped strings; like
+ * the mat tableau, it is allocated and freed by the caller, with room
+ * for len_A + len_B columns. The A and B strings are NULL until
+ * a traceback first writes them, with room for alloc columns,
+ * so they are never allocated when there is an ops array.
  */
 typedef struct
 {
     char * A;
     char * B;
+    unsigned char * ops;
     slong len;
+    slong alloc;
     arb_t log_probability;
     int optimality_flag;
     dp_mat_ptr mat;
+    slong level;
+    slong unresolved;
+    int interrupted;
 } solution_struct;
 typedef solution_struct solution_t[1];
 
 void solution_init(solution_t sol, slong aln_maxlen);
 void solution_clear(solution_t sol);
 void solution_fprint(FILE * file, const solution_t sol);
+void solution_traceback(solution_t sol, const slong *A, const slong *B);
+
+/* allocate the A and B strings if they are not allocated yet */
+void solution_fit_strings(solution_t sol);
 
 static __inline__ void
 solution_print(const solution_t x)
@@ -57,17 +85,55 @@ solution_print(const solution_t x)
  * The rtol option specifies a relative tolerance to be used in the
  * traceback phase of 'float' and 'double' precision dynamic programming;
  * the rtol option is ignored for more sophisticated precision settings.
+ * The budget is NULL unless the work of the tableau-based solvers
+ * is limited by a deadline or by a cancellation flag.
+ * The checkpoint is NULL unless the high precision solver should save
+ * its progress, or resume from a previously saved state.
+ * The ctx is NULL unless the generator matrix, the expressions table,
+ * and the generator indices were taken from a tkf91 model context,
+ * in which case the solvers use its precomputed generator logs
+ * and Hermite decomposition instead of computing them again.
+ * The timing is NULL unless the phases of the solve should be timed.
+ * The diagnostics are NULL unless the certification effort of the
+ * refinement rounds of the high precision solver should be recorded.
  */
+struct tkf91_model_context_struct_tag;
+
 typedef struct
 {
     int trace;
     double rtol;
+    budget_ptr budget;
+    checkpoint_ptr checkpoint;
+    const struct tkf91_model_context_struct_tag *ctx;
+    timing_ptr timing;
+    diagnostics_ptr diagnostics;
 } request_struct;
 typedef request_struct request_t[1];
 
 
+/*
+ * The dynamic programming functions return TKF91_SUCCESS,
+ * or one of the error codes below if the request could not be
+ * carried out, in which case the solution is unspecified
+ * but may still be cleared. A budget interruption is not an error.
+ *
+ * The solvers keep their scratch space in workspaces that belong
+ * to a single call, and they only read the model context and the
+ * generator matrix, so concurrent calls may share a model context
+ * as long as each call has its own solution, tableau and request.
+ */
+#define TKF91_SUCCESS 0
+#define TKF91_ERROR_REQUEST 1
+#define TKF91_ERROR_DIMENSIONS 2
+#define TKF91_ERROR_PRECISION 3
+#define TKF91_ERROR_THREAD 4
+
+const char * tkf91_error_string(int status);
+
+
 /* function pointer typedef for the dynamic programming function */
-typedef void (*tkf91_dp_fn)(
+typedef int (*tkf91_dp_fn)(
         solution_t, const request_t,
         fmpz_mat_t, expr_ptr *,
         const tkf91_generator_indices_t,
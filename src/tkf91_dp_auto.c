@@ -0,0 +1,363 @@
+/*
+ * tkf91 dynamic programming using a portfolio of precision tiers.
+ *
+ * The double precision engine, the mag_t bound pass and an early arb
+ * precision level are run concurrently on separate threads,
+ * each with its own tableau. The first tableau pass that is verified
+ * symbolically wins, and the other passes, including the double
+ * precision pass, are cancelled through a shared budget flag.
+ * The double precision pass keeps a full tableau of three doubles
+ * per cell for its traceback, which is most of the memory used.
+ *
+ * If neither tableau is verified, then their flags are intersected
+ * (each is a valid superset of the optimal flags, so the intersection
+ * is one too) and the usual serial refinement continues from the next
+ * precision level. If the request budget runs out first, then the
+ * intersected tableau gives the best alignment found so far,
+ * and if no tableau pass completed at all then the uncertified
+ * double precision alignment is reported. If even the double precision
+ * pass did not finish, then the solution has no alignment.
+ *
+ * The request must have a model context, whose precomputed generator
+ * logs, Hermite decomposition and frozen expressions are only read,
+ * so the workers share it without synchronization.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "arb.h"
+
+#include "tkf91_dp.h"
+#include "tkf91_dp_auto.h"
+#include "tkf91_dp_bound.h"
+#include "tkf91_dp_d.h"
+#include "tkf91_dp_r.h"
+#include "bound_mat.h"
+#include "budget.h"
+#include "dp.h"
+
+
+/* the first arb precision level used by the serial refinement */
+#define AUTO_ARB_LEVEL 6
+
+
+typedef struct
+{
+    /* shared inputs, read-only while the workers are running */
+    const request_struct *req;
+    fmpz_mat_struct *mat;
+    expr_ptr *expressions_table;
+    const tkf91_generator_indices_struct *g;
+    const slong *A;
+    size_t szA;
+    const slong *B;
+    size_t szB;
+    int use_ops;
+
+    /* shared cancellation flag and the mutex that guards the winner */
+    volatile int cancel;
+    pthread_mutex_t lock;
+    slong winner;
+} portfolio_struct;
+typedef portfolio_struct portfolio_t[1];
+
+typedef struct
+{
+    portfolio_struct *shared;
+    slong index;
+    slong level; /* -1 for mag_t bounds, otherwise an arb level */
+    int use_tableau;
+    solution_t sol;
+    dp_mat_t tableau;
+    budget_t budget;
+    request_t req;
+    int finished;
+    int status;
+} worker_struct;
+typedef worker_struct worker_t[1];
+
+static void worker_init(worker_t w, portfolio_struct *shared,
+        slong index, slong level, int use_tableau);
+static void worker_clear(worker_t w);
+static void * _worker_run(void *arg);
+static void _intersect_flags(dp_mat_t mat, const dp_mat_t other);
+static void _solution_take(solution_t sol, const solution_t src);
+
+
+void
+worker_init(worker_t w, portfolio_struct *shared,
+        slong index, slong level, int use_tableau)
+{
+    slong nrows, ncols;
+
+    nrows = shared->szA + 1;
+    ncols = shared->szB + 1;
+
+    w->shared = shared;
+    w->index = index;
+    w->level = level;
+    w->use_tableau = use_tableau;
+    w->finished = 0;
+    w->status = TKF91_SUCCESS;
+
+    /* the workers write the alignment in the form the caller wants */
+    solution_init(w->sol, nrows + ncols);
+    if (shared->use_ops)
+    {
+        w->sol->ops = flint_malloc(nrows + ncols);
+    }
+    if (use_tableau)
+    {
+        dp_mat_init(w->tableau, nrows, ncols);
+        w->sol->mat = w->tableau;
+    }
+
+    /* each worker stops if cancelled or if the request budget expires */
+    budget_init(w->budget);
+    budget_set_cancel(w->budget, &shared->cancel);
+    budget_set_parent(w->budget, shared->req->budget);
+
+    w->req->trace = shared->req->trace;
+    w->req->rtol = shared->req->rtol;
+    w->req->budget = w->budget;
+    w->req->checkpoint = NULL;
+    w->req->timing = shared->req->timing;
+    w->req->diagnostics = NULL;
+    w->req->ctx = shared->req->ctx;
+}
+
+void
+worker_clear(worker_t w)
+{
+    if (w->use_tableau)
+    {
+        dp_mat_clear(w->tableau);
+    }
+    flint_free(w->sol->ops);
+    solution_clear(w->sol);
+    budget_clear(w->budget);
+}
+
+void *
+_worker_run(void *arg)
+{
+    worker_struct *w = arg;
+    portfolio_struct *p = w->shared;
+
+    if (!w->use_tableau)
+    {
+        w->status = tkf91_dp_d(w->sol, w->req,
+                p->mat, p->expressions_table, p->g,
+                p->A, p->szA, p->B, p->szB);
+    }
+    else
+    {
+        w->sol->level = w->level;
+        if (w->level < 0)
+        {
+            w->status = tkf91_dp_mag(w->sol, w->req,
+                    p->mat, p->expressions_table, p->g,
+                    p->A, p->szA, p->B, p->szB);
+        }
+        else
+        {
+            w->status = tkf91_dp_r_level(w->level, w->sol, w->req,
+                    p->mat, p->expressions_table, p->g,
+                    p->A, p->szA, p->B, p->szB);
+        }
+        if (!w->status && !w->sol->interrupted)
+        {
+            tkf91_dp_verify_symbolically(
+                    &w->sol->optimality_flag,
+                    p->mat, p->g, w->sol->mat,
+                    p->expressions_table,
+                    p->A, p->B, w->req, NULL);
+        }
+        if (w->sol->optimality_flag)
+        {
+            pthread_mutex_lock(&p->lock);
+            if (p->winner < 0)
+            {
+                p->winner = w->index;
+                p->cancel = 1;
+            }
+            pthread_mutex_unlock(&p->lock);
+        }
+    }
+    w->finished = !w->status && !w->sol->interrupted;
+
+    /* release the thread-local caches used by flint and arb */
+    flint_cleanup();
+    return NULL;
+}
+
+void
+_intersect_flags(dp_mat_t mat, const dp_mat_t other)
+{
+    /*
+     * Only the candidate flags are intersected;
+     * the flags that mark interesting cells and trace candidates
+     * are recomputed by a subsequent backward pass.
+     */
+    slong k, n;
+    dp_t candidates;
+
+    candidates = DP_MAX3_M0 | DP_MAX3_M1 | DP_MAX3_M2 |
+                 DP_MAX2_M1 | DP_MAX2_M2;
+    n = dp_mat_nrows(mat) * dp_mat_ncols(mat);
+    for (k = 0; k < n; k++)
+    {
+        mat->data[k] &= (other->data[k] | ~candidates);
+    }
+}
+
+void
+_solution_take(solution_t sol, const solution_t src)
+{
+    slong len = src->len;
+    if (len < 0)
+    {
+        /* the source was interrupted before it had an alignment */
+    }
+    else if (sol->ops)
+    {
+        memcpy(sol->ops, src->ops, len);
+    }
+    else
+    {
+        solution_fit_strings(sol);
+        memcpy(sol->A, src->A, (len + 1) * sizeof(char));
+        memcpy(sol->B, src->B, (len + 1) * sizeof(char));
+    }
+    sol->len = len;
+    arb_set(sol->log_probability, src->log_probability);
+    sol->optimality_flag = src->optimality_flag;
+    sol->level = src->level;
+}
+
+
+int
+tkf91_dp_auto(
+        solution_t sol, const request_t req,
+        fmpz_mat_t mat, expr_ptr * expressions_table,
+        const tkf91_generator_indices_t g,
+        const slong *A, size_t szA,
+        const slong *B, size_t szB)
+{
+    portfolio_t p;
+    worker_t workers[3];
+    pthread_t threads[3];
+    slong i, nworkers, nthreads;
+    int status;
+
+    if (!req->trace || !sol->mat || !req->ctx)
+    {
+        return TKF91_ERROR_REQUEST;
+    }
+
+    if (dp_mat_nrows(sol->mat) != (slong) szA + 1 ||
+        dp_mat_ncols(sol->mat) != (slong) szB + 1)
+    {
+        return TKF91_ERROR_DIMENSIONS;
+    }
+
+    p->req = req;
+    p->mat = mat;
+    p->expressions_table = expressions_table;
+    p->g = g;
+    p->A = A;
+    p->szA = szA;
+    p->B = B;
+    p->szB = szB;
+    p->use_ops = (sol->ops != NULL);
+    p->cancel = 0;
+    p->winner = -1;
+    pthread_mutex_init(&p->lock, NULL);
+
+    nworkers = 3;
+    worker_init(workers[0], p, 0, -1, 1);
+    worker_init(workers[1], p, 1, AUTO_ARB_LEVEL, 1);
+    worker_init(workers[2], p, 2, 0, 0);
+
+    status = TKF91_SUCCESS;
+    for (nthreads = 0; nthreads < nworkers; nthreads++)
+    {
+        if (pthread_create(threads + nthreads, NULL,
+                    _worker_run, workers[nthreads]))
+        {
+            /* stop the workers that were already started */
+            status = TKF91_ERROR_THREAD;
+            p->cancel = 1;
+            break;
+        }
+    }
+    for (i = 0; i < nthreads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    for (i = 0; i < nthreads && !status; i++)
+    {
+        status = workers[i]->status;
+    }
+
+    if (status)
+    {
+        /* a worker failed, so there is no solution to report */
+    }
+    else if (p->winner >= 0)
+    {
+        /* a tableau was verified symbolically */
+        worker_struct *w = workers[p->winner];
+        dp_mat_set(sol->mat, w->tableau);
+        _solution_take(sol, w->sol);
+        sol->interrupted = 0;
+        sol->unresolved = dp_mat_count_unresolved(sol->mat);
+    }
+    else if (workers[0]->finished || workers[1]->finished)
+    {
+        /* combine what the completed tableau passes have learned */
+        if (workers[0]->finished)
+        {
+            dp_mat_set(sol->mat, workers[0]->tableau);
+            if (workers[1]->finished)
+            {
+                _intersect_flags(sol->mat, workers[1]->tableau);
+            }
+        }
+        else
+        {
+            dp_mat_set(sol->mat, workers[1]->tableau);
+        }
+        dp_mat_backward(sol->mat);
+        if (workers[1]->finished)
+        {
+            status = tkf91_dp_refine(AUTO_ARB_LEVEL + 1,
+                    sol, req, mat, expressions_table, g,
+                    A, szA, B, szB);
+        }
+        else
+        {
+            status = tkf91_dp_refine(AUTO_ARB_LEVEL,
+                    sol, req, mat, expressions_table, g,
+                    A, szA, B, szB);
+        }
+    }
+    else
+    {
+        /* the budget ran out before any tableau pass completed */
+        _solution_take(sol, workers[2]->sol);
+        sol->level = -1;
+        sol->interrupted = 1;
+        sol->unresolved = dp_mat_count_unresolved(sol->mat);
+    }
+
+    for (i = 0; i < nworkers; i++)
+    {
+        worker_clear(workers[i]);
+    }
+    pthread_mutex_destroy(&p->lock);
+
+    return status;
+}
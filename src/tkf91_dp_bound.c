@@ -10,10 +10,11 @@
 
 #include "tkf91_dp.h"
 #include "tkf91_dp_bound.h"
+#include "tkf91_dp_r.h"
 #include "dp.h"
 #include "forward.h"
-#include "printutil.h"
 #include "unused.h"
+#include "tkf91_model_context.h"
 
 
 typedef struct
@@ -38,7 +39,8 @@ static void tkf91_values_clear(tkf91_values_t h);
 
 static void _bounds_init(tkf91_values_t lb, tkf91_values_t ub,
         fmpz_mat_t mat, expr_ptr * expressions_table,
-        const tkf91_generator_indices_t g);
+        const tkf91_generator_indices_t g,
+        tkf91_model_context_srcptr ctx);
 
 
 static __inline__ void
@@ -102,11 +104,11 @@ tkf91_values_clear(tkf91_values_t h)
 void
 _bounds_init(tkf91_values_t lb, tkf91_values_t ub,
         fmpz_mat_t mat, expr_ptr * expressions_table,
-        const tkf91_generator_indices_t g)
+        const tkf91_generator_indices_t g,
+        tkf91_model_context_srcptr ctx)
 {
-    slong nr, nc, level, prec;
-    arb_mat_t G, U, V;
-    arb_t x;
+    slong nr, level, prec;
+    arb_mat_t V;
     arb_ptr v;
     mag_ptr lb_arr, ub_arr;
     slong i;
@@ -117,27 +119,10 @@ _bounds_init(tkf91_values_t lb, tkf91_values_t ub,
     level = 8;
     prec = 1 << level;
 
-    /* count the generators and expressions respectively */
-    nr = fmpz_mat_nrows(mat);
-    nc = fmpz_mat_ncols(mat);
-
-    /* initialize the arbitrary precision integer exponent matrix */
-    arb_mat_init(G, nr, nc);
-    arb_mat_set_fmpz_mat(G, mat);
-
-    /* compute logs of expressions to the specified precision */
-    arb_init(x);
-    arb_mat_init(U, nc, 1);
-    for (i = 0; i < nc; i++)
-    {
-        expr_eval(x, expressions_table[i], level);
-        arb_log(arb_mat_entry(U, i, 0), x, prec);
-    }
-    arb_clear(x);
-
     /* compute logs of generators */
+    nr = fmpz_mat_nrows(mat);
     arb_mat_init(V, nr, 1);
-    arb_mat_mul(V, G, U, prec);
+    tkf91_generator_logs(V, ctx, mat, expressions_table, level);
 
     /* copy the column vector to a new vector and exponentiate its entries */
     v = _arb_vec_init(nr);
@@ -163,8 +148,6 @@ _bounds_init(tkf91_values_t lb, tkf91_values_t ub,
     _mag_vec_clear(lb_arr, nr);
     _mag_vec_clear(ub_arr, nr);
     _arb_vec_clear(v, nr);
-    arb_mat_clear(G);
-    arb_mat_clear(U);
     arb_mat_clear(V);
 }
 
@@ -231,6 +214,7 @@ static void utility_init(utility_t p,
         fmpz_mat_t mat,
         expr_ptr * expressions_table,
         const tkf91_generator_indices_t g,
+        tkf91_model_context_srcptr ctx,
         const slong *A, const slong *B);
 
 void
@@ -238,9 +222,10 @@ utility_init(utility_t p,
         fmpz_mat_t mat,
         expr_ptr * expressions_table,
         const tkf91_generator_indices_t g,
+        tkf91_model_context_srcptr ctx,
         const slong *A, const slong *B)
 {
-    _bounds_init(p->lb, p->ub, mat, expressions_table, g);
+    _bounds_init(p->lb, p->ub, mat, expressions_table, g, ctx);
     mag_init(p->lb_m0);
     mag_init(p->lb_m1);
     mag_init(p->lb_m2);
@@ -283,7 +268,7 @@ void *
 _init(void *userdata, size_t num)
 {
     UNUSED(userdata);
-    cell_ptr p = malloc(num * sizeof(cell_struct));
+    cell_ptr p = flint_malloc(num * sizeof(cell_struct));
     size_t i;
     for (i = 0; i < num; i++)
     {
@@ -303,7 +288,7 @@ _clear(void *userdata, void *celldata, size_t num)
     {
         cell_clear(p + i);
     }
-    free(p);
+    flint_free(p);
 }
 
 
@@ -495,7 +480,7 @@ _visit(void *userdata, dp_mat_t mat,
 
 
 
-void
+int
 tkf91_dp_mag(
         solution_t sol, const request_t req,
         fmpz_mat_t mat, expr_ptr * expressions_table,
@@ -506,24 +491,11 @@ tkf91_dp_mag(
     utility_t util;
     forward_strategy_t s;
     slong nrows, ncols;
-    clock_t start;
-    int verbose = 0;
-    FILE *file = NULL;
-    if (verbose)
-    {
-        file = stderr;
-    }
+    timing_mark_t start;
 
-    if (!req->trace)
+    if (!req->trace || !sol->mat)
     {
-        fprintf(stderr, "tkf91_dp_mag: req->trace is required\n");
-        abort();
-    }
-
-    if (!sol->mat)
-    {
-        fprintf(stderr, "tkf91_dp_mag: sol->mat is required\n");
-        abort();
+        return TKF91_ERROR_REQUEST;
     }
 
     nrows = dp_mat_nrows(sol->mat);
@@ -531,31 +503,32 @@ tkf91_dp_mag(
     if (nrows != (slong) szA + 1 ||
         ncols != (slong) szB + 1)
     {
-        fprintf(stderr, "tkf91_dp_mag: the sequence lengths are ");
-        fprintf(stderr, "incompatible with the tableau dimensions\n");
-        abort();
+        return TKF91_ERROR_DIMENSIONS;
     }
 
-    start = clock();
-    utility_init(util, mat, expressions_table, g, A, B);
+    timing_mark(req->timing, start);
+    utility_init(util, mat, expressions_table, g, req->ctx, A, B);
     s->init = _init;
     s->clear = _clear;
     s->visit = _visit;
     s->sz_celldata = sizeof(cell_struct);
     s->userdata = util;
-    dp_forward(sol->mat, s);
+    s->budget = req->budget;
+    s->checkpoint = req->checkpoint;
+    sol->interrupted = (dp_forward(sol->mat, s) == FORWARD_INTERRUPTED);
     utility_clear(util);
-    _fprint_elapsed(file, "dynamic programming", clock() - start);
+    timing_record(req->timing, "forward", -1, start);
 
     /* update flags using a backward pass through the tableau */
-    start = clock();
+    timing_mark(req->timing, start);
     dp_mat_backward(sol->mat);
-    _fprint_elapsed(file, "backward algorithm pass", clock() - start);
+    timing_record(req->timing, "backward", -1, start);
 
     /* extract the alignment */
-    start = clock();
-    dp_mat_get_alignment(
-            sol->A, sol->B, &(sol->len),
-            sol->mat, A, B);
-    _fprint_elapsed(file, "alignment traceback", clock() - start);
+    timing_mark(req->timing, start);
+    solution_traceback(sol, A, B);
+    tkf91_dp_score(sol, req, mat, expressions_table, g, A, B);
+    timing_record(req->timing, "traceback", -1, start);
+
+    return TKF91_SUCCESS;
 }
@@ -1,14 +1,24 @@
 /*
  * Double precision tkf91 dynamic programming.
+ *
+ * The budget of the request, if any, is checked between rows as in the
+ * forward pass of the tableau-based solvers. If it runs out, then the
+ * solution is marked as interrupted, without an alignment (its length
+ * is -1) and without a log probability.
+ *
+ * The alignment is traced back through the full tableau of the three
+ * values of each cell, or, by tkf91_dp_d_checkpointed, through blocks of
+ * rows that are recomputed from rows kept during the forward pass.
  */
 
+#include <string.h>
 #include <time.h>
 
 #include "arb_mat.h"
 
 #include "tkf91_dp.h"
 #include "tkf91_dp_d.h"
-#include "printutil.h"
+#include "tkf91_model_context.h"
 
 
 typedef struct
@@ -28,10 +38,32 @@ typedef struct
 } tmat_struct;
 typedef tmat_struct tmat_t[1];
 
+/* the generators in double precision */
+typedef struct
+{
+    double m1_00;
+    double m0_10;
+    double m0_i0_incr[4];
+    double m2_01;
+    double m2_0j_incr[4];
+    double c0_incr[4];
+    double c1_incr[16];
+    double c2_incr[4];
+} dgen_struct;
+
 static void tmat_init(tmat_t mat, slong nrows, slong ncols);
 static void tmat_clear(tmat_t mat);
 static void tmat_get_alignment(solution_t sol, double rtol,
         const tmat_t mat, const slong *A, const slong *B);
+static int _traceback_op(const tnode_struct *cell, double rtol);
+static void _finish_alignment(solution_t sol, unsigned char *ops, slong len,
+        const slong *A, const slong *B);
+static void _dgen_init(dgen_struct *d,
+        const tkf91_generator_indices_t g, const arb_mat_t m);
+static void _top_row(tnode_ptr row, const dgen_struct *d,
+        const slong *B, slong ncols);
+static void _next_row(tnode_ptr curr, const tnode_struct *prev, slong i,
+        const dgen_struct *d, const slong *A, const slong *B, slong ncols);
 
 static __inline__ slong
 tmat_nrows(const tmat_t mat)
@@ -78,7 +110,7 @@ tmat_entry_left(tmat_t mat, slong i, slong j)
 void
 tmat_init(tmat_t mat, slong nrows, slong ncols)
 {
-    mat->data = flint_malloc(nrows * ncols * sizeof(tmat_struct));
+    mat->data = flint_malloc(nrows * ncols * sizeof(tnode_struct));
     mat->r = nrows;
     mat->c = ncols;
 }
@@ -103,22 +135,67 @@ _almost_equal(double a, double b, double rtol)
     return fabs(b - a) / fmin(fabs(b), fabs(a)) < rtol;
 }
 
+/*
+ * The operation that leads to the best value of the cell, or -1 if none
+ * of the values is close enough to the best one.
+ */
+int
+_traceback_op(const tnode_struct *cell, double rtol)
+{
+    double max3 = fmax(cell->m0, fmax(cell->m1, cell->m2));
+    if (_almost_equal(cell->m0, max3, rtol))
+    {
+        return DP_OP_DELETE;
+    }
+    else if (_almost_equal(cell->m1, max3, rtol))
+    {
+        return DP_OP_MATCH;
+    }
+    else if (_almost_equal(cell->m2, max3, rtol))
+    {
+        return DP_OP_INSERT;
+    }
+    flint_printf("lost the thread ");
+    flint_printf("in the dynamic programing traceback\n");
+    abort();
+    return -1;
+}
+
+/* reverse the traced operations, and expand them if there is no ops array */
+void
+_finish_alignment(solution_t sol, unsigned char *ops, slong len,
+        const slong *A, const slong *B)
+{
+    slong i, j;
+    unsigned char tmp;
+    for (i = 0; i < len/2; i++)
+    {
+        j = len - 1 - i;
+        tmp = ops[i]; ops[i] = ops[j]; ops[j] = tmp;
+    }
+    if (!sol->ops)
+    {
+        dp_ops_get_alignment(sol->A, sol->B, ops, len, A, B);
+    }
+    sol->len = len;
+}
+
 void
 tmat_get_alignment(
         solution_t sol, double rtol,
         const tmat_t mat, const slong *A, const slong *B)
 {
     slong i, j;
-    char ACGT[4] = "ACGT";
-    char tmp;
     slong len, nrows, ncols;
-    double max3;
     tnode_ptr cell;
-    char * sa;
-    char * sb;
+    unsigned char * ops;
 
-    sa = sol->A;
-    sb = sol->B;
+    /* without an ops array, the operations are expanded in place */
+    if (!sol->ops)
+    {
+        solution_fit_strings(sol);
+    }
+    ops = sol->ops ? sol->ops : (unsigned char *) sol->A;
 
     nrows = tmat_nrows(mat);
     ncols = tmat_ncols(mat);
@@ -128,42 +205,12 @@ tmat_get_alignment(
     while (i > 0 || j > 0)
     {
         cell = tmat_srcentry(mat, i, j);
-        max3 = fmax(cell->m0, fmax(cell->m1, cell->m2));
-        if (_almost_equal(cell->m0, max3, rtol))
-        {
-            sa[len] = ACGT[A[i-1]];
-            sb[len] = '-';
-            i--;
-        }
-        else if (_almost_equal(cell->m1, max3, rtol))
-        {
-            sa[len] = ACGT[A[i-1]];
-            sb[len] = ACGT[B[j-1]];
-            i--;
-            j--;
-        }
-        else if (_almost_equal(cell->m2, max3, rtol))
-        {
-            sa[len] = '-';
-            sb[len] = ACGT[B[j-1]];
-            j--;
-        }
-        else
-        {
-            flint_printf("lost the thread ");
-            flint_printf("in the dynamic programing traceback\n");
-            abort();
-        }
+        ops[len] = _traceback_op(cell, rtol);
+        i -= (ops[len] != DP_OP_INSERT);
+        j -= (ops[len] != DP_OP_DELETE);
         len++;
     }
-    for (i = 0; i < len/2; i++)
-    {
-        j = len - 1 - i;
-        tmp = sa[i]; sa[i] = sa[j]; sa[j] = tmp;
-        tmp = sb[i]; sb[i] = sb[j]; sb[j] = tmp;
-    }
-
-    sol->len = len;
+    _finish_alignment(sol, ops, len, A, B);
 }
 
 static __inline__ double
@@ -180,6 +227,97 @@ _doublify(slong i, const arb_mat_t m)
     return _arb_get_d(arb_mat_entry(m, i, 0));
 }
 
+void
+_dgen_init(dgen_struct *d,
+        const tkf91_generator_indices_t g, const arb_mat_t m)
+{
+    slong i, j;
+    d->m1_00 = _doublify(g->m1_00, m);
+    d->m0_10 = _doublify(g->m0_10, m);
+    d->m2_01 = _doublify(g->m2_01, m);
+    for (i = 0; i < 4; i++)
+    {
+        d->m0_i0_incr[i] = _doublify(g->m0_i0_incr[i], m);
+        d->m2_0j_incr[i] = _doublify(g->m2_0j_incr[i], m);
+        d->c0_incr[i] = _doublify(g->c0_incr[i], m);
+        for (j = 0; j < 4; j++)
+        {
+            d->c1_incr[i*4+j] = _doublify(g->c1_incr[i*4+j], m);
+        }
+        d->c2_incr[i] = _doublify(g->c2_incr[i], m);
+    }
+}
+
+/* the corner and the top edge */
+void
+_top_row(tnode_ptr row, const dgen_struct *d, const slong *B, slong ncols)
+{
+    slong j;
+    tnode_ptr cell, p2;
+
+    cell = row;
+    cell->m0 = -INFINITY;
+    cell->m1 = d->m1_00;
+    cell->m2 = -INFINITY;
+    for (j = 1; j < ncols; j++)
+    {
+        cell = row + j;
+        cell->m0 = -INFINITY;
+        cell->m1 = -INFINITY;
+        if (j == 1)
+        {
+            cell->m2 = d->m2_01;
+        }
+        else
+        {
+            p2 = cell - 1;
+            cell->m2 = fmax(p2->m1, p2->m2) + d->m2_0j_incr[B[j - 1]];
+        }
+    }
+}
+
+/* row i > 0, from row i - 1 */
+void
+_next_row(tnode_ptr curr, const tnode_struct *prev, slong i,
+        const dgen_struct *d, const slong *A, const slong *B, slong ncols)
+{
+    slong j, nta, ntb;
+    tnode_ptr cell;
+    const tnode_struct *p0, *p1, *p2;
+    const double *c1_incr_nta;
+    double c0_incr_nta;
+
+    nta = A[i - 1];
+    c0_incr_nta = d->c0_incr[nta];
+    c1_incr_nta = d->c1_incr + 4*nta;
+
+    /* left edge */
+    cell = curr;
+    cell->m1 = -INFINITY;
+    cell->m2 = -INFINITY;
+    if (i == 1)
+    {
+        cell->m0 = d->m0_10;
+    }
+    else
+    {
+        p0 = prev;
+        cell->m0 = fmax(p0->m0, fmax(p0->m1, p0->m2)) + d->m0_i0_incr[nta];
+    }
+
+    for (j = 1; j < ncols; j++)
+    {
+        ntb = B[j - 1];
+        cell = curr + j;
+        p0 = prev + j;
+        p1 = prev + j - 1;
+        p2 = curr + j - 1;
+        cell->m0 = fmax(p0->m0, fmax(p0->m1, p0->m2)) + c0_incr_nta;
+        cell->m1 = fmax(p1->m0, fmax(p1->m1, p1->m2)) + c1_incr_nta[ntb];
+        cell->m2 = fmax(p2->m1, p2->m2) + d->c2_incr[ntb];
+    }
+}
+
 
 void
 tkf91_dynamic_programming_double_tmat(
@@ -197,21 +335,92 @@ tkf91_dynamic_programming_double_tmat(
         const slong *A, slong szA,
         const slong *B, slong szB)
 {
+    dgen_struct d[1];
     slong nrows, ncols;
     tmat_t tmat;
+    slong i;
+    tnode_ptr cell;
+    timing_mark_t start;
+
+    /* start the clock */
+    timing_mark(req->timing, start);
+
+    /* init the dynamic programming 'generators' */
+    _dgen_init(d, g, m);
+
+    nrows = szA + 1;
+    ncols = szB + 1;
+
+    tmat_init(tmat, nrows, ncols);
+
+    /* corner and top edge, then the left edge and interior of each row */
+    _top_row(tmat->data, d, B, ncols);
+    for (i = 1; i < nrows; i++)
+    {
+        if (req->budget && budget_expired(req->budget))
+        {
+            break;
+        }
+        _next_row(tmat->data + i*ncols, tmat->data + (i-1)*ncols,
+                i, d, A, B, ncols);
+    }
+
+    if (i < nrows)
+    {
+        sol->interrupted = 1;
+        sol->len = -1;
+        arb_indeterminate(sol->log_probability);
+        timing_record(req->timing, "forward", TIMING_NO_LEVEL, start);
+        tmat_clear(tmat);
+        return;
+    }
+
+    /* compute the log probability of the optimal alignment */
+    double logp;
+    cell = tmat_entry(tmat, nrows-1, ncols-1);
+    logp = fmax(cell->m0, fmax(cell->m1, cell->m2));
+    arb_set_d(sol->log_probability, logp);
+
+    timing_record(req->timing, "forward", TIMING_NO_LEVEL, start);
+
+
+    /* do the traceback if requested */
+    if (req->trace)
+    {
+        timing_mark(req->timing, start);
+        tmat_get_alignment(sol, req->rtol, tmat, A, B);
+        timing_record(req->timing, "traceback", TIMING_NO_LEVEL, start);
+    }
+
+    tmat_clear(tmat);
+}
+
+void
+tkf91_dynamic_programming_double_score(
+        solution_t sol, budget_ptr budget,
+        const tkf91_generator_indices_t g,
+        const arb_mat_t m,
+        const slong *A, slong szA,
+        const slong *B, slong szB);
+
+void
+tkf91_dynamic_programming_double_score(
+        solution_t sol, budget_ptr budget,
+        const tkf91_generator_indices_t g,
+        const arb_mat_t m,
+        const slong *A, slong szA,
+        const slong *B, slong szB)
+{
+    /*
+     * Compute only the log probability of the best alignment,
+     * keeping two rows of the tableau instead of the full tableau.
+     */
+    slong ncols;
+    tnode_ptr prev_row, curr_row, tmp_row, cell, p0, p1, p2;
     double p0_max3, p1_max3, p2_max2;
     slong i, j;
-    tnode_ptr cell, p0, p1, p2;
     slong nta, ntb;
-    clock_t start;
-    int verbose = 0;
-    FILE * file = NULL;
-    if (verbose)
-    {
-        file = stderr;
-    }
 
-    /* dynamic programming 'generators' as local variables */
     double m1_00;
     double m0_10;
     double m0_i0_incr[4];
@@ -221,14 +430,6 @@ tkf91_dynamic_programming_double_tmat(
     double c1_incr[16];
     double c2_incr[4];
 
-    /* values that are cached per row in the main loop */
-    double c0_incr_nta;
-    double * c1_incr_nta;
-
-    /* start the clock */
-    start = clock();
-
-    /* init the dynamic programming 'generators' */
     m1_00 = _doublify(g->m1_00, m);
     m0_10 = _doublify(g->m0_10, m);
     m2_01 = _doublify(g->m2_01, m);
@@ -244,25 +445,19 @@ tkf91_dynamic_programming_double_tmat(
         c2_incr[i] = _doublify(g->c2_incr[i], m);
     }
 
-    nrows = szA + 1;
     ncols = szB + 1;
+    prev_row = flint_malloc(2 * ncols * sizeof(tnode_struct));
+    curr_row = prev_row + ncols;
 
-    tmat_init(tmat, nrows, ncols);
-
-    /* corner */
-    i = 0;
-    j = 0;
-    cell = tmat_entry(tmat, i, j);
+    /* top edge, including the corner */
+    cell = prev_row;
     cell->m0 = -INFINITY;
-    cell->m2 = -INFINITY;
     cell->m1 = m1_00;
-
-    /* top edge */
-    i = 0;
+    cell->m2 = -INFINITY;
     for (j = 1; j < ncols; j++)
     {
         ntb = B[j - 1];
-        cell = tmat_entry(tmat, i, j);
+        cell = prev_row + j;
         cell->m0 = -INFINITY;
         cell->m1 = -INFINITY;
         if (j == 1)
@@ -271,18 +466,23 @@ tkf91_dynamic_programming_double_tmat(
         }
         else
         {
-            p2 = tmat_entry_left(tmat, i, j);
+            p2 = cell - 1;
             p2_max2 = fmax(p2->m1, p2->m2);
             cell->m2 = p2_max2 + m2_0j_incr[ntb];
         }
     }
 
-    /* left edge */
-    j = 0;
-    for (i = 1; i < nrows; i++)
+    for (i = 1; i < szA + 1; i++)
     {
+        if (budget && budget_expired(budget))
+        {
+            break;
+        }
+
         nta = A[i - 1];
-        cell = tmat_entry(tmat, i, j);
+
+        /* left edge */
+        cell = curr_row;
         cell->m1 = -INFINITY;
         cell->m2 = -INFINITY;
         if (i == 1)
@@ -291,77 +491,169 @@ tkf91_dynamic_programming_double_tmat(
         }
         else
         {
-            p0 = tmat_entry_top(tmat, i, j);
+            p0 = prev_row;
             p0_max3 = fmax(p0->m0, fmax(p0->m1, p0->m2));
             cell->m0 = p0_max3 + m0_i0_incr[nta];
         }
-    }
-
-    /* main loop */
-    tnode_ptr prev_row;
-    tnode_ptr curr_row;
-    i = 1;
-    prev_row = tmat->data + (i-1)*ncols;
-    curr_row = tmat->data + i*ncols;
-    while (i < nrows)
-    {
-        nta = A[i - 1];
 
-        /* precompute stuff for this row */
-        c0_incr_nta = c0_incr[nta];
-        c1_incr_nta = c1_incr + 4*nta;
-
-        j = 1;
-        cell = curr_row + j;
-        p0 = prev_row + j;
-        p1 = prev_row + j - 1;
-        p2 = curr_row + j - 1;
-        while (j < ncols)
+        for (j = 1; j < ncols; j++)
         {
             ntb = B[j - 1];
+            cell = curr_row + j;
+            p0 = prev_row + j;
+            p1 = prev_row + j - 1;
+            p2 = curr_row + j - 1;
 
             p0_max3 = fmax(p0->m0, fmax(p0->m1, p0->m2));
             p1_max3 = fmax(p1->m0, fmax(p1->m1, p1->m2));
             p2_max2 = fmax(p2->m1, p2->m2);
 
-            cell->m0 = p0_max3 + c0_incr_nta;
-            cell->m1 = p1_max3 + c1_incr_nta[ntb];
+            cell->m0 = p0_max3 + c0_incr[nta];
+            cell->m1 = p1_max3 + c1_incr[4*nta + ntb];
             cell->m2 = p2_max2 + c2_incr[ntb];
-
-            j++;
-            cell++;
-            p0++;
-            p1++;
-            p2++;
         }
-        i++;
-        prev_row += ncols;
-        curr_row += ncols;
+
+        tmp_row = prev_row;
+        prev_row = curr_row;
+        curr_row = tmp_row;
     }
 
-    /* compute the log probability of the optimal alignment */
-    double logp;
-    cell = tmat_entry(tmat, nrows-1, ncols-1);
-    logp = fmax(cell->m0, fmax(cell->m1, cell->m2));
-    arb_set_d(sol->log_probability, logp);
+    /* after the final swap the last row is in prev_row */
+    if (i < szA + 1)
+    {
+        sol->interrupted = 1;
+        sol->len = -1;
+        arb_indeterminate(sol->log_probability);
+    }
+    else
+    {
+        cell = prev_row + ncols - 1;
+        arb_set_d(sol->log_probability,
+                fmax(cell->m0, fmax(cell->m1, cell->m2)));
+        sol->len = 0;
+    }
+
+    flint_free(prev_row < curr_row ? prev_row : curr_row);
+}
+
+void
+tkf91_dynamic_programming_double_checkpointed(
+        solution_t sol, const request_t req,
+        const tkf91_generator_indices_t g,
+        const arb_mat_t m,
+        const slong *A, slong szA,
+        const slong *B, slong szB);
 
-    _fprint_elapsed(file, "forward dynamic programming", clock() - start);
+void
+tkf91_dynamic_programming_double_checkpointed(
+        solution_t sol, const request_t req,
+        const tkf91_generator_indices_t g,
+        const arb_mat_t m,
+        const slong *A, slong szA,
+        const slong *B, slong szB)
+{
+    /*
+     * Keep the rows 0, k, 2k, ... of the forward pass, with k about the
+     * square root of the number of rows, and during the traceback
+     * recompute the rows of one block at a time from its first row.
+     * This takes O(ncols sqrt(nrows)) memory and a second forward pass,
+     * and the traceback takes the same steps as through the full tableau.
+     */
+    dgen_struct d[1];
+    slong nrows, ncols, k, nsaved, i, j, r, r0, block, len;
+    tnode_ptr saved, rows, prev, curr, tmp;
+    const tnode_struct *cell;
+    unsigned char * ops;
+    size_t row_bytes;
+    timing_mark_t start;
+
+    timing_mark(req->timing, start);
+    _dgen_init(d, g, m);
 
+    nrows = szA + 1;
+    ncols = szB + 1;
+    row_bytes = ncols * sizeof(tnode_struct);
+    k = (slong) sqrt((double) (nrows - 1)) + 1;
+    nsaved = (nrows - 1) / k + 1;
+    saved = flint_malloc(nsaved * row_bytes);
+    rows = flint_malloc((k + 1) * row_bytes);
+
+    /* the forward pass, in two of the rows of the block buffer */
+    prev = rows;
+    curr = rows + ncols;
+    _top_row(prev, d, B, ncols);
+    memcpy(saved, prev, row_bytes);
+    for (i = 1; i < nrows; i++)
+    {
+        if (req->budget && budget_expired(req->budget))
+        {
+            break;
+        }
+        _next_row(curr, prev, i, d, A, B, ncols);
+        if (i % k == 0)
+        {
+            memcpy(saved + (i / k) * ncols, curr, row_bytes);
+        }
+        tmp = prev;
+        prev = curr;
+        curr = tmp;
+    }
 
-    /* do the traceback if requested */
-    if (req->trace)
+    if (i < nrows)
     {
-        start = clock();
-        tmat_get_alignment(sol, req->rtol, tmat, A, B);
-        _fprint_elapsed(file, "traceback", clock() - start);
+        sol->interrupted = 1;
+        sol->len = -1;
+        arb_indeterminate(sol->log_probability);
+        timing_record(req->timing, "forward", TIMING_NO_LEVEL, start);
+        flint_free(saved);
+        flint_free(rows);
+        return;
     }
 
-    start = clock();
-    tmat_clear(tmat);
-    _fprint_elapsed(file, "cleanup", clock() - start);
+    /* after the final swap the last row is in prev */
+    cell = prev + ncols - 1;
+    arb_set_d(sol->log_probability,
+            fmax(cell->m0, fmax(cell->m1, cell->m2)));
+    timing_record(req->timing, "forward", TIMING_NO_LEVEL, start);
+
+    /* trace back through the block holding row i, which is r0 < i <= r0+k */
+    timing_mark(req->timing, start);
+    if (!sol->ops)
+    {
+        solution_fit_strings(sol);
+    }
+    ops = sol->ops ? sol->ops : (unsigned char *) sol->A;
+    i = nrows - 1;
+    j = ncols - 1;
+    len = 0;
+    block = -1;
+    while (i > 0 || j > 0)
+    {
+        r0 = (i > 0) ? ((i - 1) / k) * k : 0;
+        if (r0 != block)
+        {
+            memcpy(rows, saved + (r0 / k) * ncols, row_bytes);
+            for (r = r0 + 1; r <= FLINT_MIN(r0 + k, nrows - 1); r++)
+            {
+                _next_row(rows + (r - r0) * ncols,
+                        rows + (r - r0 - 1) * ncols, r, d, A, B, ncols);
+            }
+            block = r0;
+        }
+        cell = rows + (i - r0) * ncols + j;
+        ops[len] = _traceback_op(cell, req->rtol);
+        i -= (ops[len] != DP_OP_INSERT);
+        j -= (ops[len] != DP_OP_DELETE);
+        len++;
+    }
+    _finish_alignment(sol, ops, len, A, B);
+    timing_record(req->timing, "traceback", TIMING_NO_LEVEL, start);
+
+    flint_free(saved);
+    flint_free(rows);
 }
 
-void
+int
 tkf91_dp_d(
         solution_t sol, const request_t req,
         fmpz_mat_t mat, expr_ptr * expressions_table,
@@ -370,39 +662,57 @@ tkf91_dp_d(
         const slong *B, size_t szB)
 {
     slong level = 8;
-    slong prec = 1 << level;
-
-    arb_t x;
-    arb_mat_t G;
-    arb_mat_t expression_logs;
     arb_mat_t generator_logs;
-    slong i;
     slong generator_count = fmpz_mat_nrows(mat);
-    slong expression_count = fmpz_mat_ncols(mat);
 
-    arb_init(x);
+    /* compute the generator logarithms */
+    arb_mat_init(generator_logs, generator_count, 1);
+    tkf91_generator_logs(generator_logs, req->ctx,
+            mat, expressions_table, level);
 
-    /* initialize the arbitrary precision exponent matrix */
-    arb_mat_init(G, generator_count, expression_count);
-    arb_mat_set_fmpz_mat(G, mat);
+    /* the full tableau is needed only for the traceback */
+    if (req->trace)
+    {
+        tkf91_dynamic_programming_double_tmat(
+                sol, req, g, generator_logs, A, szA, B, szB);
+    }
+    else
+    {
+        timing_mark_t start;
+        timing_mark(req->timing, start);
+        tkf91_dynamic_programming_double_score(
+                sol, req->budget, g, generator_logs, A, szA, B, szB);
+        timing_record(req->timing, "forward", TIMING_NO_LEVEL, start);
+    }
 
-    /* compute the expression logarithms */
-    arb_mat_init(expression_logs, expression_count, 1);
-    for (i = 0; i < expression_count; i++)
+    arb_mat_clear(generator_logs);
+    return TKF91_SUCCESS;
+}
+
+int
+tkf91_dp_d_checkpointed(
+        solution_t sol, const request_t req,
+        fmpz_mat_t mat, expr_ptr * expressions_table,
+        const tkf91_generator_indices_t g,
+        const slong *A, size_t szA,
+        const slong *B, size_t szB)
+{
+    slong level = 8;
+    arb_mat_t generator_logs;
+    slong generator_count = fmpz_mat_nrows(mat);
+
+    /* without a traceback this is the two row score pass */
+    if (!req->trace)
     {
-        expr_eval(x, expressions_table[i], level);
-        arb_log(arb_mat_entry(expression_logs, i, 0), x, prec);
+        return tkf91_dp_d(sol, req, mat, expressions_table, g,
+                A, szA, B, szB);
     }
 
-    /* compute the generator logarithms */
     arb_mat_init(generator_logs, generator_count, 1);
-    arb_mat_mul(generator_logs, G, expression_logs, prec);
-
-    tkf91_dynamic_programming_double_tmat(
+    tkf91_generator_logs(generator_logs, req->ctx,
+            mat, expressions_table, level);
+    tkf91_dynamic_programming_double_checkpointed(
             sol, req, g, generator_logs, A, szA, B, szB);
-
-    arb_clear(x);
-    arb_mat_clear(G);
-    arb_mat_clear(expression_logs);
     arb_mat_clear(generator_logs);
+    return TKF91_SUCCESS;
 }
@@ -14,7 +14,19 @@ extern "C" {
 #endif
 
 
-void tkf91_dp_d(
+int tkf91_dp_d(
+        solution_t, const request_t,
+        fmpz_mat_t mat, expr_ptr * expressions_table,
+        const tkf91_generator_indices_t g,
+        const slong *A, size_t szA,
+        const slong *B, size_t szB);
+
+/*
+ * As above, but the traceback keeps only about sqrt(len_A) rows of the
+ * tableau at a time, recomputing blocks of rows from rows kept during
+ * the forward pass; it finds the same alignment as tkf91_dp_d.
+ */
+int tkf91_dp_d_checkpointed(
         solution_t, const request_t,
         fmpz_mat_t mat, expr_ptr * expressions_table,
         const tkf91_generator_indices_t g,
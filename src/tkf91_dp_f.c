@@ -8,7 +8,7 @@
 
 #include "tkf91_dp.h"
 #include "tkf91_dp_f.h"
-#include "printutil.h"
+#include "tkf91_model_context.h"
 
 
 typedef struct
@@ -78,7 +78,7 @@ tmat_entry_left(tmat_t mat, slong i, slong j)
 void
 tmat_init(tmat_t mat, slong nrows, slong ncols)
 {
-    mat->data = flint_malloc(nrows * ncols * sizeof(tmat_struct));
+    mat->data = flint_malloc(nrows * ncols * sizeof(tnode_struct));
     mat->r = nrows;
     mat->c = ncols;
 }
@@ -109,16 +109,18 @@ tmat_get_alignment(
         const tmat_t mat, const slong *A, const slong *B)
 {
     slong i, j;
-    char ACGT[4] = "ACGT";
-    char * sa;
-    char * sb;
-    char tmp;
+    unsigned char * ops;
+    unsigned char tmp;
     slong len, nrows, ncols;
     float max3;
     tnode_ptr cell;
 
-    sa = sol->A;
-    sb = sol->B;
+    /* without an ops array, the operations are expanded in place */
+    if (!sol->ops)
+    {
+        solution_fit_strings(sol);
+    }
+    ops = sol->ops ? sol->ops : (unsigned char *) sol->A;
 
     nrows = tmat_nrows(mat);
     ncols = tmat_ncols(mat);
@@ -131,21 +133,18 @@ tmat_get_alignment(
         max3 = fmaxf(cell->m0, fmaxf(cell->m1, cell->m2));
         if (_almost_equal(cell->m0, max3, rtol))
         {
-            sa[len] = ACGT[A[i-1]];
-            sb[len] = '-';
+            ops[len] = DP_OP_DELETE;
             i--;
         }
         else if (_almost_equal(cell->m1, max3, rtol))
         {
-            sa[len] = ACGT[A[i-1]];
-            sb[len] = ACGT[B[j-1]];
+            ops[len] = DP_OP_MATCH;
             i--;
             j--;
         }
         else if (_almost_equal(cell->m2, max3, rtol))
         {
-            sa[len] = '-';
-            sb[len] = ACGT[B[j-1]];
+            ops[len] = DP_OP_INSERT;
             j--;
         }
         else
@@ -159,8 +158,11 @@ tmat_get_alignment(
     for (i = 0; i < len/2; i++)
     {
         j = len - 1 - i;
-        tmp = sa[i]; sa[i] = sa[j]; sa[j] = tmp;
-        tmp = sb[i]; sb[i] = sb[j]; sb[j] = tmp;
+        tmp = ops[i]; ops[i] = ops[j]; ops[j] = tmp;
+    }
+    if (!sol->ops)
+    {
+        dp_ops_get_alignment(sol->A, sol->B, ops, len, A, B);
     }
 
     sol->len = len;
@@ -204,13 +206,7 @@ tkf91_dynamic_programming_float_tmat(
     slong i, j;
     tnode_ptr cell, p0, p1, p2;
     slong nta, ntb;
-    clock_t start;
-    int verbose = 0;
-    FILE * file = NULL;
-    if (verbose)
-    {
-        file = stderr;
-    }
+    timing_mark_t start;
 
     /* dynamic programming 'generators' as local variables */
     float m1_00;
@@ -227,7 +223,7 @@ tkf91_dynamic_programming_float_tmat(
     float * c1_incr_nta;
 
     /* start the clock */
-    start = clock();
+    timing_mark(req->timing, start);
 
     /* init the dynamic programming 'generators' */
     m1_00 = _floatify(g->m1_00, m);
@@ -345,28 +341,26 @@ tkf91_dynamic_programming_float_tmat(
     cell = tmat_entry(tmat, nrows-1, ncols-1);
     logp = fmaxf(cell->m0, fmaxf(cell->m1, cell->m2));
     arb_set_d(sol->log_probability, (double) logp);
-    _fprint_elapsed(file, "forward dynamic programming", clock() - start);
+    timing_record(req->timing, "forward", TIMING_NO_LEVEL, start);
 
     /* do the traceback if requested */
     if (req->trace)
     {
         float rtol;
         rtol = (float) req->rtol;
-        start = clock();
+        timing_mark(req->timing, start);
         tmat_get_alignment(sol, rtol, tmat, A, B);
-        _fprint_elapsed(file, "traceback", clock() - start);
+        timing_record(req->timing, "traceback", TIMING_NO_LEVEL, start);
     }
 
-    start = clock();
     tmat_clear(tmat);
-    _fprint_elapsed(file, "cleanup", clock() - start);
 }
 
 
 
 
 
-void
+int
 tkf91_dp_f(
         solution_t sol, const request_t req,
         fmpz_mat_t mat, expr_ptr * expressions_table,
@@ -375,39 +369,17 @@ tkf91_dp_f(
         const slong *B, size_t szB)
 {
     slong level = 8;
-    slong prec = 1 << level;
-
-    arb_t x;
-    arb_mat_t G;
-    arb_mat_t expression_logs;
     arb_mat_t generator_logs;
-    slong i;
     slong generator_count = fmpz_mat_nrows(mat);
-    slong expression_count = fmpz_mat_ncols(mat);
-
-    arb_init(x);
-
-    /* initialize the arbitrary precision exponent matrix */
-    arb_mat_init(G, generator_count, expression_count);
-    arb_mat_set_fmpz_mat(G, mat);
-
-    /* compute the expression logarithms */
-    arb_mat_init(expression_logs, expression_count, 1);
-    for (i = 0; i < expression_count; i++)
-    {
-        expr_eval(x, expressions_table[i], level);
-        arb_log(arb_mat_entry(expression_logs, i, 0), x, prec);
-    }
 
     /* compute the generator logarithms */
     arb_mat_init(generator_logs, generator_count, 1);
-    arb_mat_mul(generator_logs, G, expression_logs, prec);
+    tkf91_generator_logs(generator_logs, req->ctx,
+            mat, expressions_table, level);
 
     tkf91_dynamic_programming_float_tmat(
             sol, req, g, generator_logs, A, szA, B, szB);
 
-    arb_clear(x);
-    arb_mat_clear(G);
-    arb_mat_clear(expression_logs);
     arb_mat_clear(generator_logs);
+    return TKF91_SUCCESS;
 }
@@ -15,9 +15,9 @@
 #include "tkf91_dp_bound.h"
 #include "dp.h"
 #include "forward.h"
-#include "printutil.h"
 #include "unused.h"
 #include "bound_mat.h"
+#include "tkf91_model_context.h"
 
 
 typedef struct
@@ -43,7 +43,8 @@ static void tkf91_values_clear(tkf91_values_t h);
 
 static void _bounds_init(tkf91_values_t v, slong level,
         fmpz_mat_t mat, expr_ptr * expressions_table,
-        const tkf91_generator_indices_t g);
+        const tkf91_generator_indices_t g,
+        tkf91_model_context_srcptr ctx);
 
 static void _arb_mat_get_col(arb_ptr v, const arb_mat_t mat, slong j);
 static void _arb_max(arb_t z, const arb_t x, const arb_t y);
@@ -134,38 +135,16 @@ tkf91_values_clear(tkf91_values_t h)
 void
 _bounds_init(tkf91_values_t h, slong level,
         fmpz_mat_t mat, expr_ptr * expressions_table,
-        const tkf91_generator_indices_t g)
+        const tkf91_generator_indices_t g,
+        tkf91_model_context_srcptr ctx)
 {
-    slong nr, nc, prec;
-    arb_mat_t G, U, V;
-
-    prec = 1 << level;
-
-    /* count the generators and expressions respectively */
-    nr = fmpz_mat_nrows(mat);
-    nc = fmpz_mat_ncols(mat);
-
-    /* initialize the arbitrary precision integer exponent matrix */
-    arb_mat_init(G, nr, nc);
-    arb_mat_set_fmpz_mat(G, mat);
-
-    /* compute logs of expressions to the specified precision */
-    {
-        slong i;
-        arb_t x;
-        arb_init(x);
-        arb_mat_init(U, nc, 1);
-        for (i = 0; i < nc; i++)
-        {
-            expr_eval(x, expressions_table[i], level);
-            arb_log(arb_mat_entry(U, i, 0), x, prec);
-        }
-        arb_clear(x);
-    }
+    slong nr;
+    arb_mat_t V;
 
     /* compute logs of generators */
+    nr = fmpz_mat_nrows(mat);
     arb_mat_init(V, nr, 1);
-    arb_mat_mul(V, G, U, prec);
+    tkf91_generator_logs(V, ctx, mat, expressions_table, level);
 
     /* 
      * Copy the column vector to a new vector
@@ -179,8 +158,6 @@ _bounds_init(tkf91_values_t h, slong level,
         _arb_vec_clear(v, nr);
     }
 
-    arb_mat_clear(G);
-    arb_mat_clear(U);
     arb_mat_clear(V);
 }
 
@@ -239,6 +216,7 @@ static void utility_init(utility_t p,
         fmpz_mat_t mat,
         expr_ptr * expressions_table,
         const tkf91_generator_indices_t g,
+        tkf91_model_context_srcptr ctx,
         const slong *A, const slong *B);
 
 void
@@ -247,9 +225,10 @@ utility_init(utility_t p,
         fmpz_mat_t mat,
         expr_ptr * expressions_table,
         const tkf91_generator_indices_t g,
+        tkf91_model_context_srcptr ctx,
         const slong *A, const slong *B)
 {
-    _bounds_init(p->h, level, mat, expressions_table, g);
+    _bounds_init(p->h, level, mat, expressions_table, g, ctx);
     arb_init(p->m0);
     arb_init(p->m1);
     arb_init(p->m2);
@@ -286,7 +265,7 @@ void *
 _init(void *userdata, size_t num)
 {
     UNUSED(userdata);
-    cell_ptr p = malloc(num * sizeof(cell_struct));
+    cell_ptr p = flint_malloc(num * sizeof(cell_struct));
     size_t i;
     for (i = 0; i < num; i++)
     {
@@ -306,7 +285,7 @@ _clear(void *userdata, void *celldata, size_t num)
     {
         cell_clear(p + i);
     }
-    free(p);
+    flint_free(p);
 }
 
 
@@ -482,7 +461,7 @@ _visit(void *userdata, dp_mat_t mat,
 }
 
 
-void
+int
 tkf91_dp_r(
         solution_t sol, const request_t req,
         fmpz_mat_t mat, expr_ptr * expressions_table,
@@ -491,12 +470,12 @@ tkf91_dp_r(
         const slong *B, size_t szB)
 {
     slong level = 8;
-    tkf91_dp_r_level(level,
+    return tkf91_dp_r_level(level,
             sol, req, mat, expressions_table, g, A, szA, B, szB);
 }
 
 
-void
+int
 tkf91_dp_r_level(slong level,
         solution_t sol, const request_t req,
         fmpz_mat_t mat, expr_ptr * expressions_table,
@@ -507,26 +486,11 @@ tkf91_dp_r_level(slong level,
     utility_t util;
     forward_strategy_t s;
     slong nrows, ncols;
-    clock_t start;
-    int verbose = 0;
-    FILE *file = NULL;
-    if (verbose)
-    {
-        file = stderr;
-    }
-
-    if (!req->trace)
-    {
-        flint_fprintf(stderr, "tkf91_dp_r_(level %wd): ", level);
-        flint_fprintf(stderr, "req->trace is required\n");
-        abort();
-    }
+    timing_mark_t start;
 
-    if (!sol->mat)
+    if (!req->trace || !sol->mat)
     {
-        flint_fprintf(stderr, "tkf91_dp_r_(level %wd): ", level);
-        flint_fprintf(stderr, "sol->mat is required\n");
-        abort();
+        return TKF91_ERROR_REQUEST;
     }
 
     nrows = dp_mat_nrows(sol->mat);
@@ -534,38 +498,125 @@ tkf91_dp_r_level(slong level,
     if (nrows != (slong) szA + 1 ||
         ncols != (slong) szB + 1)
     {
-        flint_fprintf(stderr, "tkf91_dp_r_(level %wd): ", level);
-        flint_fprintf(stderr, "the sequence lengths are ");
-        flint_fprintf(stderr, "incompatible with the tableau dimensions\n");
-        abort();
+        return TKF91_ERROR_DIMENSIONS;
     }
 
-    start = clock();
-    utility_init(util, level, mat, expressions_table, g, A, B);
+    if (level < 0 || EXPR_CACHE_CAP <= level)
+    {
+        return TKF91_ERROR_PRECISION;
+    }
+
+    timing_mark(req->timing, start);
+    utility_init(util, level, mat, expressions_table, g, req->ctx, A, B);
     s->init = _init;
     s->clear = _clear;
     s->visit = _visit;
     s->sz_celldata = sizeof(cell_struct);
     s->userdata = util;
-    dp_forward(sol->mat, s);
+    s->budget = req->budget;
+    s->checkpoint = req->checkpoint;
+    sol->interrupted = (dp_forward(sol->mat, s) == FORWARD_INTERRUPTED);
     utility_clear(util);
-    _fprint_elapsed(file, "dynamic programming", clock() - start);
+    timing_record(req->timing, "forward", level, start);
 
     /* update flags using a backward pass through the tableau */
-    start = clock();
+    timing_mark(req->timing, start);
     dp_mat_backward(sol->mat);
-    _fprint_elapsed(file, "backward algorithm pass", clock() - start);
+    timing_record(req->timing, "backward", level, start);
 
     /* extract the alignment */
-    start = clock();
-    dp_mat_get_alignment(
-            sol->A, sol->B, &(sol->len),
-            sol->mat, A, B);
-    _fprint_elapsed(file, "alignment traceback", clock() - start);
+    timing_mark(req->timing, start);
+    solution_traceback(sol, A, B);
+    tkf91_dp_score(sol, req, mat, expressions_table, g, A, B);
+    timing_record(req->timing, "traceback", level, start);
+
+    return TKF91_SUCCESS;
 }
 
 
 void
+tkf91_dp_score(
+        solution_t sol, const request_t req,
+        fmpz_mat_t mat, expr_ptr * expressions_table,
+        const tkf91_generator_indices_t g,
+        const slong *A, const slong *B)
+{
+    slong i, j, k, prec;
+    unsigned char *ops;
+    arb_mat_t logs;
+    arb_ptr x;
+
+    if (sol->len < 0)
+    {
+        arb_indeterminate(sol->log_probability);
+        return;
+    }
+
+    /* the path is read from the ops, converting the strings if needed */
+    ops = sol->ops;
+    if (!ops)
+    {
+        ops = flint_malloc(FLINT_MAX(sol->len, 1));
+        dp_alignment_get_ops(ops, sol->A, sol->B, sol->len);
+    }
+
+    prec = WORD(1) << TKF91_DP_SCORE_LEVEL;
+    arb_mat_init(logs, fmpz_mat_nrows(mat), 1);
+    tkf91_generator_logs(logs, req->ctx, mat, expressions_table,
+            TKF91_DP_SCORE_LEVEL);
+
+#define LOG(index) arb_mat_entry(logs, (index), 0)
+
+    /*
+     * Each step adds the same increment as the forward recurrence, which
+     * depends only on the state entered and on the residues it consumes;
+     * the first cell on each edge holds an absolute value instead.
+     */
+    x = sol->log_probability;
+    arb_set(x, LOG(g->m1_00));
+    i = 0;
+    j = 0;
+    for (k = 0; k < sol->len; k++)
+    {
+        if (ops[k] == DP_OP_DELETE)
+        {
+            i++;
+            if (j == 0 && i == 1)
+                arb_set(x, LOG(g->m0_10));
+            else if (j == 0)
+                arb_add(x, x, LOG(g->m0_i0_incr[A[i-1]]), prec);
+            else
+                arb_add(x, x, LOG(g->c0_incr[A[i-1]]), prec);
+        }
+        else if (ops[k] == DP_OP_INSERT)
+        {
+            j++;
+            if (i == 0 && j == 1)
+                arb_set(x, LOG(g->m2_01));
+            else if (i == 0)
+                arb_add(x, x, LOG(g->m2_0j_incr[B[j-1]]), prec);
+            else
+                arb_add(x, x, LOG(g->c2_incr[B[j-1]]), prec);
+        }
+        else
+        {
+            i++;
+            j++;
+            arb_add(x, x, LOG(g->c1_incr[4*A[i-1] + B[j-1]]), prec);
+        }
+    }
+
+#undef LOG
+
+    arb_mat_clear(logs);
+    if (ops != sol->ops)
+    {
+        flint_free(ops);
+    }
+}
+
+
+int
 tkf91_dp_high(
         solution_t sol, const request_t req,
         fmpz_mat_t mat, expr_ptr * expressions_table,
@@ -574,27 +625,104 @@ tkf91_dp_high(
         const slong *B, size_t szB)
 {
     slong level = -1;
+    if (req->checkpoint && req->checkpoint->resumed)
+    {
+        level = req->checkpoint->level;
+    }
+    return tkf91_dp_refine(level,
+            sol, req, mat, expressions_table, g,
+            A, szA, B, szB);
+}
+
+
+int
+tkf91_dp_refine(slong level,
+        solution_t sol, const request_t req,
+        fmpz_mat_t mat, expr_ptr * expressions_table,
+        const tkf91_generator_indices_t g,
+        const slong *A, size_t szA,
+        const slong *B, size_t szB)
+{
+    /*
+     * Refine the tableau using increasingly precise arithmetic,
+     * starting at the given level (-1 for mag_t bounds),
+     * until the traceback is verified symbolically.
+     * If the request has a budget, then stop refining when it runs out;
+     * the first round is always run to completion or interruption.
+     * The tableau flags remain a valid superset of the optimal
+     * flags after an interrupted round, so the solution still holds
+     * the best alignment found so far.
+     * If the request has a checkpoint, then the state is saved after
+     * each round that does not finish the refinement.
+     * If the request has diagnostics, then each round is recorded.
+     */
+    checkpoint_ptr c = req->checkpoint;
+    diagnostics_round_struct *round;
+    int first = 1;
+    int status = TKF91_SUCCESS;
     sol->optimality_flag = 0;
+    sol->interrupted = 0;
     while (!sol->optimality_flag)
     {
+        if (!first && req->budget && budget_expired(req->budget))
+        {
+            sol->interrupted = 1;
+            break;
+        }
+        first = 0;
+        sol->level = level;
+        if (c)
+        {
+            c->level = level;
+        }
+        round = diagnostics_begin(req->diagnostics, level, sol->mat);
         if (level < 0)
         {
-            tkf91_dp_mag(
+            status = tkf91_dp_mag(
                     sol, req, mat, expressions_table, g,
                     A, szA, B, szB);
             level = 6;
         }
         else
         {
-            tkf91_dp_r_level(level,
+            status = tkf91_dp_r_level(level,
                     sol, req, mat, expressions_table, g,
                     A, szA, B, szB);
             level++;
         }
-        tkf91_dp_verify_symbolically(
-                &sol->optimality_flag, 
-                mat, g, sol->mat,
-                expressions_table,
-                A, B);
+        if (status)
+        {
+            return status;
+        }
+        if (sol->interrupted)
+        {
+            diagnostics_end(req->diagnostics, round, sol->mat, 1, 0);
+
+            /* the round in progress will be repeated on resumption */
+            if (c)
+            {
+                checkpoint_write(c, sol->mat, 0);
+            }
+            break;
+        }
+        {
+            timing_mark_t start;
+            timing_mark(req->timing, start);
+            tkf91_dp_verify_symbolically(
+                    &sol->optimality_flag,
+                    mat, g, sol->mat,
+                    expressions_table,
+                    A, B, req, round);
+            timing_record(req->timing, "verification", sol->level, start);
+        }
+        diagnostics_end(req->diagnostics, round, sol->mat,
+                0, sol->optimality_flag);
+        if (c && !sol->optimality_flag)
+        {
+            c->level = level;
+            checkpoint_write(c, sol->mat, 0);
+        }
     }
+    sol->unresolved = dp_mat_count_unresolved(sol->mat);
+    return TKF91_SUCCESS;
 }
@@ -14,14 +14,14 @@ extern "C" {
 #endif
 
 
-void tkf91_dp_r(
+int tkf91_dp_r(
         solution_t, const request_t,
         fmpz_mat_t mat, expr_ptr * expressions_table,
         const tkf91_generator_indices_t g,
         const slong *A, size_t szA,
         const slong *B, size_t szB);
 
-void tkf91_dp_r_level(
+int tkf91_dp_r_level(
         slong level,
         solution_t sol, const request_t req,
         fmpz_mat_t mat, expr_ptr * expressions_table,
@@ -29,7 +29,30 @@ void tkf91_dp_r_level(
         const slong *A, size_t szA,
         const slong *B, size_t szB);
 
-void tkf91_dp_high(
+/*
+ * Set the log probability of the solution to the score of its traced
+ * alignment, evaluated in ball arithmetic at TKF91_DP_SCORE_LEVEL.
+ * The tableau-based solvers call this after their traceback, so their
+ * score is that of the reported path, also after an interrupted round;
+ * a solution without an alignment gets an indeterminate score.
+ */
+#define TKF91_DP_SCORE_LEVEL 8
+
+void tkf91_dp_score(
+        solution_t sol, const request_t req,
+        fmpz_mat_t mat, expr_ptr * expressions_table,
+        const tkf91_generator_indices_t g,
+        const slong *A, const slong *B);
+
+int tkf91_dp_high(
+        solution_t sol, const request_t req,
+        fmpz_mat_t mat, expr_ptr * expressions_table,
+        const tkf91_generator_indices_t g,
+        const slong *A, size_t szA,
+        const slong *B, size_t szB);
+
+int tkf91_dp_refine(
+        slong level,
         solution_t sol, const request_t req,
         fmpz_mat_t mat, expr_ptr * expressions_table,
         const tkf91_generator_indices_t g,
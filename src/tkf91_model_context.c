@@ -0,0 +1,336 @@
+#include "flint/flint.h"
+#include "flint/fmpz_mat.h"
+
+#include "arb.h"
+#include "arb_mat.h"
+
+#include "expressions.h"
+#include "rgenerators.h"
+#include "tkf91_rationals.h"
+#include "tkf91_rgenerators.h"
+#include "tkf91_generator_vecs.h"
+#include "tkf91_model_context.h"
+#include "hash.h"
+
+
+static void _compute_generator_logs(arb_mat_t res,
+        const fmpz_mat_t mat, expr_ptr * expressions_table, slong level);
+static void _cache_fit(tkf91_model_context_cache_t cache, slong len);
+static void _cache_evict(tkf91_model_context_cache_t cache, slong i);
+
+
+void
+_compute_generator_logs(arb_mat_t res,
+        const fmpz_mat_t mat, expr_ptr * expressions_table, slong level)
+{
+    slong i, nr, nc, prec;
+    arb_mat_t G, U;
+    arb_t x;
+
+    prec = 1 << level;
+
+    /* count the generators and expressions respectively */
+    nr = fmpz_mat_nrows(mat);
+    nc = fmpz_mat_ncols(mat);
+
+    /* initialize the arbitrary precision integer exponent matrix */
+    arb_mat_init(G, nr, nc);
+    arb_mat_set_fmpz_mat(G, mat);
+
+    /* compute logs of expressions to the specified precision */
+    arb_init(x);
+    arb_mat_init(U, nc, 1);
+    for (i = 0; i < nc; i++)
+    {
+        expr_eval(x, expressions_table[i], level);
+        arb_log(arb_mat_entry(U, i, 0), x, prec);
+    }
+    arb_clear(x);
+
+    /* compute logs of generators */
+    arb_mat_mul(res, G, U, prec);
+
+    arb_mat_clear(G);
+    arb_mat_clear(U);
+}
+
+
+void
+tkf91_model_context_init(tkf91_model_context_t ctx, const model_params_t p)
+{
+    tkf91_model_context_init_timing(ctx, p, NULL);
+}
+
+
+void
+tkf91_model_context_init_timing(tkf91_model_context_t ctx,
+        const model_params_t p, timing_ptr timing)
+{
+    tkf91_rationals_t r;
+    rgen_reg_ptr gr;
+    slong level, nr, nc;
+    timing_mark_t start;
+
+    timing_mark(timing, start);
+    ctx->key = model_params_hash(HASH_INIT, p);
+
+    /* expressions registry and (refining) generator registry */
+    reg_init(ctx->reg);
+    tkf91_rationals_init(r, p->lambda, p->mu, p->tau, p->pi);
+    tkf91_expressions_init(ctx->expressions, ctx->reg, r);
+    timing_record(timing, "setup_expressions", TIMING_NO_LEVEL, start);
+
+    timing_mark(timing, start);
+    gr = rgen_reg_new();
+    tkf91_rgenerators_init_all(ctx->generators, gr, r, ctx->expressions);
+    rgen_reg_finalize(gr, ctx->reg);
+    nr = rgen_reg_nrows(gr);
+    nc = rgen_reg_ncols(gr);
+    fmpz_mat_init(ctx->mat, nr, nc);
+    rgen_reg_get_matrix(ctx->mat, gr);
+    ctx->expressions_table = flint_malloc(FLINT_MAX(1, nc) * sizeof(expr_ptr));
+    rgen_reg_get_expressions(ctx->expressions_table, gr);
+
+    rgen_reg_clear(gr);
+    tkf91_rationals_clear(r);
+    timing_record(timing, "setup_generators", TIMING_NO_LEVEL, start);
+
+    timing_mark(timing, start);
+    expr_program_init(ctx->program, ctx->expressions_table, nc);
+    timing_record(timing, "setup_program", TIMING_NO_LEVEL, start);
+
+    /* the Hermite decomposition used by the symbolic verification */
+    timing_mark(timing, start);
+    fmpz_mat_init(ctx->H, nr, nc);
+    fmpz_mat_init(ctx->V, nr, nr);
+    _fmpz_mat_hnf_inverse_transform(ctx->H, ctx->V, &ctx->rank, ctx->mat);
+    timing_record(timing, "setup_hnf", TIMING_NO_LEVEL, start);
+
+    /* the expressions are only read from now on */
+    reg_freeze(ctx->reg, TKF91_MODEL_CONTEXT_MAX_LEVEL);
+
+    /* generator logs at each precision level */
+    for (level = 0; level <= TKF91_MODEL_CONTEXT_MAX_LEVEL; level++)
+    {
+        timing_mark(timing, start);
+        arb_mat_init(ctx->logs + level, nr, 1);
+        expr_program_eval_log_combinations(ctx->logs + level,
+                ctx->program, ctx->mat, level);
+        timing_record(timing, "setup_logs", level, start);
+    }
+}
+
+
+void
+tkf91_model_context_clear(tkf91_model_context_t ctx)
+{
+    slong level;
+
+    for (level = 0; level <= TKF91_MODEL_CONTEXT_MAX_LEVEL; level++)
+    {
+        arb_mat_clear(ctx->logs + level);
+    }
+    fmpz_mat_clear(ctx->H);
+    fmpz_mat_clear(ctx->V);
+    fmpz_mat_clear(ctx->mat);
+    expr_program_clear(ctx->program);
+    flint_free(ctx->expressions_table);
+
+    reg_clear(ctx->reg);
+    tkf91_expressions_clear(ctx->expressions);
+}
+
+
+const tkf91_generator_indices_struct *
+tkf91_model_context_generators(
+        tkf91_model_context_srcptr ctx,
+        const slong *A, slong szA,
+        const slong *B, slong szB)
+{
+    if (!szA || !szB)
+    {
+        return NULL;
+    }
+    return ctx->generators + A[0]*4 + B[0];
+}
+
+
+void
+tkf91_generator_logs(arb_mat_t res,
+        tkf91_model_context_srcptr ctx,
+        const fmpz_mat_t mat, expr_ptr * expressions_table, slong level)
+{
+    if (ctx && level >= 0 && level <= TKF91_MODEL_CONTEXT_MAX_LEVEL)
+    {
+        arb_mat_set(res, ctx->logs + level);
+    }
+    else if (ctx)
+    {
+        expr_program_eval_log_combinations(res, ctx->program, mat, level);
+    }
+    else
+    {
+        _compute_generator_logs(res, mat, expressions_table, level);
+    }
+}
+
+
+void
+tkf91_model_context_cache_init(tkf91_model_context_cache_t cache,
+        slong limit)
+{
+    cache->limit = FLINT_MAX(0, limit);
+    cache->alloc = 0;
+    cache->contexts = NULL;
+    cache->params = NULL;
+    cache->used = NULL;
+    cache->refs = NULL;
+    cache->len = 0;
+    cache->clock = 0;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->evictions = 0;
+    _cache_fit(cache, cache->limit ? cache->limit : 4);
+}
+
+void
+tkf91_model_context_cache_clear(tkf91_model_context_cache_t cache)
+{
+    slong i;
+    for (i = 0; i < cache->len; i++)
+    {
+        tkf91_model_context_clear(cache->contexts[i]);
+        flint_free(cache->contexts[i]);
+    }
+    for (i = 0; i < cache->alloc; i++)
+    {
+        model_params_clear(cache->params + i);
+    }
+    flint_free(cache->contexts);
+    flint_free(cache->params);
+    flint_free(cache->used);
+    flint_free(cache->refs);
+}
+
+void
+_cache_fit(tkf91_model_context_cache_t cache, slong len)
+{
+    slong i, alloc;
+
+    if (len <= cache->alloc)
+    {
+        return;
+    }
+    alloc = FLINT_MAX(len, 2 * cache->alloc);
+    cache->contexts = flint_realloc(cache->contexts,
+            alloc * sizeof(tkf91_model_context_ptr));
+    cache->params = flint_realloc(cache->params,
+            alloc * sizeof(model_params_struct));
+    cache->used = flint_realloc(cache->used, alloc * sizeof(ulong));
+    cache->refs = flint_realloc(cache->refs, alloc * sizeof(slong));
+    for (i = cache->alloc; i < alloc; i++)
+    {
+        model_params_init(cache->params + i);
+    }
+    cache->alloc = alloc;
+}
+
+void
+_cache_evict(tkf91_model_context_cache_t cache, slong i)
+{
+    slong last;
+    tkf91_model_context_ptr ctx;
+    model_params_struct tmp;
+
+    tkf91_model_context_clear(cache->contexts[i]);
+    flint_free(cache->contexts[i]);
+
+    /* move the last entry into the hole, keeping the params allocated */
+    last = cache->len - 1;
+    ctx = cache->contexts[last];
+    cache->contexts[i] = ctx;
+    tmp = cache->params[i];
+    cache->params[i] = cache->params[last];
+    cache->params[last] = tmp;
+    cache->used[i] = cache->used[last];
+    cache->refs[i] = cache->refs[last];
+    cache->len--;
+    cache->evictions++;
+}
+
+tkf91_model_context_ptr
+tkf91_model_context_cache_get(
+        tkf91_model_context_cache_t cache, const model_params_t p)
+{
+    slong i, victim;
+    uint64_t key;
+
+    key = model_params_hash(HASH_INIT, p);
+    cache->clock++;
+
+    for (i = 0; i < cache->len; i++)
+    {
+        if (cache->contexts[i]->key == key &&
+            model_params_equal(cache->params + i, p))
+        {
+            cache->used[i] = cache->clock;
+            cache->refs[i]++;
+            cache->hits++;
+            return cache->contexts[i];
+        }
+    }
+
+    /* make room by evicting the least recently used idle context */
+    if (cache->limit && cache->len >= cache->limit)
+    {
+        victim = -1;
+        for (i = 0; i < cache->len; i++)
+        {
+            if (!cache->refs[i] &&
+                (victim < 0 || cache->used[i] < cache->used[victim]))
+            {
+                victim = i;
+            }
+        }
+        if (victim >= 0)
+        {
+            _cache_evict(cache, victim);
+        }
+    }
+
+    /* the cache goes over its limit only while every context is in use */
+    _cache_fit(cache, cache->len + 1);
+    i = cache->len;
+    cache->contexts[i] = flint_malloc(sizeof(tkf91_model_context_struct));
+    tkf91_model_context_init(cache->contexts[i], p);
+    model_params_set(cache->params + i, p);
+    cache->used[i] = cache->clock;
+    cache->refs[i] = 1;
+    cache->len++;
+    cache->misses++;
+
+    return cache->contexts[i];
+}
+
+void
+tkf91_model_context_cache_release(tkf91_model_context_cache_t cache,
+        tkf91_model_context_srcptr ctx)
+{
+    slong i;
+
+    for (i = 0; i < cache->len; i++)
+    {
+        if (cache->contexts[i] == ctx)
+        {
+            cache->refs[i]--;
+            if (!cache->refs[i] && cache->limit && cache->len > cache->limit)
+            {
+                _cache_evict(cache, i);
+            }
+            return;
+        }
+    }
+    flint_printf("tkf91_model_context_cache_release: "
+            "the context is not in the cache\n");
+    abort();
+}
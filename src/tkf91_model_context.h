@@ -0,0 +1,127 @@
+#ifndef TKF91_MODEL_CONTEXT_H
+#define TKF91_MODEL_CONTEXT_H
+
+/*
+ * A compiled tkf91 model context holds everything that the
+ * dynamic programming solvers need which depends only on the
+ * model parameters, so that it can be built once and reused
+ * for every pair of sequences aligned with those parameters.
+ *
+ * The generator matrix includes the generators for every pair of
+ * first sequence characters, and the generator logs are precomputed
+ * at each precision level up to TKF91_MODEL_CONTEXT_MAX_LEVEL.
+ * The expressions are compiled into a flat evaluation program,
+ * which is used for the generator logs at higher levels.
+ * The caches of the expressions are frozen at the highest of those levels.
+ * After initialization the context is only read,
+ * so it may be shared by concurrent solvers.
+ */
+
+#include <stdint.h>
+
+#include "flint/flint.h"
+#include "flint/fmpz_mat.h"
+#include "arb_mat.h"
+
+#include "femtocas.h"
+#include "expressions.h"
+#include "expr_program.h"
+#include "model_params.h"
+#include "tkf91_generator_indices.h"
+#include "timing.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define TKF91_MODEL_CONTEXT_MAX_LEVEL 10
+
+typedef struct tkf91_model_context_struct_tag
+{
+    uint64_t key;
+    reg_t reg;
+    tkf91_expressions_t expressions;
+    expr_ptr * expressions_table;
+    expr_program_t program;
+    fmpz_mat_t mat;
+    tkf91_generator_indices_struct generators[16];
+    fmpz_mat_t H;
+    fmpz_mat_t V;
+    slong rank;
+    arb_mat_struct logs[TKF91_MODEL_CONTEXT_MAX_LEVEL + 1];
+} tkf91_model_context_struct;
+typedef tkf91_model_context_struct tkf91_model_context_t[1];
+typedef tkf91_model_context_struct * tkf91_model_context_ptr;
+typedef const tkf91_model_context_struct * tkf91_model_context_srcptr;
+
+void tkf91_model_context_init(tkf91_model_context_t ctx,
+        const model_params_t p);
+
+/* as above, recording the setup steps into the timing collector */
+void tkf91_model_context_init_timing(tkf91_model_context_t ctx,
+        const model_params_t p, timing_ptr timing);
+void tkf91_model_context_clear(tkf91_model_context_t ctx);
+
+/*
+ * The generator indices for sequences with the given first characters,
+ * or NULL if either sequence is empty.
+ */
+const tkf91_generator_indices_struct * tkf91_model_context_generators(
+        tkf91_model_context_srcptr ctx,
+        const slong *A, slong szA,
+        const slong *B, slong szB);
+
+/*
+ * Set the (#generators x 1) matrix res to the generator logs at the
+ * given precision level. If the context is not NULL then its logs are
+ * copied, or computed by its evaluation program if the level is higher
+ * than the precomputed levels; otherwise the expressions are evaluated.
+ */
+void tkf91_generator_logs(arb_mat_t res,
+        tkf91_model_context_srcptr ctx,
+        const fmpz_mat_t mat, expr_ptr * expressions_table, slong level);
+
+
+/*
+ * A small cache of model contexts keyed by the model parameters,
+ * for drivers that align many sequence pairs with few distinct
+ * parameter sets. A context returned by the cache is referenced until
+ * it is given back with tkf91_model_context_cache_release, and only
+ * contexts that are not referenced are evicted. When a new context
+ * does not fit within the limit, the least recently used context that
+ * is not referenced is evicted; if every context is referenced the cache
+ * goes over its limit, and shrinks back as the contexts are released.
+ * A cache with limit 0 never evicts. The cache itself is not thread-safe.
+ */
+typedef struct
+{
+    tkf91_model_context_ptr * contexts;
+    model_params_struct * params;
+    ulong * used;
+    slong * refs;
+    slong len;
+    slong alloc;
+    slong limit;
+    ulong clock;
+    slong hits;
+    slong misses;
+    slong evictions;
+} tkf91_model_context_cache_struct;
+typedef tkf91_model_context_cache_struct tkf91_model_context_cache_t[1];
+typedef tkf91_model_context_cache_struct * tkf91_model_context_cache_ptr;
+
+void tkf91_model_context_cache_init(tkf91_model_context_cache_t cache,
+        slong limit);
+void tkf91_model_context_cache_clear(tkf91_model_context_cache_t cache);
+tkf91_model_context_ptr tkf91_model_context_cache_get(
+        tkf91_model_context_cache_t cache, const model_params_t p);
+void tkf91_model_context_cache_release(tkf91_model_context_cache_t cache,
+        tkf91_model_context_srcptr ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
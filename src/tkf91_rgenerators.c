@@ -75,6 +75,44 @@ void rgen_add_p1_bar(rgen_reg_ptr g,
 
 
 
+static void _add_m0_10(slong *pidx, rgen_reg_ptr g,
+        tkf91_rationals_ptr r, tkf91_expressions_ptr p, slong a);
+static void _add_m2_01(slong *pidx, rgen_reg_ptr g,
+        tkf91_rationals_ptr r, tkf91_expressions_ptr p, slong b);
+static void _rgenerators_init(
+        tkf91_generator_indices_t x,
+        rgen_reg_ptr g,
+        tkf91_rationals_t r,
+        tkf91_expressions_t p,
+        slong a, slong b);
+
+
+void
+_add_m0_10(slong *pidx, rgen_reg_ptr g,
+        tkf91_rationals_ptr r, tkf91_expressions_ptr p, slong a)
+{
+    /* M0(1, 0) = gamma_1 * zeta_1 * pi_{A_1} * \bar{p0} */
+    rgen_open(g, pidx);
+    rgen_add_gamma_1(g, r, p, 1);
+    rgen_add_zeta_1(g, r, p, 1);
+    rgen_add_fmpq(g, r->pi+a, 1);
+    rgen_add_p0_bar(g, r, p, 1);
+    rgen_close(g);
+}
+
+void
+_add_m2_01(slong *pidx, rgen_reg_ptr g,
+        tkf91_rationals_ptr r, tkf91_expressions_ptr p, slong b)
+{
+    /* M2(0, 1) = gamma_0 * zeta_2 * pi_{B_1} */
+    rgen_open(g, pidx);
+    rgen_add_gamma_0(g, r, p, 1);
+    rgen_add_zeta_2(g, r, p, 1);
+    rgen_add_fmpq(g, r->pi+b, 1);
+    rgen_close(g);
+}
+
+
 void
 tkf91_rgenerators_init(
         tkf91_generator_indices_t x,
@@ -83,6 +121,66 @@ tkf91_rgenerators_init(
         tkf91_expressions_t p,
         const slong *A, slong Alen,
         const slong *B, slong Blen)
+{
+    if (!Alen || !Blen)
+    {
+        flint_printf("expected both sequences to have length at least 1\n");
+        abort();
+    }
+    _rgenerators_init(x, g, r, p, A[0], B[0]);
+}
+
+
+void
+tkf91_rgenerators_init_all(
+        tkf91_generator_indices_struct *x,
+        rgen_reg_ptr g,
+        tkf91_rationals_t r,
+        tkf91_expressions_t p)
+{
+    /*
+     * Only the M0(1, 0) and M2(0, 1) generators depend on the sequences,
+     * through their first characters, so the other generators are shared.
+     * The generators for the first pair of nucleotides are added
+     * as usual, and the remaining entries of the array of 16 index
+     * structures differ only in their M0(1, 0) and M2(0, 1) rows.
+     */
+    slong a, b;
+    slong m0_10[4];
+    slong m2_01[4];
+
+    _rgenerators_init(x, g, r, p, 0, 0);
+
+    m0_10[0] = x->m0_10;
+    m2_01[0] = x->m2_01;
+    for (a = 1; a < 4; a++)
+    {
+        _add_m0_10(m0_10+a, g, r, p, a);
+    }
+    for (b = 1; b < 4; b++)
+    {
+        _add_m2_01(m2_01+b, g, r, p, b);
+    }
+
+    for (a = 0; a < 4; a++)
+    {
+        for (b = 0; b < 4; b++)
+        {
+            x[a*4+b] = x[0];
+            x[a*4+b].m0_10 = m0_10[a];
+            x[a*4+b].m2_01 = m2_01[b];
+        }
+    }
+}
+
+
+void
+_rgenerators_init(
+        tkf91_generator_indices_t x,
+        rgen_reg_ptr g,
+        tkf91_rationals_t r,
+        tkf91_expressions_t p,
+        slong a, slong b)
 {
     /*
      * The linear integer combinations defining the generators themselves
@@ -94,12 +192,6 @@ tkf91_rgenerators_init(
      */
     slong i, j;
 
-    if (!Alen || !Blen)
-    {
-        flint_printf("expected both sequences to have length at least 1\n");
-        abort();
-    }
-
     /* M1(0, 0) = gamma_0 * zeta_1 */
     rgen_open(g, &(x->m1_00));
     rgen_add_gamma_0(g, r, p, 1);
@@ -108,12 +200,7 @@ tkf91_rgenerators_init(
 
     /* M0(1, 0) = gamma_1 * zeta_1 * pi_{A_1} * \bar{p0} */
     /* Note that this depends on the first character of the first sequence. */
-    rgen_open(g, &(x->m0_10));
-    rgen_add_gamma_1(g, r, p, 1);
-    rgen_add_zeta_1(g, r, p, 1);
-    rgen_add_fmpq(g, r->pi+A[0], 1);
-    rgen_add_p0_bar(g, r, p, 1);
-    rgen_close(g);
+    _add_m0_10(&(x->m0_10), g, r, p, a);
 
     /* M0(i>1, 0) = pi_{A_i} * (...) * M0(i-1, 0) */
     /* There are four of these generators, one for each nucleotide. */
@@ -130,11 +217,7 @@ tkf91_rgenerators_init(
 
     /* M2(0, 1) = gamma_0 * zeta_2 * pi_{B_1} */
     /* Note that this depends on the first character of the second sequence. */
-    rgen_open(g, &(x->m2_01));
-    rgen_add_gamma_0(g, r, p, 1);
-    rgen_add_zeta_2(g, r, p, 1);
-    rgen_add_fmpq(g, r->pi+B[0], 1);
-    rgen_close(g);
+    _add_m2_01(&(x->m2_01), g, r, p, b);
 
     /* M2(0, j>1) = pi_{B_i} * (...) * M2(0, i-1) */
     /* There are four of these generators, one for each nucleotide. */
@@ -18,6 +18,15 @@ void tkf91_rgenerators_init(
         tkf91_expressions_t p,
         const slong *A, slong Alen,
         const slong *B, slong Blen);
+/*
+ * Add the generators for every pair of first sequence characters,
+ * filling an array of 16 index structures indexed by 4*A[0] + B[0].
+ */
+void tkf91_rgenerators_init_all(
+        tkf91_generator_indices_struct *x,
+        rgen_reg_ptr g,
+        tkf91_rationals_t r,
+        tkf91_expressions_t p);
 void tkf91_rgenerators_clear(tkf91_generator_indices_t x);
 
 #ifdef __cplusplus
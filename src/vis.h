@@ -2,6 +2,7 @@
 #define VIS_H
 
 #include "dp.h"
+#include "diagnostics.h"
 
 
 #ifdef __cplusplus
@@ -15,6 +16,15 @@ int write_tableau_image(const char * filename,
 int write_simple_tableau_image(const char * filename,
         dp_mat_t mat, const char * title);
 
+/*
+ * A heatmap of the rounds after which each cell of the tableau was
+ * still unresolved, from the map kept by the diagnostics of its solve,
+ * with the recorded consensus failures in black and the cells of
+ * the final traceback that were never unresolved in blue.
+ */
+int write_unresolved_image(const char * filename,
+        dp_mat_t mat, const diagnostics_t d, const char * title);
+
 
 #ifdef __cplusplus
 }